@@ -0,0 +1,50 @@
+#ifndef ADC_ACQUISITION_H
+#define ADC_ACQUISITION_H
+
+#include "main.h"
+
+// Dual regular simultaneous mode: ADC1 scans one rank per cell, then the on-board thermistors,
+// while ADC2 converts the current shunt at every rank. Each voltage therefore has a current
+// sample taken in the same sampling window.
+#define ADC_ACQ_NUM_CELL_CHANNELS 6
+#define ADC_ACQ_NUM_NTC_CHANNELS  1
+#define ADC_ACQ_FIRST_NTC_RANK    ADC_ACQ_NUM_CELL_CHANNELS
+#define ADC_ACQ_NUM_RANKS         (ADC_ACQ_FIRST_NTC_RANK + ADC_ACQ_NUM_NTC_CHANNELS)
+
+// DMA mode 2 stores each rank as one word, ADC1 in the low half and ADC2 in the high half, so
+// a sweep is ADC_ACQ_NUM_CHANNELS halfwords: the ADC1 rank, then the current sampled with it
+#define ADC_ACQ_NUM_CHANNELS          (2 * ADC_ACQ_NUM_RANKS)
+#define ADC_ACQ_RANK_CHANNEL(rank)    (2U * (rank))
+#define ADC_ACQ_CURRENT_CHANNEL(rank) (2U * (rank) + 1U)
+
+// Each half of the DMA buffer holds up to this many complete scan sweeps
+#define ADC_ACQ_MAX_SWEEPS_PER_BLOCK 100
+#define ADC_ACQ_MAX_BLOCK_SIZE       (ADC_ACQ_NUM_CHANNELS * ADC_ACQ_MAX_SWEEPS_PER_BLOCK)
+
+// A block of raw samples, sweep-major: samples[sweep * ADC_ACQ_NUM_CHANNELS + channel]
+typedef struct {
+    const uint16_t *samples;
+    uint32_t sequence;   // Incremented for every block the DMA completes
+    uint32_t timestamp;  // Cycle counter when the block completed
+    uint16_t sweeps;     // Number of scan sweeps in the block
+} AdcBlock;
+
+// Called from the DMA interrupt each time a half buffer has been filled
+typedef void (*AdcBlockReadyCallback)(const AdcBlock *block);
+
+extern ADC_HandleTypeDef hadc1;
+extern ADC_HandleTypeDef hadc2;
+extern const uint32_t adcScanChannels[ADC_ACQ_NUM_RANKS];
+extern const uint32_t adcCurrentChannel;
+
+HAL_StatusTypeDef adcAcquisitionInit(void);
+HAL_StatusTypeDef adcAcquisitionSetSweepsPerBlock(uint16_t sweeps);
+HAL_StatusTypeDef adcAcquisitionStart(void);
+void adcAcquisitionStop(void);
+void adcAcquisitionRegisterCallback(AdcBlockReadyCallback callback);
+uint8_t adcAcquisitionGetLatestBlock(AdcBlock *block);
+uint8_t adcAcquisitionReleaseBlock(const AdcBlock *block);
+void adcAcquisitionAverageBlock(const AdcBlock *block, uint16_t average[ADC_ACQ_NUM_CHANNELS]);
+uint32_t adcAcquisitionGetOverruns(void);
+
+#endif /* ADC_ACQUISITION_H */
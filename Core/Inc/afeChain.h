@@ -0,0 +1,58 @@
+#ifndef AFE_CHAIN_H
+#define AFE_CHAIN_H
+
+#include "main.h"
+#include "packConfig.h"
+
+// LTC681x command codes (broadcast, all devices respond in chain order)
+#define AFE_CMD_WRCFGA  0x0001U
+#define AFE_CMD_RDCFGA  0x0002U
+#define AFE_CMD_RDCVA   0x0004U
+#define AFE_CMD_RDCVB   0x0006U
+#define AFE_CMD_RDCVC   0x0008U
+#define AFE_CMD_RDCVD   0x000AU
+#define AFE_CMD_RDAUXA  0x000CU
+#define AFE_CMD_RDAUXB  0x000EU
+#define AFE_CMD_ADCV    0x0360U   // Normal mode (7 kHz), discharge off during conversion, all cells
+#define AFE_CMD_ADAX    0x0560U   // Normal mode (7 kHz), GPIO1-5 and VREF2
+
+#define AFE_REGISTER_BYTES     6
+#define AFE_PEC_BYTES          2
+#define AFE_CELLS_PER_GROUP    3
+#define AFE_NUM_CELL_GROUPS    (AFE_CELLS_PER_DEVICE / AFE_CELLS_PER_GROUP)
+#define AFE_CELL_LSB_VOLTS     0.0001f
+#define AFE_AUX_PER_GROUP      3
+#define AFE_NUM_AUX_GROUPS     2
+#define AFE_AUX_REGISTERS      (AFE_AUX_PER_GROUP * AFE_NUM_AUX_GROUPS)
+#define AFE_AUX_REF2_INDEX     5         // RDAUXB holds GPIO4, GPIO5, VREF2
+
+// Scans run on their own period, not per sample block: a 144S scan takes about 11.4 ms,
+// longer than the 10 ms block. The voltage stage hands on the last completed scan.
+#define AFE_SCAN_PERIOD_MS     20U
+#define AFE_AUX_SCAN_INTERVAL  50U       // Cell scans per thermistor scan, ~1 s
+
+#define AFE_CONVERSION_TIME_MS 3U     // ADCV at 7 kHz takes 2.3 ms for all cells
+#define AFE_WAKE_TIME_US       300U   // tWAKE, sleep to standby, per device
+#define AFE_TRANSFER_TIMEOUT_MS 5U
+
+typedef struct {
+    uint32_t scans;
+    uint32_t pecErrors;          // Register groups rejected, all devices
+    uint32_t timeouts;
+    uint32_t lastScanCycles;     // Wake-up to last group decoded
+    uint32_t worstScanCycles;
+    uint32_t devicePecErrors[AFE_NUM_DEVICES];
+    uint16_t deviceStaleScans[AFE_NUM_DEVICES];  // Consecutive scans without all four cell groups
+} AfeChainStats;
+
+extern SPI_HandleTypeDef hspi2;
+
+HAL_StatusTypeDef afeChainInit(void);
+HAL_StatusTypeDef afeChainMeasureCells(float voltages[PACK_NUM_CELLS]);
+void afeChainSetDischarge(uint8_t cell, uint8_t enable);
+uint32_t afeChainGetCellVoltages(float voltages[PACK_NUM_CELLS]);
+void afeChainGetThermistorCodes(uint16_t codes[AFE_NUM_DEVICES * AFE_THERMISTORS_PER_DEVICE]);
+void afeChainGetStats(AfeChainStats *stats);
+uint16_t afeChainGetStaleScans(void);
+
+#endif /* AFE_CHAIN_H */
@@ -0,0 +1,37 @@
+#ifndef BALANCING_PLANNER_H
+#define BALANCING_PLANNER_H
+
+#include "main.h"
+#include "packConfig.h"
+
+#define BALANCE_BLEED_RESISTOR_OHM   33.0f    // Per-cell bleed resistor, ~110 mA at 3.7 V
+#define BALANCE_START_MAH            10.0f    // Excess charge that puts a cell into the plan
+#define BALANCE_STOP_MAH             2.0f     // A planned cell stays in until its excess drops below this
+#define BALANCE_REPLAN_MS            60000U   // Excess is re-estimated this often; durations count down in between
+#define BALANCE_MAX_TEMPERATURE_C    45.0f    // Hottest sensor above this pauses all bleeding
+#define BALANCE_RESUME_TEMPERATURE_C 40.0f
+#define BALANCE_GROUP_POWER_W        1.5f     // Bleed power one group of resistors may dissipate together
+
+// Cells whose resistors share a board: one AFE module, or the whole 6S bench pack
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+#define BALANCE_GROUP_CELLS AFE_CELLS_PER_DEVICE
+#else
+#define BALANCE_GROUP_CELLS PACK_NUM_CELLS
+#endif
+
+typedef struct {
+    uint32_t remainingMs[PACK_NUM_CELLS];   // Bleed time each cell is still owed
+    uint8_t active[PACK_NUM_CELLS];         // Resistor state after the last step
+    uint32_t sinceReplanMs;
+    uint8_t thermalPause;
+    float dissipatedJoules;
+} BalancingPlanner;
+
+void balancingPlannerInit(BalancingPlanner *planner);
+uint8_t balancingPlannerReplanDue(const BalancingPlanner *planner);
+void balancingPlannerReplan(BalancingPlanner *planner, const float soc[PACK_NUM_CELLS],
+                            const float capacityMah[PACK_NUM_CELLS], const float voltages[PACK_NUM_CELLS]);
+uint8_t balancingPlannerStep(BalancingPlanner *planner, const float voltages[PACK_NUM_CELLS],
+                             const float *duty, float hottest, uint32_t elapsedMs);
+
+#endif /* BALANCING_PLANNER_H */
@@ -0,0 +1,26 @@
+#ifndef BALANCING_PWM_H
+#define BALANCING_PWM_H
+
+#include "main.h"
+#include "packConfig.h"
+
+// Each bleed MOSFET on PB0-PB5 is driven by a PWM channel of TIM2 or TIM3. Both timers are
+// reset by every TIM8 trigger, so each period starts with the outputs off for
+// BALANCE_PWM_BLANK_US while the ADC sweeps the cells. Bench pack (ADC cell source) only.
+#define BALANCE_PWM_NUM_CHANNELS    ADC_ACQ_NUM_CELL_CHANNELS
+#define BALANCE_PWM_BLANK_US        80U      // 7 dual-mode ranks x 156 ADC clocks at 22.5 MHz, plus input filter settling
+#define BALANCE_PWM_FULL_DELTA_V    0.05f    // Cells this far above the lowest get the full duty
+#define BALANCE_PWM_MIN_DUTY        0.25f    // Smallest duty a planned cell is given
+#define BALANCE_PWM_DERATE_START_C  35.0f    // Duty falls linearly to zero at BALANCE_MAX_TEMPERATURE_C
+#define BALANCE_PWM_DUTY_STEPS      16U      // Duty resolution; smaller changes are not written
+
+extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+
+// Call again after samplingSchedulerInit() changes the rate
+HAL_StatusTypeDef balancingPwmInit(uint32_t sampleRateHz);
+float balancingPwmComputeDuty(float delta, float temperature);
+void balancingPwmSetDuty(uint8_t cell, float duty);
+float balancingPwmGetMaxDuty(void);
+
+#endif /* BALANCING_PWM_H */
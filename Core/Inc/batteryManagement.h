@@ -2,49 +2,61 @@
 #define BATTERY_MANAGEMENT_H
 
 #include "main.h"
+#include "adcAcquisition.h"
+#include "packConfig.h"
+#include "packModel.h"
+#include "canReceive.h"
 
-#define NUM_CELLS 6
+#define NUM_CELLS PACK_NUM_CELLS
 #define MAX_CELL_VOLTAGE 4.2f
 #define MIN_CELL_VOLTAGE 3.0f
 #define MAX_SAFE_TEMPERATURE 60.0f
+#define MAX_CHARGE_CURRENT 50.0f
+#define MAX_CELL_VOLTAGE_SPREAD 0.2f
 
+// Protection state as a bitmask, the layout broadcast in the 0x104 telemetry frame
+#define SAFETY_FLAG_OVERVOLTAGE     (1U << 0)
+#define SAFETY_FLAG_OVERTEMPERATURE (1U << 1)
+#define SAFETY_FLAG_OVERCURRENT     (1U << 2)
+#define SAFETY_FLAG_UNDERVOLTAGE    (1U << 3)
 
-typedef struct {
-    float voltage;
-    uint8_t channel;  // ADC channel for each cell
-} BatteryCell;
+// Byte 0 of the 0x200 command frame
+#define BMS_COMMAND_REARM_OVERCURRENT (1U << 0)
+#define BMS_COMMAND_CLEAR_FAULTS      (1U << 1)
 
-// Struct to represent the entire battery pack
-typedef struct {
-    BatteryCell cells[NUM_CELLS];  // Array of battery cells
-    float totalVoltage;
-    float averageVoltage;
-    float current;
-    float temperature;
-} BatteryPack;
+typedef enum {
+    STATUS_OK,
+    STATUS_ERROR,
+    STATUS_TIMEOUT,
+    STATUS_INVALID_PARAM
+} status_t;
 
-// Safety state
-typedef struct {
-    uint8_t overVoltageProtection;  // Flag for overvoltage protection
-    uint8_t overTempProtection;     // Flag for overtemperature protection
-} BatterySafety;
-
-// Global variables for battery and safety states
-BatteryPack batteryPack;
-BatterySafety batterySafety;
+// Global battery state, written only by the safety stage; fault state lives in faultManager
+extern BatteryPack batteryPack;
 
 extern ADC_HandleTypeDef hadc1;
-extern I2C_HandleTypeDef hi2c1;
 
 // Function Prototypes
+void batteryPackInit(void);
 void chargeControlInit(void);
 void enableCharging(void);
 void disableCharging(void);
 void enableDischarging(void);
 void disableDischarging(void);
-float readBatteryVoltage(void);
-float readBatteryCurrent(void);
-float readBatteryTemperature(void);
+status_t readCellVoltages(const AdcBlock *block, float voltages[NUM_CELLS]);
+uint16_t readCellVoltageStaleScans(void);
+uint32_t readCellVoltageCount(void);
+void updateBatteryPackVoltages(const float voltages[NUM_CELLS], uint16_t staleScans);
+void updateBatteryPackTemperatures(const float temperatures[PACK_NUM_TEMPERATURES],
+                                   const uint8_t lost[PACK_NUM_TEMPERATURES]);
+status_t readBlockCurrent(const AdcBlock *block, float *current);
+status_t readBatteryCurrent(float *current);
+status_t readSynchronizedSamples(const AdcBlock *block, float voltages[NUM_CELLS], float currents[NUM_CELLS]);
+status_t readThermistorTemperatures(float temperatures[PACK_NUM_THERMISTORS]);
 float estimateSoc(void);
+void checkSafety(void);
+void controlCharging(float soc);
+uint8_t getSafetyFlags(void);
+void handleBmsCommand(const CanRxFrame *frame);
 
 #endif /* BATTERY_MANAGEMENT_H */
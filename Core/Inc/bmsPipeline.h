@@ -0,0 +1,34 @@
+#ifndef BMS_PIPELINE_H
+#define BMS_PIPELINE_H
+
+#include "main.h"
+
+#define PIPELINE_SAFETY_DEADLINE_US     1000U  // Sample block completion to protective action
+#define PIPELINE_TEMPERATURE_PERIOD_MS  1000U
+#define PIPELINE_BALANCING_PERIOD_MS    1000U
+#define PIPELINE_CAN_PERIOD_MS          10U    // Telemetry tick; per-message rates live in canTelemetryTable.h
+#define PIPELINE_EVENT_LOG_PERIOD_MS    100U
+
+typedef enum {
+    STAGE_VOLTAGE,
+    STAGE_CURRENT,
+    STAGE_TEMPERATURE,
+    STAGE_SAFETY,
+    STAGE_BALANCING,
+    STAGE_CAN,
+    STAGE_EVENT_LOG,
+    STAGE_CELL_SCAN,           // AFE builds only: the chain scan, against AFE_SCAN_PERIOD_MS
+    PIPELINE_NUM_STAGES
+} PipelineStage;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t deadlineMisses;
+    uint32_t worstCaseCycles;  // Longest observed time measured against the stage deadline
+    uint32_t droppedMessages;  // Outputs that did not fit in the downstream buffer
+} PipelineStageStats;
+
+void bmsPipelineInit(void);
+void bmsPipelineGetStats(PipelineStage stage, PipelineStageStats *stats);
+
+#endif /* BMS_PIPELINE_H */
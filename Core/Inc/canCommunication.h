@@ -3,8 +3,39 @@
 
 #include "main.h"
 #include "stm32f4xx_hal_can.h"
+#include "batteryManagement.h"
+
+// Frames wait here when all three bxCAN mailboxes are busy
+#define CAN_TX_QUEUE_DEPTH 16
+
+typedef enum {
+    CAN_STATUS_OK,
+    CAN_STATUS_ERROR,
+    CAN_STATUS_NO_MAILBOX,
+    CAN_STATUS_TIMEOUT,
+    CAN_STATUS_QUEUE_FULL,
+} can_status_t;
+
+// Queues are drained highest priority first whenever a mailbox frees up
+typedef enum {
+    CAN_TX_PRIORITY_HIGH,     // Faults and protection state
+    CAN_TX_PRIORITY_NORMAL,   // Periodic pack telemetry
+    CAN_TX_PRIORITY_LOW,      // Per-cell detail and diagnostics
+    CAN_TX_NUM_PRIORITIES
+} CanTxPriority;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;       // Rejected because the queue was full
+    uint16_t depth;
+    uint16_t peakDepth;
+} CanTxQueueStats;
 
 // CAN communication function prototypes
-void canTransmitBmsData(void);
+can_status_t canInit(void);
+can_status_t canTransmitMessage(uint32_t id, const uint8_t *data, uint8_t length, CanTxPriority priority);
+can_status_t canTransmitExtendedMessage(uint32_t id, const uint8_t *data, uint8_t length, CanTxPriority priority);
+void canGetTxQueueStats(CanTxPriority priority, CanTxQueueStats *stats);
 
 #endif /* CAN_COMMUNICATION_H */
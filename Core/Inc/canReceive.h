@@ -0,0 +1,61 @@
+#ifndef CAN_RECEIVE_H
+#define CAN_RECEIVE_H
+
+#include "main.h"
+#include "canReceiveTable.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Slots per FIFO; a power of two so the free-running indices wrap cleanly
+#define CAN_RX_POOL_DEPTH      16U
+
+// CAN1 owns banks 0-13; CAN2 starts at 14
+#define CAN_RX_FILTER_BANKS    14U
+
+// Shortest frame at 1 Mbit/s: standard ID, no data, plus interframe space. An ISR that
+// takes longer than this per frame cannot keep up with a fully loaded bus.
+#define CAN_RX_MIN_FRAME_US    47U
+
+typedef enum {
+    CAN_RX_PRIORITY_HIGH,   // FIFO0
+    CAN_RX_PRIORITY_LOW,    // FIFO1
+    CAN_RX_NUM_PRIORITIES
+} CanRxPriority;
+
+#define CAN_RX_HANDLER_ENUM(name, id, mask, extended, priority, handler) CAN_RX_##name,
+typedef enum {
+    CAN_RX_HANDLERS(CAN_RX_HANDLER_ENUM)
+    CAN_RX_NUM_HANDLERS
+} CanRxHandlerId;
+#undef CAN_RX_HANDLER_ENUM
+
+// A pool slot, filled by the ISR straight from the FIFO mailbox. Handlers get it by
+// reference and must not keep the pointer: the slot is reused once they return.
+typedef struct {
+    CAN_RxHeaderTypeDef header;
+    uint8_t data[8];
+    uint32_t timestamp;     // Cycle counter at IRQ entry
+} CanRxFrame;
+
+typedef void (*CanRxHandler)(const CanRxFrame *frame);
+
+typedef struct {
+    uint32_t received;
+    uint32_t dropped;          // Pool full; the frame was read out and discarded
+    uint32_t overruns;         // Hardware FIFO overflowed before the ISR ran
+    uint32_t unmatched;        // Filter index with no table entry
+    uint16_t peakDepth;
+    uint32_t lastIsrCycles;    // Per frame, IRQ entry to enqueue
+    uint32_t worstIsrCycles;
+    uint32_t overBudget;       // Frames whose ISR took longer than CAN_RX_MIN_FRAME_US
+} CanRxStats;
+
+extern CAN_HandleTypeDef hcan1;
+extern volatile uint32_t canRxIrqEntryCycles;
+
+HAL_StatusTypeDef canReceiveInit(void);
+void canReceiveSubscribe(TaskHandle_t task);
+void canReceiveDispatch(TickType_t timeout);
+void canReceiveGetStats(CanRxPriority priority, CanRxStats *stats);
+
+#endif /* CAN_RECEIVE_H */
@@ -0,0 +1,15 @@
+#ifndef CAN_RECEIVE_TABLE_H
+#define CAN_RECEIVE_TABLE_H
+
+// Every frame the BMS listens to. Each entry gets one 32-bit mask filter bank, so anything
+// not listed here is dropped by the bxCAN hardware and never raises an interrupt.
+// HIGH entries land in FIFO0 and are dispatched before anything waiting in FIFO1.
+
+// X(name, id, mask, extended, priority, handler)
+#define CAN_RX_HANDLERS(X) \
+    X(BmsCommand,      0x200,      0x7FF,      0, CAN_RX_PRIORITY_HIGH, handleBmsCommand) \
+    X(TelemetryConfig, 0x201,      0x7FF,      0, CAN_RX_PRIORITY_LOW,  canTelemetryHandleConfig) \
+    X(EventLogReadout, 0x202,      0x7FF,      0, CAN_RX_PRIORITY_LOW,  eventLogHandleReadout) \
+    X(ChargerStatus,   0x18FF50E5, 0x1FFFFFFF, 1, CAN_RX_PRIORITY_LOW,  chargeControllerHandleStatus)
+
+#endif /* CAN_RECEIVE_TABLE_H */
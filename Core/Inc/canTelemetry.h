@@ -0,0 +1,25 @@
+#ifndef CAN_TELEMETRY_H
+#define CAN_TELEMETRY_H
+
+#include "main.h"
+#include "batteryManagement.h"
+#include "packSnapshot.h"
+#include "canCommunication.h"
+#include "canTelemetryTable.h"
+#include "canReceive.h"
+#include "FreeRTOS.h"
+
+#define TELEMETRY_MESSAGE_ENUM(message, id, dlc, frames, periodMs, priority) TELEMETRY_MSG_##message,
+typedef enum {
+    TELEMETRY_MESSAGES(TELEMETRY_MESSAGE_ENUM)
+    TELEMETRY_NUM_MESSAGES
+} TelemetryMessage;
+#undef TELEMETRY_MESSAGE_ENUM
+
+void canTelemetryInit(void);
+void canTelemetrySetPeriod(TelemetryMessage message, uint16_t periodMs);
+// Frames are packed from a published pack snapshot, never from a sensor read
+void canTelemetryService(const PackSnapshot *snap, TickType_t now);
+void canTelemetryHandleConfig(const CanRxFrame *frame);
+
+#endif /* CAN_TELEMETRY_H */
@@ -0,0 +1,74 @@
+#ifndef CAN_TELEMETRY_TABLE_H
+#define CAN_TELEMETRY_TABLE_H
+
+// Single source of truth for the telemetry frames. canTelemetry.c packs from it and
+// Tools/generateDbc.py turns it into Tools/bms.dbc, so edit here and regenerate.
+
+#include "packConfig.h"
+
+// 0x100 carries three cells per frame behind the group number in byte 0, so its frame count
+// follows the pack. A message with more frames than TELEMETRY_MAX_FRAMES_PER_PERIOD sends
+// that many per period and picks up where it left off (144S: 48 frames, 120 ms per rotation).
+#define TELEMETRY_CELLS_PER_FRAME       3
+#define TELEMETRY_CELL_FRAMES           ((PACK_NUM_CELLS + TELEMETRY_CELLS_PER_FRAME - 1) / TELEMETRY_CELLS_PER_FRAME)
+#define TELEMETRY_MAX_FRAMES_PER_PERIOD 4
+
+// 0x102 does the same with every temperature sensor, I2C first, then the NTCs (144S: 21
+// frames, 600 ms per rotation). A lost sensor, and a slot past the last one, reads
+// TELEMETRY_TEMPERATURE_NONE (raw 0x8000); canTelemetry.c provides telemetryTemperature().
+#define TELEMETRY_TEMPERATURES_PER_FRAME 3
+#define TELEMETRY_TEMPERATURE_FRAMES \
+    ((PACK_NUM_TEMPERATURES + TELEMETRY_TEMPERATURES_PER_FRAME - 1) / TELEMETRY_TEMPERATURES_PER_FRAME)
+#define TELEMETRY_TEMPERATURE_NONE       (-3276.8f)
+#define TELEMETRY_TEMPERATURE(snap, frame, slot) \
+    telemetryTemperature((snap), TELEMETRY_TEMPERATURES_PER_FRAME * (frame) + (slot))
+
+// X(message, id, dlc, frames, defaultPeriodMs, priority)
+#define TELEMETRY_MESSAGES(X) \
+    X(CellVoltages,  0x100, 7, TELEMETRY_CELL_FRAMES, 10, CAN_TX_PRIORITY_LOW) \
+    X(PackCurrent,   0x101, 6, 1, 10,   CAN_TX_PRIORITY_NORMAL) \
+    X(Temperatures,  0x102, 7, TELEMETRY_TEMPERATURE_FRAMES, 100, CAN_TX_PRIORITY_LOW) \
+    X(StateOfCharge, 0x103, 2, 1, 100,  CAN_TX_PRIORITY_NORMAL) \
+    X(SafetyFlags,   0x104, 6, 1, 100,  CAN_TX_PRIORITY_HIGH) \
+    X(PowerLimits,   0x105, 8, 1, 10,   CAN_TX_PRIORITY_HIGH)
+
+// Multiplexing of the mux column: a signal either selects the frame, is in every frame,
+// or is only present in the frame whose selector equals the given value. A
+// TELEMETRY_MUX_EACH signal is in every frame but carries the next item of a list each time;
+// its name is the one in frame 0, and the DBC renumbers it for each later frame.
+#define TELEMETRY_MUX_EACH     (-3)
+#define TELEMETRY_MUX_SELECTOR (-2)
+#define TELEMETRY_MUX_NONE     (-1)
+
+// Intel byte order. source is evaluated with `snap` (const PackSnapshot *) and
+// `frame` (index within a multi-frame message) in scope.
+// X(message, signal, mux, startBit, length, isSigned, factor, offset, unit, source)
+#define TELEMETRY_SIGNALS(X) \
+    X(CellVoltages,  CellGroup,        TELEMETRY_MUX_SELECTOR, 0,  8,  0, 1.0f,   0.0f, "",     frame) \
+    X(CellVoltages,  Cell1_Voltage,    TELEMETRY_MUX_EACH,     8,  16, 0, 0.001f, 0.0f, "V",    snap->pack.cellVoltages[TELEMETRY_CELLS_PER_FRAME * frame]) \
+    X(CellVoltages,  Cell2_Voltage,    TELEMETRY_MUX_EACH,     24, 16, 0, 0.001f, 0.0f, "V",    snap->pack.cellVoltages[TELEMETRY_CELLS_PER_FRAME * frame + 1U]) \
+    X(CellVoltages,  Cell3_Voltage,    TELEMETRY_MUX_EACH,     40, 16, 0, 0.001f, 0.0f, "V",    snap->pack.cellVoltages[TELEMETRY_CELLS_PER_FRAME * frame + 2U]) \
+    X(PackCurrent,   Current,          TELEMETRY_MUX_NONE,     0,  32, 1, 0.001f, 0.0f, "A",    snap->pack.current) \
+    X(PackCurrent,   PackVoltage,      TELEMETRY_MUX_NONE,     32, 16, 0, 0.01f,  0.0f, "V",    snap->pack.totalVoltage) \
+    X(Temperatures,  TemperatureGroup, TELEMETRY_MUX_SELECTOR, 0,  8,  0, 1.0f,   0.0f, "",     frame) \
+    X(Temperatures,  Temperature1,     TELEMETRY_MUX_EACH,     8,  16, 1, 0.1f,   0.0f, "degC", TELEMETRY_TEMPERATURE(snap, frame, 0U)) \
+    X(Temperatures,  Temperature2,     TELEMETRY_MUX_EACH,     24, 16, 1, 0.1f,   0.0f, "degC", TELEMETRY_TEMPERATURE(snap, frame, 1U)) \
+    X(Temperatures,  Temperature3,     TELEMETRY_MUX_EACH,     40, 16, 1, 0.1f,   0.0f, "degC", TELEMETRY_TEMPERATURE(snap, frame, 2U)) \
+    X(StateOfCharge, SoC,              TELEMETRY_MUX_NONE,     0,  16, 0, 0.01f,  0.0f, "%",    snap->soc) \
+    X(SafetyFlags,   OverVoltage,      TELEMETRY_MUX_NONE,     0,  1,  0, 1.0f,   0.0f, "",     (snap->safetyFlags >> 0) & 1U) \
+    X(SafetyFlags,   OverTemperature,  TELEMETRY_MUX_NONE,     1,  1,  0, 1.0f,   0.0f, "",     (snap->safetyFlags >> 1) & 1U) \
+    X(SafetyFlags,   OverCurrent,      TELEMETRY_MUX_NONE,     2,  1,  0, 1.0f,   0.0f, "",     (snap->safetyFlags >> 2) & 1U) \
+    X(SafetyFlags,   UnderVoltage,     TELEMETRY_MUX_NONE,     3,  1,  0, 1.0f,   0.0f, "",     (snap->safetyFlags >> 3) & 1U) \
+    X(SafetyFlags,   BmsState,         TELEMETRY_MUX_NONE,     8,  8,  0, 1.0f,   0.0f, "",     snap->faults.state) \
+    X(SafetyFlags,   ActiveFaults,     TELEMETRY_MUX_NONE,     16, 16, 0, 1.0f,   0.0f, "",     snap->faults.active) \
+    X(SafetyFlags,   LatchedFaults,    TELEMETRY_MUX_NONE,     32, 16, 0, 1.0f,   0.0f, "",     snap->faults.latched) \
+    X(PowerLimits,   DischargeCont,    TELEMETRY_MUX_NONE,     0,  16, 0, 0.1f,   0.0f, "A",    snap->powerLimits.dischargeContinuous) \
+    X(PowerLimits,   DischargePeak,    TELEMETRY_MUX_NONE,     16, 16, 0, 0.1f,   0.0f, "A",    snap->powerLimits.dischargePeak) \
+    X(PowerLimits,   ChargeCont,       TELEMETRY_MUX_NONE,     32, 16, 0, 0.1f,   0.0f, "A",    snap->powerLimits.chargeContinuous) \
+    X(PowerLimits,   ChargePeak,       TELEMETRY_MUX_NONE,     48, 16, 0, 0.1f,   0.0f, "A",    snap->powerLimits.chargePeak)
+
+#if PACK_NUM_CELLS % TELEMETRY_CELLS_PER_FRAME != 0
+#error "0x100 packs whole frames of TELEMETRY_CELLS_PER_FRAME cells"
+#endif
+
+#endif /* CAN_TELEMETRY_TABLE_H */
@@ -6,8 +6,9 @@
 
 // Function declarations
 void cellBalancingInit(void);
-void balanceCells(void);
+void balanceCells(const BatteryPack *pack);
 void activateBalancing(uint8_t cellIndex);
 void deactivateBalancing(uint8_t cellIndex);
+void cellBalancingGetActive(uint8_t active[NUM_CELLS]);
 
 #endif // CELL_BALANCING_H
@@ -0,0 +1,31 @@
+#ifndef CELL_FILTER_H
+#define CELL_FILTER_H
+
+#include "main.h"
+#include "adcAcquisition.h"
+#include "signalPath.h"
+
+// Anti-alias biquad cascade (Butterworth, 2 poles per stage) ahead of a FIR decimator
+#define CELL_FILTER_BIQUAD_STAGES  2
+#define CELL_FILTER_FIR_TAPS       32
+
+// Decimated cell readings are produced at this rate unless reconfigured; it matches
+// SAMPLING_TARGET_BLOCK_RATE_HZ so every DMA block divides evenly by the decimation factor
+#define CELL_FILTER_OUTPUT_RATE_HZ 100U
+#define CELL_FILTER_CUTOFF_RATIO   0.4f   // Anti-alias corner as a fraction of the output rate
+
+typedef struct {
+    uint32_t blocks;
+    uint32_t samplesFiltered;     // Input samples, all cells
+    uint32_t rejectedBlocks;      // Block length not a multiple of the decimation factor
+    uint32_t lastBlockCycles;
+    uint32_t worstBlockCycles;
+} CellFilterStats;
+
+HAL_StatusTypeDef cellFilterInit(uint32_t sampleRateHz);
+HAL_StatusTypeDef cellFilterConfigure(uint32_t sampleRateHz, uint16_t decimation, float cutoffHz);
+uint16_t cellFilterGetDecimation(void);
+uint8_t cellFilterProcessBlock(const AdcBlock *block, signal_t out[ADC_ACQ_NUM_CELL_CHANNELS]);
+void cellFilterGetStats(CellFilterStats *stats);
+
+#endif /* CELL_FILTER_H */
@@ -0,0 +1,58 @@
+#ifndef CHARGE_CONTROLLER_H
+#define CHARGE_CONTROLLER_H
+
+#include "main.h"
+#include "packConfig.h"
+#include "packSnapshot.h"
+#include "canReceive.h"
+#include "FreeRTOS.h"
+
+// Elcon/TC charger protocol: extended IDs, big-endian fields. The status broadcast
+// (0x18FF50E5: output voltage, current, status flags) is routed in canReceiveTable.h.
+#define CHARGER_REQUEST_ID         0x1806E5F4U   // BMS -> charger: max voltage, max current (0.1 V/A), stop flag
+#define CHARGER_TIMEOUT_MS         5000U         // Either side treats the other as gone after this long
+
+// Status byte bits. Hardware, temperature and battery faults end the session; a wrong input
+// voltage or a missed request only pause it until the charger clears the bit.
+#define CHARGER_FLAG_HARDWARE      (1U << 0)
+#define CHARGER_FLAG_TEMPERATURE   (1U << 1)
+#define CHARGER_FLAG_INPUT         (1U << 2)
+#define CHARGER_FLAG_BATTERY       (1U << 3)     // Battery missing or reversed
+#define CHARGER_FLAG_COMMS         (1U << 4)     // No request from the BMS within the charger's timeout
+#define CHARGER_FLAGS_FAULT        (CHARGER_FLAG_HARDWARE | CHARGER_FLAG_TEMPERATURE | CHARGER_FLAG_BATTERY)
+
+#define CHARGE_CONTROL_PERIOD_MS   500U
+#define CHARGE_MAX_CURRENT_A       3.0f          // CC phase, 1C
+#define CHARGE_CV_CELL_VOLTAGE     4.15f         // Highest cell is held here, 50 mV under the trip
+#define CHARGE_TERMINATION_A       0.15f         // C/20
+#define CHARGE_TERMINATION_MS      60000U        // Command must stay below termination this long
+
+// arm_pid_f32 on the highest cell's headroom below CHARGE_CV_CELL_VOLTAGE, output in amps
+#define CHARGE_PID_KP              50.0f         // A per V
+#define CHARGE_PID_KI              5.0f          // A per V*s
+#define CHARGE_PID_KD              0.0f
+
+typedef enum {
+    CHARGE_STATE_IDLE,        // No charger on the bus
+    CHARGE_STATE_CHARGING,
+    CHARGE_STATE_COMPLETE,    // Terminated; stays here until the charger is unplugged
+    CHARGE_STATE_FAULT        // Pack protection or charger fault; also latched until unplugged
+} ChargeState;
+
+typedef struct {
+    float outputVoltage;
+    float outputCurrent;
+    uint8_t flags;            // Elcon status byte, CHARGER_FLAG_*
+    TickType_t lastTick;
+    uint8_t valid;
+} ChargerStatus;
+
+void chargeControllerInit(void);
+void chargeControllerService(const PackSnapshot *snap, TickType_t now);
+void chargeControllerHandleStatus(const CanRxFrame *frame);
+uint8_t chargeControllerIsConnected(void);
+ChargeState chargeControllerGetState(void);
+float chargeControllerGetCommand(void);
+void chargeControllerGetChargerStatus(ChargerStatus *status);
+
+#endif /* CHARGE_CONTROLLER_H */
@@ -0,0 +1,11 @@
+#ifndef CHARGE_CONTROLLER_LOOP_H
+#define CHARGE_CONTROLLER_LOOP_H
+
+// Internal to chargeController: the cell-level PID step, shared with the host test so its
+// charge simulation runs the same loop
+#include "chargeController.h"
+#include "arm_math.h"
+
+float chargeControllerControlStep(arm_pid_instance_f32 *instance, float maxCellVoltage, float limit);
+
+#endif /* CHARGE_CONTROLLER_LOOP_H */
@@ -0,0 +1,24 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "main.h"
+
+// PEC15:  LTC681x packet error code, x^15+x^14+x^10+x^8+x^7+x^4+x^3+1, seed 16, left-aligned
+// CRC-8:  SAE J1850 (0x1D, init/xor 0xFF), the AUTOSAR E2E profile 1/2 CRC for CAN payloads
+// CRC-32: 0x04C11DB7, init 0xFFFFFFFF, no reflection (CRC-32/MPEG-2), on the STM32 CRC unit
+typedef enum {
+    CHECKSUM_PEC15,
+    CHECKSUM_CRC8,
+    CHECKSUM_CRC32,
+    CHECKSUM_NUM_TYPES
+} ChecksumType;
+
+extern CRC_HandleTypeDef hcrc;
+
+void checksumInit(void);
+uint32_t checksumCompute(ChecksumType type, const uint8_t *data, uint32_t length);
+uint16_t checksumPec15(const uint8_t *data, uint32_t length);
+uint8_t checksumCrc8(const uint8_t *data, uint32_t length);
+uint32_t checksumCrc32(const uint8_t *data, uint32_t length);
+
+#endif /* CHECKSUM_H */
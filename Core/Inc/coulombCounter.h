@@ -0,0 +1,26 @@
+#ifndef COULOMB_COUNTER_H
+#define COULOMB_COUNTER_H
+
+#include "main.h"
+#include "adcAcquisition.h"
+
+#define COULOMB_CAPACITY_MAH    3000.0f  // Rated capacity of one series cell group
+#define COULOMB_REST_CURRENT_A  0.5f     // Below this the pack counts as resting
+#define COULOMB_REST_TIME_S     60U      // Relaxation time before OCV is trusted
+
+typedef struct {
+    uint32_t lastUpdateCycles;   // Cycles spent integrating the most recent block
+    uint32_t worstUpdateCycles;
+    uint32_t samplesIntegrated;
+    uint32_t ocvCorrections;
+} CoulombCounterStats;
+
+void coulombCounterInit(uint32_t sampleRateHz);
+void coulombCounterIntegrateBlock(const AdcBlock *block);
+void coulombCounterApplyOcv(float cellVoltage);
+float coulombCounterGetSoc(void);
+float ocvToSoc(float cellVoltage);
+float socToOcv(float soc, float *slope);
+void coulombCounterGetStats(CoulombCounterStats *stats);
+
+#endif /* COULOMB_COUNTER_H */
@@ -0,0 +1,21 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "main.h"
+
+// DWT cycle counter, used for timestamps and cycle budgets (wraps every ~51 s at 84 MHz)
+static inline void cycleCounterInit(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycleCounterNow(void) {
+    return DWT->CYCCNT;
+}
+
+static inline uint32_t cycleCounterToMicros(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+#endif /* CYCLE_COUNTER_H */
@@ -0,0 +1,38 @@
+#ifndef DCIR_ESTIMATOR_H
+#define DCIR_ESTIMATOR_H
+
+#include "main.h"
+#include "batteryManagement.h"
+
+// Per-cell recursive least squares on V = OCV - R * I, fed with voltage/current pairs that
+// were converted in the same sampling window
+#define DCIR_FORGETTING_FACTOR    0.999f    // ~1000 accepted updates of memory
+#define DCIR_MIN_EXCITATION_A     2.0f      // Current step needed since the last accepted update
+#define DCIR_INITIAL_OHM          0.015f    // Matches SOC_EKF_R0_OHM until the cell has been excited
+#define DCIR_MIN_OHM              0.0005f
+#define DCIR_MAX_OHM              0.2f
+#define DCIR_INITIAL_P_OCV        0.01f     // V^2
+#define DCIR_INITIAL_P_OHM        1.0e-4f   // Ohm^2
+#define DCIR_MAX_P                1.0f      // Covariance cap against wind-up while unexcited
+
+typedef struct {
+    float dischargeCurrent;   // Amps the pack can deliver before the weakest cell hits MIN_CELL_VOLTAGE
+    float dischargePower;     // Watts at that current
+    float chargeCurrent;      // Amps it can absorb before the strongest cell hits MAX_CELL_VOLTAGE
+    float chargePower;
+} DcirPowerLimits;
+
+typedef struct {
+    uint32_t updates;          // Accepted, all cells
+    uint32_t skipped;          // Rejected for lack of excitation
+    uint32_t lastUpdateCycles;
+    uint32_t worstUpdateCycles;
+} DcirEstimatorStats;
+
+void dcirEstimatorInit(void);
+void dcirEstimatorUpdate(const float voltages[NUM_CELLS], const float currents[NUM_CELLS]);
+void dcirEstimatorGetResistances(float resistances[NUM_CELLS]);
+void dcirEstimatorGetPowerLimits(DcirPowerLimits *limits);
+void dcirEstimatorGetStats(DcirEstimatorStats *stats);
+
+#endif /* DCIR_ESTIMATOR_H */
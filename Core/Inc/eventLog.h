@@ -0,0 +1,55 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "main.h"
+#include "canReceive.h"
+
+// Flash sectors 1-3 (16 KB each), kept out of ROM_region in EWARM/stm32f446xx_flash.icf.
+// Sectors are used round-robin; one is kept erased so rotation never has to erase.
+#define EVENT_LOG_SECTORS          3U
+#define EVENT_LOG_FIRST_SECTOR     FLASH_SECTOR_1
+#define EVENT_LOG_BASE_ADDRESS     0x08004000U
+#define EVENT_LOG_SECTOR_BYTES     0x4000U
+
+// Events waiting in RAM for the background commit; newer events are dropped when full
+#define EVENT_LOG_BATCH_DEPTH      32U
+
+// Readout: 0x202 byte 0 selects the channel; records go out a few per service call
+#define EVENT_LOG_READOUT_CAN      0U
+#define EVENT_LOG_READOUT_UART     1U
+#define EVENT_LOG_READOUT_ID       0x110U
+#define EVENT_LOG_READOUT_PER_CALL 8U
+
+// Fault codes (FaultCode) are logged as themselves; system events start at 0x100
+typedef enum {
+    EVENT_BOOT = 0x100,        // value: RCC_CSR reset flags
+    EVENT_ERROR_HANDLER,       // value: IPSR, the exception that was active (0 in thread mode)
+    EVENT_STATE_CHANGE         // value: new BmsState
+} EventCode;
+
+typedef struct {
+    uint32_t sequence;         // Monotonic across sectors and reboots
+    uint32_t timestamp;        // HAL tick, ms since that boot
+    uint32_t code;
+    uint32_t value;
+} EventRecord;
+
+typedef struct {
+    uint32_t committed;
+    uint32_t dropped;          // Batch full, or a panic flush with no room left
+    uint32_t writeErrors;
+    uint32_t erases;
+    uint32_t tornRecords;      // Partly written records found at mount and skipped
+    uint32_t deferred;         // Commits held back because the next sector still needed erasing
+} EventLogStats;
+
+extern UART_HandleTypeDef huart2;
+
+HAL_StatusTypeDef eventLogInit(void);
+void eventLogAppend(uint32_t code, uint32_t value);
+void eventLogService(uint8_t eraseAllowed);
+void eventLogPanic(uint32_t code, uint32_t value);
+void eventLogHandleReadout(const CanRxFrame *frame);
+void eventLogGetStats(EventLogStats *stats);
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,43 @@
+#ifndef EVENT_LOG_STORE_H
+#define EVENT_LOG_STORE_H
+
+// Internal to eventLog: the sector store under the batch and readout, shared with the host
+// test so it can run the same code on a RAM medium
+#include "eventLog.h"
+
+// Word access to a set of equal sectors; internal flash on target, RAM in the power-loss test
+typedef struct {
+    uint32_t (*read)(uint32_t address);
+    HAL_StatusTypeDef (*program)(uint32_t address, uint32_t word);
+    HAL_StatusTypeDef (*erase)(uint8_t sector);
+    uint32_t base;
+    uint32_t sectorBytes;
+} EventLogMedium;
+
+typedef struct {
+    const EventLogMedium *medium;
+    uint8_t state[EVENT_LOG_SECTORS];
+    uint32_t sectorSequence[EVENT_LOG_SECTORS];
+    uint8_t active;
+    uint32_t writeOffset;
+    uint32_t nextSequence;         // Of the next record
+    uint32_t nextSectorSequence;
+    EventLogStats stats;
+} EventLogStore;
+
+// Valid sectors oldest first, and the position within the current one
+typedef struct {
+    uint8_t order[EVENT_LOG_SECTORS];
+    uint8_t count;
+    uint8_t index;
+    uint32_t offset;
+} EventLogCursor;
+
+void eventLogStoreMount(EventLogStore *log);
+HAL_StatusTypeDef eventLogStorePrepareSpare(EventLogStore *log);
+HAL_StatusTypeDef eventLogStoreAppend(EventLogStore *log, uint32_t timestamp, uint32_t code, uint32_t value,
+                                      uint8_t eraseAllowed);
+void eventLogStoreOpenCursor(const EventLogStore *log, EventLogCursor *cursor);
+uint8_t eventLogStoreReadNext(const EventLogStore *log, EventLogCursor *cursor, EventRecord *record);
+
+#endif /* EVENT_LOG_STORE_H */
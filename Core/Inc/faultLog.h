@@ -0,0 +1,31 @@
+#ifndef FAULT_LOG_H
+#define FAULT_LOG_H
+
+#include "main.h"
+
+// Most recent faults kept in RAM; older entries are overwritten
+#define FAULT_LOG_DEPTH 32
+
+typedef enum {
+    FAULT_OVERCURRENT,
+    FAULT_OVERVOLTAGE,
+    FAULT_OVERTEMPERATURE,
+    FAULT_UNDERVOLTAGE,
+    FAULT_CHARGE_OVERCURRENT,
+    FAULT_CELL_IMBALANCE,
+    FAULT_VOLTAGE_STALE,
+    FAULT_TEMPERATURE_LOST
+} FaultCode;
+
+typedef struct {
+    uint32_t timestamp;   // Cycle counter when the fault was detected
+    uint32_t value;       // Raw reading that tripped, in the source's own units
+    FaultCode code;
+} FaultRecord;
+
+void faultLogRecord(FaultCode code, uint32_t timestamp, uint32_t value);
+uint32_t faultLogGetCount(void);
+uint8_t faultLogGetRecord(uint32_t age, FaultRecord *record);
+void faultLogClear(void);
+
+#endif /* FAULT_LOG_H */
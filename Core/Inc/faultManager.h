@@ -0,0 +1,74 @@
+#ifndef FAULT_MANAGER_H
+#define FAULT_MANAGER_H
+
+#include "main.h"
+#include "packModel.h"
+#include "faultLog.h"
+#include "faultTable.h"
+
+// |current| above this counts as charging or discharging rather than resting
+#define FAULT_STATE_ACTIVE_CURRENT_A  0.5f
+
+typedef enum {
+    FAULT_SEVERITY_NONE,
+    FAULT_SEVERITY_WARNING,    // Reported only
+    FAULT_SEVERITY_MAJOR,      // Disables the fault's own paths, FAULT_MODE
+    FAULT_SEVERITY_CRITICAL    // Disables both paths, SHUTDOWN
+} FaultSeverity;
+
+typedef enum {
+    FAULT_POLICY_AUTO_CLEAR,   // Clears once the condition has been gone for clearSamples
+    FAULT_POLICY_LATCH,        // Also needs faultManagerClearLatched()
+    FAULT_POLICY_EXTERNAL      // Mirrors a latch kept, and logged, by its source
+} FaultPolicy;
+
+// Paths a fault disables, and the layout of FaultStatus.disabledPaths
+#define FAULT_PATH_NONE       0U
+#define FAULT_PATH_CHARGE     (1U << 0)
+#define FAULT_PATH_DISCHARGE  (1U << 1)
+#define FAULT_PATH_BOTH       (FAULT_PATH_CHARGE | FAULT_PATH_DISCHARGE)
+
+#define FAULT_ID_ENUM(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading) FAULT_ID_##name,
+typedef enum {
+    FAULT_TABLE(FAULT_ID_ENUM)
+    FAULT_NUM_IDS
+} FaultId;
+#undef FAULT_ID_ENUM
+
+#define FAULT_BIT(id) (1UL << (id))
+
+#define FAULT_COUNT_ONE(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading) + 1
+#if (0 FAULT_TABLE(FAULT_COUNT_ONE)) > 16
+#error "The 0x104 frame carries 16 bits of each fault word"
+#endif
+#undef FAULT_COUNT_ONE
+
+// ReadMe section 6.2
+typedef enum {
+    BMS_STATE_IDLE,            // No pack sample evaluated yet; both paths disabled
+    BMS_STATE_MONITORING,      // Both paths disabled until every fault has had its full debounce window
+    BMS_STATE_NORMAL,
+    BMS_STATE_CHARGING,
+    BMS_STATE_DISCHARGING,
+    BMS_STATE_FAULT_MODE,      // A major fault has disabled at least one path
+    BMS_STATE_SHUTDOWN,        // A critical fault has disabled both paths
+    BMS_NUM_STATES
+} BmsState;
+
+// Bit-packed words, one bit per FaultId
+typedef struct {
+    uint32_t active;
+    uint32_t latched;          // Active, and will stay so until cleared
+    uint32_t pending;          // Condition present, still debouncing
+    uint8_t disabledPaths;     // FAULT_PATH_* bits
+    BmsState state;
+} FaultStatus;
+
+void faultManagerInit(void);
+void faultManagerEvaluate(const BatteryPack *pack);
+void faultManagerClearLatched(void);
+uint8_t faultManagerIsActive(FaultId id);
+uint8_t faultManagerGetDisabledPaths(void);
+void faultManagerGetStatus(FaultStatus *status);
+
+#endif /* FAULT_MANAGER_H */
@@ -0,0 +1,10 @@
+#ifndef FAULT_MANAGER_STATE_H
+#define FAULT_MANAGER_STATE_H
+
+// Internal to faultManager: the 6.2 transition function, shared with the host test so it can
+// check every state against every input class
+#include "faultManager.h"
+
+BmsState faultManagerNextState(BmsState state, FaultSeverity worst, uint8_t monitored, float current);
+
+#endif /* FAULT_MANAGER_STATE_H */
@@ -0,0 +1,20 @@
+#ifndef FAULT_TABLE_H
+#define FAULT_TABLE_H
+
+// Every fault the manager evaluates, one bit each in the fault words, in this order.
+// condition and reading are evaluated with `pack` (const BatteryPack *) in scope; the
+// reading goes to the fault log in milli-units. Debounce counts are safety-stage updates,
+// one per sample block (10 ms at the default rate).
+
+// X(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading)
+#define FAULT_TABLE(X) \
+    X(CellOvervoltage,   FAULT_OVERVOLTAGE,        FAULT_SEVERITY_MAJOR,    FAULT_POLICY_LATCH,      FAULT_PATH_CHARGE,    2,   10,  pack->voltageStats.max > MAX_CELL_VOLTAGE,               pack->voltageStats.max) \
+    X(CellUndervoltage,  FAULT_UNDERVOLTAGE,       FAULT_SEVERITY_MAJOR,    FAULT_POLICY_AUTO_CLEAR, FAULT_PATH_DISCHARGE, 5,   100, pack->voltageStats.min < MIN_CELL_VOLTAGE,               pack->voltageStats.min) \
+    X(Overtemperature,   FAULT_OVERTEMPERATURE,    FAULT_SEVERITY_CRITICAL, FAULT_POLICY_LATCH,      FAULT_PATH_BOTH,      2,   10,  pack->temperatureStats.max > MAX_SAFE_TEMPERATURE,       pack->temperatureStats.max) \
+    X(Overcurrent,       FAULT_OVERCURRENT,        FAULT_SEVERITY_MAJOR,    FAULT_POLICY_EXTERNAL,   FAULT_PATH_DISCHARGE, 1,   1,   overcurrentProtectionIsTripped(),                       pack->current) \
+    X(ChargeOvercurrent, FAULT_CHARGE_OVERCURRENT, FAULT_SEVERITY_MAJOR,    FAULT_POLICY_AUTO_CLEAR, FAULT_PATH_CHARGE,    5,   100, pack->current < -MAX_CHARGE_CURRENT,                    -pack->current) \
+    X(CellImbalance,     FAULT_CELL_IMBALANCE,     FAULT_SEVERITY_WARNING,  FAULT_POLICY_AUTO_CLEAR, FAULT_PATH_NONE,      100, 100, pack->voltageStats.spread > MAX_CELL_VOLTAGE_SPREAD,     pack->voltageStats.spread) \
+    X(VoltageStale,      FAULT_VOLTAGE_STALE,      FAULT_SEVERITY_CRITICAL, FAULT_POLICY_LATCH,      FAULT_PATH_BOTH,      10,  10,  pack->voltageStaleScans > 0,                           pack->voltageStaleScans / 1000.0f) \
+    X(TemperatureLost,   FAULT_TEMPERATURE_LOST,   FAULT_SEVERITY_MAJOR,    FAULT_POLICY_AUTO_CLEAR, FAULT_PATH_CHARGE,    50,  100, pack->temperatureSensorsLost > 0,                      pack->temperatureSensorsLost / 1000.0f)
+
+#endif /* FAULT_TABLE_H */
@@ -11,7 +11,9 @@ extern "C" {
 #include <stdint.h>
 
 /* Exported functions prototypes ---------------------------------------------*/
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
 void Error_Handler(void);
+void MX_FREERTOS_Init(void);
 
 /* Private defines -----------------------------------------------------------*/
 #define B1_Pin GPIO_PIN_13
@@ -21,6 +23,10 @@ void Error_Handler(void);
 #define ADC_Voltage_Port GPIOA
 #define ADC_Current_Pin GPIO_PIN_1
 #define ADC_Current_Port GPIOA
+#define ADC_Thermistor_Pin GPIO_PIN_7
+#define ADC_Thermistor_Port GPIOA
+#define ADC_Cell_Sense_Pins (GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3|GPIO_PIN_4|GPIO_PIN_5)
+#define ADC_Cell_Sense_Port GPIOC
 
 #define Charge_Control_Pin GPIO_PIN_4
 #define Charge_Control_Port GPIOA
@@ -32,10 +38,19 @@ void Error_Handler(void);
 #define CAN1_RX_Pin GPIO_PIN_11
 #define CAN1_RX_GPIO_Port GPIOA
 
+#define AFE_SPI_Pins (GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15)
+#define AFE_SPI_GPIO_Port GPIOB
+#define AFE_CS_Pin GPIO_PIN_12
+#define AFE_CS_GPIO_Port GPIOB
+
 #define I2C1_SDA_Pin GPIO_PIN_7
 #define I2C1_SDA_GPIO_Port GPIOB
 #define I2C1_SCL_Pin GPIO_PIN_6
 #define I2C1_SCL_GPIO_Port GPIOB
+#define I2C2_SDA_Pin GPIO_PIN_12
+#define I2C2_SDA_GPIO_Port GPIOC
+#define I2C2_SCL_Pin GPIO_PIN_10
+#define I2C2_SCL_GPIO_Port GPIOB
 
 #define Overvoltage_Protection_Pin GPIO_PIN_8
 #define Overvoltage_Protection_Port GPIOB
@@ -0,0 +1,58 @@
+#ifndef NTC_TABLE_H
+#define NTC_TABLE_H
+
+// Generated by Tools/generateNtcTable.py; edit the parameters there and regenerate.
+// 10000 ohm / B3435 NTC to ground, 10000 ohm pull-up to the ADC reference.
+// Worst interpolation error 0.036 degC (code 215) between -40 and 125 degC.
+
+#include "arm_math.h"
+
+#define NTC_TABLE_ENTRIES        257
+#define NTC_TABLE_STEP_SHIFT     4      // Codes per interval = 1 << shift
+#define NTC_TABLE_FULL_SCALE_C   256.0f // Q15 1.0 in degC
+#define NTC_SHORT_CODE           214    // Below this the sensor reads hotter than 125 degC
+#define NTC_OPEN_CODE            3938   // Above this it reads colder than -40 degC
+
+// Divider and beta-equation parameters, for the on-target cross-check against logf
+#define NTC_NOMINAL_OHMS         10000.0f
+#define NTC_NOMINAL_C            25.0f
+#define NTC_BETA                 3435.0f
+#define NTC_PULLUP_OHMS          10000.0f
+
+static const q15_t ntcTemperatureTable[NTC_TABLE_ENTRIES] = {
+     32767,  32767,  30888,  27084,  24631,  22851,  21469,  20346,
+     19405,  18598,  17894,  17270,  16710,  16204,  15743,  15319,
+     14927,  14563,  14223,  13904,  13604,  13322,  13054,  12800,
+     12558,  12327,  12106,  11895,  11693,  11498,  11311,  11130,
+     10956,  10787,  10624,  10467,  10314,  10165,  10021,   9881,
+      9744,   9611,   9482,   9355,   9232,   9111,   8993,   8878,
+      8766,   8655,   8547,   8441,   8337,   8235,   8135,   8037,
+      7940,   7846,   7752,   7661,   7570,   7481,   7394,   7308,
+      7223,   7139,   7056,   6975,   6895,   6815,   6737,   6660,
+      6584,   6508,   6434,   6360,   6287,   6215,   6144,   6073,
+      6004,   5935,   5866,   5799,   5731,   5665,   5599,   5534,
+      5469,   5405,   5342,   5279,   5216,   5154,   5092,   5031,
+      4971,   4910,   4851,   4791,   4732,   4674,   4615,   4557,
+      4500,   4443,   4386,   4329,   4273,   4217,   4161,   4106,
+      4051,   3996,   3942,   3887,   3833,   3779,   3726,   3672,
+      3619,   3566,   3513,   3461,   3408,   3356,   3304,   3252,
+      3200,   3148,   3097,   3045,   2994,   2943,   2892,   2841,
+      2790,   2739,   2688,   2638,   2587,   2537,   2486,   2436,
+      2385,   2335,   2285,   2234,   2184,   2134,   2084,   2033,
+      1983,   1933,   1882,   1832,   1782,   1731,   1681,   1630,
+      1580,   1529,   1478,   1428,   1377,   1326,   1274,   1223,
+      1172,   1120,   1069,   1017,    965,    913,    861,    808,
+       756,    703,    650,    596,    543,    489,    435,    381,
+       326,    271,    216,    160,    105,     48,     -8,    -65,
+      -122,   -180,   -238,   -297,   -356,   -415,   -475,   -536,
+      -597,   -659,   -721,   -784,   -848,   -912,   -977,  -1042,
+     -1109,  -1176,  -1244,  -1313,  -1383,  -1454,  -1526,  -1599,
+     -1673,  -1748,  -1825,  -1903,  -1982,  -2063,  -2145,  -2229,
+     -2314,  -2402,  -2491,  -2583,  -2677,  -2773,  -2872,  -2974,
+     -3079,  -3187,  -3298,  -3414,  -3533,  -3657,  -3787,  -3922,
+     -4063,  -4212,  -4368,  -4534,  -4710,  -4898,  -5101,  -5322,
+     -5563,  -5831,  -6133,  -6481,  -6894,  -7407,  -8096,  -9194,
+    -32768,
+};
+
+#endif /* NTC_TABLE_H */
@@ -0,0 +1,24 @@
+#ifndef OVERCURRENT_PROTECTION_H
+#define OVERCURRENT_PROTECTION_H
+
+#include "main.h"
+
+#define OVERCURRENT_TRIP_MILLIAMPS 110000   // Shut-down threshold from the safety table
+
+// Above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY: kernel critical sections never delay a trip
+#define OVERCURRENT_IRQ_PRIORITY   0
+
+typedef struct {
+    uint32_t trips;
+    uint32_t lastResponseCycles;    // ADC interrupt entry to discharge MOSFET open
+    uint32_t worstResponseCycles;
+} OvercurrentStats;
+
+extern volatile uint32_t overcurrentIrqEntryCycles;
+
+HAL_StatusTypeDef overcurrentProtectionInit(void);
+uint8_t overcurrentProtectionIsTripped(void);
+void overcurrentProtectionRearm(void);
+void overcurrentProtectionGetStats(OvercurrentStats *stats);
+
+#endif /* OVERCURRENT_PROTECTION_H */
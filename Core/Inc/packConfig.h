@@ -0,0 +1,56 @@
+#ifndef PACK_CONFIG_H
+#define PACK_CONFIG_H
+
+#include "adcAcquisition.h"
+
+// Where cell voltages come from: the on-board ADC scan (6S bench pack) or a daisy chain
+// of LTC681x-style cell-monitor AFEs on SPI2 (full accumulator)
+#define PACK_CELL_SOURCE_ADC 0
+#define PACK_CELL_SOURCE_AFE 1
+
+#ifndef PACK_CELL_SOURCE
+#define PACK_CELL_SOURCE PACK_CELL_SOURCE_ADC
+#endif
+
+// One AFE monitors one module of series cells and reads its thermistors on GPIO1-5
+#define AFE_CELLS_PER_DEVICE       12
+#define AFE_THERMISTORS_PER_DEVICE 5
+#ifndef AFE_NUM_DEVICES
+#define AFE_NUM_DEVICES      12      // 144S
+#endif
+
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+#define PACK_NUM_CELLS (AFE_NUM_DEVICES * AFE_CELLS_PER_DEVICE)
+#else
+#define PACK_NUM_CELLS ADC_ACQ_NUM_CELL_CHANNELS
+#endif
+
+// Pack temperature sensors, TMP102-compatible, polled round-robin on each bus.
+// X(bus, 7-bit address); the hottest one drives the over-temperature check.
+#define PACK_TEMPERATURE_BUS_I2C1 0
+#define PACK_TEMPERATURE_BUS_I2C2 1
+#define PACK_NUM_TEMPERATURE_BUSES 2
+
+#define PACK_TEMPERATURE_SENSORS(X) \
+    X(PACK_TEMPERATURE_BUS_I2C1, TEMP_SENSOR_ADDRESS) \
+    X(PACK_TEMPERATURE_BUS_I2C2, TEMP_SENSOR_ADDRESS)
+
+#define PACK_TEMPERATURE_COUNT_ONE(bus, address) + 1
+#define PACK_NUM_I2C_TEMPERATURES (0 PACK_TEMPERATURE_SENSORS(PACK_TEMPERATURE_COUNT_ONE))
+
+// NTC thermistors on the AFE GPIO inputs, or on the ADC scan ranks after the current channel
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+#define PACK_NUM_THERMISTORS (AFE_NUM_DEVICES * AFE_THERMISTORS_PER_DEVICE)
+#else
+#define PACK_NUM_THERMISTORS ADC_ACQ_NUM_NTC_CHANNELS
+#endif
+
+// Pack temperature array: the I2C sensors first, then the thermistors
+#define PACK_FIRST_THERMISTOR PACK_NUM_I2C_TEMPERATURES
+#define PACK_NUM_TEMPERATURES (PACK_NUM_I2C_TEMPERATURES + PACK_NUM_THERMISTORS)
+
+#if PACK_NUM_CELLS > 255
+#error "Cell indices are uint8_t throughout; split the pack or widen them"
+#endif
+
+#endif /* PACK_CONFIG_H */
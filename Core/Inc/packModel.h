@@ -0,0 +1,38 @@
+#ifndef PACK_MODEL_H
+#define PACK_MODEL_H
+
+#include "main.h"
+#include "packConfig.h"
+#include "packStatistics.h"
+
+// Per-cell fault bits held in BatteryPack.cellFaults
+#define CELL_FAULT_OVERVOLTAGE  (1U << 0)
+#define CELL_FAULT_UNDERVOLTAGE (1U << 1)
+
+// Structure of arrays, sized by packConfig.h: every per-cell quantity is contiguous, so a
+// reduction over the pack is a single CMSIS-DSP call. Scan rank channels live in adcScanChannels.
+// The statistics are computed once per update and travel with the pack in every snapshot.
+typedef struct {
+    float cellVoltages[PACK_NUM_CELLS];
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t temperatureLost[PACK_NUM_TEMPERATURES];   // 1 while the sensor is not answering
+    uint8_t balancing[PACK_NUM_CELLS];    // 1 while the cell's bleed resistor is on
+    uint8_t cellFaults[PACK_NUM_CELLS];   // CELL_FAULT_* bits
+    float cellResistance[PACK_NUM_CELLS]; // Online DCIR estimate, ohms
+    PackStatistics voltageStats;
+    PackStatistics temperatureStats;
+    float totalVoltage;
+    float averageVoltage;
+    float current;
+    float temperature;                    // Hottest sensor
+    float dischargePowerLimit;            // Watts before the weakest cell reaches its minimum voltage
+    float chargePowerLimit;               // Watts before the strongest cell reaches its maximum voltage
+    uint16_t voltageStaleScans;           // Scans since the oldest cell reading was refreshed
+    uint8_t temperatureSensorsLost;       // Sensors left out of temperatureStats
+} BatteryPack;
+
+void packModelInit(BatteryPack *pack);
+void packModelUpdateVoltageStatistics(BatteryPack *pack);
+void packModelUpdateTemperatureStatistics(BatteryPack *pack);
+
+#endif /* PACK_MODEL_H */
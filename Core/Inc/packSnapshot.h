@@ -0,0 +1,35 @@
+#ifndef PACK_SNAPSHOT_H
+#define PACK_SNAPSHOT_H
+
+#include "main.h"
+#include "packModel.h"
+#include "sopEstimator.h"
+#include "faultManager.h"
+
+// A reader gives up after this many torn copies and keeps whatever it held before
+#define PACK_SNAPSHOT_MAX_RETRIES 4U
+
+// One complete pack frame as published by the safety stage
+typedef struct {
+    uint32_t version;      // Publish count, set by packSnapshotPublish; 0 means nothing published yet
+    uint32_t timestamp;    // DWT cycles when the underlying samples were captured
+    BatteryPack pack;
+    float soc;
+    SopLimits powerLimits; // Refreshed every SOP_UPDATE_PERIOD_MS, carried over in between
+    uint8_t safetyFlags;   // SAFETY_FLAG_* bits
+    FaultStatus faults;
+} PackSnapshot;
+
+typedef struct {
+    uint32_t publishes;
+    uint32_t readRetries;    // Copies discarded because a publish overlapped them
+    uint32_t readFailures;   // Reads that ran out of retries
+} PackSnapshotStats;
+
+// Single writer, any number of readers, task or ISR context on either side; no locks
+void packSnapshotPublish(const PackSnapshot *snapshot);
+uint8_t packSnapshotRead(PackSnapshot *snapshot);
+uint32_t packSnapshotGetVersion(void);
+void packSnapshotGetStats(PackSnapshotStats *stats);
+
+#endif /* PACK_SNAPSHOT_H */
@@ -0,0 +1,20 @@
+#ifndef PACK_STATISTICS_H
+#define PACK_STATISTICS_H
+
+#include "main.h"
+#include "arm_math.h"
+
+// Summary of one per-cell or per-sensor array, computed once when the array is updated
+typedef struct {
+    float min;
+    float max;
+    float mean;
+    float spread;          // max - min
+    float stdDev;          // Sample standard deviation
+    uint32_t minIndex;
+    uint32_t maxIndex;
+} PackStatistics;
+
+void packStatisticsCompute(const float *values, uint32_t count, PackStatistics *stats);
+
+#endif /* PACK_STATISTICS_H */
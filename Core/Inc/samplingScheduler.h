@@ -0,0 +1,39 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include "main.h"
+#include "adcAcquisition.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SAMPLING_MIN_RATE_HZ     1U
+#define SAMPLING_MAX_RATE_HZ     10000U
+#define SAMPLING_DEFAULT_RATE_HZ 1000U
+
+// Sweeps are grouped so consumers wake at roughly this rate regardless of the sample rate
+#define SAMPLING_TARGET_BLOCK_RATE_HZ 100U
+
+// Jitter histogram: deviation of each block period from nominal, in microseconds
+#define SAMPLING_JITTER_BINS      32
+#define SAMPLING_JITTER_BIN_US    2
+
+typedef struct {
+    uint32_t bins[SAMPLING_JITTER_BINS];  // Centre bin is zero deviation, ends collect outliers
+    uint32_t samples;
+    int32_t minJitterUs;
+    int32_t maxJitterUs;
+} JitterHistogram;
+
+extern TIM_HandleTypeDef htim8;
+
+HAL_StatusTypeDef samplingSchedulerInit(uint32_t rateHz);
+HAL_StatusTypeDef samplingSchedulerStart(void);
+void samplingSchedulerStop(void);
+uint32_t samplingSchedulerGetRate(void);
+uint32_t samplingSchedulerGetBlockPeriodCycles(void);
+void samplingSchedulerSubscribe(TaskHandle_t task);
+uint8_t samplingSchedulerWaitBlock(AdcBlock *block, TickType_t timeout);
+void samplingSchedulerGetJitterHistogram(JitterHistogram *histogram);
+void samplingSchedulerResetJitterHistogram(void);
+
+#endif /* SAMPLING_SCHEDULER_H */
@@ -0,0 +1,43 @@
+#ifndef SIGNAL_PATH_H
+#define SIGNAL_PATH_H
+
+#include "main.h"
+#include "adcAcquisition.h"
+#include "arm_math.h"
+
+// Select the acquisition arithmetic at build time; both paths expose the same API.
+// The fixed-point path carries integer millivolts/milliamps in q31_t containers,
+// the float path carries the same units in float32_t.
+#ifndef BMS_FIXED_POINT
+#define BMS_FIXED_POINT 0
+#endif
+
+#if BMS_FIXED_POINT
+typedef q31_t signal_t;
+#define SIGNAL_TO_FLOAT(x)   ((float)(x) * 0.001f)
+#else
+typedef float32_t signal_t;
+#define SIGNAL_TO_FLOAT(x)   ((x) * 0.001f)
+#endif
+
+// Fractional bits carried by a code-unit value on the fixed-point path
+#define SIGNAL_CODE_FRACTION_BITS        4
+
+// Default calibration: ADC full scale in mV at a cell input and mA at the shunt amplifier
+#define SIGNAL_CELL_FULL_SCALE_MILLI     3300
+#define SIGNAL_CURRENT_FULL_SCALE_MILLI  100000
+
+typedef struct {
+    uint32_t conversions;
+    uint32_t lastConvertCycles;   // One full block, every channel
+    uint32_t worstConvertCycles;
+} SignalPathStats;
+
+void signalPathInit(void);
+void signalPathSetCalibration(uint8_t channel, int32_t fullScaleMilli, int32_t offsetMilli);
+void signalConvertBlock(const AdcBlock *block, signal_t out[ADC_ACQ_NUM_CHANNELS]);
+void signalCalibrateBlock(uint8_t channel, const signal_t *codes, signal_t *values, uint32_t count);
+signal_t signalCalibrate(uint8_t channel, signal_t code);
+void signalPathGetStats(SignalPathStats *stats);
+
+#endif /* SIGNAL_PATH_H */
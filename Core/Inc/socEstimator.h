@@ -0,0 +1,43 @@
+#ifndef SOC_ESTIMATOR_H
+#define SOC_ESTIMATOR_H
+
+#include "main.h"
+#include "batteryManagement.h"
+
+// 1-RC equivalent circuit per cell: OCV(SoC) - R1||C1 polarization - R0 * I
+#define SOC_EKF_R0_OHM        0.015f
+#define SOC_EKF_R1_OHM        0.010f
+#define SOC_EKF_C1_FARAD      2000.0f
+
+// Process noise per second on SoC (%^2/s) and polarization voltage (V^2/s), scaled by the
+// step so the tuning holds at any block rate; measurement noise (V^2). The RC voltage follows
+// the current almost exactly, so its noise is kept far below SoC's: otherwise the filter
+// explains a SoC error as polarization and never corrects it.
+#define SOC_EKF_Q_SOC         1.0e-3f
+#define SOC_EKF_Q_VRC         1.0e-8f
+#define SOC_EKF_R_VOLTAGE     1.0e-4f
+
+// Closed-form 2x2 update instead of the generic CMSIS-DSP matrix chain
+#ifndef SOC_EKF_SCALAR_PATH
+#define SOC_EKF_SCALAR_PATH   (NUM_CELLS == 6)
+#endif
+
+typedef struct {
+    float soc;                  // Percent
+    float polarizationVoltage;  // Volts across the RC pair
+    float soh;                  // Percent of rated capacity
+} CellEstimate;
+
+typedef struct {
+    uint32_t updates;
+    uint32_t lastUpdateCycles;   // All cells, one step
+    uint32_t worstUpdateCycles;
+} SocEstimatorStats;
+
+void socEstimatorInit(void);
+void socEstimatorUpdate(const float voltages[NUM_CELLS], float current, float dt);
+void socEstimatorGetCell(uint8_t cell, CellEstimate *estimate);
+float socEstimatorGetPackSoc(void);
+void socEstimatorGetStats(SocEstimatorStats *stats);
+
+#endif /* SOC_ESTIMATOR_H */
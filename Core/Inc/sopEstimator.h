@@ -0,0 +1,42 @@
+#ifndef SOP_ESTIMATOR_H
+#define SOP_ESTIMATOR_H
+
+#include "main.h"
+#include "packModel.h"
+
+#define SOP_UPDATE_PERIOD_MS          10U      // 100 Hz, matched by the 0x105 telemetry rate
+#define SOP_PEAK_DURATION_S           10.0f
+#define SOP_VOLTAGE_MARGIN            0.05f    // Keep the loaded cell this far inside the trip limits
+
+// Cell ratings at 25 degC and mid SoC, before derating
+#define SOP_DISCHARGE_CONTINUOUS_A    15.0f
+#define SOP_DISCHARGE_PEAK_A          20.0f
+#define SOP_CHARGE_CONTINUOUS_A       4.0f
+#define SOP_CHARGE_PEAK_A             6.0f
+
+// Derating map grid: temperature along the columns, SoC down the rows
+#define SOP_MAP_TEMPERATURE_MIN_C     -20.0f
+#define SOP_MAP_TEMPERATURE_STEP_C    10.0f
+#define SOP_MAP_TEMPERATURES          9        // -20 to 60 degC
+#define SOP_MAP_SOC_STEP              20.0f
+#define SOP_MAP_SOCS                  6        // 0 to 100 %
+
+// Pack current limits in amps, all >= 0; the series string carries one current
+typedef struct {
+    float dischargeContinuous;
+    float dischargePeak;          // Held for SOP_PEAK_DURATION_S
+    float chargeContinuous;
+    float chargePeak;
+} SopLimits;
+
+typedef struct {
+    uint32_t updates;
+    uint32_t lastUpdateCycles;
+    uint32_t worstUpdateCycles;
+} SopEstimatorStats;
+
+void sopEstimatorInit(void);
+void sopEstimatorUpdate(const BatteryPack *pack, float soc, uint8_t disabledPaths, SopLimits *limits);
+void sopEstimatorGetStats(SopEstimatorStats *stats);
+
+#endif /* SOP_ESTIMATOR_H */
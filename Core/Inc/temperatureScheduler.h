@@ -0,0 +1,28 @@
+#ifndef TEMPERATURE_SCHEDULER_H
+#define TEMPERATURE_SCHEDULER_H
+
+#include "main.h"
+#include "packConfig.h"
+
+#define TEMPERATURE_TRANSFER_TIMEOUT_MS 5U    // A 2-byte TMP102 read takes ~0.4 ms at 100 kHz
+#define TEMPERATURE_SENSOR_FAULT_LIMIT  3U    // Consecutive failures before a sensor counts as unhealthy
+
+typedef struct {
+    uint32_t reads;
+    uint32_t failures;              // NACKs and bus errors
+    uint32_t timeouts;              // No completion within TEMPERATURE_TRANSFER_TIMEOUT_MS
+    uint32_t consecutiveFailures;
+    uint32_t lastReadTick;
+    float lastTemperature;
+} TemperatureSensorStats;
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+
+void temperatureSchedulerInit(void);
+uint8_t temperatureSchedulerSweep(float temperatures[PACK_NUM_I2C_TEMPERATURES], uint8_t lost[PACK_NUM_I2C_TEMPERATURES]);
+uint8_t temperatureSchedulerIsHealthy(uint8_t sensor);
+void temperatureSchedulerGetStats(uint8_t sensor, TemperatureSensorStats *stats);
+uint32_t temperatureSchedulerGetBusRecoveries(uint8_t bus);
+
+#endif /* TEMPERATURE_SCHEDULER_H */
@@ -0,0 +1,10 @@
+#ifndef THERMISTOR_H
+#define THERMISTOR_H
+
+#include "main.h"
+#include "packConfig.h"
+
+float thermistorCodeToCelsius(uint16_t code);
+uint8_t thermistorConvert(const uint16_t *codes, float *temperatures, uint32_t count);
+
+#endif /* THERMISTOR_H */
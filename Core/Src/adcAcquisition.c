@@ -0,0 +1,160 @@
+#include "adcAcquisition.h"
+#include "main.h"
+#include "cycleCounter.h"
+
+// ADC1 regular sequence, in rank order: cell 1..6 sense dividers, then thermistors
+const uint32_t adcScanChannels[ADC_ACQ_NUM_RANKS] = {
+    ADC_CHANNEL_10,  // PC0 - Cell 1
+    ADC_CHANNEL_11,  // PC1 - Cell 2
+    ADC_CHANNEL_12,  // PC2 - Cell 3
+    ADC_CHANNEL_13,  // PC3 - Cell 4
+    ADC_CHANNEL_14,  // PC4 - Cell 5
+    ADC_CHANNEL_15,  // PC5 - Cell 6
+    ADC_CHANNEL_7,   // PA7 - Thermistor 1 (ratiometric divider from VREF)
+};
+
+// ADC2 converts this at every rank, in step with ADC1
+const uint32_t adcCurrentChannel = ADC_CHANNEL_1;   // PA1 - Current shunt
+
+// Circular DMA target, split into two halves that alternate between DMA and consumers.
+// Word-aligned: every DMA transfer is one ADC1/ADC2 pair read from the common data register.
+static uint16_t adcDmaBuffer[2 * ADC_ACQ_MAX_BLOCK_SIZE] __ALIGNED(4);
+static uint16_t sweepsPerBlock = 1;
+static volatile uint32_t blockTimestamp[2];
+
+static volatile uint32_t blockSequence = 0;
+static volatile uint32_t blockOverruns = 0;
+static AdcBlockReadyCallback blockReadyCallback = NULL;
+
+// Configure every rank of both regular sequences once, instead of per conversion. Both ADCs
+// use the same sampling time so each pair of conversions starts and ends together.
+HAL_StatusTypeDef adcAcquisitionInit(void) {
+    ADC_ChannelConfTypeDef sConfig = {0};
+    ADC_MultiModeTypeDef multimode = {0};
+
+    sConfig.SamplingTime = ADC_SAMPLETIME_144CYCLES;  // Full sweep fits a 10 kHz trigger
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        sConfig.Rank = rank + 1;
+        sConfig.Channel = adcScanChannels[rank];
+        if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        sConfig.Channel = adcCurrentChannel;
+        if (HAL_ADC_ConfigChannel(&hadc2, &sConfig) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    multimode.Mode = ADC_DUALMODE_REGSIMULT;
+    multimode.DMAAccessMode = ADC_DMAACCESSMODE_2;
+    multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_5CYCLES;
+    if (HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multimode) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    blockSequence = 0;
+    blockOverruns = 0;
+    return HAL_OK;
+}
+
+// Only valid while acquisition is stopped
+HAL_StatusTypeDef adcAcquisitionSetSweepsPerBlock(uint16_t sweeps) {
+    if (sweeps == 0 || sweeps > ADC_ACQ_MAX_SWEEPS_PER_BLOCK) {
+        return HAL_ERROR;
+    }
+    sweepsPerBlock = sweeps;
+    return HAL_OK;
+}
+
+// The slave is enabled first; the master's TIM8 trigger then starts both. The DMA length
+// counts words, one per rank.
+HAL_StatusTypeDef adcAcquisitionStart(void) {
+    blockSequence = 0;
+    if (HAL_ADC_Start(&hadc2) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    return HAL_ADCEx_MultiModeStart_DMA(&hadc1, (uint32_t *)adcDmaBuffer,
+                                        2 * ADC_ACQ_NUM_RANKS * sweepsPerBlock);
+}
+
+void adcAcquisitionStop(void) {
+    HAL_ADCEx_MultiModeStop_DMA(&hadc1);
+    HAL_ADC_Stop(&hadc2);
+}
+
+void adcAcquisitionRegisterCallback(AdcBlockReadyCallback callback) {
+    blockReadyCallback = callback;
+}
+
+// Block n (1-based) always lands in half (n - 1) % 2, so the sequence alone locates it
+static void fillBlock(uint32_t sequence, AdcBlock *block) {
+    uint32_t half = (sequence - 1) & 1U;
+
+    block->sequence = sequence;
+    block->sweeps = sweepsPerBlock;
+    block->timestamp = blockTimestamp[half];
+    block->samples = &adcDmaBuffer[half * ADC_ACQ_NUM_CHANNELS * sweepsPerBlock];
+}
+
+// Returns 0 until the first block has completed
+uint8_t adcAcquisitionGetLatestBlock(AdcBlock *block) {
+    uint32_t sequence = blockSequence;
+    if (sequence == 0) {
+        return 0;
+    }
+    fillBlock(sequence, block);
+    return 1;
+}
+
+// Returns 0 if the DMA already started overwriting the block while it was in use
+uint8_t adcAcquisitionReleaseBlock(const AdcBlock *block) {
+    if (blockSequence > block->sequence) {
+        blockOverruns++;
+        return 0;
+    }
+    return 1;
+}
+
+void adcAcquisitionAverageBlock(const AdcBlock *block, uint16_t average[ADC_ACQ_NUM_CHANNELS]) {
+    uint32_t sum[ADC_ACQ_NUM_CHANNELS] = {0};
+
+    for (uint32_t sweep = 0; sweep < block->sweeps; sweep++) {
+        const uint16_t *samples = &block->samples[sweep * ADC_ACQ_NUM_CHANNELS];
+        for (uint8_t rank = 0; rank < ADC_ACQ_NUM_CHANNELS; rank++) {
+            sum[rank] += samples[rank];
+        }
+    }
+
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_CHANNELS; rank++) {
+        average[rank] = (uint16_t)(sum[rank] / block->sweeps);
+    }
+}
+
+uint32_t adcAcquisitionGetOverruns(void) {
+    return blockOverruns;
+}
+
+static void publishBlock(void) {
+    AdcBlock block;
+
+    blockTimestamp[blockSequence & 1U] = cycleCounterNow();
+    blockSequence++;
+    if (blockReadyCallback != NULL) {
+        fillBlock(blockSequence, &block);
+        blockReadyCallback(&block);
+    }
+}
+
+// DMA finished the first half of the buffer
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) {
+    if (hadc->Instance == ADC1) {
+        publishBlock();
+    }
+}
+
+// DMA finished the second half and wrapped back to the first
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+    if (hadc->Instance == ADC1) {
+        publishBlock();
+    }
+}
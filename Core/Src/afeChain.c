@@ -0,0 +1,353 @@
+#include "afeChain.h"
+#include "checksum.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+#define AFE_COMMAND_BYTES      4
+#define AFE_DEVICE_FRAME_BYTES (AFE_REGISTER_BYTES + AFE_PEC_BYTES)
+#define AFE_TRANSFER_BYTES     (AFE_COMMAND_BYTES + AFE_NUM_DEVICES * AFE_DEVICE_FRAME_BYTES)
+
+// CFGR0: GPIO pull-downs off, reference kept on between conversions
+#define AFE_CFGR0_DEFAULT 0xFCU
+
+// Group n+1 is clocked in through one buffer pair while group n is checked from the other
+static uint8_t txBuffers[2][AFE_TRANSFER_BYTES];
+static uint8_t rxBuffers[2][AFE_TRANSFER_BYTES];
+
+static uint8_t configRegisters[AFE_NUM_DEVICES][AFE_REGISTER_BYTES];
+static float cellVoltages[PACK_NUM_CELLS];      // Last reading that passed its PEC
+static float scanVoltages[PACK_NUM_CELLS];      // cellVoltages as of the last completed scan
+static uint8_t groupsStored[AFE_NUM_DEVICES];   // Cell groups that passed their PEC this scan
+static volatile TaskHandle_t waitingTask = NULL;
+static volatile uint8_t transferFailed = 0;
+static AfeChainStats chainStats;
+
+static uint16_t auxCodes[AFE_NUM_DEVICES][AFE_AUX_REGISTERS];   // GPIO1-5 then VREF2, 100 uV/LSB
+static uint32_t scansSinceAux = AFE_AUX_SCAN_INTERVAL;              // Aux on the first scan
+
+static const uint16_t cellGroupCommands[AFE_NUM_CELL_GROUPS] = {
+    AFE_CMD_RDCVA, AFE_CMD_RDCVB, AFE_CMD_RDCVC, AFE_CMD_RDCVD
+};
+static const uint16_t auxGroupCommands[AFE_NUM_AUX_GROUPS] = {
+    AFE_CMD_RDAUXA, AFE_CMD_RDAUXB
+};
+
+// Stores one register group of one device once its PEC has passed
+typedef void (*GroupDecoder)(uint8_t device, uint8_t group, const uint8_t *registers);
+
+static void chipSelect(GPIO_PinState state) {
+    HAL_GPIO_WritePin(AFE_CS_GPIO_Port, AFE_CS_Pin, state);
+}
+
+static void buildCommand(uint16_t command, uint8_t *out) {
+    out[0] = (uint8_t)(command >> 8);
+    out[1] = (uint8_t)command;
+    uint16_t pec = checksumPec15(out, 2);
+    out[2] = (uint8_t)(pec >> 8);
+    out[3] = (uint8_t)pec;
+}
+
+// isoSPI ports drop to idle after 4.3 ms; one CS pulse per device ripples the wake-up up the chain
+static void wakeChain(void) {
+    uint8_t dummy = 0xFF;
+
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        chipSelect(GPIO_PIN_RESET);
+        HAL_SPI_Transmit(&hspi2, &dummy, 1, 1);
+        chipSelect(GPIO_PIN_SET);
+    }
+}
+
+static HAL_StatusTypeDef startTransfer(const uint8_t *tx, uint8_t *rx, uint16_t length) {
+    waitingTask = xTaskGetCurrentTaskHandle();
+    transferFailed = 0;
+    chipSelect(GPIO_PIN_RESET);
+    if (HAL_SPI_TransmitReceive_DMA(&hspi2, (uint8_t *)tx, rx, length) != HAL_OK) {
+        chipSelect(GPIO_PIN_SET);
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef waitTransfer(void) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AFE_TRANSFER_TIMEOUT_MS)) == 0) {
+        HAL_SPI_Abort(&hspi2);
+        chipSelect(GPIO_PIN_SET);
+        chainStats.timeouts++;
+        return HAL_TIMEOUT;
+    }
+    return transferFailed ? HAL_ERROR : HAL_OK;
+}
+
+static HAL_StatusTypeDef transfer(const uint8_t *tx, uint8_t *rx, uint16_t length) {
+    if (startTransfer(tx, rx, length) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    return waitTransfer();
+}
+
+// Daisy-chain writes shift through every device, so the farthest device's data goes first
+static HAL_StatusTypeDef writeConfig(void) {
+    uint8_t *tx = txBuffers[0];
+
+    buildCommand(AFE_CMD_WRCFGA, tx);
+    taskENTER_CRITICAL();
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        uint8_t *frame = &tx[AFE_COMMAND_BYTES + (AFE_NUM_DEVICES - 1U - device) * AFE_DEVICE_FRAME_BYTES];
+        memcpy(frame, configRegisters[device], AFE_REGISTER_BYTES);
+    }
+    taskEXIT_CRITICAL();
+
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        uint8_t *frame = &tx[AFE_COMMAND_BYTES + device * AFE_DEVICE_FRAME_BYTES];
+        uint16_t pec = checksumPec15(frame, AFE_REGISTER_BYTES);
+        frame[AFE_REGISTER_BYTES] = (uint8_t)(pec >> 8);
+        frame[AFE_REGISTER_BYTES + 1] = (uint8_t)pec;
+    }
+    return transfer(tx, rxBuffers[0], AFE_TRANSFER_BYTES);
+}
+
+static HAL_StatusTypeDef sendCommand(uint16_t command) {
+    buildCommand(command, txBuffers[0]);
+    return transfer(txBuffers[0], rxBuffers[0], AFE_COMMAND_BYTES);
+}
+
+static void prepareRead(uint16_t command, uint8_t *tx) {
+    buildCommand(command, tx);
+    memset(&tx[AFE_COMMAND_BYTES], 0xFF, AFE_TRANSFER_BYTES - AFE_COMMAND_BYTES);
+}
+
+static void storeCellGroup(uint8_t device, uint8_t group, const uint8_t *registers) {
+    float *cells = &cellVoltages[device * AFE_CELLS_PER_DEVICE + group * AFE_CELLS_PER_GROUP];
+
+    groupsStored[device]++;
+
+    for (uint8_t cell = 0; cell < AFE_CELLS_PER_GROUP; cell++) {
+        uint16_t code = (uint16_t)(registers[2 * cell] | (registers[2 * cell + 1] << 8));
+        cells[cell] = code * AFE_CELL_LSB_VOLTS;
+    }
+}
+
+// The temperature stage copies these out, so each group lands under a critical section
+static void storeAuxGroup(uint8_t device, uint8_t group, const uint8_t *registers) {
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < AFE_AUX_PER_GROUP; i++) {
+        auxCodes[device][group * AFE_AUX_PER_GROUP + i] = (uint16_t)(registers[2 * i] | (registers[2 * i + 1] << 8));
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Reads come back nearest device first; a group that fails its PEC keeps the previous values
+static uint8_t decodeGroup(uint8_t group, const uint8_t *rx, GroupDecoder store) {
+    uint8_t errors = 0;
+
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        const uint8_t *frame = &rx[AFE_COMMAND_BYTES + device * AFE_DEVICE_FRAME_BYTES];
+        uint16_t received = (uint16_t)((frame[AFE_REGISTER_BYTES] << 8) | frame[AFE_REGISTER_BYTES + 1]);
+
+        if (checksumPec15(frame, AFE_REGISTER_BYTES) != received) {
+            chainStats.devicePecErrors[device]++;
+            errors++;
+            continue;
+        }
+        store(device, group, frame);
+    }
+    return errors;
+}
+
+// Read register groups back to back over DMA. The next group is queued before the current
+// one is checked, so the bus never sits idle while a PEC is computed.
+static HAL_StatusTypeDef readGroups(const uint16_t *commands, uint8_t numGroups, GroupDecoder store,
+                                    uint32_t *pecErrors) {
+    prepareRead(commands[0], txBuffers[0]);
+    if (startTransfer(txBuffers[0], rxBuffers[0], AFE_TRANSFER_BYTES) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    for (uint8_t group = 0; group < numGroups; group++) {
+        if (waitTransfer() != HAL_OK) {
+            return HAL_ERROR;
+        }
+
+        if (group + 1U < numGroups) {
+            uint8_t next = (group + 1U) & 1U;
+            prepareRead(commands[group + 1U], txBuffers[next]);
+            if (startTransfer(txBuffers[next], rxBuffers[next], AFE_TRANSFER_BYTES) != HAL_OK) {
+                *pecErrors += decodeGroup(group, rxBuffers[group & 1U], store);
+                return HAL_ERROR;
+            }
+        }
+        *pecErrors += decodeGroup(group, rxBuffers[group & 1U], store);
+    }
+    return HAL_OK;
+}
+
+// GPIO1-5 and VREF2 in one conversion; the scan task runs it every AFE_AUX_SCAN_INTERVAL scans
+static HAL_StatusTypeDef measureAux(uint32_t *pecErrors) {
+    if (sendCommand(AFE_CMD_ADAX) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    vTaskDelay(pdMS_TO_TICKS(AFE_CONVERSION_TIME_MS) + 1);
+    wakeChain();
+    return readGroups(auxGroupCommands, AFE_NUM_AUX_GROUPS, storeAuxGroup, pecErrors);
+}
+
+HAL_StatusTypeDef afeChainInit(void) {
+    memset(cellVoltages, 0, sizeof(cellVoltages));
+    memset(auxCodes, 0, sizeof(auxCodes));
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        memset(configRegisters[device], 0, AFE_REGISTER_BYTES);
+        configRegisters[device][0] = AFE_CFGR0_DEFAULT;
+    }
+
+    // Core wake-up from sleep needs tWAKE per device before the chain answers. This runs before
+    // the scheduler, so it spins on the cycle counter instead of waiting for SysTick.
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        uint32_t start = cycleCounterNow();
+
+        chipSelect(GPIO_PIN_RESET);
+        while (cycleCounterNow() - start < AFE_WAKE_TIME_US * (SystemCoreClock / 1000000U)) {
+        }
+        chipSelect(GPIO_PIN_SET);
+    }
+    return HAL_OK;
+}
+
+// Broadcast one conversion, then read the four cell groups back to back over DMA; every
+// AFE_AUX_SCAN_INTERVAL scans the thermistor inputs follow. Blocks the calling task for the
+// conversion time plus the transfers. voltages always receives the last reading of every
+// cell that passed its PEC; HAL_ERROR means at least one device was not refreshed this scan.
+HAL_StatusTypeDef afeChainMeasureCells(float voltages[PACK_NUM_CELLS]) {
+    uint32_t start = cycleCounterNow();
+    HAL_StatusTypeDef status = HAL_ERROR;
+    uint32_t pecErrors = 0;
+    uint8_t complete = 1;
+
+    memset(groupsStored, 0, sizeof(groupsStored));
+    wakeChain();
+    if (writeConfig() == HAL_OK && sendCommand(AFE_CMD_ADCV) == HAL_OK) {
+        vTaskDelay(pdMS_TO_TICKS(AFE_CONVERSION_TIME_MS) + 1);
+        wakeChain();
+        status = readGroups(cellGroupCommands, AFE_NUM_CELL_GROUPS, storeCellGroup, &pecErrors);
+    }
+    memcpy(voltages, cellVoltages, sizeof(cellVoltages));
+
+    if (status == HAL_OK && ++scansSinceAux >= AFE_AUX_SCAN_INTERVAL) {
+        scansSinceAux = 0;
+        measureAux(&pecErrors);
+    }
+
+    uint32_t elapsed = cycleCounterNow() - start;
+    taskENTER_CRITICAL();
+    memcpy(scanVoltages, cellVoltages, sizeof(cellVoltages));
+    chainStats.scans++;
+    chainStats.pecErrors += pecErrors;
+    chainStats.lastScanCycles = elapsed;
+    if (elapsed > chainStats.worstScanCycles) {
+        chainStats.worstScanCycles = elapsed;
+    }
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        if (groupsStored[device] == AFE_NUM_CELL_GROUPS) {
+            chainStats.deviceStaleScans[device] = 0;
+        } else {
+            complete = 0;
+            if (chainStats.deviceStaleScans[device] < UINT16_MAX) {
+                chainStats.deviceStaleScans[device]++;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return complete ? HAL_OK : HAL_ERROR;
+}
+
+// Scans since the least recently refreshed device last returned all of its cells
+uint16_t afeChainGetStaleScans(void) {
+    uint16_t worst = 0;
+
+    taskENTER_CRITICAL();
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        if (chainStats.deviceStaleScans[device] > worst) {
+            worst = chainStats.deviceStaleScans[device];
+        }
+    }
+    taskEXIT_CRITICAL();
+    return worst;
+}
+
+// Staged in the shadow configuration and written at the start of the next scan
+void afeChainSetDischarge(uint8_t cell, uint8_t enable) {
+    if (cell >= PACK_NUM_CELLS) {
+        return;
+    }
+
+    uint8_t device = cell / AFE_CELLS_PER_DEVICE;
+    uint8_t index = cell % AFE_CELLS_PER_DEVICE;
+    uint8_t reg = (index < 8) ? 4 : 5;   // DCC1-8 in CFGR4, DCC9-12 in the low nibble of CFGR5
+    uint8_t mask = (uint8_t)(1U << (index < 8 ? index : index - 8));
+
+    taskENTER_CRITICAL();
+    if (enable) {
+        configRegisters[device][reg] |= mask;
+    } else {
+        configRegisters[device][reg] &= (uint8_t)~mask;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Every cell as of the last completed scan, never a scan in progress. Returns the number of
+// scans completed, 0 before the first.
+uint32_t afeChainGetCellVoltages(float voltages[PACK_NUM_CELLS]) {
+    uint32_t scans;
+
+    taskENTER_CRITICAL();
+    memcpy(voltages, scanVoltages, sizeof(scanVoltages));
+    scans = chainStats.scans;
+    taskEXIT_CRITICAL();
+    return scans;
+}
+
+// Thermistor dividers run from VREF2, so each GPIO reading becomes a 12-bit ratio of it,
+// the same scale the ADC thermistor ranks produce
+void afeChainGetThermistorCodes(uint16_t codes[AFE_NUM_DEVICES * AFE_THERMISTORS_PER_DEVICE]) {
+    taskENTER_CRITICAL();
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        uint32_t reference = auxCodes[device][AFE_AUX_REF2_INDEX];
+
+        for (uint8_t gpio = 0; gpio < AFE_THERMISTORS_PER_DEVICE; gpio++) {
+            uint32_t ratio = reference ? ((uint32_t)auxCodes[device][gpio] << 12) / reference : 4095U;
+            codes[device * AFE_THERMISTORS_PER_DEVICE + gpio] = (uint16_t)(ratio > 4095U ? 4095U : ratio);
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+void afeChainGetStats(AfeChainStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = chainStats;
+    taskEXIT_CRITICAL();
+}
+
+static void finishTransfer(SPI_HandleTypeDef *hspi, uint8_t failed) {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if (hspi->Instance != SPI2) {
+        return;
+    }
+    chipSelect(GPIO_PIN_SET);
+    transferFailed = failed;
+    if (waitingTask != NULL) {
+        vTaskNotifyGiveFromISR(waitingTask, &higherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    finishTransfer(hspi, 0);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    finishTransfer(hspi, 1);
+}
@@ -0,0 +1,108 @@
+#include "balancingPlanner.h"
+#include "arm_math.h"
+#include <string.h>
+
+static float bleedPower(float voltage) {
+    return voltage * voltage / BALANCE_BLEED_RESISTOR_OHM;
+}
+
+// Fraction of the time a cell's resistor conducts while it is on: 1 for on/off switches
+static float cellDuty(const float *duty, uint32_t cell) {
+    return (duty != NULL) ? duty[cell] : 1.0f;
+}
+
+void balancingPlannerInit(BalancingPlanner *planner) {
+    memset(planner, 0, sizeof(*planner));
+    planner->sinceReplanMs = BALANCE_REPLAN_MS;   // Plan on the first step
+}
+
+uint8_t balancingPlannerReplanDue(const BalancingPlanner *planner) {
+    return planner->sinceReplanMs >= BALANCE_REPLAN_MS;
+}
+
+// Every cell is bled down to the charge of the emptiest one. A cell enters the plan above
+// BALANCE_START_MAH of excess and leaves below BALANCE_STOP_MAH, so estimator noise around
+// a single threshold cannot toggle it.
+void balancingPlannerReplan(BalancingPlanner *planner, const float soc[PACK_NUM_CELLS],
+                            const float capacityMah[PACK_NUM_CELLS], const float voltages[PACK_NUM_CELLS]) {
+    float charge[PACK_NUM_CELLS];
+    float lowest;
+    uint32_t index;
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        charge[i] = soc[i] * 0.01f * capacityMah[i];
+    }
+    arm_min_f32(charge, PACK_NUM_CELLS, &lowest, &index);
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        float excess = charge[i] - lowest;
+        float threshold = (planner->remainingMs[i] > 0) ? BALANCE_STOP_MAH : BALANCE_START_MAH;
+        float bleedMa = voltages[i] / BALANCE_BLEED_RESISTOR_OHM * 1000.0f;
+
+        planner->remainingMs[i] = (excess > threshold && bleedMa > 0.0f)
+                                ? (uint32_t)(excess / bleedMa * 3600000.0f) : 0;
+    }
+    planner->sinceReplanMs = 0;
+}
+
+// Charges the elapsed time to the cells that were bleeding, then picks the next set within
+// each group's power budget: running cells keep their slot, free power goes to the longest
+// remaining bleeds. duty (NULL for on/off drive) scales both the charge removed and the power.
+// Returns how many cells changed state; active[] holds the new set.
+uint8_t balancingPlannerStep(BalancingPlanner *planner, const float voltages[PACK_NUM_CELLS],
+                             const float *duty, float hottest, uint32_t elapsedMs) {
+    uint8_t changes = 0;
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        if (!planner->active[i]) {
+            continue;
+        }
+        uint32_t bledMs = (uint32_t)(elapsedMs * cellDuty(duty, i));
+        planner->remainingMs[i] = (planner->remainingMs[i] > bledMs) ? planner->remainingMs[i] - bledMs : 0;
+        planner->dissipatedJoules += bleedPower(voltages[i]) * (bledMs / 1000.0f);
+    }
+    planner->sinceReplanMs += elapsedMs;
+
+    if (hottest > BALANCE_MAX_TEMPERATURE_C) {
+        planner->thermalPause = 1;
+    } else if (hottest < BALANCE_RESUME_TEMPERATURE_C) {
+        planner->thermalPause = 0;
+    }
+
+    for (uint32_t first = 0; first < PACK_NUM_CELLS; first += BALANCE_GROUP_CELLS) {
+        uint32_t end = (first + BALANCE_GROUP_CELLS < PACK_NUM_CELLS) ? first + BALANCE_GROUP_CELLS : PACK_NUM_CELLS;
+        uint8_t wanted[BALANCE_GROUP_CELLS] = {0};
+        float budget = planner->thermalPause ? 0.0f : BALANCE_GROUP_POWER_W;
+
+        for (uint32_t i = first; i < end; i++) {
+            float power = bleedPower(voltages[i]) * cellDuty(duty, i);
+            if (planner->active[i] && planner->remainingMs[i] > 0 && power <= budget) {
+                wanted[i - first] = 1;
+                budget -= power;
+            }
+        }
+        for (;;) {
+            uint32_t best = end;
+            for (uint32_t i = first; i < end; i++) {
+                if (!wanted[i - first] && planner->remainingMs[i] > 0 &&
+                    bleedPower(voltages[i]) * cellDuty(duty, i) <= budget &&
+                    (best == end || planner->remainingMs[i] > planner->remainingMs[best])) {
+                    best = i;
+                }
+            }
+            if (best == end) {
+                break;
+            }
+            wanted[best - first] = 1;
+            budget -= bleedPower(voltages[best]) * cellDuty(duty, best);
+        }
+
+        for (uint32_t i = first; i < end; i++) {
+            if (planner->active[i] != wanted[i - first]) {
+                planner->active[i] = wanted[i - first];
+                changes++;
+            }
+        }
+    }
+    return changes;
+}
@@ -0,0 +1,146 @@
+#include "balancingPwm.h"
+#include "balancingPlanner.h"
+
+typedef struct {
+    TIM_HandleTypeDef *timer;
+    uint32_t channel;
+} BalanceChannel;
+
+// Cell order follows Balance_Control_Pin_Cell1-6 (PB0-PB5)
+static const BalanceChannel balanceChannels[BALANCE_PWM_NUM_CHANNELS] = {
+    { &htim3, TIM_CHANNEL_3 },   // PB0
+    { &htim3, TIM_CHANNEL_4 },   // PB1
+    { &htim2, TIM_CHANNEL_4 },   // PB2
+    { &htim2, TIM_CHANNEL_2 },   // PB3
+    { &htim3, TIM_CHANNEL_1 },   // PB4
+    { &htim3, TIM_CHANNEL_2 },   // PB5
+};
+
+static uint32_t periodTicks;   // Counts between two TIM8 resets
+static uint32_t blankTicks;
+
+// TIM2 and TIM3 sit on APB1; their kernel clock doubles whenever APB1 is divided
+static uint32_t getTimerClock(void) {
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1_2) != 0U) {
+        return pclk1 * 2U;
+    }
+    return pclk1;
+}
+
+// Reset on ITR1, pass the reset on as TRGO. PWM mode 2 keeps a channel off until CNT reaches
+// CCR, so CCR past the reload is fully off.
+static HAL_StatusTypeDef initTimer(TIM_HandleTypeDef *htim, TIM_TypeDef *instance, uint32_t prescaler) {
+    TIM_SlaveConfigTypeDef sSlaveConfig = {0};
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+    TIM_OC_InitTypeDef sConfigOC = {0};
+
+    htim->Instance = instance;
+    htim->Init.Prescaler = prescaler;
+    htim->Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim->Init.Period = periodTicks + periodTicks / 32U;   // Margin so the TIM8 reset always comes first
+    htim->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_PWM_Init(htim) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sSlaveConfig.SlaveMode = TIM_SLAVEMODE_RESET;
+    sSlaveConfig.InputTrigger = TIM_TS_ITR1;
+    if (HAL_TIM_SlaveConfigSynchro(htim, &sSlaveConfig) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(htim, &sMasterConfig) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sConfigOC.OCMode = TIM_OCMODE_PWM2;
+    sConfigOC.Pulse = htim->Init.Period + 1U;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    for (uint8_t cell = 0; cell < BALANCE_PWM_NUM_CHANNELS; cell++) {
+        if (balanceChannels[cell].timer == htim &&
+            HAL_TIM_PWM_ConfigChannel(htim, &sConfigOC, balanceChannels[cell].channel) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
+
+// TIM2 is reset by TIM8 (ITR1) and passes its reset on to TIM3 (ITR1), so all six channels
+// share the sampling period and its blanking window
+HAL_StatusTypeDef balancingPwmInit(uint32_t sampleRateHz) {
+    uint32_t ticks = getTimerClock() / sampleRateHz;
+    uint32_t prescaler = (ticks - 1U) / 60000U;   // Leaves room for the reload margin in 16 bits
+
+    periodTicks = ticks / (prescaler + 1U);
+    blankTicks = (uint32_t)(((uint64_t)getTimerClock() * BALANCE_PWM_BLANK_US) / 1000000U / (prescaler + 1U));
+    if (blankTicks >= periodTicks) {
+        blankTicks = periodTicks;   // Sampling too fast to fit any bleed time; stays off
+    }
+
+    if (initTimer(&htim2, TIM2, prescaler) != HAL_OK || initTimer(&htim3, TIM3, prescaler) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    HAL_TIM_MspPostInit(&htim2);
+    HAL_TIM_MspPostInit(&htim3);
+
+    for (uint8_t cell = 0; cell < BALANCE_PWM_NUM_CHANNELS; cell++) {
+        if (HAL_TIM_PWM_Start(balanceChannels[cell].timer, balanceChannels[cell].channel) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
+
+// Fraction of each period the resistor may conduct: the part after the blanking window
+float balancingPwmGetMaxDuty(void) {
+    return (periodTicks == 0U) ? 0.0f : (float)(periodTicks - blankTicks) / (float)periodTicks;
+}
+
+// Proportional to how far the cell sits above the lowest one, derated as the board heats up,
+// and quantized so small changes in either do not rewrite the compare register
+float balancingPwmComputeDuty(float delta, float temperature) {
+    float duty = delta / BALANCE_PWM_FULL_DELTA_V;
+
+    if (duty < BALANCE_PWM_MIN_DUTY) {
+        duty = BALANCE_PWM_MIN_DUTY;
+    } else if (duty > 1.0f) {
+        duty = 1.0f;
+    }
+
+    if (temperature > BALANCE_PWM_DERATE_START_C) {
+        duty *= (BALANCE_MAX_TEMPERATURE_C - temperature) / (BALANCE_MAX_TEMPERATURE_C - BALANCE_PWM_DERATE_START_C);
+    }
+    if (duty <= 0.0f) {
+        return 0.0f;
+    }
+
+    uint32_t steps = (uint32_t)(duty * BALANCE_PWM_DUTY_STEPS + 0.5f);
+    if (steps == 0U) {
+        steps = 1U;
+    }
+    return balancingPwmGetMaxDuty() * steps / BALANCE_PWM_DUTY_STEPS;
+}
+
+// duty is the fraction of the whole period the resistor conducts, capped at the maximum;
+// the compare register is preloaded, so the change lands at the next TIM8 reset
+void balancingPwmSetDuty(uint8_t cell, float duty) {
+    if (cell >= BALANCE_PWM_NUM_CHANNELS) {
+        return;
+    }
+
+    TIM_HandleTypeDef *htim = balanceChannels[cell].timer;
+    uint32_t compare = __HAL_TIM_GET_AUTORELOAD(htim) + 1U;
+    if (duty > 0.0f) {
+        uint32_t onTicks = (uint32_t)(duty * periodTicks);
+        if (onTicks > periodTicks - blankTicks) {
+            onTicks = periodTicks - blankTicks;
+        }
+        compare = periodTicks - onTicks;
+    }
+    __HAL_TIM_SET_COMPARE(htim, balanceChannels[cell].channel, compare);
+}
@@ -1,215 +1,331 @@
 #include "batteryManagement.h"
 #include "main.h"
 #include "cellBalancing.h"
+#include "adcAcquisition.h"
+#include "coulombCounter.h"
+#include "socEstimator.h"
+#include "signalPath.h"
+#include "cellFilter.h"
+#include "overcurrentProtection.h"
+#include "afeChain.h"
+#include "thermistor.h"
+#include "chargeController.h"
+#include "faultManager.h"
 #include <stdint.h>
+#include <string.h>
 
-#define BUFFER_SIZE 10
-
-typedef enum {
-    STATUS_OK,
-    STATUS_ERROR,
-    STATUS_TIMEOUT,
-    STATUS_INVALID_PARAM
-} status_t;
-
-typedef struct {
-    float buffer[BUFFER_SIZE];
-    uint8_t head;
-    uint8_t count;
-    float sum;
-} CircularBuffer;
-
-typedef struct {
-    uint8_t channel;
-    float voltage;
-} Cell;
-
-typedef struct {
-    Cell cells[NUM_CELLS];
-    float totalVoltage;
-    float averageVoltage;
-    float current;
-    float temperature;
-} BatteryPack;
+BatteryPack batteryPack;
 
-typedef struct {
-    uint8_t overVoltageProtection;
-    uint8_t overTempProtection;
-} BatterySafety;
+// Set once the pack has charged past the top of the band; charge waits for the bottom again
+static uint8_t chargeHeldFull = 0;
 
-CircularBuffer voltageBuffer = { .head = 0, .count = 0, .sum = 0.0f };
-BatteryPack batteryPack;
-BatterySafety batterySafety;
+// Cell readings taken by readCellVoltages; only the voltage stage calls it
+static uint32_t cellReadings = 0;
 
 void batteryPackInit(void) {
-    for (uint8_t i = 0; i < NUM_CELLS; i++) {
-        batteryPack.cells[i].channel = ADC_CHANNEL_0 + i; // Assign ADC channels
-        batteryPack.cells[i].voltage = 0.0f;              // Initialize voltages to 0
+    packModelInit(&batteryPack);
+    faultManagerInit();
+}
+
+// Convert every rank of one DMA block to calibrated millivolts/milliamps
+static status_t readBlockSignals(const AdcBlock *block, signal_t signals[ADC_ACQ_NUM_CHANNELS]) {
+    signalConvertBlock(block, signals);
+    if (!adcAcquisitionReleaseBlock(block)) {
+        return STATUS_ERROR;    // DMA overwrote the block while it was being read
     }
-    batteryPack.totalVoltage = 0.0f;
-    batteryPack.averageVoltage = 0.0f;
-    batteryPack.current = 0.0f;
-    batteryPack.temperature = 0.0f;
+    return STATUS_OK;
+}
+
+// The shunt is converted alongside every rank, so the block current is the mean over all of them
+static float blockCurrent(const signal_t signals[ADC_ACQ_NUM_CHANNELS]) {
+    float sum = 0.0f;
 
-    // Initialize safety flags
-    batterySafety.overVoltageProtection = 0;
-    batterySafety.overTempProtection = 0;
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        sum += SIGNAL_TO_FLOAT(signals[ADC_ACQ_CURRENT_CHANNEL(rank)]);
+    }
+    return sum / ADC_ACQ_NUM_RANKS;
 }
 
-// Hardware Abstraction Layer for ADC Configuration
-status_t configureADCChannel(uint8_t channel) {
-    ADC_ChannelConfTypeDef sConfig = {0};
-    sConfig.Channel = channel;
-    sConfig.Rank = 1;
-    sConfig.SamplingTime = ADC_SAMPLETIME_3CYCLES;
+// Convert every rank of the most recent DMA block
+static status_t readLatestSignals(signal_t signals[ADC_ACQ_NUM_CHANNELS]) {
+    AdcBlock block;
 
-    if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK) {
-        return STATUS_ERROR;
+    if (!adcAcquisitionGetLatestBlock(&block)) {
+        return STATUS_TIMEOUT;  // No sweep has completed yet
     }
-    return STATUS_OK;
+    return readBlockSignals(&block, signals);
+}
+
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// Function to take the last completed AFE scan; the chain is scanned on its own period, so the
+// sample block only paces the hand-off. A device that fails its PECs keeps its last good
+// readings, and readCellVoltageStaleScans() says for how long.
+status_t readCellVoltages(const AdcBlock *block, float voltages[NUM_CELLS]) {
+    adcAcquisitionReleaseBlock(block);
+    cellReadings = afeChainGetCellVoltages(voltages);
+    return cellReadings > 0 ? STATUS_OK : STATUS_TIMEOUT;   // No scan has completed yet
 }
 
-// Function to read the voltage of a single cell
-status_t readCellVoltage(uint8_t channel, float *voltage) {
-    if (configureADCChannel(channel) != STATUS_OK) {
+uint16_t readCellVoltageStaleScans(void) {
+    return afeChainGetStaleScans();
+}
+#else
+// Function to run the cell ranks of one sample block through the per-cell filter bank
+status_t readCellVoltages(const AdcBlock *block, float voltages[NUM_CELLS]) {
+    signal_t signals[ADC_ACQ_NUM_CELL_CHANNELS];
+    uint8_t filtered = cellFilterProcessBlock(block, signals);
+
+    if (!adcAcquisitionReleaseBlock(block) || !filtered) {
         return STATUS_ERROR;
     }
 
-    HAL_ADC_Start(&hadc1);
-    if (HAL_ADC_PollForConversion(&hadc1, HAL_MAX_DELAY) != HAL_OK) {
-        HAL_ADC_Stop(&hadc1);
-        return STATUS_TIMEOUT;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        voltages[i] = SIGNAL_TO_FLOAT(signals[i]);
     }
-
-    uint32_t adcValue = HAL_ADC_GetValue(&hadc1);
-    HAL_ADC_Stop(&hadc1);
-
-    // Convert ADC value to voltage (assuming 12-bit ADC)
-    *voltage = (adcValue * 3.3f) / 4096.0f;
+    cellReadings++;
     return STATUS_OK;
 }
 
-void addVoltageToBuffer(CircularBuffer *cb, float newVoltage) {
-    if (cb->count < BUFFER_SIZE) {
-        cb->buffer[cb->head] = newVoltage;
-        cb->sum += newVoltage;
-        cb->count++;
-    } else {
-        cb->sum -= cb->buffer[cb->head];
-        cb->buffer[cb->head] = newVoltage;
-        cb->sum += newVoltage;
-    }
-    cb->head = (cb->head + 1) % BUFFER_SIZE;
+// Every rank is converted in every sweep, so a published reading is never stale
+uint16_t readCellVoltageStaleScans(void) {
+    return 0;
 }
+#endif /* PACK_CELL_SOURCE */
 
-float calculateAverageVoltage(CircularBuffer *cb) {
-    return cb->count == 0 ? 0.0f : cb->sum / cb->count;
+// New cell readings so far: AFE scans completed, or filtered ADC blocks. readCellVoltages
+// can hand on the same AFE scan for several blocks; this tells them apart.
+uint32_t readCellVoltageCount(void) {
+    return cellReadings;
 }
 
-// Function to update battery pack voltages
-status_t updateBatteryPackVoltages(void) {
-    float totalVoltage = 0.0f;
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// Function to pair the last AFE scan with the current of the block that paced it. The AFE
+// converts on its own clock, so the two are only aligned to within one block period.
+status_t readSynchronizedSamples(const AdcBlock *block, float voltages[NUM_CELLS], float currents[NUM_CELLS]) {
+    float current;
 
+    if (readBlockCurrent(block, &current) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    afeChainGetCellVoltages(voltages);
     for (uint8_t i = 0; i < NUM_CELLS; i++) {
-        float cellVoltage;
-        if (readCellVoltage(batteryPack.cells[i].channel, &cellVoltage) != STATUS_OK) {
-            return STATUS_ERROR;
-        }
-
-        batteryPack.cells[i].voltage = cellVoltage;
-        totalVoltage += cellVoltage;
-        addVoltageToBuffer(&voltageBuffer, cellVoltage);
+        currents[i] = current;
     }
+    return STATUS_OK;
+}
+#else
+// Function to read each cell with the current ADC2 converted in the same sampling window.
+// Block means rather than filter outputs, so the filter delay does not skew the pairs.
+status_t readSynchronizedSamples(const AdcBlock *block, float voltages[NUM_CELLS], float currents[NUM_CELLS]) {
+    signal_t signals[ADC_ACQ_NUM_CHANNELS];
 
-    batteryPack.totalVoltage = totalVoltage;
-    batteryPack.averageVoltage = calculateAverageVoltage(&voltageBuffer);
+    if (readBlockSignals(block, signals) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        voltages[i] = SIGNAL_TO_FLOAT(signals[ADC_ACQ_RANK_CHANNEL(i)]);
+        currents[i] = SIGNAL_TO_FLOAT(signals[ADC_ACQ_CURRENT_CHANNEL(i)]);
+    }
     return STATUS_OK;
 }
+#endif /* PACK_CELL_SOURCE */
+
+// Function to update battery pack voltages
+void updateBatteryPackVoltages(const float voltages[NUM_CELLS], uint16_t staleScans) {
+    memcpy(batteryPack.cellVoltages, voltages, sizeof(batteryPack.cellVoltages));
+    batteryPack.voltageStaleScans = staleScans;
+
+    // Readings arrive already filtered per cell, so the statistics are those of the true cell voltages
+    packModelUpdateVoltageStatistics(&batteryPack);
+}
+
+// Function to store the latest reading of every temperature sensor, and which ones are lost
+void updateBatteryPackTemperatures(const float temperatures[PACK_NUM_TEMPERATURES],
+                                   const uint8_t lost[PACK_NUM_TEMPERATURES]) {
+    memcpy(batteryPack.temperatures, temperatures, sizeof(batteryPack.temperatures));
+    memcpy(batteryPack.temperatureLost, lost, sizeof(batteryPack.temperatureLost));
+    packModelUpdateTemperatureStatistics(&batteryPack);
+}
 
 // Function to estimate State of Charge (SoC)
 float estimateSoc(void) {
-    if (updateBatteryPackVoltages() != STATUS_OK) {
-        return -1.0f;  // Return an invalid SoC value if an error occurs
+    // Coulomb count, anchored to the OCV table whenever the pack has rested
+    coulombCounterApplyOcv(batteryPack.voltageStats.mean);
+
+    // Prefer the per-cell EKF once it is running; it bounds SoC by the weakest cell
+    float soc = socEstimatorGetPackSoc();
+    if (soc >= 0.0f) {
+        return soc;
     }
+    return coulombCounterGetSoc();
+}
+
+// Function to convert the current channels of one sample block (assuming current sense resistor)
+status_t readBlockCurrent(const AdcBlock *block, float *current) {
+    signal_t signals[ADC_ACQ_NUM_CHANNELS];
 
-    // Simple linear SoC estimation based on average voltage of all cells
-    if (batteryPack.averageVoltage >= MAX_CELL_VOLTAGE) return 100.0f;
-    if (batteryPack.averageVoltage <= MIN_CELL_VOLTAGE) return 0.0f;
+    if (readBlockSignals(block, signals) != STATUS_OK) {
+        return STATUS_ERROR;
+    }
 
-    return ((batteryPack.averageVoltage - MIN_CELL_VOLTAGE) /
-            (MAX_CELL_VOLTAGE - MIN_CELL_VOLTAGE)) * 100.0f;
+    *current = blockCurrent(signals);
+    return STATUS_OK;
 }
 
-// Function to read battery current from ADC (assuming current sense resistor)
+// Function to read battery current from the most recent sample block
 status_t readBatteryCurrent(float *current) {
-    if (configureADCChannel(ADC_CHANNEL_1) != STATUS_OK) {
-        return STATUS_ERROR;
-    }
+    signal_t signals[ADC_ACQ_NUM_CHANNELS];
 
-    HAL_ADC_Start(&hadc1);
-    if (HAL_ADC_PollForConversion(&hadc1, HAL_MAX_DELAY) != HAL_OK) {
-        HAL_ADC_Stop(&hadc1);
-        return STATUS_TIMEOUT;
+    if (readLatestSignals(signals) != STATUS_OK) {
+        return STATUS_ERROR;
     }
 
-    uint32_t adcValue = HAL_ADC_GetValue(&hadc1);
-    HAL_ADC_Stop(&hadc1);
-
-    // Convert ADC value to current
-    *current = (adcValue * 100.0f) / 4096.0f;
-    batteryPack.current = *current;
+    *current = blockCurrent(signals);
     return STATUS_OK;
 }
 
-// Function to read battery temperature from an I2C sensor
-status_t readBatteryTemperature(float *temperature) {
-    uint8_t tempRegister = 0x00;
-    uint8_t tempData[2] = {0};
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// Function to convert the thermistor ratios the AFE chain last measured on its GPIO inputs
+status_t readThermistorTemperatures(float temperatures[PACK_NUM_THERMISTORS]) {
+    uint16_t codes[PACK_NUM_THERMISTORS];
 
-    if (HAL_I2C_Master_Transmit(&hi2c1, (uint16_t)(TEMP_SENSOR_ADDRESS << 1), &tempRegister, 1, HAL_MAX_DELAY) != HAL_OK) {
+    afeChainGetThermistorCodes(codes);
+    if (thermistorConvert(codes, temperatures, PACK_NUM_THERMISTORS) != 0) {
+        return STATUS_ERROR;    // Open or shorted sensor; values are clamped, not dropped
+    }
+    return STATUS_OK;
+}
+#else
+// Function to convert the thermistor ranks of the most recent sample block. The dividers
+// run from the ADC reference, so the raw code is already the ratio the table expects.
+status_t readThermistorTemperatures(float temperatures[PACK_NUM_THERMISTORS]) {
+    AdcBlock block;
+    uint16_t average[ADC_ACQ_NUM_CHANNELS];
+    uint16_t codes[PACK_NUM_THERMISTORS];
+
+    if (!adcAcquisitionGetLatestBlock(&block)) {
+        return STATUS_TIMEOUT;  // No sweep has completed yet
+    }
+    adcAcquisitionAverageBlock(&block, average);
+    if (!adcAcquisitionReleaseBlock(&block)) {
         return STATUS_ERROR;
     }
-
-    if (HAL_I2C_Master_Receive(&hi2c1, (uint16_t)(TEMP_SENSOR_ADDRESS << 1), tempData, 2, HAL_MAX_DELAY) != HAL_OK) {
+    for (uint8_t i = 0; i < PACK_NUM_THERMISTORS; i++) {
+        codes[i] = average[ADC_ACQ_RANK_CHANNEL(ADC_ACQ_FIRST_NTC_RANK + i)];
+    }
+    if (thermistorConvert(codes, temperatures, PACK_NUM_THERMISTORS) != 0) {
         return STATUS_ERROR;
     }
-
-    int16_t rawTemperature = (tempData[0] << 8) | tempData[1];
-    rawTemperature >>= 4;
-
-    *temperature = rawTemperature * 0.0625f;
-    batteryPack.temperature = *temperature;
     return STATUS_OK;
 }
+#endif /* PACK_CELL_SOURCE */
 
-// Safety check function
+// Safety check function, evaluated on values already stored in batteryPack
 void checkSafety(void) {
-    // Check overvoltage for each cell
-    for (uint8_t i = 0; i < NUM_CELLS; i++) {
-        if (batteryPack.cells[i].voltage > MAX_CELL_VOLTAGE) {
-            batterySafety.overVoltageProtection = 1;
-            HAL_GPIO_WritePin(Overvoltage_Protection_Port, Overvoltage_Protection_Pin, GPIO_PIN_SET);
-            return;
+    const PackStatistics *voltage = &batteryPack.voltageStats;
+
+    // The extremes tell whether any cell is out of limits; only then are the cells walked to mark which
+    if (voltage->max > MAX_CELL_VOLTAGE || voltage->min < MIN_CELL_VOLTAGE) {
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            uint8_t faults = 0;
+
+            if (batteryPack.cellVoltages[i] > MAX_CELL_VOLTAGE) {
+                faults |= CELL_FAULT_OVERVOLTAGE;
+            } else if (batteryPack.cellVoltages[i] < MIN_CELL_VOLTAGE) {
+                faults |= CELL_FAULT_UNDERVOLTAGE;
+            }
+            batteryPack.cellFaults[i] = faults;
         }
+    } else {
+        memset(batteryPack.cellFaults, 0, sizeof(batteryPack.cellFaults));
     }
 
-    // Check temperature
-    float temperature;
-    if (readBatteryTemperature(&temperature) == STATUS_OK && temperature > MAX_SAFE_TEMPERATURE) {
-        batterySafety.overTempProtection = 1;
-        HAL_GPIO_WritePin(Overtemperature_Protection_Port, Overtemperature_Protection_Pin, GPIO_PIN_SET);
-    }
+    // Every fault is debounced and classified in one pass; the indicators follow the active bits
+    faultManagerEvaluate(&batteryPack);
+    HAL_GPIO_WritePin(Overvoltage_Protection_Port, Overvoltage_Protection_Pin,
+                      faultManagerIsActive(FAULT_ID_CellOvervoltage) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(Overtemperature_Protection_Port, Overtemperature_Protection_Pin,
+                      faultManagerIsActive(FAULT_ID_Overtemperature) ? GPIO_PIN_SET : GPIO_PIN_RESET);
 }
 
-// Function to enable or disable charging based on safety status
-void controlCharging(void) {
-    if (batterySafety.overVoltageProtection || batterySafety.overTempProtection) {
+// Function to enable or disable charging based on fault state and SoC. With a charger on
+// the bus the charge controller sets the current, so the path just follows its state.
+void controlCharging(float soc) {
+    uint8_t disabledPaths = faultManagerGetDisabledPaths();
+
+    if (disabledPaths & FAULT_PATH_CHARGE) {
         disableCharging();
-    } else {
+    } else if (chargeControllerIsConnected()) {
+        if (chargeControllerGetState() == CHARGE_STATE_CHARGING) {
+            enableCharging();
+        } else {
+            disableCharging();
+        }
+    } else if (soc < 0.0f) {
+        // SoC not known yet, leave the switches as they are
+    } else if (soc > 80.0f) {
+        chargeHeldFull = 1;
+        disableCharging();
+    } else if (soc < 20.0f || !chargeHeldFull) {
+        chargeHeldFull = 0;
         enableCharging();
+    } else {
+        disableCharging();
+    }
+
+    // Decided on its own, so a charge-side fault or a charger session never leaves it cut. The
+    // watchdog already cut discharge from its ISR; its fault keeps it cut until rearmed.
+    if (disabledPaths & FAULT_PATH_DISCHARGE) {
+        disableDischarging();
+    } else if (soc < 0.0f) {
+        // SoC not known yet, leave the switch as it is
+    } else if (soc < 20.0f) {
+        disableDischarging();
+    } else {
+        enableDischarging();
     }
 }
 
+uint8_t getSafetyFlags(void) {
+    uint8_t flags = 0;
+
+    if (faultManagerIsActive(FAULT_ID_CellOvervoltage)) {
+        flags |= SAFETY_FLAG_OVERVOLTAGE;
+    }
+    if (faultManagerIsActive(FAULT_ID_Overtemperature)) {
+        flags |= SAFETY_FLAG_OVERTEMPERATURE;
+    }
+    if (faultManagerIsActive(FAULT_ID_Overcurrent)) {
+        flags |= SAFETY_FLAG_OVERCURRENT;
+    }
+    if (faultManagerIsActive(FAULT_ID_CellUndervoltage)) {
+        flags |= SAFETY_FLAG_UNDERVOLTAGE;
+    }
+    return flags;
+}
+
+// Commands from the vehicle. A rearm only re-enables the watchdog: if the current is still
+// above the trip point it fires again on the next sweep, and discharge stays with the safety stage.
+void handleBmsCommand(const CanRxFrame *frame) {
+    if (frame->header.DLC < 1) {
+        return;
+    }
+    if (frame->data[0] & BMS_COMMAND_REARM_OVERCURRENT) {
+        overcurrentProtectionRearm();
+    }
+    if (frame->data[0] & BMS_COMMAND_CLEAR_FAULTS) {
+        faultManagerClearLatched();
+    }
+}
+
+// Both paths start disabled; controlCharging enables them once the safety stage has checked
+// the pack and the fault manager has left MONITORING
+void chargeControlInit(void) {
+    chargeHeldFull = 0;
+    disableCharging();
+    disableDischarging();
+}
+
 // Enable charging
 void enableCharging(void) {
     HAL_GPIO_WritePin(Charge_Control_Port, Charge_Control_Pin, GPIO_PIN_SET);
@@ -220,14 +336,12 @@ void disableCharging(void) {
     HAL_GPIO_WritePin(Charge_Control_Port, Charge_Control_Pin, GPIO_PIN_RESET);
 }
 
-// Main battery management loop
-void batteryManagementLoop(void) {
-    if (updateBatteryPackVoltages() == STATUS_OK) {
-        readBatteryCurrent(&batteryPack.current);
-        checkSafety();
-        controlCharging();
-        balanceCells();
-    } else {
-        return
-    }
+// Enable discharging
+void enableDischarging(void) {
+    HAL_GPIO_WritePin(Discharge_Control_Port, Discharge_Control_Pin, GPIO_PIN_SET);
+}
+
+// Disable discharging
+void disableDischarging(void) {
+    HAL_GPIO_WritePin(Discharge_Control_Port, Discharge_Control_Pin, GPIO_PIN_RESET);
 }
@@ -0,0 +1,450 @@
+#include "bmsPipeline.h"
+#include "batteryManagement.h"
+#include "cellBalancing.h"
+#include "canCommunication.h"
+#include "canTelemetry.h"
+#include "canReceive.h"
+#include "chargeController.h"
+#include "packSnapshot.h"
+#include "samplingScheduler.h"
+#include "coulombCounter.h"
+#include "socEstimator.h"
+#include "dcirEstimator.h"
+#include "sopEstimator.h"
+#include "eventLog.h"
+#include "signalPath.h"
+#include "cellFilter.h"
+#include "temperatureScheduler.h"
+#include "cycleCounter.h"
+#include "afeChain.h"
+#include "arm_math.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "message_buffer.h"
+#include "cmsis_os2.h"
+
+// Notification bits the producers raise on the safety task
+#define SAFETY_EVENT_VOLTAGE     (1UL << 0)
+#define SAFETY_EVENT_CURRENT     (1UL << 1)
+#define SAFETY_EVENT_TEMPERATURE (1UL << 2)
+
+#define PIPELINE_BUFFER_DEPTH 2
+
+typedef struct {
+    uint32_t timestamp;
+    uint16_t staleScans;
+    float voltages[NUM_CELLS];
+} VoltageMessage;
+
+typedef struct {
+    uint32_t timestamp;
+    float current;
+} CurrentMessage;
+
+typedef struct {
+    uint32_t timestamp;
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t lost[PACK_NUM_TEMPERATURES];   // Left out of the statistics
+} TemperatureMessage;
+
+#define MESSAGE_BUFFER_BYTES(type) (PIPELINE_BUFFER_DEPTH * (sizeof(type) + sizeof(size_t)))
+
+static MessageBufferHandle_t voltageToSafety;
+static MessageBufferHandle_t currentToSafety;
+static MessageBufferHandle_t temperatureToSafety;
+
+static osThreadId_t voltageTaskHandle;
+static osThreadId_t currentTaskHandle;
+static osThreadId_t temperatureTaskHandle;
+static osThreadId_t safetyTaskHandle;
+static osThreadId_t balancingTaskHandle;
+static osThreadId_t canTaskHandle;
+static osThreadId_t canRxTaskHandle;
+static osThreadId_t eventLogTaskHandle;
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+static osThreadId_t cellScanTaskHandle;
+#endif
+
+static PipelineStageStats stageStats[PIPELINE_NUM_STAGES];
+
+// Safety outranks every other stage so a slow producer can never delay a trip
+// Stacks that hold pack copies grow with the cell count; a snapshot reader holds two, its own
+// and the one packSnapshotRead checks before handing it over
+static const osThreadAttr_t safetyTask_attributes = {
+  .name = "safetyTask",
+  .stack_size = 256 * 4 + sizeof(VoltageMessage) + sizeof(PackSnapshot) + 2 * PACK_NUM_CELLS * sizeof(float),
+  .priority = (osPriority_t) osPriorityRealtime,
+};
+static const osThreadAttr_t voltageTask_attributes = {
+  .name = "voltageTask",
+  .stack_size = 384 * 4 + sizeof(VoltageMessage) + 2 * PACK_NUM_CELLS * sizeof(float),
+  .priority = (osPriority_t) osPriorityHigh,
+};
+static const osThreadAttr_t currentTask_attributes = {
+  .name = "currentTask",
+  .stack_size = 384 * 4,
+  .priority = (osPriority_t) osPriorityHigh,
+};
+// Commands arrive rarely but should not wait behind telemetry packing
+static const osThreadAttr_t canRxTask_attributes = {
+  .name = "canRxTask",
+  .stack_size = 256 * 4,
+  .priority = (osPriority_t) osPriorityAboveNormal,
+};
+static const osThreadAttr_t canTask_attributes = {
+  .name = "canTask",
+  .stack_size = 256 * 4 + 2 * sizeof(PackSnapshot),
+  .priority = (osPriority_t) osPriorityNormal,
+};
+static const osThreadAttr_t balancingTask_attributes = {
+  .name = "balancingTask",
+  .stack_size = 256 * 4 + 2 * sizeof(PackSnapshot) + PACK_NUM_CELLS * sizeof(float),
+  .priority = (osPriority_t) osPriorityBelowNormal,
+};
+// Bus recovery bit-bangs with busy-wait delays, so it lives at the bottom where it cannot hold up anything else
+static const osThreadAttr_t temperatureTask_attributes = {
+  .name = "temperatureTask",
+  .stack_size = 256 * 4 + sizeof(TemperatureMessage) + PACK_NUM_THERMISTORS * sizeof(uint16_t),
+  .priority = (osPriority_t) osPriorityLow,
+};
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// Below the block consumers, so a scan's PEC decoding never delays a block hand-off; it sleeps
+// through the conversion and the DMA transfers
+static const osThreadAttr_t cellScanTask_attributes = {
+  .name = "cellScanTask",
+  .stack_size = 256 * 4 + PACK_NUM_CELLS * sizeof(float),
+  .priority = (osPriority_t) osPriorityAboveNormal,
+};
+#endif
+// Flash programming stalls instruction fetch, so commits run below everything that samples
+static const osThreadAttr_t eventLogTask_attributes = {
+  .name = "eventLogTask",
+  .stack_size = 256 * 4 + 2 * sizeof(PackSnapshot) + 64,
+  .priority = (osPriority_t) osPriorityLow,
+};
+
+static uint32_t msToCycles(uint32_t ms) {
+    return (SystemCoreClock / 1000U) * ms;
+}
+
+static void recordStageRun(PipelineStage stage, uint32_t elapsedCycles, uint32_t deadlineCycles) {
+    taskENTER_CRITICAL();
+    stageStats[stage].runs++;
+    if (elapsedCycles > stageStats[stage].worstCaseCycles) {
+        stageStats[stage].worstCaseCycles = elapsedCycles;
+    }
+    if (elapsedCycles > deadlineCycles) {
+        stageStats[stage].deadlineMisses++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void recordDrop(PipelineStage stage) {
+    taskENTER_CRITICAL();
+    stageStats[stage].droppedMessages++;
+    taskEXIT_CRITICAL();
+}
+
+// Send without blocking; a full buffer means the consumer is behind and the sample is dropped
+static void sendToStage(PipelineStage stage, MessageBufferHandle_t buffer, const void *message, size_t length) {
+    if (xMessageBufferSend(buffer, message, length, 0) != length) {
+        recordDrop(stage);
+    }
+}
+
+// Keep only the newest message waiting in a buffer
+static uint8_t receiveLatest(MessageBufferHandle_t buffer, void *message, size_t length) {
+    uint8_t received = 0;
+    while (xMessageBufferReceive(buffer, message, length, 0) == length) {
+        received = 1;
+    }
+    return received;
+}
+
+static void StartVoltageTask(void *argument) {
+    AdcBlock block;
+    VoltageMessage message;
+    float pairedVoltages[NUM_CELLS];
+    float pairedCurrents[NUM_CELLS];
+    float current;
+    uint32_t lastReading = 0;
+    uint32_t lastSequence = 0;
+
+    for (;;) {
+        if (!samplingSchedulerWaitBlock(&block, portMAX_DELAY)) {
+            continue;
+        }
+
+        message.timestamp = block.timestamp;
+        if (readCellVoltages(&block, message.voltages) == STATUS_OK) {
+            // Held readings are published too, so safety keeps running and can trip on their age
+            message.staleScans = readCellVoltageStaleScans();
+            sendToStage(STAGE_VOLTAGE, voltageToSafety, &message, sizeof(message));
+            xTaskNotify((TaskHandle_t)safetyTaskHandle, SAFETY_EVENT_VOLTAGE, eSetBits);
+
+            // The estimators need voltage and current from the same block, after the safety hand-off.
+            // DCIR takes each cell with the current converted alongside it. Neither learns from
+            // held readings, nor twice from the same AFE scan; dt spans the blocks since they last did.
+            uint32_t reading = readCellVoltageCount();
+            if (message.staleScans == 0 && reading != lastReading &&
+                readSynchronizedSamples(&block, pairedVoltages, pairedCurrents) == STATUS_OK) {
+                uint32_t blocks = lastSequence != 0 ? block.sequence - lastSequence : 1U;
+
+                arm_mean_f32(pairedCurrents, NUM_CELLS, &current);
+                socEstimatorUpdate(message.voltages, current,
+                                   (float)blocks * samplingSchedulerGetBlockPeriodCycles() / SystemCoreClock);
+                dcirEstimatorUpdate(pairedVoltages, pairedCurrents);
+                lastReading = reading;
+                lastSequence = block.sequence;
+            }
+        }
+        recordStageRun(STAGE_VOLTAGE, cycleCounterNow() - block.timestamp,
+                       samplingSchedulerGetBlockPeriodCycles());
+    }
+}
+
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// One 144S scan outlasts a sample block, so the chain is scanned on its own period and the
+// voltage stage hands on the last completed scan at every block
+static void StartCellScanTask(void *argument) {
+    float voltages[PACK_NUM_CELLS];
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        uint32_t start = cycleCounterNow();
+
+        afeChainMeasureCells(voltages);
+        recordStageRun(STAGE_CELL_SCAN, cycleCounterNow() - start, msToCycles(AFE_SCAN_PERIOD_MS));
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(AFE_SCAN_PERIOD_MS));
+    }
+}
+#endif /* PACK_CELL_SOURCE */
+
+static void StartCurrentTask(void *argument) {
+    AdcBlock block;
+    CurrentMessage message;
+
+    for (;;) {
+        if (!samplingSchedulerWaitBlock(&block, portMAX_DELAY)) {
+            continue;
+        }
+
+        // Integrate every sample for SoC before reducing the block to one reading
+        coulombCounterIntegrateBlock(&block);
+
+        message.timestamp = block.timestamp;
+        if (readBlockCurrent(&block, &message.current) == STATUS_OK) {
+            sendToStage(STAGE_CURRENT, currentToSafety, &message, sizeof(message));
+            xTaskNotify((TaskHandle_t)safetyTaskHandle, SAFETY_EVENT_CURRENT, eSetBits);
+        }
+        recordStageRun(STAGE_CURRENT, cycleCounterNow() - block.timestamp,
+                       samplingSchedulerGetBlockPeriodCycles());
+    }
+}
+
+static void StartTemperatureTask(void *argument) {
+    TemperatureMessage message = {0};   // Thermistors are never marked lost
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        uint32_t start = cycleCounterNow();
+
+        // Sleeps while the DMA reads run; a hung bus costs at most one transfer timeout per round.
+        // Thermistors follow the I2C sensors and are refreshed every period.
+        uint8_t changed = temperatureSchedulerSweep(message.temperatures, message.lost);
+        if (readThermistorTemperatures(&message.temperatures[PACK_FIRST_THERMISTOR]) != STATUS_TIMEOUT) {
+            changed = 1;
+        }
+        if (changed) {
+            message.timestamp = cycleCounterNow();
+            sendToStage(STAGE_TEMPERATURE, temperatureToSafety, &message, sizeof(message));
+            xTaskNotify((TaskHandle_t)safetyTaskHandle, SAFETY_EVENT_TEMPERATURE, eSetBits);
+        }
+        recordStageRun(STAGE_TEMPERATURE, cycleCounterNow() - start,
+                       msToCycles(PIPELINE_TEMPERATURE_PERIOD_MS));
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PIPELINE_TEMPERATURE_PERIOD_MS));
+    }
+}
+
+// Sole writer of batteryPack, the fault manager and the pack snapshot; everything it does is bounded and non-blocking
+static void StartSafetyTask(void *argument) {
+    VoltageMessage voltage;
+    CurrentMessage current;
+    TemperatureMessage temperature;
+    PackSnapshot output;
+    DcirPowerLimits limits;
+    TickType_t lastSop = 0;
+    uint32_t events;
+
+    for (;;) {
+        xTaskNotifyWait(0, 0xFFFFFFFFUL, &events, portMAX_DELAY);
+
+        if ((events & SAFETY_EVENT_CURRENT) && receiveLatest(currentToSafety, &current, sizeof(current))) {
+            batteryPack.current = current.current;
+        }
+        if ((events & SAFETY_EVENT_TEMPERATURE) &&
+            receiveLatest(temperatureToSafety, &temperature, sizeof(temperature))) {
+            updateBatteryPackTemperatures(temperature.temperatures, temperature.lost);
+        }
+        if (!(events & SAFETY_EVENT_VOLTAGE) || !receiveLatest(voltageToSafety, &voltage, sizeof(voltage))) {
+            continue;
+        }
+
+        updateBatteryPackVoltages(voltage.voltages, voltage.staleScans);
+        checkSafety();
+        output.soc = estimateSoc();
+        controlCharging(output.soc);
+
+        // Latency is measured from the moment the samples were captured
+        recordStageRun(STAGE_SAFETY, cycleCounterNow() - voltage.timestamp,
+                       (SystemCoreClock / 1000000U) * PIPELINE_SAFETY_DEADLINE_US);
+
+        dcirEstimatorGetResistances(batteryPack.cellResistance);
+        dcirEstimatorGetPowerLimits(&limits);
+        batteryPack.dischargePowerLimit = limits.dischargePower;
+        batteryPack.chargePowerLimit = limits.chargePower;
+
+        output.timestamp = voltage.timestamp;
+        cellBalancingGetActive(batteryPack.balancing);
+        output.pack = batteryPack;
+        output.safetyFlags = getSafetyFlags();
+        faultManagerGetStatus(&output.faults);
+        if ((xTaskGetTickCount() - lastSop) >= pdMS_TO_TICKS(SOP_UPDATE_PERIOD_MS)) {
+            lastSop = xTaskGetTickCount();
+            sopEstimatorUpdate(&batteryPack, output.soc, output.faults.disabledPaths, &output.powerLimits);
+        }
+        packSnapshotPublish(&output);
+    }
+}
+
+// Acts once per period on the newest pack frame, skipping the run if nothing new was published
+static void StartBalancingTask(void *argument) {
+    PackSnapshot snapshot;
+    uint32_t lastVersion = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PIPELINE_BALANCING_PERIOD_MS));
+        if (packSnapshotGetVersion() == lastVersion || !packSnapshotRead(&snapshot)) {
+            continue;
+        }
+        lastVersion = snapshot.version;
+
+        uint32_t start = cycleCounterNow();
+        balanceCells(&snapshot.pack);
+        recordStageRun(STAGE_BALANCING, cycleCounterNow() - start,
+                       msToCycles(PIPELINE_BALANCING_PERIOD_MS));
+    }
+}
+
+// Frames are packed from the newest published pack frame; nothing here touches a sensor
+static void StartCanTask(void *argument) {
+    PackSnapshot snapshot;
+    uint8_t snapshotValid = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PIPELINE_CAN_PERIOD_MS));
+        if (packSnapshotRead(&snapshot)) {
+            snapshotValid = 1;
+        }
+        if (!snapshotValid) {
+            continue;
+        }
+
+        uint32_t start = cycleCounterNow();
+        chargeControllerService(&snapshot, xTaskGetTickCount());
+        canTelemetryService(&snapshot, xTaskGetTickCount());
+        recordStageRun(STAGE_CAN, cycleCounterNow() - start, msToCycles(PIPELINE_CAN_PERIOD_MS));
+    }
+}
+
+// Logs state changes and commits batched events. Erases only while both paths are disabled:
+// no current can flow, so a sector erase stalling the CPU cannot delay a trip that matters.
+static void StartEventLogTask(void *argument) {
+    PackSnapshot snapshot;
+    BmsState lastState = BMS_STATE_IDLE;
+    uint8_t pathsDisabled = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(PIPELINE_EVENT_LOG_PERIOD_MS));
+        if (packSnapshotRead(&snapshot)) {
+            if (snapshot.faults.state != lastState) {
+                lastState = snapshot.faults.state;
+                eventLogAppend(EVENT_STATE_CHANGE, lastState);
+            }
+            pathsDisabled = (snapshot.faults.disabledPaths == FAULT_PATH_BOTH);
+        }
+
+        uint32_t start = cycleCounterNow();
+        eventLogService(pathsDisabled);
+        recordStageRun(STAGE_EVENT_LOG, cycleCounterNow() - start, msToCycles(PIPELINE_EVENT_LOG_PERIOD_MS));
+    }
+}
+
+// Runs the receive handlers on frames the CAN RX interrupts queued; handlers may block briefly
+static void StartCanRxTask(void *argument) {
+    for (;;) {
+        canReceiveDispatch(portMAX_DELAY);
+    }
+}
+
+void bmsPipelineInit(void) {
+    batteryPackInit();
+    cellBalancingInit();
+    coulombCounterInit(samplingSchedulerGetRate());
+    socEstimatorInit();
+    dcirEstimatorInit();
+    sopEstimatorInit();
+    signalPathInit();
+    canTelemetryInit();
+    chargeControllerInit();
+    temperatureSchedulerInit();
+    if (cellFilterInit(samplingSchedulerGetRate()) != HAL_OK) {
+        Error_Handler();
+    }
+
+    voltageToSafety = xMessageBufferCreate(MESSAGE_BUFFER_BYTES(VoltageMessage));
+    currentToSafety = xMessageBufferCreate(MESSAGE_BUFFER_BYTES(CurrentMessage));
+    temperatureToSafety = xMessageBufferCreate(MESSAGE_BUFFER_BYTES(TemperatureMessage));
+    if (voltageToSafety == NULL || currentToSafety == NULL || temperatureToSafety == NULL) {
+        Error_Handler();
+    }
+
+    safetyTaskHandle = osThreadNew(StartSafetyTask, NULL, &safetyTask_attributes);
+    voltageTaskHandle = osThreadNew(StartVoltageTask, NULL, &voltageTask_attributes);
+    currentTaskHandle = osThreadNew(StartCurrentTask, NULL, &currentTask_attributes);
+    temperatureTaskHandle = osThreadNew(StartTemperatureTask, NULL, &temperatureTask_attributes);
+    balancingTaskHandle = osThreadNew(StartBalancingTask, NULL, &balancingTask_attributes);
+    canTaskHandle = osThreadNew(StartCanTask, NULL, &canTask_attributes);
+    canRxTaskHandle = osThreadNew(StartCanRxTask, NULL, &canRxTask_attributes);
+    eventLogTaskHandle = osThreadNew(StartEventLogTask, NULL, &eventLogTask_attributes);
+    if (safetyTaskHandle == NULL || voltageTaskHandle == NULL || currentTaskHandle == NULL ||
+        temperatureTaskHandle == NULL || balancingTaskHandle == NULL || canTaskHandle == NULL ||
+        canRxTaskHandle == NULL || eventLogTaskHandle == NULL) {
+        Error_Handler();
+    }
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+    cellScanTaskHandle = osThreadNew(StartCellScanTask, NULL, &cellScanTask_attributes);
+    if (cellScanTaskHandle == NULL) {
+        Error_Handler();
+    }
+#endif
+    canReceiveSubscribe((TaskHandle_t)canRxTaskHandle);
+
+    // Both sample consumers are woken by the TIM8-paced block notifications
+    samplingSchedulerSubscribe((TaskHandle_t)voltageTaskHandle);
+    samplingSchedulerSubscribe((TaskHandle_t)currentTaskHandle);
+}
+
+void bmsPipelineGetStats(PipelineStage stage, PipelineStageStats *stats) {
+    if (stage >= PIPELINE_NUM_STAGES) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    *stats = stageStats[stage];
+    taskEXIT_CRITICAL();
+}
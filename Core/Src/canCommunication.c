@@ -1,109 +1,178 @@
 #include "canCommunication.h"
+#include "canReceive.h"
 #include "batteryManagement.h"
 #include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
 
 extern CAN_HandleTypeDef hcan1;
 
-typedef enum {
-    CAN_STATUS_OK,
-    CAN_STATUS_ERROR,
-    CAN_STATUS_NO_MAILBOX,
-    CAN_STATUS_TIMEOUT,
-} can_status_t;
+typedef struct {
+    uint32_t id;
+    uint8_t extended;       // 29-bit identifier
+    uint8_t length;
+    uint8_t data[8];
+} CanTxFrame;
+
+typedef struct {
+    CanTxFrame frames[CAN_TX_QUEUE_DEPTH];
+    uint8_t head;           // Next slot to write
+    uint8_t tail;           // Next frame to hand to a mailbox
+    CanTxQueueStats stats;
+} CanTxQueue;
+
+static CanTxQueue txQueues[CAN_TX_NUM_PRIORITIES];
+
+// Move queued frames into free mailboxes, highest priority first.
+// Caller must already hold a critical section (task or ISR flavour).
+static void refillMailboxes(void) {
+    CAN_TxHeaderTypeDef txHeader;
+    uint32_t txMailbox;
+
+    txHeader.RTR = CAN_RTR_DATA;          // Data frame
+    txHeader.TransmitGlobalTime = DISABLE; // No timestamp
+
+    while (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) > 0) {
+        CanTxQueue *queue = NULL;
 
-// Function to initialize CAN communication
+        for (uint8_t priority = 0; priority < CAN_TX_NUM_PRIORITIES; priority++) {
+            if (txQueues[priority].stats.depth > 0) {
+                queue = &txQueues[priority];
+                break;
+            }
+        }
+        if (queue == NULL) {
+            return;
+        }
+
+        CanTxFrame *frame = &queue->frames[queue->tail];
+        txHeader.IDE = frame->extended ? CAN_ID_EXT : CAN_ID_STD;
+        txHeader.StdId = frame->extended ? 0 : frame->id;
+        txHeader.ExtId = frame->extended ? frame->id : 0;
+        txHeader.DLC = frame->length;
+        if (HAL_CAN_AddTxMessage(&hcan1, &txHeader, frame->data, &txMailbox) != HAL_OK) {
+            return;  // Peripheral not started or in error; the frame stays queued
+        }
+
+        queue->tail = (uint8_t)((queue->tail + 1) % CAN_TX_QUEUE_DEPTH);
+        queue->stats.depth--;
+        queue->stats.sent++;
+    }
+}
+
+// Function to initialize CAN communication; call once, before the scheduler starts
 can_status_t canInit(void) {
+    memset(txQueues, 0, sizeof(txQueues));
+
+    // Filter banks from the receive table; nothing else reaches the FIFOs
+    if (canReceiveInit() != HAL_OK) {
+        return CAN_STATUS_ERROR;
+    }
+
+    // Mailboxes go out in request order. By identifier, two frames with the same ID could swap
+    // (the tie goes to the lower mailbox), splitting multi-frame records such as the event log
+    // readout. Priority is already settled by the rings. Still in init mode, so MCR is writable.
+    hcan1.Init.TransmitFifoPriority = ENABLE;
+    SET_BIT(hcan1.Instance->MCR, CAN_MCR_TXFP);
+
     // Start the CAN peripheral
     if (HAL_CAN_Start(&hcan1) != HAL_OK) {
         return CAN_STATUS_ERROR;
     }
 
-    // Optionally, activate CAN notifications (interrupts) for RX, etc.
-    if (HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO0_MSG_PENDING) != HAL_OK) {
+    // Both RX FIFOs and their overruns, plus a TX interrupt whenever a mailbox empties so the queues keep draining
+    if (HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO0_OVERRUN |
+                                             CAN_IT_RX_FIFO1_MSG_PENDING | CAN_IT_RX_FIFO1_OVERRUN |
+                                             CAN_IT_TX_MAILBOX_EMPTY) != HAL_OK) {
         return CAN_STATUS_ERROR;
     }
 
     return CAN_STATUS_OK;
 }
 
-// Function to transmit data via CAN
-can_status_t canTransmitMessage(uint32_t id, uint8_t *data, uint8_t length) {
-    CAN_TxHeaderTypeDef txHeader;
-    uint32_t txMailbox;
+// Queue one frame for transmission from task context; never blocks
+static can_status_t queueFrame(uint32_t id, uint8_t extended, const uint8_t *data, uint8_t length, CanTxPriority priority) {
+    if (length > 8 || priority >= CAN_TX_NUM_PRIORITIES) {
+        return CAN_STATUS_ERROR;
+    }
 
-    // Set up CAN header
-    txHeader.StdId = id;                  // Standard ID
-    txHeader.RTR = CAN_RTR_DATA;          // Data frame
-    txHeader.IDE = CAN_ID_STD;            // Standard identifier
-    txHeader.DLC = length;                // Data length code
-    txHeader.TransmitGlobalTime = DISABLE; // No timestamp
+    CanTxQueue *queue = &txQueues[priority];
+    can_status_t status = CAN_STATUS_OK;
 
-    // Check if there is space in the mailbox
-    if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) > 0) {
-        // Attempt to transmit the CAN message
-        if (HAL_CAN_AddTxMessage(&hcan1, &txHeader, data, &txMailbox) != HAL_OK) {
-            return CAN_STATUS_ERROR;  // Transmission error
-        }
+    taskENTER_CRITICAL();
+    if (queue->stats.depth >= CAN_TX_QUEUE_DEPTH) {
+        queue->stats.dropped++;
+        status = CAN_STATUS_QUEUE_FULL;
     } else {
-        // No mailbox available
-        return CAN_STATUS_NO_MAILBOX;
+        CanTxFrame *frame = &queue->frames[queue->head];
+        frame->id = id;
+        frame->extended = extended;
+        frame->length = length;
+        memcpy(frame->data, data, length);
+        queue->head = (uint8_t)((queue->head + 1) % CAN_TX_QUEUE_DEPTH);
+        queue->stats.depth++;
+        queue->stats.queued++;
+        if (queue->stats.depth > queue->stats.peakDepth) {
+            queue->stats.peakDepth = queue->stats.depth;
+        }
+
+        // Idle bus: go straight to a mailbox instead of waiting for the next TX interrupt
+        refillMailboxes();
     }
+    taskEXIT_CRITICAL();
 
-    return CAN_STATUS_OK;
+    return status;
 }
 
-// Function to prepare BMS data to transmit via CAN
-can_status_t canTransmitBmsData(void) {
-    uint8_t bmsData[8] = {0};
-    float voltage = 0.0f, current = 0.0f, soc = 0.0f;
+can_status_t canTransmitMessage(uint32_t id, const uint8_t *data, uint8_t length, CanTxPriority priority) {
+    return queueFrame(id, 0, data, length, priority);
+}
+
+// 29-bit identifier, for devices such as the charger that use J1939-style IDs
+can_status_t canTransmitExtendedMessage(uint32_t id, const uint8_t *data, uint8_t length, CanTxPriority priority) {
+    return queueFrame(id, 1, data, length, priority);
+}
 
-    // Read and scale BMS data
-    if (readBatteryVoltage(&voltage) != STATUS_OK ||
-        readBatteryCurrent(&current) != STATUS_OK ||
-        estimateSoc(&soc) != STATUS_OK) {
-        return CAN_STATUS_ERROR;  // Return if unable to read required data
+void canGetTxQueueStats(CanTxPriority priority, CanTxQueueStats *stats) {
+    if (priority >= CAN_TX_NUM_PRIORITIES) {
+        return;
     }
+    taskENTER_CRITICAL();
+    *stats = txQueues[priority].stats;
+    taskEXIT_CRITICAL();
+}
 
-    int voltage_scaled = (int)(voltage * 100);   // Scale to centivolts (2 decimal places)
-    int current_scaled = (int)(current * 100);   // Scale to centiamps
-    int soc_scaled = (int)(soc * 100);           // Scale to percentage (0–100%)
-
-    // Fill CAN data bytes
-    bmsData[0] = (uint8_t)(voltage_scaled & 0xFF);
-    bmsData[1] = (uint8_t)((voltage_scaled >> 8) & 0xFF);
-    bmsData[2] = (uint8_t)(current_scaled & 0xFF);
-    bmsData[3] = (uint8_t)((current_scaled >> 8) & 0xFF);
-    bmsData[4] = (uint8_t)(soc_scaled & 0xFF);
-    bmsData[5] = (uint8_t)((soc_scaled >> 8) & 0xFF);
-
-    // Attempt to transmit the CAN message with BMS data
-    can_status_t status = canTransmitMessage(0x321, bmsData, 6);
-    if (status != CAN_STATUS_OK) {
-        // Handle error: logging, retrying, or other actions can be implemented here
-        return status;
+// A mailbox finished (sent or aborted): hand it the next queued frame
+static void onMailboxFree(CAN_HandleTypeDef *hcan) {
+    if (hcan->Instance != CAN1) {
+        return;
     }
+    UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    refillMailboxes();
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+}
 
-    return CAN_STATUS_OK;
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
 }
 
-// Main CAN communication loop (example usage)
-void canCommunicationLoop(void) {
-    // Initialize CAN communication
-    can_status_t initStatus = canInit();
-    if (initStatus != CAN_STATUS_OK) {
-        // Handle initialization error (e.g., log error, retry initialization, etc.)
-        Error_Handler();
-    }
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
+}
 
-    // Transmit BMS data
-    can_status_t transmitStatus = canTransmitBmsData();
-    if (transmitStatus != CAN_STATUS_OK) {
-        // Implement proper error handling based on the returned status
-        // For example, log error or retry based on CAN_STATUS_NO_MAILBOX
-        if (transmitStatus == CAN_STATUS_NO_MAILBOX) {
-            // Retry logic or queue for later transmission
-        } else {
-            Error_Handler();
-        }
-    }
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
+}
+
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
+}
+
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
+}
+
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) {
+    onMailboxFree(hcan);
 }
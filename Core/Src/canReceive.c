@@ -0,0 +1,206 @@
+#include "canReceive.h"
+#include "cycleCounter.h"
+#include <string.h>
+
+typedef struct {
+    uint32_t id;
+    uint32_t mask;
+    uint8_t extended;
+    CanRxPriority priority;
+    CanRxHandler handler;
+} CanRxHandlerInfo;
+
+#define CAN_RX_HANDLER_DECLARE(name, id, mask, extended, priority, handler) \
+    void handler(const CanRxFrame *frame);
+CAN_RX_HANDLERS(CAN_RX_HANDLER_DECLARE)
+#undef CAN_RX_HANDLER_DECLARE
+
+#define CAN_RX_HANDLER_INFO(name, id, mask, extended, priority, handler) \
+    { id, mask, extended, priority, handler },
+static const CanRxHandlerInfo handlerInfo[CAN_RX_NUM_HANDLERS] = {
+    CAN_RX_HANDLERS(CAN_RX_HANDLER_INFO)
+};
+#undef CAN_RX_HANDLER_INFO
+
+// One single-producer/single-consumer ring per FIFO: the ISR fills slots at head, the
+// dispatcher hands them out at tail and frees each one only after its handler returns
+typedef struct {
+    CanRxFrame slots[CAN_RX_POOL_DEPTH];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    CanRxStats stats;
+} CanRxRing;
+
+// Set by the CAN1 RX IRQ handlers on entry, so the ISR cost includes the HAL dispatch
+volatile uint32_t canRxIrqEntryCycles = 0;
+
+static CanRxRing rings[CAN_RX_NUM_PRIORITIES];
+static CanRxFrame discardSlot;   // Read target when the ring is full, so the FIFO still drains
+
+// Filter match index -> table entry, per FIFO. Each 32-bit mask bank is one filter number,
+// counted in bank order among the banks assigned to the same FIFO.
+static uint8_t matchHandler[CAN_RX_NUM_PRIORITIES][CAN_RX_FILTER_BANKS];
+static uint8_t matchCount[CAN_RX_NUM_PRIORITIES];
+
+static TaskHandle_t consumer = NULL;
+
+// bxCAN 32-bit filter layout: STID[31:21] or EXID[31:3], IDE bit 2, RTR bit 1.
+// IDE and RTR are always compared, so only data frames of the right ID type pass.
+static uint32_t filterWord(uint32_t id, uint8_t extended) {
+    return extended ? ((id << 3) | CAN_ID_EXT) : (id << 21);
+}
+
+// One bank per table entry, FIFO chosen by the entry's priority; call before HAL_CAN_Start
+HAL_StatusTypeDef canReceiveInit(void) {
+    CAN_FilterTypeDef filter = {0};
+
+    if (CAN_RX_NUM_HANDLERS > CAN_RX_FILTER_BANKS) {
+        return HAL_ERROR;
+    }
+    memset(rings, 0, sizeof(rings));
+    memset(matchCount, 0, sizeof(matchCount));
+
+    filter.FilterMode = CAN_FILTERMODE_IDMASK;
+    filter.FilterScale = CAN_FILTERSCALE_32BIT;
+    filter.FilterActivation = ENABLE;
+    filter.SlaveStartFilterBank = CAN_RX_FILTER_BANKS;
+
+    for (uint8_t i = 0; i < CAN_RX_NUM_HANDLERS; i++) {
+        const CanRxHandlerInfo *info = &handlerInfo[i];
+        uint32_t id = filterWord(info->id, info->extended);
+        uint32_t mask = filterWord(info->mask, info->extended) | CAN_ID_EXT | CAN_RTR_REMOTE;
+
+        filter.FilterBank = i;
+        filter.FilterIdHigh = id >> 16;
+        filter.FilterIdLow = id & 0xFFFFU;
+        filter.FilterMaskIdHigh = mask >> 16;
+        filter.FilterMaskIdLow = mask & 0xFFFFU;
+        filter.FilterFIFOAssignment = (info->priority == CAN_RX_PRIORITY_HIGH) ? CAN_FILTER_FIFO0 : CAN_FILTER_FIFO1;
+        if (HAL_CAN_ConfigFilter(&hcan1, &filter) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        matchHandler[info->priority][matchCount[info->priority]++] = i;
+    }
+    return HAL_OK;
+}
+
+// The dispatching task; notified once per enqueued frame batch
+void canReceiveSubscribe(TaskHandle_t task) {
+    consumer = task;
+}
+
+// ISR side: copy nothing, decode nothing. The mailbox is read straight into the next free
+// slot, the slot is published and the dispatcher is woken.
+static void onMessagePending(CAN_HandleTypeDef *hcan, CanRxPriority priority) {
+    if (hcan->Instance != CAN1) {
+        return;
+    }
+
+    uint32_t start = canRxIrqEntryCycles;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    CanRxRing *ring = &rings[priority];
+    uint32_t fifo = (priority == CAN_RX_PRIORITY_HIGH) ? CAN_RX_FIFO0 : CAN_RX_FIFO1;
+    uint32_t head = ring->head;
+    uint32_t depth = head - ring->tail;
+
+    if (depth >= CAN_RX_POOL_DEPTH) {
+        HAL_CAN_GetRxMessage(hcan, fifo, &discardSlot.header, discardSlot.data);
+        ring->stats.dropped++;
+        return;
+    }
+
+    CanRxFrame *slot = &ring->slots[head % CAN_RX_POOL_DEPTH];
+    if (HAL_CAN_GetRxMessage(hcan, fifo, &slot->header, slot->data) != HAL_OK) {
+        return;
+    }
+    slot->timestamp = start;
+    __DMB();
+    ring->head = head + 1U;
+
+    ring->stats.received++;
+    if (depth + 1U > ring->stats.peakDepth) {
+        ring->stats.peakDepth = (uint16_t)(depth + 1U);
+    }
+
+    if (consumer != NULL) {
+        xTaskNotifyFromISR(consumer, 1UL << priority, eSetBits, &higherPriorityTaskWoken);
+    }
+
+    uint32_t elapsed = cycleCounterNow() - start;
+    ring->stats.lastIsrCycles = elapsed;
+    if (elapsed > ring->stats.worstIsrCycles) {
+        ring->stats.worstIsrCycles = elapsed;
+    }
+    if (elapsed > (SystemCoreClock / 1000000U) * CAN_RX_MIN_FRAME_US) {
+        ring->stats.overBudget++;
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static CanRxFrame *nextFrame(CanRxPriority *priority) {
+    for (uint8_t p = 0; p < CAN_RX_NUM_PRIORITIES; p++) {
+        CanRxRing *ring = &rings[p];
+
+        if (ring->head != ring->tail) {
+            *priority = (CanRxPriority)p;
+            return &ring->slots[ring->tail % CAN_RX_POOL_DEPTH];
+        }
+    }
+    return NULL;
+}
+
+// Task side: wait for frames, then run handlers until both rings are empty. FIFO0 is
+// re-checked before every frame, so a high-priority frame never waits behind a FIFO1 backlog.
+void canReceiveDispatch(TickType_t timeout) {
+    CanRxPriority priority;
+    CanRxFrame *frame;
+
+    if (xTaskNotifyWait(0, 0xFFFFFFFFUL, NULL, timeout) != pdTRUE) {
+        return;
+    }
+
+    while ((frame = nextFrame(&priority)) != NULL) {
+        uint32_t index = frame->header.FilterMatchIndex;
+
+        if (index < matchCount[priority]) {
+            handlerInfo[matchHandler[priority][index]].handler(frame);
+        } else {
+            taskENTER_CRITICAL();
+            rings[priority].stats.unmatched++;
+            taskEXIT_CRITICAL();
+        }
+        __DMB();
+        rings[priority].tail++;
+    }
+}
+
+void canReceiveGetStats(CanRxPriority priority, CanRxStats *stats) {
+    if (priority >= CAN_RX_NUM_PRIORITIES) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    *stats = rings[priority].stats;
+    taskEXIT_CRITICAL();
+}
+
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+    onMessagePending(hcan, CAN_RX_PRIORITY_HIGH);
+}
+
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+    onMessagePending(hcan, CAN_RX_PRIORITY_LOW);
+}
+
+// A FIFO overrun means the hardware FIFO filled before the ISR could empty it
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) {
+    if (hcan->Instance != CAN1) {
+        return;
+    }
+    if (hcan->ErrorCode & HAL_CAN_ERROR_RX_FOV0) {
+        rings[CAN_RX_PRIORITY_HIGH].stats.overruns++;
+    }
+    if (hcan->ErrorCode & HAL_CAN_ERROR_RX_FOV1) {
+        rings[CAN_RX_PRIORITY_LOW].stats.overruns++;
+    }
+    HAL_CAN_ResetError(hcan);
+}
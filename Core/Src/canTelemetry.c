@@ -0,0 +1,157 @@
+#include "canTelemetry.h"
+#include "task.h"
+#include <math.h>
+
+typedef struct {
+    uint16_t id;
+    uint8_t dlc;
+    uint8_t frames;
+    uint16_t defaultPeriodMs;
+    CanTxPriority priority;
+} TelemetryMessageInfo;
+
+typedef struct {
+    TelemetryMessage message;
+    int8_t mux;
+    uint8_t startBit;
+    uint8_t length;
+    uint8_t isSigned;
+    float factor;
+    float offset;
+} TelemetrySignalInfo;
+
+#define TELEMETRY_MESSAGE_INFO(message, id, dlc, frames, periodMs, priority) \
+    { id, dlc, frames, periodMs, priority },
+static const TelemetryMessageInfo messageInfo[TELEMETRY_NUM_MESSAGES] = {
+    TELEMETRY_MESSAGES(TELEMETRY_MESSAGE_INFO)
+};
+#undef TELEMETRY_MESSAGE_INFO
+
+#define TELEMETRY_SIGNAL_ENUM(message, signal, mux, start, length, isSigned, factor, offset, unit, source) \
+    TELEMETRY_SIG_##message##_##signal,
+typedef enum {
+    TELEMETRY_SIGNALS(TELEMETRY_SIGNAL_ENUM)
+    TELEMETRY_NUM_SIGNALS
+} TelemetrySignal;
+#undef TELEMETRY_SIGNAL_ENUM
+
+#define TELEMETRY_SIGNAL_INFO(message, signal, mux, start, length, isSigned, factor, offset, unit, source) \
+    { TELEMETRY_MSG_##message, mux, start, length, isSigned, factor, offset },
+static const TelemetrySignalInfo signalInfo[TELEMETRY_NUM_SIGNALS] = {
+    TELEMETRY_SIGNALS(TELEMETRY_SIGNAL_INFO)
+};
+#undef TELEMETRY_SIGNAL_INFO
+
+static uint16_t periodMs[TELEMETRY_NUM_MESSAGES];
+static TickType_t lastSent[TELEMETRY_NUM_MESSAGES];
+static uint8_t sentOnce[TELEMETRY_NUM_MESSAGES];
+static uint8_t nextFrame[TELEMETRY_NUM_MESSAGES];   // Where a long message resumes next period
+
+static float telemetryTemperature(const PackSnapshot *snap, uint32_t index) {
+    if (index >= PACK_NUM_TEMPERATURES || snap->pack.temperatureLost[index]) {
+        return TELEMETRY_TEMPERATURE_NONE;
+    }
+    return snap->pack.temperatures[index];
+}
+
+// Physical value of one signal, straight from the snapshot
+static float signalValue(TelemetrySignal signal, const PackSnapshot *snap, uint8_t frame) {
+    switch (signal) {
+#define TELEMETRY_SIGNAL_CASE(message, name, mux, start, length, isSigned, factor, offset, unit, source) \
+    case TELEMETRY_SIG_##message##_##name: return (float)(source);
+    TELEMETRY_SIGNALS(TELEMETRY_SIGNAL_CASE)
+#undef TELEMETRY_SIGNAL_CASE
+    default:
+        return 0.0f;
+    }
+}
+
+// Scale, saturate to the field width and place the raw value little-endian
+static uint64_t packSignal(const TelemetrySignalInfo *info, float value, uint64_t payload) {
+    int64_t raw = (int64_t)lroundf((value - info->offset) / info->factor);
+    int64_t minRaw = info->isSigned ? -((int64_t)1 << (info->length - 1)) : 0;
+    int64_t maxRaw = info->isSigned ? ((int64_t)1 << (info->length - 1)) - 1 : ((int64_t)1 << info->length) - 1;
+    uint64_t mask = ((uint64_t)1 << info->length) - 1U;
+
+    if (raw < minRaw) {
+        raw = minRaw;
+    } else if (raw > maxRaw) {
+        raw = maxRaw;
+    }
+    return payload | (((uint64_t)raw & mask) << info->startBit);
+}
+
+// At most TELEMETRY_MAX_FRAMES_PER_PERIOD frames, so one message cannot fill the TX queue
+static void sendMessage(TelemetryMessage message, const PackSnapshot *snap) {
+    const TelemetryMessageInfo *info = &messageInfo[message];
+    uint8_t count = (info->frames < TELEMETRY_MAX_FRAMES_PER_PERIOD) ? info->frames : TELEMETRY_MAX_FRAMES_PER_PERIOD;
+    uint8_t frame = nextFrame[message];
+
+    for (uint8_t sent = 0; sent < count; sent++) {
+        uint64_t payload = 0;
+        uint8_t data[8];
+
+        for (uint8_t signal = 0; signal < TELEMETRY_NUM_SIGNALS; signal++) {
+            const TelemetrySignalInfo *signalDesc = &signalInfo[signal];
+
+            if (signalDesc->message != message) {
+                continue;
+            }
+            if (signalDesc->mux >= 0 && signalDesc->mux != frame) {
+                continue;
+            }
+            payload = packSignal(signalDesc, signalValue((TelemetrySignal)signal, snap, frame), payload);
+        }
+
+        for (uint8_t i = 0; i < 8; i++) {
+            data[i] = (uint8_t)(payload >> (8U * i));
+        }
+        canTransmitMessage(info->id, data, info->dlc, info->priority);
+        frame = (frame + 1U < info->frames) ? frame + 1U : 0U;
+    }
+    nextFrame[message] = frame;
+}
+
+void canTelemetryInit(void) {
+    for (uint8_t message = 0; message < TELEMETRY_NUM_MESSAGES; message++) {
+        periodMs[message] = messageInfo[message].defaultPeriodMs;
+        sentOnce[message] = 0;
+        nextFrame[message] = 0;
+    }
+}
+
+// 0 disables the message; the CAN stage must be woken at least this often for the rate to hold
+void canTelemetrySetPeriod(TelemetryMessage message, uint16_t period) {
+    if (message >= TELEMETRY_NUM_MESSAGES) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    periodMs[message] = period;
+    taskEXIT_CRITICAL();
+}
+
+// 0x201: byte 0 is the message index in table order, bytes 1-2 the new period in ms (LE)
+void canTelemetryHandleConfig(const CanRxFrame *frame) {
+    if (frame->header.DLC < 3) {
+        return;
+    }
+    canTelemetrySetPeriod((TelemetryMessage)frame->data[0], (uint16_t)(frame->data[1] | (frame->data[2] << 8)));
+}
+
+// Send every message whose period has elapsed, all packed from the same snapshot
+void canTelemetryService(const PackSnapshot *snap, TickType_t now) {
+    for (uint8_t message = 0; message < TELEMETRY_NUM_MESSAGES; message++) {
+        uint16_t period = periodMs[message];
+
+        if (period == 0) {
+            continue;
+        }
+        if (sentOnce[message] && (now - lastSent[message]) < pdMS_TO_TICKS(period)) {
+            continue;
+        }
+
+        sendMessage((TelemetryMessage)message, snap);
+        lastSent[message] = now;
+        sentOnce[message] = 1;
+    }
+}
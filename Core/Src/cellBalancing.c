@@ -1,78 +1,135 @@
 #include "cellBalancing.h"
 #include "main.h"
-
-#define BALANCE_THRESHOLD 0.05f  // 50mV difference between cells
+#include "afeChain.h"
+#include "balancingPlanner.h"
+#include "balancingPwm.h"
+#include "samplingScheduler.h"
+#include "socEstimator.h"
+#include "coulombCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
 typedef struct {
     uint8_t isBalancing;
-    GPIO_TypeDef* balancePort;
-    uint16_t balancePin;
+    float duty;            // Fraction of the time the resistor conducts
 } CellBalancer;
 
 CellBalancer cellBalancers[NUM_CELLS];  // Define balancers for each cell
 
-extern BatteryPack batteryPack;  // Reference to battery pack data
+static BalancingPlanner planner;
+static TickType_t lastBalanceTick;
 
-// Initialize the cell balancing system
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+// Each AFE drives the bleed resistors of its own module through its DCC bits; ADCV is sent
+// with discharge not permitted, so the AFE itself pauses them while it converts.
+// afeChainInit() already cleared every DCC bit; this runs before the scheduler, where the
+// lock in afeChainSetDischarge() must not be taken.
 void cellBalancingInit(void) {
-    // Assign GPIO ports and pins for each cell balancer
-    cellBalancers[0].balancePort = Balance_Control_Port_Cell1;
-    cellBalancers[0].balancePin = Balance_Control_Pin_Cell1;
-    
-    cellBalancers[1].balancePort = Balance_Control_Port_Cell2;
-    cellBalancers[1].balancePin = Balance_Control_Pin_Cell2;
-
-    cellBalancers[2].balancePort = Balance_Control_Port_Cell3;
-    cellBalancers[2].balancePin = Balance_Control_Pin_Cell3;
-
-    cellBalancers[3].balancePort = Balance_Control_Port_Cell4;
-    cellBalancers[3].balancePin = Balance_Control_Pin_Cell4;
-
-    cellBalancers[4].balancePort = Balance_Control_Port_Cell5;
-    cellBalancers[4].balancePin = Balance_Control_Pin_Cell5;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        cellBalancers[i].isBalancing = 0;
+        cellBalancers[i].duty = 0.0f;
+    }
+    balancingPlannerInit(&planner);
+}
 
-    cellBalancers[5].balancePort = Balance_Control_Port_Cell6;
-    cellBalancers[5].balancePin = Balance_Control_Pin_Cell6;
+// DCC bits are on/off only
+static float bleedDuty(const BatteryPack *pack, uint8_t cellIndex) {
+    (void)pack;
+    (void)cellIndex;
+    return 1.0f;
+}
 
+static void setBalancingDuty(uint8_t cellIndex, float duty) {
+    afeChainSetDischarge(cellIndex, duty > 0.0f);
+    cellBalancers[cellIndex].isBalancing = duty > 0.0f;
+    cellBalancers[cellIndex].duty = (duty > 0.0f) ? 1.0f : 0.0f;
+}
+#else
+// Initialize the cell balancing system: one PWM channel per bleed resistor, synchronized
+// to the sampling timer
+void cellBalancingInit(void) {
     for (uint8_t i = 0; i < NUM_CELLS; i++) {
         cellBalancers[i].isBalancing = 0;
+        cellBalancers[i].duty = 0.0f;
     }
+    if (balancingPwmInit(samplingSchedulerGetRate()) != HAL_OK) {
+        Error_Handler();
+    }
+    balancingPlannerInit(&planner);
+}
+
+// Proportional to the cell's distance from the lowest one and derated with the hottest sensor
+static float bleedDuty(const BatteryPack *pack, uint8_t cellIndex) {
+    return balancingPwmComputeDuty(pack->cellVoltages[cellIndex] - pack->voltageStats.min,
+                                   pack->temperatureStats.max);
+}
+
+static void setBalancingDuty(uint8_t cellIndex, float duty) {
+    balancingPwmSetDuty(cellIndex, duty);
+    cellBalancers[cellIndex].isBalancing = duty > 0.0f;
+    cellBalancers[cellIndex].duty = duty;
 }
+#endif /* PACK_CELL_SOURCE */
 
+// Full duty (as much as the sampling window leaves), for manual control and tests on the bench
 void activateBalancing(uint8_t cellIndex) {
-    HAL_GPIO_WritePin(cellBalancers[cellIndex].balancePort, cellBalancers[cellIndex].balancePin, GPIO_PIN_SET);
-    cellBalancers[cellIndex].isBalancing = 1;
+    setBalancingDuty(cellIndex, 1.0f);
 }
 
 void deactivateBalancing(uint8_t cellIndex) {
-    HAL_GPIO_WritePin(cellBalancers[cellIndex].balancePort, cellBalancers[cellIndex].balancePin, GPIO_PIN_RESET);
-    cellBalancers[cellIndex].isBalancing = 0;
+    setBalancingDuty(cellIndex, 0.0f);
 }
 
-void balanceCells(void) {
-    float maxVoltage = batteryPack.cells[0].voltage;
-    float minVoltage = batteryPack.cells[0].voltage;
+// Per-cell SoC and usable capacity for the planner. Until the EKF has run, SoC comes from the
+// OCV table and every cell is assumed to have its rated capacity.
+static void readCellCharge(const BatteryPack *pack, float soc[NUM_CELLS], float capacityMah[NUM_CELLS]) {
+    uint8_t estimatorRunning = socEstimatorGetPackSoc() >= 0.0f;
 
-    for (uint8_t i = 1; i < NUM_CELLS; i++) {
-        if (batteryPack.cells[i].voltage > maxVoltage) {
-            maxVoltage = batteryPack.cells[i].voltage;
-        }
-        if (batteryPack.cells[i].voltage < minVoltage) {
-            minVoltage = batteryPack.cells[i].voltage;
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        CellEstimate estimate;
+
+        if (estimatorRunning) {
+            socEstimatorGetCell(i, &estimate);
+            soc[i] = estimate.soc;
+            capacityMah[i] = COULOMB_CAPACITY_MAH * estimate.soh * 0.01f;
+        } else {
+            soc[i] = ocvToSoc(pack->cellVoltages[i]);
+            capacityMah[i] = COULOMB_CAPACITY_MAH;
         }
     }
-    
-    if (maxVoltage - minVoltage > BALANCE_THRESHOLD) {
-        for (uint8_t i = 0; i < NUM_CELLS; i++) {
-            if (batteryPack.cells[i].voltage > minVoltage) {
-                activateBalancing(i);  // Balance cells that are higher than the minimum voltage
-            } else {
-                deactivateBalancing(i);  // Stop balancing if cell voltage is close to the minimum
-            }
-        }
-    } else {
-        for (uint8_t i = 0; i < NUM_CELLS; i++) {
-            deactivateBalancing(i);
+}
+
+// Balance against a copy of the pack handed over by the safety stage. The planner owns the
+// schedule; a channel is only written when its duty changes.
+void balanceCells(const BatteryPack *pack) {
+    static float soc[NUM_CELLS];
+    static float capacityMah[NUM_CELLS];
+    static float duty[NUM_CELLS];
+    TickType_t now = xTaskGetTickCount();
+    uint32_t elapsedMs = (lastBalanceTick == 0) ? 0 : (uint32_t)(now - lastBalanceTick) * portTICK_PERIOD_MS;
+
+    lastBalanceTick = now;
+    if (balancingPlannerReplanDue(&planner)) {
+        readCellCharge(pack, soc, capacityMah);
+        balancingPlannerReplan(&planner, soc, capacityMah, pack->cellVoltages);
+    }
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        duty[i] = bleedDuty(pack, i);
+    }
+    balancingPlannerStep(&planner, pack->cellVoltages, duty, pack->temperatureStats.max, elapsedMs);
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        float wanted = planner.active[i] ? duty[i] : 0.0f;
+        if (wanted != cellBalancers[i].duty) {
+            setBalancingDuty(i, wanted);
         }
     }
 }
+
+// Snapshot of which bleed resistors are on, for the pack model
+void cellBalancingGetActive(uint8_t active[NUM_CELLS]) {
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        active[i] = cellBalancers[i].isBalancing;
+    }
+}
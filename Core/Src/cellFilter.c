@@ -0,0 +1,215 @@
+#include "cellFilter.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <math.h>
+
+#define FIR_STATE_LENGTH (CELL_FILTER_FIR_TAPS + ADC_ACQ_MAX_SWEEPS_PER_BLOCK - 1)
+
+#if BMS_FIXED_POINT
+// Codes enter at half of q31 full scale so the biquad has headroom for overshoot
+#define CODE_TO_Q31_SHIFT   18
+// Biquad coefficients are stored halved and restored by the kernel's post-shift
+#define BIQUAD_POST_SHIFT   1
+
+typedef struct {
+    arm_biquad_casd_df1_inst_q31 antiAlias;
+    arm_fir_decimate_instance_q31 decimator;
+    q31_t biquadState[4 * CELL_FILTER_BIQUAD_STAGES];
+    q31_t firState[FIR_STATE_LENGTH];
+} ChannelFilter;
+
+static q31_t biquadCoeffs[5 * CELL_FILTER_BIQUAD_STAGES];
+static q31_t firCoeffs[CELL_FILTER_FIR_TAPS];
+#else
+typedef struct {
+    arm_biquad_cascade_df2T_instance_f32 antiAlias;
+    arm_fir_decimate_instance_f32 decimator;
+    float32_t biquadState[2 * CELL_FILTER_BIQUAD_STAGES];
+    float32_t firState[FIR_STATE_LENGTH];
+} ChannelFilter;
+
+static float32_t biquadCoeffs[5 * CELL_FILTER_BIQUAD_STAGES];
+static float32_t firCoeffs[CELL_FILTER_FIR_TAPS];
+#endif
+
+static ChannelFilter channelFilters[ADC_ACQ_NUM_CELL_CHANNELS];
+static uint16_t decimationFactor = 1;
+static CellFilterStats filterStats;
+
+// Only the voltage stage filters, so one set of block scratch buffers is enough
+#if BMS_FIXED_POINT
+static q31_t channelInput[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+static q31_t channelAntiAliased[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+static q31_t channelOutput[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+#else
+static float32_t channelInput[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+static float32_t channelAntiAliased[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+static float32_t channelOutput[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+#endif
+
+#if BMS_FIXED_POINT
+static q31_t toQ31(float value) {
+    return (q31_t)(value * 2147483648.0f);
+}
+#endif
+
+// Butterworth low-pass split into RBJ sections; CMSIS wants {b0, b1, b2, -a1, -a2} / a0
+static void designAntiAlias(uint32_t sampleRateHz, float cutoffHz) {
+    float w0 = 2.0f * PI * cutoffHz / (float)sampleRateHz;
+    float cosW0 = cosf(w0);
+
+    for (uint8_t stage = 0; stage < CELL_FILTER_BIQUAD_STAGES; stage++) {
+        float q = 1.0f / (2.0f * cosf(PI * (2.0f * stage + 1.0f) / (4.0f * CELL_FILTER_BIQUAD_STAGES)));
+        float alpha = sinf(w0) / (2.0f * q);
+        float a0 = 1.0f + alpha;
+        float section[5] = {
+            (1.0f - cosW0) * 0.5f / a0,
+            (1.0f - cosW0) / a0,
+            (1.0f - cosW0) * 0.5f / a0,
+            2.0f * cosW0 / a0,
+            -(1.0f - alpha) / a0,
+        };
+
+        for (uint8_t i = 0; i < 5; i++) {
+#if BMS_FIXED_POINT
+            biquadCoeffs[stage * 5 + i] = toQ31(section[i] / (float)(1 << BIQUAD_POST_SHIFT));
+#else
+            biquadCoeffs[stage * 5 + i] = section[i];
+#endif
+        }
+    }
+}
+
+// Hamming-windowed sinc at the output Nyquist rate, normalised to unity DC gain
+static void designDecimator(uint16_t decimation) {
+    float taps[CELL_FILTER_FIR_TAPS];
+    float centre = (CELL_FILTER_FIR_TAPS - 1) * 0.5f;
+    float cutoff = 0.5f / (float)decimation;
+    float sum = 0.0f;
+
+    for (uint8_t n = 0; n < CELL_FILTER_FIR_TAPS; n++) {
+        float t = (float)n - centre;
+        float sinc = (t == 0.0f) ? 2.0f * cutoff : sinf(2.0f * PI * cutoff * t) / (PI * t);
+        float window = 0.54f - 0.46f * cosf(2.0f * PI * n / (CELL_FILTER_FIR_TAPS - 1));
+
+        taps[n] = sinc * window;
+        sum += taps[n];
+    }
+
+    for (uint8_t n = 0; n < CELL_FILTER_FIR_TAPS; n++) {
+#if BMS_FIXED_POINT
+        firCoeffs[n] = toQ31(taps[n] / sum);
+#else
+        firCoeffs[n] = taps[n] / sum;
+#endif
+    }
+}
+
+HAL_StatusTypeDef cellFilterInit(uint32_t sampleRateHz) {
+    uint32_t decimation = sampleRateHz / CELL_FILTER_OUTPUT_RATE_HZ;
+
+    if (decimation == 0) {
+        decimation = 1;
+    } else if (decimation > ADC_ACQ_MAX_SWEEPS_PER_BLOCK) {
+        decimation = ADC_ACQ_MAX_SWEEPS_PER_BLOCK;
+    }
+    return cellFilterConfigure(sampleRateHz, (uint16_t)decimation,
+                               CELL_FILTER_CUTOFF_RATIO * (float)sampleRateHz / (float)decimation);
+}
+
+// Must run before the voltage stage starts consuming blocks; it resets every channel
+HAL_StatusTypeDef cellFilterConfigure(uint32_t sampleRateHz, uint16_t decimation, float cutoffHz) {
+    if (sampleRateHz == 0 || decimation == 0 || decimation > ADC_ACQ_MAX_SWEEPS_PER_BLOCK) {
+        return HAL_ERROR;
+    }
+    if (cutoffHz <= 0.0f || cutoffHz >= 0.45f * (float)sampleRateHz) {
+        return HAL_ERROR;
+    }
+
+    designAntiAlias(sampleRateHz, cutoffHz);
+    designDecimator(decimation);
+
+    for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+        ChannelFilter *filter = &channelFilters[cell];
+
+#if BMS_FIXED_POINT
+        arm_biquad_cascade_df1_init_q31(&filter->antiAlias, CELL_FILTER_BIQUAD_STAGES, biquadCoeffs,
+                                        filter->biquadState, BIQUAD_POST_SHIFT);
+        if (arm_fir_decimate_init_q31(&filter->decimator, CELL_FILTER_FIR_TAPS, (uint8_t)decimation,
+                                      firCoeffs, filter->firState, decimation) != ARM_MATH_SUCCESS) {
+            return HAL_ERROR;
+        }
+#else
+        arm_biquad_cascade_df2T_init_f32(&filter->antiAlias, CELL_FILTER_BIQUAD_STAGES, biquadCoeffs,
+                                         filter->biquadState);
+        if (arm_fir_decimate_init_f32(&filter->decimator, CELL_FILTER_FIR_TAPS, (uint8_t)decimation,
+                                      firCoeffs, filter->firState, decimation) != ARM_MATH_SUCCESS) {
+            return HAL_ERROR;
+        }
+#endif
+    }
+
+    decimationFactor = decimation;
+    return HAL_OK;
+}
+
+uint16_t cellFilterGetDecimation(void) {
+    return decimationFactor;
+}
+
+// Filter every cell rank of one block and return the newest decimated reading per cell
+uint8_t cellFilterProcessBlock(const AdcBlock *block, signal_t out[ADC_ACQ_NUM_CELL_CHANNELS]) {
+    uint32_t start = cycleCounterNow();
+    uint32_t sweeps = block->sweeps;
+
+    if (sweeps == 0 || (sweeps % decimationFactor) != 0) {
+        taskENTER_CRITICAL();
+        filterStats.rejectedBlocks++;
+        taskEXIT_CRITICAL();
+        return 0;
+    }
+
+    uint32_t outputs = sweeps / decimationFactor;
+
+    for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+        ChannelFilter *filter = &channelFilters[cell];
+
+        for (uint32_t sweep = 0; sweep < sweeps; sweep++) {
+            uint16_t code = block->samples[sweep * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_RANK_CHANNEL(cell)];
+#if BMS_FIXED_POINT
+            channelInput[sweep] = (q31_t)code << CODE_TO_Q31_SHIFT;
+#else
+            channelInput[sweep] = (float32_t)code;
+#endif
+        }
+
+#if BMS_FIXED_POINT
+        arm_biquad_cascade_df1_q31(&filter->antiAlias, channelInput, channelAntiAliased, sweeps);
+        arm_fir_decimate_q31(&filter->decimator, channelAntiAliased, channelOutput, sweeps);
+        out[cell] = signalCalibrate(ADC_ACQ_RANK_CHANNEL(cell), channelOutput[outputs - 1] >>
+                                          (CODE_TO_Q31_SHIFT - SIGNAL_CODE_FRACTION_BITS));
+#else
+        arm_biquad_cascade_df2T_f32(&filter->antiAlias, channelInput, channelAntiAliased, sweeps);
+        arm_fir_decimate_f32(&filter->decimator, channelAntiAliased, channelOutput, sweeps);
+        out[cell] = signalCalibrate(ADC_ACQ_RANK_CHANNEL(cell), channelOutput[outputs - 1]);
+#endif
+    }
+
+    uint32_t elapsed = cycleCounterNow() - start;
+    taskENTER_CRITICAL();
+    filterStats.blocks++;
+    filterStats.samplesFiltered += sweeps * ADC_ACQ_NUM_CELL_CHANNELS;
+    filterStats.lastBlockCycles = elapsed;
+    if (elapsed > filterStats.worstBlockCycles) {
+        filterStats.worstBlockCycles = elapsed;
+    }
+    taskEXIT_CRITICAL();
+    return 1;
+}
+
+void cellFilterGetStats(CellFilterStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = filterStats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,149 @@
+#include "chargeControllerLoop.h"
+#include "canCommunication.h"
+#include "task.h"
+#include "arm_math.h"
+#include <math.h>
+#include <string.h>
+
+#define CHARGER_CONTROL_START  0U
+#define CHARGER_CONTROL_STOP   1U
+
+static arm_pid_instance_f32 pid;
+static volatile ChargeState state = CHARGE_STATE_IDLE;
+static float command = 0.0f;
+static uint32_t belowTerminationMs = 0;
+static TickType_t lastRequest = 0;
+static ChargerStatus charger;
+
+static void resetLoop(void) {
+    pid.Kp = CHARGE_PID_KP;
+    pid.Ki = CHARGE_PID_KI * (CHARGE_CONTROL_PERIOD_MS / 1000.0f);   // arm_pid takes Ki per sample
+    pid.Kd = CHARGE_PID_KD / (CHARGE_CONTROL_PERIOD_MS / 1000.0f);
+    arm_pid_init_f32(&pid, 1);
+    command = 0.0f;
+    belowTerminationMs = 0;
+}
+
+// One PID step on the highest cell. The output is clamped to [0, limit] and written back as
+// the integrator state, so a long CC phase at the limit does not wind it up.
+float chargeControllerControlStep(arm_pid_instance_f32 *instance, float maxCellVoltage, float limit) {
+    float output = arm_pid_f32(instance, CHARGE_CV_CELL_VOLTAGE - maxCellVoltage);
+
+    if (output > limit) {
+        output = limit;
+    } else if (output < 0.0f) {
+        output = 0.0f;
+    }
+    instance->state[2] = output;
+    return output;
+}
+
+static void putBigEndian16(uint8_t *out, float value, float lsb) {
+    long raw = lroundf(value / lsb);
+    uint16_t field = (uint16_t)(raw < 0 ? 0 : (raw > 0xFFFF ? 0xFFFF : raw));
+
+    out[0] = (uint8_t)(field >> 8);
+    out[1] = (uint8_t)field;
+}
+
+static void sendRequest(float current, uint8_t stop) {
+    uint8_t data[8] = {0};
+
+    putBigEndian16(&data[0], PACK_NUM_CELLS * CHARGE_CV_CELL_VOLTAGE, 0.1f);
+    putBigEndian16(&data[2], current, 0.1f);
+    data[4] = stop ? CHARGER_CONTROL_STOP : CHARGER_CONTROL_START;
+    canTransmitExtendedMessage(CHARGER_REQUEST_ID, data, 8, CAN_TX_PRIORITY_HIGH);
+}
+
+// Before the scheduler starts, so no kernel critical section
+void chargeControllerInit(void) {
+    memset(&charger, 0, sizeof(charger));
+    state = CHARGE_STATE_IDLE;
+    resetLoop();
+}
+
+// Runs in the CAN RX task for every status broadcast
+void chargeControllerHandleStatus(const CanRxFrame *frame) {
+    if (frame->header.DLC < 5) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    charger.outputVoltage = (float)((frame->data[0] << 8) | frame->data[1]) * 0.1f;
+    charger.outputCurrent = (float)((frame->data[2] << 8) | frame->data[3]) * 0.1f;
+    charger.flags = frame->data[4];
+    charger.lastTick = xTaskGetTickCount();
+    charger.valid = 1;
+    taskEXIT_CRITICAL();
+}
+
+uint8_t chargeControllerIsConnected(void) {
+    uint8_t connected;
+
+    taskENTER_CRITICAL();
+    connected = charger.valid && (xTaskGetTickCount() - charger.lastTick) < pdMS_TO_TICKS(CHARGER_TIMEOUT_MS);
+    taskEXIT_CRITICAL();
+    return connected;
+}
+
+// Called from the CAN task on every tick; acts once per CHARGE_CONTROL_PERIOD_MS while a
+// charger is on the bus. The continuous SOP charge limit caps the CC current as well, so the
+// request follows the DCIR headroom and the temperature/SoC derating.
+void chargeControllerService(const PackSnapshot *snap, TickType_t now) {
+    ChargerStatus status;
+    // Both paths are held while the fault manager monitors; that pauses a session, it is no fault
+    uint8_t monitoring = snap->faults.state == BMS_STATE_IDLE || snap->faults.state == BMS_STATE_MONITORING;
+    uint8_t paused;
+
+    if (!chargeControllerIsConnected()) {
+        if (state != CHARGE_STATE_IDLE) {
+            state = CHARGE_STATE_IDLE;
+            resetLoop();
+        }
+        return;
+    }
+    if ((now - lastRequest) < pdMS_TO_TICKS(CHARGE_CONTROL_PERIOD_MS)) {
+        return;
+    }
+    lastRequest = now;
+    chargeControllerGetChargerStatus(&status);
+    paused = monitoring || (status.flags & ~CHARGER_FLAGS_FAULT) != 0;
+
+    if ((!monitoring && (snap->faults.disabledPaths & FAULT_PATH_CHARGE)) || (status.flags & CHARGER_FLAGS_FAULT)) {
+        state = CHARGE_STATE_FAULT;
+    } else if (state == CHARGE_STATE_IDLE && !paused) {
+        state = CHARGE_STATE_CHARGING;
+    }
+
+    if (state == CHARGE_STATE_CHARGING && paused) {
+        resetLoop();   // Restart from zero current once the pause ends
+    } else if (state == CHARGE_STATE_CHARGING) {
+        float limit = fminf(CHARGE_MAX_CURRENT_A, snap->powerLimits.chargeContinuous);
+
+        command = chargeControllerControlStep(&pid, snap->pack.voltageStats.max, limit);
+
+        belowTerminationMs = (command < CHARGE_TERMINATION_A) ? belowTerminationMs + CHARGE_CONTROL_PERIOD_MS : 0;
+        if (belowTerminationMs >= CHARGE_TERMINATION_MS) {
+            state = CHARGE_STATE_COMPLETE;
+        }
+    }
+    if (state != CHARGE_STATE_CHARGING || paused) {
+        command = 0.0f;
+    }
+
+    // Keep requesting even when stopped: the charger holds off on an explicit stop, not on silence
+    sendRequest(command, state != CHARGE_STATE_CHARGING || paused);
+}
+
+ChargeState chargeControllerGetState(void) {
+    return state;
+}
+
+float chargeControllerGetCommand(void) {
+    return command;
+}
+
+void chargeControllerGetChargerStatus(ChargerStatus *status) {
+    taskENTER_CRITICAL();
+    *status = charger;
+    taskEXIT_CRITICAL();
+}
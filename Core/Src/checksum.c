@@ -0,0 +1,125 @@
+#include "checksum.h"
+
+// PEC15 is run as a 16-bit MSB-first CRC with the 15-bit register left-aligned, so the
+// polynomial and seed are shifted up one bit and the result needs no final shift
+#define PEC15_POLYNOMIAL   0x8B32U   // 0x4599 << 1
+#define PEC15_SEED         0x0020U   // 16 << 1
+#define PEC15_SLICES       4U
+
+#define CRC8_POLYNOMIAL    0x1DU
+#define CRC8_INIT          0xFFU
+#define CRC8_XOR_OUT       0xFFU
+
+#define CRC32_POLYNOMIAL   0x04C11DB7U
+#define CRC32_INIT         0xFFFFFFFFU
+
+// pec15Tables[k][b]: remainder of byte b followed by k zero bytes, so four bytes fold per step
+static uint16_t pec15Tables[PEC15_SLICES][256];
+static uint8_t crc8Table[256];
+static uint32_t crc32Table[256];   // Finishes the 1-3 bytes the word-wide CRC unit cannot take
+
+static void buildTables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t pec = (uint16_t)(i << 8);
+        uint8_t crc8 = (uint8_t)i;
+        uint32_t crc32 = i << 24;
+
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            pec = (pec & 0x8000U) ? (uint16_t)((pec << 1) ^ PEC15_POLYNOMIAL) : (uint16_t)(pec << 1);
+            crc8 = (crc8 & 0x80U) ? (uint8_t)((crc8 << 1) ^ CRC8_POLYNOMIAL) : (uint8_t)(crc8 << 1);
+            crc32 = (crc32 & 0x80000000U) ? (crc32 << 1) ^ CRC32_POLYNOMIAL : crc32 << 1;
+        }
+        pec15Tables[0][i] = pec;
+        crc8Table[i] = crc8;
+        crc32Table[i] = crc32;
+    }
+
+    for (uint32_t slice = 1; slice < PEC15_SLICES; slice++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint16_t previous = pec15Tables[slice - 1][i];
+            pec15Tables[slice][i] = (uint16_t)(previous << 8) ^ pec15Tables[0][previous >> 8];
+        }
+    }
+}
+
+// Enables the CRC unit and builds the software tables; call before anything sends a PEC
+void checksumInit(void) {
+    hcrc.Instance = CRC;
+    if (HAL_CRC_Init(&hcrc) != HAL_OK) {
+        Error_Handler();
+    }
+    buildTables();
+}
+
+// Slice-by-4: the register absorbs two bytes, then four lookups advance it past four
+uint16_t checksumPec15(const uint8_t *data, uint32_t length) {
+    uint16_t crc = PEC15_SEED;
+
+    while (length >= PEC15_SLICES) {
+        crc ^= (uint16_t)((data[0] << 8) | data[1]);
+        crc = pec15Tables[3][crc >> 8] ^ pec15Tables[2][crc & 0xFFU]
+            ^ pec15Tables[1][data[2]] ^ pec15Tables[0][data[3]];
+        data += PEC15_SLICES;
+        length -= PEC15_SLICES;
+    }
+    while (length--) {
+        crc = (uint16_t)(crc << 8) ^ pec15Tables[0][(crc >> 8) ^ *data++];
+    }
+    return crc;
+}
+
+uint8_t checksumCrc8(const uint8_t *data, uint32_t length) {
+    uint8_t crc = CRC8_INIT;
+
+    while (length--) {
+        crc = crc8Table[crc ^ *data++];
+    }
+    return crc ^ CRC8_XOR_OUT;
+}
+
+// Whole words go through the CRC unit (byte-swapped so the stream is MSB first), the tail
+// through the table
+static uint32_t crc32Unit(const uint8_t *data, uint32_t length) {
+    uint32_t words = length / 4U;
+    uint32_t crc = CRC32_INIT;
+
+    if (words > 0) {
+        __HAL_CRC_DR_RESET(&hcrc);
+        for (uint32_t i = 0; i < words; i++) {
+            hcrc.Instance->DR = __REV(__UNALIGNED_UINT32_READ(data));
+            data += 4;
+        }
+        crc = hcrc.Instance->DR;
+    }
+
+    for (uint32_t i = 0; i < (length & 3U); i++) {
+        crc = (crc << 8) ^ crc32Table[(crc >> 24) ^ data[i]];
+    }
+    return crc;
+}
+
+// The unit is shared, so it is held with interrupts masked. PRIMASK is saved and restored
+// rather than taking the kernel lock: callers run before the scheduler starts (a kernel
+// critical section there leaves BASEPRI raised and SysTick masked) and from Error_Handler.
+uint32_t checksumCrc32(const uint8_t *data, uint32_t length) {
+    uint32_t primask = __get_PRIMASK();
+    uint32_t crc;
+
+    __disable_irq();
+    crc = crc32Unit(data, length);
+    __set_PRIMASK(primask);
+    return crc;
+}
+
+uint32_t checksumCompute(ChecksumType type, const uint8_t *data, uint32_t length) {
+    switch (type) {
+    case CHECKSUM_PEC15:
+        return checksumPec15(data, length);
+    case CHECKSUM_CRC8:
+        return checksumCrc8(data, length);
+    case CHECKSUM_CRC32:
+        return checksumCrc32(data, length);
+    default:
+        return 0;
+    }
+}
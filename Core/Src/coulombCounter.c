@@ -0,0 +1,166 @@
+#include "coulombCounter.h"
+#include "cycleCounter.h"
+#include "signalPath.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "arm_math.h"
+#include <math.h>
+
+// Open-circuit voltage of a rested cell at 0%, 10%, ... 100% SoC
+#define OCV_TABLE_POINTS 11
+#define OCV_TABLE_STEP   10.0f
+
+static const float ocvTable[OCV_TABLE_POINTS] = {
+    3.00f, 3.45f, 3.55f, 3.62f, 3.68f, 3.75f, 3.83f, 3.92f, 4.00f, 4.08f, 4.20f
+};
+
+// Sum of signed milliamp samples since the last reference point. Integer accumulation
+// keeps every milliamp, so a long stint drifts only by sensor error, not rounding.
+static int64_t chargeAccumulator = 0;
+static float referenceSoc = 0.0f;
+static uint8_t referenceValid = 0;
+
+static uint32_t sampleRate = 1;
+static int32_t restThresholdMilli = 0;
+static uint32_t restSamples = 0;
+static uint32_t restSamplesRequired = 0;
+
+static CoulombCounterStats counterStats;
+
+// ADC2 samples the shunt at every rank, so each sweep carries ADC_ACQ_NUM_RANKS current samples
+void coulombCounterInit(uint32_t sampleRateHz) {
+    sampleRateHz *= ADC_ACQ_NUM_RANKS;
+    sampleRate = sampleRateHz;
+    restThresholdMilli = (int32_t)(COULOMB_REST_CURRENT_A * 1000.0f);
+    restSamplesRequired = COULOMB_REST_TIME_S * sampleRateHz;
+    restSamples = 0;
+    chargeAccumulator = 0;
+    referenceValid = 0;
+}
+
+// Integrate every current sample of the block, not just its average. Each rank's samples go
+// through its channel's calibration in one vector pass, the same the reported current uses, so
+// a bidirectional sensor's offset turns charge into negative current here too.
+void coulombCounterIntegrateBlock(const AdcBlock *block) {
+    signal_t rankSamples[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+    uint32_t start = cycleCounterNow();
+    uint32_t total = block->sweeps * ADC_ACQ_NUM_RANKS;
+    uint32_t lastActive = 0;      // Position after the last sample above the rest threshold, in scan order
+    int64_t blockSum = 0;
+    uint32_t rested;
+
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        uint8_t channel = ADC_ACQ_CURRENT_CHANNEL(rank);
+
+        for (uint32_t sweep = 0; sweep < block->sweeps; sweep++) {
+            uint16_t code = block->samples[sweep * ADC_ACQ_NUM_CHANNELS + channel];
+#if BMS_FIXED_POINT
+            rankSamples[sweep] = (q31_t)code << SIGNAL_CODE_FRACTION_BITS;
+#else
+            rankSamples[sweep] = (float32_t)code;
+#endif
+        }
+        signalCalibrateBlock(channel, rankSamples, rankSamples, block->sweeps);
+
+        for (uint32_t sweep = 0; sweep < block->sweeps; sweep++) {
+#if BMS_FIXED_POINT
+            int32_t current = rankSamples[sweep];
+#else
+            int32_t current = (int32_t)lroundf(rankSamples[sweep]);
+#endif
+            uint32_t position = sweep * ADC_ACQ_NUM_RANKS + rank + 1U;
+
+            blockSum += current;
+            if ((current >= restThresholdMilli || current <= -restThresholdMilli) && position > lastActive) {
+                lastActive = position;
+            }
+        }
+    }
+
+    // The rest run continues from the previous block only if no sample in this one broke it
+    rested = lastActive == 0 ? restSamples + total : total - lastActive;
+
+    // An overrun only means newer samples were mixed in; dropping the block would lose charge
+    adcAcquisitionReleaseBlock(block);
+
+    taskENTER_CRITICAL();
+    chargeAccumulator += blockSum;
+    restSamples = rested;
+    counterStats.samplesIntegrated += total;
+    counterStats.lastUpdateCycles = cycleCounterNow() - start;
+    if (counterStats.lastUpdateCycles > counterStats.worstUpdateCycles) {
+        counterStats.worstUpdateCycles = counterStats.lastUpdateCycles;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Re-anchor the count to the OCV curve on first use and after every full rest period
+void coulombCounterApplyOcv(float cellVoltage) {
+    taskENTER_CRITICAL();
+    if (!referenceValid || restSamples >= restSamplesRequired) {
+        referenceSoc = ocvToSoc(cellVoltage);
+        chargeAccumulator = 0;
+        if (referenceValid) {
+            counterStats.ocvCorrections++;
+        }
+        referenceValid = 1;
+        restSamples = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Discharge (positive current) lowers SoC from the last OCV reference
+float coulombCounterGetSoc(void) {
+    taskENTER_CRITICAL();
+    int64_t accumulator = chargeAccumulator;
+    float soc = referenceSoc;
+    uint8_t valid = referenceValid;
+    taskEXIT_CRITICAL();
+
+    if (!valid) {
+        return -1.0f;  // No voltage seen yet
+    }
+
+    float ampSeconds = (float)accumulator * 0.001f / (float)sampleRate;
+    soc -= ampSeconds / (COULOMB_CAPACITY_MAH * 3.6f) * 100.0f;
+
+    if (soc > 100.0f) return 100.0f;
+    if (soc < 0.0f) return 0.0f;
+    return soc;
+}
+
+float ocvToSoc(float cellVoltage) {
+    if (cellVoltage <= ocvTable[0]) return 0.0f;
+    if (cellVoltage >= ocvTable[OCV_TABLE_POINTS - 1]) return 100.0f;
+
+    for (uint8_t i = 1; i < OCV_TABLE_POINTS; i++) {
+        if (cellVoltage < ocvTable[i]) {
+            float fraction = (cellVoltage - ocvTable[i - 1]) / (ocvTable[i] - ocvTable[i - 1]);
+            return ((i - 1) + fraction) * OCV_TABLE_STEP;
+        }
+    }
+    return 100.0f;
+}
+
+// Inverse lookup; slope is dOCV/dSoC in volts per percent
+float socToOcv(float soc, float *slope) {
+    if (soc <= 0.0f) soc = 0.0f;
+    if (soc >= 100.0f) soc = 100.0f;
+
+    uint8_t i = (uint8_t)(soc / OCV_TABLE_STEP);
+    if (i >= OCV_TABLE_POINTS - 1) {
+        i = OCV_TABLE_POINTS - 2;
+    }
+
+    float segmentSlope = (ocvTable[i + 1] - ocvTable[i]) / OCV_TABLE_STEP;
+    if (slope != NULL) {
+        *slope = segmentSlope;
+    }
+    return ocvTable[i] + (soc - i * OCV_TABLE_STEP) * segmentSlope;
+}
+
+void coulombCounterGetStats(CoulombCounterStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = counterStats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,157 @@
+#include "dcirEstimator.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct {
+    float ocv;             // Volts
+    float resistance;      // Ohms
+    float P[3];            // Symmetric 2x2 covariance: P00, P01, P11
+    float lastCurrent;     // Current of the last accepted update
+} CellDcir;
+
+static CellDcir cells[NUM_CELLS];
+static uint8_t cellsInitialized = 0;
+static DcirEstimatorStats estimatorStats;
+
+static void initCell(CellDcir *cell, float voltage, float current) {
+    cell->resistance = DCIR_INITIAL_OHM;
+    cell->ocv = voltage + DCIR_INITIAL_OHM * current;
+    cell->P[0] = DCIR_INITIAL_P_OCV;
+    cell->P[1] = 0.0f;
+    cell->P[2] = DCIR_INITIAL_P_OHM;
+    cell->lastCurrent = current;
+}
+
+static float clampf(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+// One RLS step with phi = [1, -I]. A steady current says nothing about R, so the step is
+// skipped until the current has moved; the covariance is capped as a second guard.
+static uint8_t updateCell(CellDcir *cell, float voltage, float current) {
+    float step = current - cell->lastCurrent;
+    if (step < DCIR_MIN_EXCITATION_A && step > -DCIR_MIN_EXCITATION_A) {
+        return 0;
+    }
+
+    float *P = cell->P;
+    float pPhi0 = P[0] - P[1] * current;   // P * phi
+    float pPhi1 = P[1] - P[2] * current;
+    float denominator = DCIR_FORGETTING_FACTOR + pPhi0 - current * pPhi1;
+    float k0 = pPhi0 / denominator;
+    float k1 = pPhi1 / denominator;
+    float error = voltage - (cell->ocv - cell->resistance * current);
+
+    cell->ocv += k0 * error;
+    cell->resistance = clampf(cell->resistance + k1 * error, DCIR_MIN_OHM, DCIR_MAX_OHM);
+
+    P[0] = clampf((P[0] - k0 * pPhi0) / DCIR_FORGETTING_FACTOR, 0.0f, DCIR_MAX_P);
+    P[1] = (P[1] - k0 * pPhi1) / DCIR_FORGETTING_FACTOR;
+    P[2] = clampf((P[2] - k1 * pPhi1) / DCIR_FORGETTING_FACTOR, 0.0f, DCIR_MAX_P);
+    cell->lastCurrent = current;
+    return 1;
+}
+
+void dcirEstimatorInit(void) {
+    cellsInitialized = 0;
+}
+
+// Each cell is paired with the current converted alongside it, not a block or pack average
+void dcirEstimatorUpdate(const float voltages[NUM_CELLS], const float currents[NUM_CELLS]) {
+    uint32_t start = cycleCounterNow();
+    uint32_t accepted = 0;
+
+    taskENTER_CRITICAL();
+    if (!cellsInitialized) {
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            initCell(&cells[i], voltages[i], currents[i]);
+        }
+        cellsInitialized = 1;
+    }
+    taskEXIT_CRITICAL();
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        CellDcir working = cells[i];
+
+        if (updateCell(&working, voltages[i], currents[i])) {
+            accepted++;
+            taskENTER_CRITICAL();
+            cells[i] = working;
+            taskEXIT_CRITICAL();
+        }
+    }
+
+    estimatorStats.updates += accepted;
+    estimatorStats.skipped += NUM_CELLS - accepted;
+    estimatorStats.lastUpdateCycles = cycleCounterNow() - start;
+    if (estimatorStats.lastUpdateCycles > estimatorStats.worstUpdateCycles) {
+        estimatorStats.worstUpdateCycles = estimatorStats.lastUpdateCycles;
+    }
+}
+
+void dcirEstimatorGetResistances(float resistances[NUM_CELLS]) {
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        resistances[i] = cellsInitialized ? cells[i].resistance : DCIR_INITIAL_OHM;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// The series string carries one current, so the cell that reaches its voltage limit first
+// sets it; the power is then the sum of every cell's terminal voltage at that current
+void dcirEstimatorGetPowerLimits(DcirPowerLimits *limits) {
+    float ocv[NUM_CELLS];
+    float resistance[NUM_CELLS];
+    float discharge;
+    float charge;
+    float dischargePower = 0.0f;
+    float chargePower = 0.0f;
+
+    taskENTER_CRITICAL();
+    if (!cellsInitialized) {
+        taskEXIT_CRITICAL();
+        limits->dischargeCurrent = 0.0f;
+        limits->dischargePower = 0.0f;
+        limits->chargeCurrent = 0.0f;
+        limits->chargePower = 0.0f;
+        return;
+    }
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        ocv[i] = cells[i].ocv;
+        resistance[i] = cells[i].resistance;
+    }
+    taskEXIT_CRITICAL();
+
+    discharge = (ocv[0] - MIN_CELL_VOLTAGE) / resistance[0];
+    charge = (MAX_CELL_VOLTAGE - ocv[0]) / resistance[0];
+    for (uint8_t i = 1; i < NUM_CELLS; i++) {
+        float cellDischarge = (ocv[i] - MIN_CELL_VOLTAGE) / resistance[i];
+        float cellCharge = (MAX_CELL_VOLTAGE - ocv[i]) / resistance[i];
+
+        if (cellDischarge < discharge) {
+            discharge = cellDischarge;
+        }
+        if (cellCharge < charge) {
+            charge = cellCharge;
+        }
+    }
+    discharge = discharge > 0.0f ? discharge : 0.0f;
+    charge = charge > 0.0f ? charge : 0.0f;
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        dischargePower += (ocv[i] - resistance[i] * discharge) * discharge;
+        chargePower += (ocv[i] + resistance[i] * charge) * charge;
+    }
+
+    limits->dischargeCurrent = discharge;
+    limits->dischargePower = dischargePower;
+    limits->chargeCurrent = charge;
+    limits->chargePower = chargePower;
+}
+
+void dcirEstimatorGetStats(DcirEstimatorStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = estimatorStats;
+    taskEXIT_CRITICAL();
+}
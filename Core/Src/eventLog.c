@@ -0,0 +1,553 @@
+#include "eventLogStore.h"
+#include "checksum.h"
+#include "canCommunication.h"
+#include "canTelemetryTable.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+#define EVENT_LOG_MAGIC      0xE7E1064BU
+#define EVENT_LOG_ERASED     0xFFFFFFFFU
+#define EVENT_LOG_NO_SECTOR  0xFFU
+
+// Sector header: magic, sector sequence, first record sequence, CRC. Record: the four
+// EventRecord words, then their CRC. The CRC word is always programmed last, so a write
+// cut short by power loss leaves a slot that fails its check and is skipped.
+#define HEADER_WORDS         4U
+#define RECORD_WORDS         5U
+#define HEADER_BYTES         (HEADER_WORDS * 4U)
+#define RECORD_BYTES         (RECORD_WORDS * 4U)
+
+#define READOUT_END_MARKER   0xFFU
+#define READOUT_RECORD_FRAMES 2U
+
+// LOW queue slots the readout leaves free: one period of 0x100 and one of 0x102
+#define READOUT_TX_RESERVE   (2U * TELEMETRY_MAX_FRAMES_PER_PERIOD)
+
+typedef enum {
+    SECTOR_ERASED,
+    SECTOR_VALID,
+    SECTOR_DIRTY           // Neither: a torn erase or header, erased before reuse
+} SectorState;
+
+typedef struct {
+    uint32_t timestamp;
+    uint32_t code;
+    uint32_t value;
+} PendingEvent;
+
+static uint32_t flashRead(uint32_t address);
+static HAL_StatusTypeDef flashProgram(uint32_t address, uint32_t word);
+static HAL_StatusTypeDef flashErase(uint8_t sector);
+
+static const EventLogMedium flashMedium = {
+    flashRead, flashProgram, flashErase, EVENT_LOG_BASE_ADDRESS, EVENT_LOG_SECTOR_BYTES
+};
+
+static EventLogStore store;
+static uint8_t mounted = 0;
+
+// Filled from any context including the overcurrent ISR, drained by the commit
+static PendingEvent batch[EVENT_LOG_BATCH_DEPTH];
+static volatile uint32_t batchHead = 0;
+static volatile uint32_t batchTail = 0;
+static volatile uint32_t batchDropped = 0;
+
+static volatile uint8_t readoutRequested = 0;
+static uint8_t readoutChannel = EVENT_LOG_READOUT_CAN;
+static uint8_t readoutActive = 0;
+static uint32_t readoutCount = 0;
+static EventLogCursor readoutCursor;
+static EventRecord readoutRecord;
+static uint8_t readoutHeld = 0;     // readoutRecord read but not all sent
+static uint8_t readoutPart = 0;     // Its next CAN frame
+
+static uint32_t flashRead(uint32_t address) {
+    return *(volatile const uint32_t *)(uintptr_t)address;
+}
+
+static HAL_StatusTypeDef flashProgram(uint32_t address, uint32_t word) {
+    HAL_StatusTypeDef status;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address, word);
+    HAL_FLASH_Lock();
+    return status;
+}
+
+// Code runs from the same bank, so the CPU stalls for the whole erase (hundreds of ms)
+static HAL_StatusTypeDef flashErase(uint8_t sector) {
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t sectorError;
+    HAL_StatusTypeDef status;
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = EVENT_LOG_FIRST_SECTOR + sector;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    status = HAL_FLASHEx_Erase(&erase, &sectorError);
+    HAL_FLASH_Lock();
+    return status;
+}
+
+static uint32_t sectorAddress(const EventLogStore *log, uint8_t sector) {
+    return log->medium->base + sector * log->medium->sectorBytes;
+}
+
+static uint32_t wordsCrc(const uint32_t *words, uint32_t count) {
+    return checksumCrc32((const uint8_t *)words, count * 4U);
+}
+
+static void readWords(const EventLogStore *log, uint32_t address, uint32_t *words, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        words[i] = log->medium->read(address + 4U * i);
+    }
+}
+
+static uint8_t wordsErased(const uint32_t *words, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (words[i] != EVENT_LOG_ERASED) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint8_t sectorErased(const EventLogStore *log, uint8_t sector) {
+    uint32_t address = sectorAddress(log, sector);
+
+    for (uint32_t offset = 0; offset < log->medium->sectorBytes; offset += 4U) {
+        if (log->medium->read(address + offset) != EVENT_LOG_ERASED) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// One slot: 1 with a record, 0 if the slot is erased or torn
+static uint8_t readRecord(const EventLogStore *log, uint32_t address, EventRecord *record, uint8_t *torn) {
+    uint32_t words[RECORD_WORDS];
+
+    readWords(log, address, words, RECORD_WORDS);
+    *torn = 0;
+    if (wordsErased(words, RECORD_WORDS)) {
+        return 0;
+    }
+    if (wordsCrc(words, RECORD_WORDS - 1U) != words[RECORD_WORDS - 1U]) {
+        *torn = 1;
+        return 0;
+    }
+    record->sequence = words[0];
+    record->timestamp = words[1];
+    record->code = words[2];
+    record->value = words[3];
+    return 1;
+}
+
+// Classify every sector, pick the newest valid one as active and resume after its last
+// written slot. Record sequences continue from the highest one that survived.
+void eventLogStoreMount(EventLogStore *log) {
+    log->active = EVENT_LOG_NO_SECTOR;
+    log->writeOffset = 0;
+    log->nextSequence = 0;
+    log->nextSectorSequence = 0;
+
+    for (uint8_t sector = 0; sector < EVENT_LOG_SECTORS; sector++) {
+        uint32_t header[HEADER_WORDS];
+        uint32_t address = sectorAddress(log, sector);
+
+        readWords(log, address, header, HEADER_WORDS);
+        if (header[0] == EVENT_LOG_MAGIC && wordsCrc(header, HEADER_WORDS - 1U) == header[HEADER_WORDS - 1U]) {
+            log->state[sector] = SECTOR_VALID;
+            log->sectorSequence[sector] = header[1];
+            if (header[2] > log->nextSequence) {
+                log->nextSequence = header[2];
+            }
+            if (header[1] + 1U > log->nextSectorSequence) {
+                log->nextSectorSequence = header[1] + 1U;
+            }
+            if (log->active == EVENT_LOG_NO_SECTOR || header[1] > log->sectorSequence[log->active]) {
+                log->active = sector;
+            }
+        } else {
+            log->state[sector] = sectorErased(log, sector) ? SECTOR_ERASED : SECTOR_DIRTY;
+            continue;
+        }
+
+        for (uint32_t offset = HEADER_BYTES; offset + RECORD_BYTES <= log->medium->sectorBytes; offset += RECORD_BYTES) {
+            EventRecord record;
+            uint8_t torn;
+
+            if (readRecord(log, address + offset, &record, &torn)) {
+                if (record.sequence + 1U > log->nextSequence) {
+                    log->nextSequence = record.sequence + 1U;
+                }
+            } else if (torn) {
+                log->stats.tornRecords++;
+            }
+        }
+    }
+
+    if (log->active != EVENT_LOG_NO_SECTOR) {
+        uint32_t address = sectorAddress(log, log->active);
+
+        log->writeOffset = HEADER_BYTES;
+        for (uint32_t offset = HEADER_BYTES; offset + RECORD_BYTES <= log->medium->sectorBytes; offset += RECORD_BYTES) {
+            uint32_t words[RECORD_WORDS];
+
+            readWords(log, address + offset, words, RECORD_WORDS);
+            if (!wordsErased(words, RECORD_WORDS)) {
+                log->writeOffset = offset + RECORD_BYTES;   // Torn slots are never reused
+            }
+        }
+    }
+}
+
+// The sector after the active one, or the first erased one when nothing is active yet
+static uint8_t nextSector(const EventLogStore *log) {
+    if (log->active != EVENT_LOG_NO_SECTOR) {
+        return (uint8_t)((log->active + 1U) % EVENT_LOG_SECTORS);
+    }
+    for (uint8_t sector = 0; sector < EVENT_LOG_SECTORS; sector++) {
+        if (log->state[sector] == SECTOR_ERASED) {
+            return sector;
+        }
+    }
+    return 0;
+}
+
+static HAL_StatusTypeDef eraseSector(EventLogStore *log, uint8_t sector) {
+    log->state[sector] = SECTOR_DIRTY;
+    log->stats.erases++;
+    if (log->medium->erase(sector) != HAL_OK) {
+        log->stats.writeErrors++;
+        return HAL_ERROR;
+    }
+    log->state[sector] = SECTOR_ERASED;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef programWords(EventLogStore *log, uint32_t address, const uint32_t *words, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (log->medium->program(address + 4U * i, words[i]) != HAL_OK) {
+            log->stats.writeErrors++;
+            return HAL_ERROR;
+        }
+    }
+    return HAL_OK;
+}
+
+// Keep the next sector erased, dropping the oldest records; only where a stall is acceptable
+HAL_StatusTypeDef eventLogStorePrepareSpare(EventLogStore *log) {
+    uint8_t sector = nextSector(log);
+
+    if (log->state[sector] == SECTOR_ERASED) {
+        return HAL_OK;
+    }
+    return eraseSector(log, sector);
+}
+
+// Move to the next sector. HAL_BUSY means it still needs an erase that is not allowed now.
+static HAL_StatusTypeDef storeRotate(EventLogStore *log, uint8_t eraseAllowed) {
+    uint8_t sector = nextSector(log);
+    uint32_t header[HEADER_WORDS];
+
+    if (log->state[sector] != SECTOR_ERASED) {
+        if (!eraseAllowed) {
+            return HAL_BUSY;
+        }
+        if (eraseSector(log, sector) != HAL_OK) {
+            return HAL_ERROR;
+        }
+    }
+
+    header[0] = EVENT_LOG_MAGIC;
+    header[1] = log->nextSectorSequence;
+    header[2] = log->nextSequence;
+    header[3] = wordsCrc(header, HEADER_WORDS - 1U);
+    log->state[sector] = SECTOR_DIRTY;
+    if (programWords(log, sectorAddress(log, sector), header, HEADER_WORDS) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    log->state[sector] = SECTOR_VALID;
+    log->sectorSequence[sector] = log->nextSectorSequence++;
+    log->active = sector;
+    log->writeOffset = HEADER_BYTES;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef eventLogStoreAppend(EventLogStore *log, uint32_t timestamp, uint32_t code, uint32_t value,
+                                      uint8_t eraseAllowed) {
+    uint32_t words[RECORD_WORDS];
+    HAL_StatusTypeDef status;
+
+    if (log->active == EVENT_LOG_NO_SECTOR || log->writeOffset + RECORD_BYTES > log->medium->sectorBytes) {
+        status = storeRotate(log, eraseAllowed);
+        if (status != HAL_OK) {
+            return status;
+        }
+    }
+
+    words[0] = log->nextSequence;
+    words[1] = timestamp;
+    words[2] = code;
+    words[3] = value;
+    words[4] = wordsCrc(words, RECORD_WORDS - 1U);
+
+    // Claim the slot first: after a failed or torn write it is skipped, never programmed twice
+    uint32_t address = sectorAddress(log, log->active) + log->writeOffset;
+    log->writeOffset += RECORD_BYTES;
+    if (programWords(log, address, words, RECORD_WORDS) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    log->nextSequence++;
+    log->stats.committed++;
+    return HAL_OK;
+}
+
+void eventLogStoreOpenCursor(const EventLogStore *log, EventLogCursor *cursor) {
+    cursor->count = 0;
+    for (uint8_t sector = 0; sector < EVENT_LOG_SECTORS; sector++) {
+        if (log->state[sector] != SECTOR_VALID) {
+            continue;
+        }
+        uint8_t position = cursor->count++;
+        while (position > 0 && log->sectorSequence[cursor->order[position - 1U]] > log->sectorSequence[sector]) {
+            cursor->order[position] = cursor->order[position - 1U];
+            position--;
+        }
+        cursor->order[position] = sector;
+    }
+    cursor->index = 0;
+    cursor->offset = HEADER_BYTES;
+}
+
+// Next intact record, oldest first; 0 at the end of the log
+uint8_t eventLogStoreReadNext(const EventLogStore *log, EventLogCursor *cursor, EventRecord *record) {
+    while (cursor->index < cursor->count) {
+        uint32_t address = sectorAddress(log, cursor->order[cursor->index]);
+
+        while (cursor->offset + RECORD_BYTES <= log->medium->sectorBytes) {
+            uint8_t torn;
+            uint32_t offset = cursor->offset;
+
+            cursor->offset += RECORD_BYTES;
+            if (readRecord(log, address + offset, record, &torn)) {
+                return 1;
+            }
+        }
+        cursor->index++;
+        cursor->offset = HEADER_BYTES;
+    }
+    return 0;
+}
+
+// Before the scheduler starts: mount, make sure a spare sector is ready, log the reset cause.
+// Nothing batched survives a reset, so the batch starts empty.
+HAL_StatusTypeDef eventLogInit(void) {
+    HAL_StatusTypeDef status;
+
+    batchHead = 0;
+    batchTail = 0;
+    batchDropped = 0;
+    readoutRequested = 0;
+    readoutActive = 0;
+    memset(&store, 0, sizeof(store));
+    store.medium = &flashMedium;
+    eventLogStoreMount(&store);
+    status = eventLogStorePrepareSpare(&store);
+    mounted = 1;
+
+    eventLogAppend(EVENT_BOOT, RCC->CSR & 0xFF000000U);
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+    return status;
+}
+
+// Any context, including interrupts above the RTOS syscall priority
+void eventLogAppend(uint32_t code, uint32_t value) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t head = batchHead;
+    if (head - batchTail >= EVENT_LOG_BATCH_DEPTH) {
+        batchDropped++;
+    } else {
+        PendingEvent *event = &batch[head % EVENT_LOG_BATCH_DEPTH];
+        event->timestamp = HAL_GetTick();
+        event->code = code;
+        event->value = value;
+        batchHead = head + 1U;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+// Program everything batched; an event leaves the batch once it is in flash, or once its
+// slot has failed so a bad word cannot block the log
+static void commitBatch(uint8_t eraseAllowed) {
+    while (batchTail != batchHead) {
+        const PendingEvent *event = &batch[batchTail % EVENT_LOG_BATCH_DEPTH];
+        HAL_StatusTypeDef status = eventLogStoreAppend(&store, event->timestamp, event->code, event->value,
+                                                       eraseAllowed);
+
+        if (status == HAL_BUSY) {
+            store.stats.deferred++;
+            return;
+        }
+        batchTail++;
+        if (status != HAL_OK) {
+            return;
+        }
+    }
+}
+
+static void putHex(char *out, uint32_t value, uint8_t digits) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (uint8_t i = 0; i < digits; i++) {
+        out[digits - 1U - i] = hex[(value >> (4U * i)) & 0xFU];
+    }
+}
+
+// Two frames per record on EVENT_LOG_READOUT_ID: byte 0 is the part, then
+// part 0 = sequence (24 bits LE), timestamp (32 bits LE); part 1 = code (16 bits LE), value (32 bits LE)
+static can_status_t sendRecordCan(const EventRecord *record, uint8_t part) {
+    uint8_t data[8] = {part};
+
+    if (part == 0) {
+        data[1] = (uint8_t)record->sequence;
+        data[2] = (uint8_t)(record->sequence >> 8);
+        data[3] = (uint8_t)(record->sequence >> 16);
+        memcpy(&data[4], &record->timestamp, 4);
+    } else {
+        data[1] = (uint8_t)record->code;
+        data[2] = (uint8_t)(record->code >> 8);
+        memcpy(&data[3], &record->value, 4);
+    }
+    return canTransmitMessage(EVENT_LOG_READOUT_ID, data, 8, CAN_TX_PRIORITY_LOW);
+}
+
+// One line per record: "sequence timestamp code value" in hex
+static void sendRecordUart(const EventRecord *record) {
+    char line[8 + 1 + 8 + 1 + 4 + 1 + 8 + 2];
+
+    putHex(&line[0], record->sequence, 8);
+    line[8] = ' ';
+    putHex(&line[9], record->timestamp, 8);
+    line[17] = ' ';
+    putHex(&line[18], record->code, 4);
+    line[22] = ' ';
+    putHex(&line[23], record->value, 8);
+    line[31] = '\r';
+    line[32] = '\n';
+    HAL_UART_Transmit(&huart2, (uint8_t *)line, sizeof(line), 10);
+}
+
+// Free LOW queue slots the readout may use; telemetry keeps READOUT_TX_RESERVE of them
+static uint32_t readoutFrameBudget(void) {
+    CanTxQueueStats stats;
+
+    canGetTxQueueStats(CAN_TX_PRIORITY_LOW, &stats);
+    if (stats.depth + READOUT_TX_RESERVE >= CAN_TX_QUEUE_DEPTH) {
+        return 0;
+    }
+    return CAN_TX_QUEUE_DEPTH - READOUT_TX_RESERVE - stats.depth;
+}
+
+// Up to EVENT_LOG_READOUT_PER_CALL records, and on CAN no more frames than the queue has room
+// for. A frame the queue refuses is sent again on the next call, from the same record part.
+static void serviceReadout(void) {
+    uint32_t budget = READOUT_RECORD_FRAMES * EVENT_LOG_READOUT_PER_CALL;
+
+    if (readoutRequested) {
+        readoutRequested = 0;
+        readoutActive = 1;
+        readoutHeld = 0;
+        readoutCount = 0;
+        eventLogStoreOpenCursor(&store, &readoutCursor);
+    }
+    if (!readoutActive) {
+        return;
+    }
+    if (readoutChannel == EVENT_LOG_READOUT_CAN) {
+        uint32_t space = readoutFrameBudget();
+        budget = space < budget ? space : budget;
+    }
+
+    for (uint8_t i = 0; i < EVENT_LOG_READOUT_PER_CALL; i++) {
+        if (!readoutHeld) {
+            if (!eventLogStoreReadNext(&store, &readoutCursor, &readoutRecord)) {
+                if (readoutChannel == EVENT_LOG_READOUT_CAN) {
+                    uint8_t data[8] = {READOUT_END_MARKER};
+                    memcpy(&data[1], &readoutCount, 4);
+                    if (budget == 0 ||
+                        canTransmitMessage(EVENT_LOG_READOUT_ID, data, 8, CAN_TX_PRIORITY_LOW) != CAN_STATUS_OK) {
+                        return;    // The cursor stays at the end; the marker goes on the next call
+                    }
+                }
+                readoutActive = 0;
+                return;
+            }
+            readoutHeld = 1;
+            readoutPart = 0;
+        }
+        if (readoutChannel == EVENT_LOG_READOUT_UART) {
+            sendRecordUart(&readoutRecord);
+        } else {
+            while (readoutPart < READOUT_RECORD_FRAMES) {
+                if (budget == 0 || sendRecordCan(&readoutRecord, readoutPart) != CAN_STATUS_OK) {
+                    return;
+                }
+                budget--;
+                readoutPart++;
+            }
+        }
+        readoutHeld = 0;
+        readoutCount++;
+    }
+}
+
+// Background task: commit the batch, stream any readout in progress. The caller says when
+// the pack can tolerate an erase stall; until then rotation waits on the spare sector.
+void eventLogService(uint8_t eraseAllowed) {
+    if (!mounted) {
+        return;
+    }
+    commitBatch(eraseAllowed);
+    if (eraseAllowed) {
+        eventLogStorePrepareSpare(&store);
+    }
+    serviceReadout();
+}
+
+// From Error_Handler with interrupts already off: flush what fits without erasing
+void eventLogPanic(uint32_t code, uint32_t value) {
+    if (!mounted) {
+        return;
+    }
+    eventLogAppend(code, value);
+    commitBatch(0);
+}
+
+// 0x202: byte 0 selects CAN or UART; a new request restarts from the oldest record
+void eventLogHandleReadout(const CanRxFrame *frame) {
+    if (frame->header.DLC < 1) {
+        return;
+    }
+    readoutChannel = (frame->data[0] == EVENT_LOG_READOUT_UART) ? EVENT_LOG_READOUT_UART : EVENT_LOG_READOUT_CAN;
+    readoutRequested = 1;
+}
+
+void eventLogGetStats(EventLogStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = store.stats;
+    stats->dropped = batchDropped;
+    taskEXIT_CRITICAL();
+}
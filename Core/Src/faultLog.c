@@ -0,0 +1,49 @@
+#include "faultLog.h"
+#include "eventLog.h"
+
+static FaultRecord records[FAULT_LOG_DEPTH];
+static uint32_t recordCount = 0;   // Total ever recorded; the newest sits at (count - 1) % depth
+
+// Writers include interrupts above the RTOS syscall priority, so mask everything briefly
+// instead of using a kernel critical section
+void faultLogRecord(FaultCode code, uint32_t timestamp, uint32_t value) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    FaultRecord *record = &records[recordCount % FAULT_LOG_DEPTH];
+    record->timestamp = timestamp;
+    record->value = value;
+    record->code = code;
+    recordCount++;
+
+    __set_PRIMASK(primask);
+
+    // Also kept across resets; the flash commit happens later in the event log task
+    eventLogAppend(code, value);
+}
+
+uint32_t faultLogGetCount(void) {
+    return recordCount;
+}
+
+// age 0 is the newest record; returns 0 once age runs past what is still held
+uint8_t faultLogGetRecord(uint32_t age, FaultRecord *record) {
+    uint8_t found = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (age < recordCount && age < FAULT_LOG_DEPTH) {
+        *record = records[(recordCount - 1U - age) % FAULT_LOG_DEPTH];
+        found = 1;
+    }
+
+    __set_PRIMASK(primask);
+    return found;
+}
+
+void faultLogClear(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    recordCount = 0;
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,192 @@
+#include "faultManagerState.h"
+#include "batteryManagement.h"
+#include "overcurrentProtection.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <math.h>
+
+typedef struct {
+    FaultCode code;
+    FaultSeverity severity;
+    FaultPolicy policy;
+    uint8_t paths;
+    uint16_t setSamples;
+    uint16_t clearSamples;
+} FaultInfo;
+
+#define FAULT_INFO(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading) \
+    { code, severity, policy, paths, setSamples, clearSamples },
+static const FaultInfo faultInfo[FAULT_NUM_IDS] = {
+    FAULT_TABLE(FAULT_INFO)
+};
+#undef FAULT_INFO
+
+typedef struct {
+    uint16_t setCount;     // Consecutive updates with the condition present
+    uint16_t clearCount;   // Consecutive updates without it
+} FaultDebounce;
+
+static FaultDebounce debounce[FAULT_NUM_IDS];
+static FaultStatus faultStatus;
+static uint32_t latchMask = 0;
+static uint16_t monitoringWindow = 0;   // Longest setSamples in the table
+static uint32_t monitoringSamples = 0;
+static volatile uint8_t clearRequested = 0;
+
+// Every condition in one word; the table expressions only read statistics that the pack
+// update already reduced, so the cost does not grow with the cell count
+static uint32_t evaluateConditions(const BatteryPack *pack) {
+#define FAULT_CONDITION_BIT(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading) \
+    | ((condition) ? FAULT_BIT(FAULT_ID_##name) : 0UL)
+    return 0UL FAULT_TABLE(FAULT_CONDITION_BIT);
+#undef FAULT_CONDITION_BIT
+}
+
+// What goes into the fault log when a fault sets, in milli-units
+static uint32_t faultReading(FaultId id, const BatteryPack *pack) {
+    switch (id) {
+#define FAULT_READING_CASE(name, code, severity, policy, paths, setSamples, clearSamples, condition, reading) \
+    case FAULT_ID_##name: return (uint32_t)(int32_t)lroundf((reading) * 1000.0f);
+    FAULT_TABLE(FAULT_READING_CASE)
+#undef FAULT_READING_CASE
+    default:
+        return 0;
+    }
+}
+
+// Section 6.2. Severity outranks everything; leaving FAULT_MODE or SHUTDOWN goes back through
+// MONITORING, so the paths are only enabled again after a full debounce window without faults.
+BmsState faultManagerNextState(BmsState state, FaultSeverity worst, uint8_t monitored, float current) {
+    if (worst == FAULT_SEVERITY_CRITICAL) {
+        return BMS_STATE_SHUTDOWN;
+    }
+    if (state == BMS_STATE_IDLE) {
+        return BMS_STATE_MONITORING;
+    }
+    if (worst == FAULT_SEVERITY_MAJOR) {
+        return BMS_STATE_FAULT_MODE;
+    }
+    if (state == BMS_STATE_FAULT_MODE || state == BMS_STATE_SHUTDOWN) {
+        return BMS_STATE_MONITORING;
+    }
+    if (state == BMS_STATE_MONITORING && !monitored) {
+        return BMS_STATE_MONITORING;
+    }
+    if (current > FAULT_STATE_ACTIVE_CURRENT_A) {
+        return BMS_STATE_DISCHARGING;
+    }
+    if (current < -FAULT_STATE_ACTIVE_CURRENT_A) {
+        return BMS_STATE_CHARGING;
+    }
+    return BMS_STATE_NORMAL;
+}
+
+void faultManagerInit(void) {
+    latchMask = 0;
+    monitoringWindow = 0;
+    for (uint8_t id = 0; id < FAULT_NUM_IDS; id++) {
+        debounce[id].setCount = 0;
+        debounce[id].clearCount = 0;
+        if (faultInfo[id].policy == FAULT_POLICY_LATCH) {
+            latchMask |= FAULT_BIT(id);
+        }
+        if (faultInfo[id].setSamples > monitoringWindow) {
+            monitoringWindow = faultInfo[id].setSamples;
+        }
+    }
+    monitoringSamples = 0;
+    clearRequested = 0;
+
+    // Runs before the scheduler starts, so no kernel critical section
+    faultStatus = (FaultStatus){0};
+    faultStatus.state = BMS_STATE_IDLE;
+    faultStatus.disabledPaths = FAULT_PATH_BOTH;
+}
+
+// Safety stage only, once per pack update: debounce every fault, apply its policy, then step
+// the state machine on the worst active severity. Bounded by the table size.
+void faultManagerEvaluate(const BatteryPack *pack) {
+    uint32_t conditions = evaluateConditions(pack);
+    uint8_t clear = clearRequested;
+    FaultStatus next = faultStatus;
+    FaultSeverity worst = FAULT_SEVERITY_NONE;
+
+    clearRequested = 0;
+    next.pending = 0;
+    next.disabledPaths = FAULT_PATH_NONE;
+
+    for (uint8_t id = 0; id < FAULT_NUM_IDS; id++) {
+        const FaultInfo *info = &faultInfo[id];
+        FaultDebounce *counter = &debounce[id];
+        uint32_t bit = FAULT_BIT(id);
+
+        if (conditions & bit) {
+            counter->clearCount = 0;
+            if (counter->setCount < info->setSamples) {
+                counter->setCount++;
+            }
+            if (counter->setCount < info->setSamples) {
+                next.pending |= bit;
+            } else if (!(next.active & bit)) {
+                next.active |= bit;
+                if (info->policy != FAULT_POLICY_EXTERNAL) {
+                    faultLogRecord(info->code, cycleCounterNow(), faultReading((FaultId)id, pack));
+                }
+            }
+        } else {
+            counter->setCount = 0;
+            if (counter->clearCount < info->clearSamples) {
+                counter->clearCount++;
+            }
+            if (counter->clearCount >= info->clearSamples && (info->policy != FAULT_POLICY_LATCH || clear)) {
+                next.active &= ~bit;
+            }
+        }
+
+        if (!(next.active & bit)) {
+            continue;
+        }
+        if (info->severity > worst) {
+            worst = info->severity;
+        }
+        if (info->severity == FAULT_SEVERITY_CRITICAL) {
+            next.disabledPaths |= FAULT_PATH_BOTH;
+        } else if (info->severity == FAULT_SEVERITY_MAJOR) {
+            next.disabledPaths |= info->paths;
+        }
+    }
+
+    next.latched = next.active & latchMask;
+    next.state = faultManagerNextState(faultStatus.state, worst, monitoringSamples >= monitoringWindow, pack->current);
+    monitoringSamples = (next.state == BMS_STATE_MONITORING) ? monitoringSamples + 1U : 0U;
+
+    // Nothing is trusted until a full debounce window has passed without a fault
+    if (next.state == BMS_STATE_IDLE || next.state == BMS_STATE_MONITORING) {
+        next.disabledPaths = FAULT_PATH_BOTH;
+    }
+
+    taskENTER_CRITICAL();
+    faultStatus = next;
+    taskEXIT_CRITICAL();
+}
+
+// Any task; takes effect on the next evaluation, and only for faults whose condition has
+// been gone for their clear window by then
+void faultManagerClearLatched(void) {
+    clearRequested = 1;
+}
+
+uint8_t faultManagerIsActive(FaultId id) {
+    return id < FAULT_NUM_IDS && (faultStatus.active & FAULT_BIT(id)) != 0;
+}
+
+uint8_t faultManagerGetDisabledPaths(void) {
+    return faultStatus.disabledPaths;
+}
+
+void faultManagerGetStatus(FaultStatus *status) {
+    taskENTER_CRITICAL();
+    *status = faultStatus;
+    taskEXIT_CRITICAL();
+}
@@ -8,25 +8,19 @@
 /* USER CODE END Header */
 
 /* Includes ------------------------------------------------------------------*/
-#include "FreeRTOSConfig.h"
+#include "FreeRTOS.h"
 #include "task.h"
 #include "main.h"
-#include "batteryManagement.h"
-#include "canCommunication.h"
+#include "bmsPipeline.h"
+#include "samplingScheduler.h"
 #include "cmsis_os2.h"
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
-osThreadId_t bmsTaskHandle;
-const osThreadAttr_t bmsTask_attributes = {
-  .name = "bmsTask",
-  .stack_size = 128 * 4,   // Adjust stack size based on your requirements
-  .priority = (osPriority_t) osPriorityNormal,
-};
+
 /* USER CODE END Variables */
 
 /* Private function prototypes -----------------------------------------------*/
-void StartBmsTask(void *argument);
 
 /* USER CODE BEGIN FunctionPrototypes */
 
@@ -34,18 +28,15 @@ void StartBmsTask(void *argument);
 
 /* USER CODE BEGIN Application */
 
-/* Function to start the BMS Task */
-void StartBmsTask(void *argument) {
-    for (;;) {
-        processBmsData();  // Process BMS data periodically
-        osDelay(1000);     // Delay for 1000ms (1 second) between iterations
-    }
-}
-
 /* USER CODE END Application */
 
 /* Hook to initialize FreeRTOS */
 void MX_FREERTOS_Init(void) {
-    /* Create the BMS task */
-    bmsTaskHandle = osThreadNew(StartBmsTask, NULL, &bmsTask_attributes);
+    /* Create the voltage, current, temperature, safety, balancing and CAN stages */
+    bmsPipelineInit();
+
+    /* Kernel-aware interrupts stay masked until osKernelStart, so no block is lost */
+    if (samplingSchedulerStart() != HAL_OK) {
+        Error_Handler();
+    }
 }
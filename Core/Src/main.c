@@ -11,10 +11,30 @@
 #include "cmsis_os.h"
 #include "batteryManagement.h"
 #include "canCommunication.h"
+#include "adcAcquisition.h"
+#include "samplingScheduler.h"
+#include "cycleCounter.h"
+#include "overcurrentProtection.h"
+#include "packConfig.h"
+#include "afeChain.h"
+#include "checksum.h"
+#include "eventLog.h"
 
 ADC_HandleTypeDef hadc1;
+ADC_HandleTypeDef hadc2;
+DMA_HandleTypeDef hdma_adc1;
+TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim3;
+TIM_HandleTypeDef htim8;
+SPI_HandleTypeDef hspi2;
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
 CAN_HandleTypeDef hcan1;
+CRC_HandleTypeDef hcrc;
 I2C_HandleTypeDef hi2c1;
+I2C_HandleTypeDef hi2c2;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c2_rx;
 UART_HandleTypeDef huart4;
 UART_HandleTypeDef huart2;
 
@@ -27,9 +47,13 @@ const osThreadAttr_t defaultTask_attributes = {
 
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_ADC1_Init(void);
+static void MX_ADC2_Init(void);
+static void MX_SPI2_Init(void);
 static void MX_CAN1_Init(void);
 static void MX_I2C1_Init(void);
+static void MX_I2C2_Init(void);
 static void MX_UART4_Init(void);
 static void MX_USART2_UART_Init(void);
 void StartDefaultTask(void *argument);
@@ -37,17 +61,45 @@ void StartDefaultTask(void *argument);
 int main(void) {
     HAL_Init();
     SystemClock_Config();
+    cycleCounterInit();
     MX_GPIO_Init();
+    MX_DMA_Init();
     MX_ADC1_Init();
+    MX_ADC2_Init();
+    MX_SPI2_Init();
     MX_CAN1_Init();
     MX_I2C1_Init();
+    MX_I2C2_Init();
     MX_UART4_Init();
     MX_USART2_UART_Init();
 
+    // CRC unit and checksum tables; the AFE PECs depend on them
+    checksumInit();
+
+    // Persistent event log in flash sectors 1-3; the BMS runs on without it if mounting fails
+    eventLogInit();
+
     // Initialize charge control and CAN communication
     chargeControlInit();
     canInit();
 
+    // Configure both scan sequences, dual mode and the TIM8 trigger; the BMS task starts sampling
+    if (adcAcquisitionInit() != HAL_OK || samplingSchedulerInit(SAMPLING_DEFAULT_RATE_HZ) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // Arm the hardware overcurrent trip before the first conversion can run
+    if (overcurrentProtectionInit() != HAL_OK) {
+        Error_Handler();
+    }
+
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+    // Wake the cell-monitor chain; the voltage stage scans it once per sample block
+    if (afeChainInit() != HAL_OK) {
+        Error_Handler();
+    }
+#endif
+
     // Initialize FreeRTOS and create tasks
     osKernelInitialize();
     MX_FREERTOS_Init();  // Initialize FreeRTOS tasks and configuration
@@ -59,34 +111,6 @@ int main(void) {
     }
 }
 
-void processBmsData(void) {
-    float soc = estimateSoc();
-    float voltage = readBatteryVoltage();
-    float current = readBatteryCurrent();
-    float temperature = readBatteryTemperature();
-
-    // Implementing overvoltage and overtemperature protection
-    if (voltage > 4.2f) {
-        activateOvervoltageProtection();
-    }
-    if (temperature > 60.0f) {
-        activateOvertemperatureProtection();
-    }
-
-    if (soc < 20.0f) {
-        enableCharging();
-        disableDischarging();
-    } else if (soc > 80.0f) {
-        disableCharging();
-        enableDischarging();
-    }
-
-    // Transmitting BMS data over CAN
-    canTransmitBmsData();
-
-    printf("SOC: %.2f%%, Voltage: %.2fV, Current: %.2fA, Temp: %.2f°C\n", soc, voltage, current, temperature);
-}
-
 void SystemClock_Config(void) {
     // System Clock Configuration remains unchanged
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
@@ -131,22 +155,99 @@ static void MX_ADC1_Init(void) {
     hadc1.Instance = ADC1;
     hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
     hadc1.Init.Resolution = ADC_RESOLUTION_12B;
-    hadc1.Init.ScanConvMode = DISABLE;
-    hadc1.Init.ContinuousConvMode = DISABLE;
+    hadc1.Init.ScanConvMode = ENABLE;                  // Sweep every cell and the thermistors
+    hadc1.Init.ContinuousConvMode = DISABLE;           // One sweep per TIM8 update event
     hadc1.Init.DiscontinuousConvMode = DISABLE;
-    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
-    hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T8_TRGO;
     hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
-    hadc1.Init.NbrOfConversion = 1;
-    hadc1.Init.DMAContinuousRequests = DISABLE;
-    hadc1.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+    hadc1.Init.NbrOfConversion = ADC_ACQ_NUM_RANKS;
+    hadc1.Init.DMAContinuousRequests = ENABLE;         // Keep requesting DMA in circular mode
+    hadc1.Init.EOCSelection = ADC_EOC_SEQ_CONV;
     if (HAL_ADC_Init(&hadc1) != HAL_OK) {
         Error_Handler();
     }
 }
 
+/* ADC2 is the dual-mode slave: it converts the shunt in step with every ADC1 rank */
+static void MX_ADC2_Init(void) {
+    hadc2.Instance = ADC2;
+    hadc2.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    hadc2.Init.Resolution = ADC_RESOLUTION_12B;
+    hadc2.Init.ScanConvMode = ENABLE;                  // Same rank count as ADC1, all on the shunt
+    hadc2.Init.ContinuousConvMode = DISABLE;
+    hadc2.Init.DiscontinuousConvMode = DISABLE;
+    hadc2.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;   // Triggered by ADC1
+    hadc2.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    hadc2.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    hadc2.Init.NbrOfConversion = ADC_ACQ_NUM_RANKS;
+    hadc2.Init.DMAContinuousRequests = DISABLE;        // The common data register is read through ADC1's DMA
+    hadc2.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    if (HAL_ADC_Init(&hadc2) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+/* AFE daisy chain: mode 3, 8-bit, 42 MHz / 64 = 656 kHz (LTC681x isoSPI limit is 1 MHz) */
+static void MX_SPI2_Init(void) {
+    hspi2.Instance = SPI2;
+    hspi2.Init.Mode = SPI_MODE_MASTER;
+    hspi2.Init.Direction = SPI_DIRECTION_2LINES;
+    hspi2.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi2.Init.CLKPolarity = SPI_POLARITY_HIGH;
+    hspi2.Init.CLKPhase = SPI_PHASE_2EDGE;
+    hspi2.Init.NSS = SPI_NSS_SOFT;
+    hspi2.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_64;
+    hspi2.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi2.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    hspi2.Init.CRCPolynomial = 10;
+    if (HAL_SPI_Init(&hspi2) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+/* Second temperature sensor bus: standard mode, 100 kHz */
+static void MX_I2C2_Init(void) {
+    hi2c2.Instance = I2C2;
+    hi2c2.Init.ClockSpeed = 100000;
+    hi2c2.Init.DutyCycle = I2C_DUTYCYCLE_2;
+    hi2c2.Init.OwnAddress1 = 0;
+    hi2c2.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+    hi2c2.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+    hi2c2.Init.OwnAddress2 = 0;
+    hi2c2.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+    hi2c2.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+    if (HAL_I2C_Init(&hi2c2) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+/* Enable DMA controller clocks and the ADC1, SPI2 and I2C stream interrupts */
+static void MX_DMA_Init(void) {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    /* DMA1_Stream0_IRQn and DMA1_Stream2_IRQn interrupt configuration (I2C1/I2C2 RX) */
+    HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+    HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
+
+    /* DMA1_Stream3_IRQn and DMA1_Stream4_IRQn interrupt configuration (SPI2 RX/TX) */
+    HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+
+    /* DMA2_Stream0_IRQn interrupt configuration */
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+}
+
 void Error_Handler(void) {
     __disable_irq();
+    eventLogPanic(EVENT_ERROR_HANDLER, __get_IPSR());
     while (1) {
         // Flash an LED or take necessary action
     }
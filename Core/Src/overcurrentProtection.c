@@ -0,0 +1,78 @@
+#include "overcurrentProtection.h"
+#include "adcAcquisition.h"
+#include "signalPath.h"
+#include "faultLog.h"
+#include "cycleCounter.h"
+
+// Set by ADC_IRQHandler on entry so the callback can report its own response time
+volatile uint32_t overcurrentIrqEntryCycles = 0;
+
+static volatile uint8_t tripped = 0;
+static uint32_t tripThresholdCode = 0;
+static OvercurrentStats overcurrentStats;
+
+// The watchdog fires on codes strictly above the threshold, so a trip point beyond the
+// sensor's full scale is pulled down one LSB and a saturated reading still trips
+static uint32_t tripCode(void) {
+    uint32_t code = (uint32_t)(((uint64_t)OVERCURRENT_TRIP_MILLIAMPS * 4096U) / SIGNAL_CURRENT_FULL_SCALE_MILLI);
+    return code > 4094U ? 4094U : code;
+}
+
+// ADC2 converts only the shunt, at every rank of the scan, so its watchdog sees every sample
+HAL_StatusTypeDef overcurrentProtectionInit(void) {
+    ADC_AnalogWDGConfTypeDef watchdogConfig = {0};
+
+    tripThresholdCode = tripCode();
+    watchdogConfig.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+    watchdogConfig.Channel = adcCurrentChannel;
+    watchdogConfig.HighThreshold = tripThresholdCode;
+    watchdogConfig.LowThreshold = 0;
+    watchdogConfig.ITMode = ENABLE;
+    if (HAL_ADC_AnalogWDGConfig(&hadc2, &watchdogConfig) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    HAL_NVIC_SetPriority(ADC_IRQn, OVERCURRENT_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+    return HAL_OK;
+}
+
+// Runs at OVERCURRENT_IRQ_PRIORITY: no RTOS calls, just open the switch and record it
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc) {
+    if (hadc->Instance != ADC2) {
+        return;
+    }
+
+    // Direct BSRR reset: one store, no HAL call between detection and the MOSFET
+    Discharge_Control_Port->BSRR = (uint32_t)Discharge_Control_Pin << 16U;
+    uint32_t now = cycleCounterNow();
+
+    // Latch until rearmed so a sustained fault does not re-enter on every sweep
+    __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD);
+    tripped = 1;
+
+    uint32_t response = now - overcurrentIrqEntryCycles;
+    overcurrentStats.trips++;
+    overcurrentStats.lastResponseCycles = response;
+    if (response > overcurrentStats.worstResponseCycles) {
+        overcurrentStats.worstResponseCycles = response;
+    }
+    faultLogRecord(FAULT_OVERCURRENT, now, tripThresholdCode);
+}
+
+uint8_t overcurrentProtectionIsTripped(void) {
+    return tripped;
+}
+
+// Leaves discharge open; the safety stage decides when to close it again
+void overcurrentProtectionRearm(void) {
+    tripped = 0;
+    __HAL_ADC_CLEAR_FLAG(&hadc2, ADC_FLAG_AWD);
+    __HAL_ADC_ENABLE_IT(&hadc2, ADC_IT_AWD);
+}
+
+void overcurrentProtectionGetStats(OvercurrentStats *stats) {
+    HAL_NVIC_DisableIRQ(ADC_IRQn);
+    *stats = overcurrentStats;
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+}
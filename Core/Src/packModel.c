@@ -0,0 +1,36 @@
+#include "packModel.h"
+#include <string.h>
+
+void packModelInit(BatteryPack *pack) {
+    memset(pack, 0, sizeof(*pack));
+}
+
+// arm_mean_f32 accumulates the plain sum before dividing, so scaling back loses nothing useful
+void packModelUpdateVoltageStatistics(BatteryPack *pack) {
+    packStatisticsCompute(pack->cellVoltages, PACK_NUM_CELLS, &pack->voltageStats);
+    pack->averageVoltage = pack->voltageStats.mean;
+    pack->totalVoltage = pack->voltageStats.mean * PACK_NUM_CELLS;
+}
+
+// Lost sensors hold a stale or never-read value, so only the answering ones count. With none
+// left the previous statistics stand; the sensor-loss fault has opened the paths by then.
+void packModelUpdateTemperatureStatistics(BatteryPack *pack) {
+    float present[PACK_NUM_TEMPERATURES];
+    uint16_t sensors[PACK_NUM_TEMPERATURES];
+    uint32_t count = 0;
+
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        if (!pack->temperatureLost[i]) {
+            present[count] = pack->temperatures[i];
+            sensors[count++] = i;
+        }
+    }
+    pack->temperatureSensorsLost = (uint8_t)(PACK_NUM_TEMPERATURES - count);
+    if (count == 0) {
+        return;
+    }
+    packStatisticsCompute(present, count, &pack->temperatureStats);
+    pack->temperatureStats.minIndex = sensors[pack->temperatureStats.minIndex];
+    pack->temperatureStats.maxIndex = sensors[pack->temperatureStats.maxIndex];
+    pack->temperature = pack->temperatureStats.max;
+}
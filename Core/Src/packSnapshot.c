@@ -0,0 +1,81 @@
+#include "packSnapshot.h"
+#include <string.h>
+
+// Two slots, each under its own sequence counter. The writer always fills the slot readers
+// are not pointed at, so a reader that interrupts the writer still finds a complete frame;
+// only a reader preempted by two whole publishes sees its slot change and retries.
+typedef struct {
+    volatile uint32_t sequence;   // Odd while the slot is being written
+    PackSnapshot snapshot;
+} SnapshotSlot;
+
+static SnapshotSlot slots[2];
+static volatile uint32_t publishedSlot = 0;
+static volatile uint32_t publishCount = 0;
+static volatile uint32_t readRetries = 0;
+static volatile uint32_t readFailures = 0;
+
+// Readers run at any priority, so their counters are bumped with exclusive access
+static void atomicIncrement(volatile uint32_t *counter) {
+    uint32_t value;
+
+    do {
+        value = __LDREXW(counter);
+    } while (__STREXW(value + 1U, counter) != 0U);
+}
+
+void packSnapshotPublish(const PackSnapshot *snapshot) {
+    uint32_t next = publishedSlot ^ 1U;
+    SnapshotSlot *slot = &slots[next];
+
+    slot->sequence++;
+    __DMB();
+    memcpy(&slot->snapshot, snapshot, sizeof(slot->snapshot));
+    slot->snapshot.version = publishCount + 1U;
+    __DMB();
+    slot->sequence++;
+    __DMB();
+
+    publishedSlot = next;
+    publishCount++;
+}
+
+// Returns 0 before the first publish, or if every attempt overlapped a publish; the caller's
+// copy is only written once a whole frame has been checked, so a failed read leaves it as it was.
+// The staging copy lives on the reader's stack, which bmsPipeline budgets for.
+uint8_t packSnapshotRead(PackSnapshot *snapshot) {
+    PackSnapshot copy;
+
+    if (publishCount == 0) {
+        return 0;
+    }
+
+    for (uint32_t attempt = 0; attempt < PACK_SNAPSHOT_MAX_RETRIES; attempt++) {
+        const SnapshotSlot *slot = &slots[publishedSlot];
+        uint32_t sequence = slot->sequence;
+
+        __DMB();
+        if ((sequence & 1U) == 0U) {
+            memcpy(&copy, (const void *)&slot->snapshot, sizeof(copy));
+            __DMB();
+            if (slot->sequence == sequence) {
+                *snapshot = copy;
+                return 1;
+            }
+        }
+        atomicIncrement(&readRetries);
+    }
+    atomicIncrement(&readFailures);
+    return 0;
+}
+
+// Cheap check for new data before paying for a full copy
+uint32_t packSnapshotGetVersion(void) {
+    return publishCount;
+}
+
+void packSnapshotGetStats(PackSnapshotStats *stats) {
+    stats->publishes = publishCount;
+    stats->readRetries = readRetries;
+    stats->readFailures = readFailures;
+}
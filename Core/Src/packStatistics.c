@@ -0,0 +1,14 @@
+#include "packStatistics.h"
+
+// Extremes with their indices, then mean and deviation; every reduction is a CMSIS-DSP kernel
+void packStatisticsCompute(const float *values, uint32_t count, PackStatistics *stats) {
+    arm_max_f32(values, count, &stats->max, &stats->maxIndex);
+    arm_min_f32(values, count, &stats->min, &stats->minIndex);
+    arm_mean_f32(values, count, &stats->mean);
+    if (count > 1U) {
+        arm_std_f32(values, count, &stats->stdDev);
+    } else {
+        stats->stdDev = 0.0f;
+    }
+    stats->spread = stats->max - stats->min;
+}
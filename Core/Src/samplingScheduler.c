@@ -0,0 +1,181 @@
+#include "samplingScheduler.h"
+#include "cycleCounter.h"
+
+#define SAMPLING_MAX_SUBSCRIBERS 4
+
+static uint32_t samplingRateHz = SAMPLING_DEFAULT_RATE_HZ;
+static uint32_t nominalBlockCycles = 0;
+static uint32_t lastBlockTimestamp = 0;
+static uint8_t lastBlockValid = 0;
+
+static TaskHandle_t subscribers[SAMPLING_MAX_SUBSCRIBERS];
+static uint8_t subscriberCount = 0;
+
+static JitterHistogram jitterHistogram;
+
+// TIM8 sits on APB2; its kernel clock doubles whenever APB2 is divided
+static uint32_t getTimerClock(void) {
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE2_2) != 0U) {
+        return pclk2 * 2U;
+    }
+    return pclk2;
+}
+
+// Record how far this block's completion deviated from the nominal period
+static void recordJitter(uint32_t timestamp) {
+    if (!lastBlockValid) {
+        lastBlockValid = 1;
+        lastBlockTimestamp = timestamp;
+        return;
+    }
+
+    int32_t deviation = (int32_t)((timestamp - lastBlockTimestamp) - nominalBlockCycles);
+    int32_t jitterUs = deviation / (int32_t)(SystemCoreClock / 1000000U);
+    int32_t bin = jitterUs / SAMPLING_JITTER_BIN_US + SAMPLING_JITTER_BINS / 2;
+    lastBlockTimestamp = timestamp;
+
+    if (bin < 0) {
+        bin = 0;
+    } else if (bin >= SAMPLING_JITTER_BINS) {
+        bin = SAMPLING_JITTER_BINS - 1;
+    }
+
+    jitterHistogram.bins[bin]++;
+    if (jitterHistogram.samples == 0 || jitterUs < jitterHistogram.minJitterUs) {
+        jitterHistogram.minJitterUs = jitterUs;
+    }
+    if (jitterHistogram.samples == 0 || jitterUs > jitterHistogram.maxJitterUs) {
+        jitterHistogram.maxJitterUs = jitterUs;
+    }
+    jitterHistogram.samples++;
+}
+
+// Runs in the DMA interrupt for every completed block
+static void onBlockReady(const AdcBlock *block) {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    recordJitter(block->timestamp);
+
+    for (uint8_t i = 0; i < subscriberCount; i++) {
+        xTaskNotifyFromISR(subscribers[i], block->sequence, eSetValueWithOverwrite,
+                           &higherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void clearJitterHistogram(void) {
+    for (uint8_t i = 0; i < SAMPLING_JITTER_BINS; i++) {
+        jitterHistogram.bins[i] = 0;
+    }
+    jitterHistogram.samples = 0;
+    jitterHistogram.minJitterUs = 0;
+    jitterHistogram.maxJitterUs = 0;
+    lastBlockValid = 0;
+}
+
+// Program TIM8 so its update event (TRGO) fires at rateHz and starts one ADC scan sweep
+HAL_StatusTypeDef samplingSchedulerInit(uint32_t rateHz) {
+    TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+    if (rateHz < SAMPLING_MIN_RATE_HZ || rateHz > SAMPLING_MAX_RATE_HZ) {
+        return HAL_ERROR;
+    }
+
+    uint32_t ticks = getTimerClock() / rateHz;
+    uint32_t prescaler = (ticks - 1U) / 65536U;
+    uint32_t period = ticks / (prescaler + 1U) - 1U;
+
+    htim8.Instance = TIM8;
+    htim8.Init.Prescaler = prescaler;
+    htim8.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim8.Init.Period = period;
+    htim8.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim8.Init.RepetitionCounter = 0;
+    htim8.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_Base_Init(&htim8) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+    if (HAL_TIM_ConfigClockSource(&htim8, &sClockSourceConfig) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    if (HAL_TIMEx_MasterConfigSynchronization(&htim8, &sMasterConfig) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    // Group sweeps so blocks complete at about SAMPLING_TARGET_BLOCK_RATE_HZ
+    uint32_t sweeps = rateHz / SAMPLING_TARGET_BLOCK_RATE_HZ;
+    if (sweeps == 0) {
+        sweeps = 1;
+    } else if (sweeps > ADC_ACQ_MAX_SWEEPS_PER_BLOCK) {
+        sweeps = ADC_ACQ_MAX_SWEEPS_PER_BLOCK;
+    }
+    if (adcAcquisitionSetSweepsPerBlock((uint16_t)sweeps) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    samplingRateHz = rateHz;
+    nominalBlockCycles = (uint32_t)(((uint64_t)SystemCoreClock * (prescaler + 1U) * (period + 1U) * sweeps)
+                                    / getTimerClock());
+    adcAcquisitionRegisterCallback(onBlockReady);
+    // Before the scheduler runs: no kernel critical section, it would leave BASEPRI raised
+    clearJitterHistogram();
+    return HAL_OK;
+}
+
+// Arm the ADC/DMA first so the first trigger edge is not lost
+HAL_StatusTypeDef samplingSchedulerStart(void) {
+    lastBlockValid = 0;
+    if (adcAcquisitionStart() != HAL_OK) {
+        return HAL_ERROR;
+    }
+    return HAL_TIM_Base_Start(&htim8);
+}
+
+void samplingSchedulerStop(void) {
+    HAL_TIM_Base_Stop(&htim8);
+    adcAcquisitionStop();
+}
+
+uint32_t samplingSchedulerGetRate(void) {
+    return samplingRateHz;
+}
+
+uint32_t samplingSchedulerGetBlockPeriodCycles(void) {
+    return nominalBlockCycles;
+}
+
+// Must be called before the scheduler is started
+void samplingSchedulerSubscribe(TaskHandle_t task) {
+    if (subscriberCount < SAMPLING_MAX_SUBSCRIBERS) {
+        subscribers[subscriberCount++] = task;
+    }
+}
+
+// Block the calling (subscribed) task until the next sample block is ready
+uint8_t samplingSchedulerWaitBlock(AdcBlock *block, TickType_t timeout) {
+    uint32_t sequence;
+
+    if (xTaskNotifyWait(0, 0xFFFFFFFFUL, &sequence, timeout) != pdTRUE) {
+        return 0;
+    }
+    return adcAcquisitionGetLatestBlock(block);
+}
+
+void samplingSchedulerGetJitterHistogram(JitterHistogram *histogram) {
+    taskENTER_CRITICAL();
+    *histogram = jitterHistogram;
+    taskEXIT_CRITICAL();
+}
+
+void samplingSchedulerResetJitterHistogram(void) {
+    taskENTER_CRITICAL();
+    clearJitterHistogram();
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,126 @@
+#include "signalPath.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct {
+#if BMS_FIXED_POINT
+    q31_t scaleFract;  // Gain = scaleFract * 2^shift, applied to (code << 4) << SCALE_HEADROOM_BITS
+    int8_t shift;
+    q31_t offset;
+#else
+    float32_t gain;    // Milli units per ADC code
+    float32_t offset;
+#endif
+} ChannelCalibration;
+
+#if BMS_FIXED_POINT
+// arm_scale_q31 drops everything below 2^(shift + 1) of the result, so the value is raised into
+// the unused top bits first; that keeps the shift negative and the truncation under one milli
+// unit at any full scale up to 2^31 / 2^SCALE_HEADROOM_BITS
+#define SCALE_HEADROOM_BITS 8
+#endif
+
+static ChannelCalibration calibration[ADC_ACQ_NUM_CHANNELS];
+static SignalPathStats pathStats;
+
+// Every rank has its own current channel; they all see the same shunt amplifier
+void signalPathInit(void) {
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_CELL_CHANNELS; rank++) {
+        signalPathSetCalibration(ADC_ACQ_RANK_CHANNEL(rank), SIGNAL_CELL_FULL_SCALE_MILLI, 0);
+    }
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        signalPathSetCalibration(ADC_ACQ_CURRENT_CHANNEL(rank), SIGNAL_CURRENT_FULL_SCALE_MILLI, 0);
+    }
+}
+
+// Float math here runs once per calibration change, never per sample
+void signalPathSetCalibration(uint8_t channel, int32_t fullScaleMilli, int32_t offsetMilli) {
+    if (channel >= ADC_ACQ_NUM_CHANNELS) {
+        return;
+    }
+
+#if BMS_FIXED_POINT
+    // Samples are promoted to 16 bits (code << 4) so block means keep 4 fractional bits
+    float factor = (float)fullScaleMilli / (65536.0f * (float)(1UL << SCALE_HEADROOM_BITS));
+    int8_t shift = 0;
+
+    while (factor >= 1.0f) {
+        factor *= 0.5f;
+        shift++;
+    }
+    while (factor < 0.5f && shift > -31) {
+        factor *= 2.0f;
+        shift--;
+    }
+    calibration[channel].scaleFract = (q31_t)(factor * 2147483648.0f);
+    calibration[channel].shift = shift;
+    calibration[channel].offset = offsetMilli;
+#else
+    calibration[channel].gain = (float32_t)fullScaleMilli / 4096.0f;
+    calibration[channel].offset = (float32_t)offsetMilli;
+#endif
+}
+
+// Block mean per channel, then calibrated gain and offset, all in the selected arithmetic.
+// Called from more than one stage, so the de-interleave scratch lives on the caller's stack.
+void signalConvertBlock(const AdcBlock *block, signal_t out[ADC_ACQ_NUM_CHANNELS]) {
+    signal_t channelScratch[ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+    uint32_t start = cycleCounterNow();
+
+    for (uint8_t channel = 0; channel < ADC_ACQ_NUM_CHANNELS; channel++) {
+        signal_t mean;
+
+        for (uint32_t sweep = 0; sweep < block->sweeps; sweep++) {
+            uint16_t code = block->samples[sweep * ADC_ACQ_NUM_CHANNELS + channel];
+#if BMS_FIXED_POINT
+            channelScratch[sweep] = (q31_t)code << SIGNAL_CODE_FRACTION_BITS;
+#else
+            channelScratch[sweep] = (float32_t)code;
+#endif
+        }
+
+#if BMS_FIXED_POINT
+        arm_mean_q31(channelScratch, block->sweeps, &mean);
+#else
+        arm_mean_f32(channelScratch, block->sweeps, &mean);
+#endif
+        out[channel] = signalCalibrate(channel, mean);
+    }
+
+    uint32_t elapsed = cycleCounterNow() - start;
+    taskENTER_CRITICAL();
+    pathStats.conversions++;
+    pathStats.lastConvertCycles = elapsed;
+    if (elapsed > pathStats.worstConvertCycles) {
+        pathStats.worstConvertCycles = elapsed;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Apply one channel's gain and offset to count values in code units (code << 4 on the fixed
+// path), in one vector pass per kernel. values may be the same array as codes.
+void signalCalibrateBlock(uint8_t channel, const signal_t *codes, signal_t *values, uint32_t count) {
+#if BMS_FIXED_POINT
+    arm_shift_q31(codes, SCALE_HEADROOM_BITS, values, count);
+    arm_scale_q31(values, calibration[channel].scaleFract, calibration[channel].shift, values, count);
+    arm_offset_q31(values, calibration[channel].offset, values, count);
+#else
+    arm_scale_f32(codes, calibration[channel].gain, values, count);
+    arm_offset_f32(values, calibration[channel].offset, values, count);
+#endif
+}
+
+// One value, for callers that have already reduced a block to its mean
+signal_t signalCalibrate(uint8_t channel, signal_t code) {
+    signal_t value;
+
+    signalCalibrateBlock(channel, &code, &value, 1);
+    return value;
+}
+
+void signalPathGetStats(SignalPathStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = pathStats;
+    taskEXIT_CRITICAL();
+}
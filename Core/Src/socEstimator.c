@@ -0,0 +1,230 @@
+#include "socEstimator.h"
+#include "coulombCounter.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "arm_math.h"
+#include <math.h>
+
+// SoH is re-estimated each time a cell's SoC moves this far from the last anchor
+#define SOH_SOC_WINDOW   20.0f
+#define SOH_FILTER_GAIN  0.1f
+
+typedef struct {
+    float x[2];           // SoC (%), polarization voltage (V)
+    float P[4];           // Row-major 2x2 covariance
+    float socAnchor;      // SoC and throughput at the start of the SoH window
+    float chargeAs;
+    float soh;
+} CellFilter;
+
+static CellFilter cellFilters[NUM_CELLS];
+static uint8_t filtersInitialized = 0;
+static volatile float packSoc = -1.0f;
+static SocEstimatorStats estimatorStats;
+
+static const float capacityAs = COULOMB_CAPACITY_MAH * 3.6f;
+
+static void initCell(CellFilter *filter, float voltage) {
+    filter->x[0] = ocvToSoc(voltage);
+    filter->x[1] = 0.0f;
+    filter->P[0] = 25.0f;   // +-5 % initial SoC uncertainty
+    filter->P[1] = 0.0f;
+    filter->P[2] = 0.0f;
+    filter->P[3] = 1.0e-4f;
+    filter->socAnchor = filter->x[0];
+    filter->chargeAs = 0.0f;
+    filter->soh = 100.0f;
+}
+
+#if SOC_EKF_SCALAR_PATH
+
+// Closed-form predict/update for the 2-state model, F = diag(1, a), H = [h, -1]
+static void updateCell(CellFilter *filter, float voltage, float current, float dt, float a) {
+    float *x = filter->x;
+    float *P = filter->P;
+    float slope;
+
+    // Predict
+    x[0] -= dt * current / capacityAs * 100.0f;
+    x[1] = a * x[1] + SOC_EKF_R1_OHM * (1.0f - a) * current;
+
+    float p00 = P[0] + SOC_EKF_Q_SOC * dt;
+    float p01 = a * P[1];
+    float p11 = a * a * P[3] + SOC_EKF_Q_VRC * dt;
+
+    // Update against the measured terminal voltage
+    float predicted = socToOcv(x[0], &slope) - x[1] - SOC_EKF_R0_OHM * current;
+    float ph0 = p00 * slope - p01;   // P * H'
+    float ph1 = p01 * slope - p11;
+    float s = slope * ph0 - ph1 + SOC_EKF_R_VOLTAGE;
+    float k0 = ph0 / s;
+    float k1 = ph1 / s;
+    float innovation = voltage - predicted;
+
+    x[0] += k0 * innovation;
+    x[1] += k1 * innovation;
+
+    P[0] = p00 - k0 * ph0;
+    P[1] = p01 - k0 * ph1;
+    P[2] = P[1];
+    P[3] = p11 - k1 * ph1;
+}
+
+#else
+
+// Generic chain on the CMSIS-DSP matrix kernels; scales to larger state vectors
+static void updateCell(CellFilter *filter, float voltage, float current, float dt, float a) {
+    float *x = filter->x;
+    float slope;
+
+    float F[4] = {1.0f, 0.0f, 0.0f, a};
+    float Ft[4] = {1.0f, 0.0f, 0.0f, a};
+    float Qn[4] = {SOC_EKF_Q_SOC * dt, 0.0f, 0.0f, SOC_EKF_Q_VRC * dt};
+    float I2[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+    float H[2], Ht[2], PHt[2], K[2];
+    float S[1], Sinv[1], Rn[1] = {SOC_EKF_R_VOLTAGE};
+    float FP[4], FPFt[4], KH[4], IKH[4], Pnew[4];
+
+    arm_matrix_instance_f32 matF, matFt, matQ, matI, matP, matH, matHt, matPHt, matK;
+    arm_matrix_instance_f32 matS, matSinv, matR, matFP, matFPFt, matKH, matIKH, matPnew;
+
+    arm_mat_init_f32(&matF, 2, 2, F);
+    arm_mat_init_f32(&matFt, 2, 2, Ft);
+    arm_mat_init_f32(&matQ, 2, 2, Qn);
+    arm_mat_init_f32(&matI, 2, 2, I2);
+    arm_mat_init_f32(&matP, 2, 2, filter->P);
+    arm_mat_init_f32(&matH, 1, 2, H);
+    arm_mat_init_f32(&matHt, 2, 1, Ht);
+    arm_mat_init_f32(&matPHt, 2, 1, PHt);
+    arm_mat_init_f32(&matK, 2, 1, K);
+    arm_mat_init_f32(&matS, 1, 1, S);
+    arm_mat_init_f32(&matSinv, 1, 1, Sinv);
+    arm_mat_init_f32(&matR, 1, 1, Rn);
+    arm_mat_init_f32(&matFP, 2, 2, FP);
+    arm_mat_init_f32(&matFPFt, 2, 2, FPFt);
+    arm_mat_init_f32(&matKH, 2, 2, KH);
+    arm_mat_init_f32(&matIKH, 2, 2, IKH);
+    arm_mat_init_f32(&matPnew, 2, 2, Pnew);
+
+    // Predict
+    x[0] -= dt * current / capacityAs * 100.0f;
+    x[1] = a * x[1] + SOC_EKF_R1_OHM * (1.0f - a) * current;
+    arm_mat_mult_f32(&matF, &matP, &matFP);
+    arm_mat_mult_f32(&matFP, &matFt, &matFPFt);
+    arm_mat_add_f32(&matFPFt, &matQ, &matP);
+
+    // Update against the measured terminal voltage
+    float predicted = socToOcv(x[0], &slope) - x[1] - SOC_EKF_R0_OHM * current;
+    H[0] = slope;
+    H[1] = -1.0f;
+    Ht[0] = slope;
+    Ht[1] = -1.0f;
+
+    arm_mat_mult_f32(&matP, &matHt, &matPHt);
+    arm_mat_mult_f32(&matH, &matPHt, &matS);
+    arm_mat_add_f32(&matS, &matR, &matS);
+    if (arm_mat_inverse_f32(&matS, &matSinv) != ARM_MATH_SUCCESS) {
+        return;  // Singular innovation covariance, keep the prediction
+    }
+    arm_mat_mult_f32(&matPHt, &matSinv, &matK);
+
+    float innovation = voltage - predicted;
+    x[0] += K[0] * innovation;
+    x[1] += K[1] * innovation;
+
+    arm_mat_mult_f32(&matK, &matH, &matKH);
+    arm_mat_sub_f32(&matI, &matKH, &matIKH);
+    arm_mat_mult_f32(&matIKH, &matP, &matPnew);
+    for (uint8_t i = 0; i < 4; i++) {
+        filter->P[i] = Pnew[i];
+    }
+}
+
+#endif /* SOC_EKF_SCALAR_PATH */
+
+// Coarse capacity fade: charge actually moved versus the SoC swing the filter saw
+static void updateSoh(CellFilter *filter, float current, float dt) {
+    filter->chargeAs += current * dt;
+
+    float swing = filter->socAnchor - filter->x[0];
+    if (swing < SOH_SOC_WINDOW && swing > -SOH_SOC_WINDOW) {
+        return;
+    }
+
+    float capacityRatio = (filter->chargeAs / capacityAs) / (swing / 100.0f);
+    if (capacityRatio > 0.5f && capacityRatio < 1.5f) {
+        filter->soh += SOH_FILTER_GAIN * (capacityRatio * 100.0f - filter->soh);
+    }
+    filter->socAnchor = filter->x[0];
+    filter->chargeAs = 0.0f;
+}
+
+void socEstimatorInit(void) {
+    filtersInitialized = 0;
+    packSoc = -1.0f;
+}
+
+// One EKF step for every cell; voltages and current must come from the same sample block
+void socEstimatorUpdate(const float voltages[NUM_CELLS], float current, float dt) {
+    uint32_t start = cycleCounterNow();
+    float a = expf(-dt / (SOC_EKF_R1_OHM * SOC_EKF_C1_FARAD));
+    float minSoc = 100.0f;
+
+    taskENTER_CRITICAL();
+    if (!filtersInitialized) {
+        for (uint8_t i = 0; i < NUM_CELLS; i++) {
+            initCell(&cellFilters[i], voltages[i]);
+        }
+        filtersInitialized = 1;
+    }
+    taskEXIT_CRITICAL();
+
+    for (uint8_t i = 0; i < NUM_CELLS; i++) {
+        CellFilter working = cellFilters[i];
+
+        updateCell(&working, voltages[i], current, dt, a);
+        updateSoh(&working, current, dt);
+        if (working.x[0] > 100.0f) working.x[0] = 100.0f;
+        if (working.x[0] < 0.0f) working.x[0] = 0.0f;
+
+        taskENTER_CRITICAL();
+        cellFilters[i] = working;
+        taskEXIT_CRITICAL();
+
+        if (working.x[0] < minSoc) {
+            minSoc = working.x[0];
+        }
+    }
+
+    // The weakest cell bounds what the pack can deliver
+    packSoc = minSoc;
+
+    estimatorStats.updates++;
+    estimatorStats.lastUpdateCycles = cycleCounterNow() - start;
+    if (estimatorStats.lastUpdateCycles > estimatorStats.worstUpdateCycles) {
+        estimatorStats.worstUpdateCycles = estimatorStats.lastUpdateCycles;
+    }
+}
+
+void socEstimatorGetCell(uint8_t cell, CellEstimate *estimate) {
+    if (cell >= NUM_CELLS) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    estimate->soc = cellFilters[cell].x[0];
+    estimate->polarizationVoltage = cellFilters[cell].x[1];
+    estimate->soh = cellFilters[cell].soh;
+    taskEXIT_CRITICAL();
+}
+
+// -1 until the first update has seeded the filters
+float socEstimatorGetPackSoc(void) {
+    return packSoc;
+}
+
+void socEstimatorGetStats(SocEstimatorStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = estimatorStats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,146 @@
+#include "sopEstimator.h"
+#include "batteryManagement.h"
+#include "socEstimator.h"
+#include "dcirEstimator.h"
+#include "faultManager.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <math.h>
+
+// Fraction of the rated current, one row per SoC step (0, 20 ... 100 %), one column per
+// temperature step (-20, -10 ... 60 degC). Discharge falls off in the cold, above 40 degC
+// and below 40 % SoC; charge is blocked below 0 degC and tapers above 80 % SoC.
+static const float32_t dischargeDerating[SOP_MAP_SOCS * SOP_MAP_TEMPERATURES] = {
+    0.06f, 0.10f, 0.14f, 0.18f, 0.20f, 0.20f, 0.20f, 0.12f, 0.00f,
+    0.21f, 0.35f, 0.49f, 0.63f, 0.70f, 0.70f, 0.70f, 0.42f, 0.00f,
+    0.30f, 0.50f, 0.70f, 0.90f, 1.00f, 1.00f, 1.00f, 0.60f, 0.00f,
+    0.30f, 0.50f, 0.70f, 0.90f, 1.00f, 1.00f, 1.00f, 0.60f, 0.00f,
+    0.30f, 0.50f, 0.70f, 0.90f, 1.00f, 1.00f, 1.00f, 0.60f, 0.00f,
+    0.30f, 0.50f, 0.70f, 0.90f, 1.00f, 1.00f, 1.00f, 0.60f, 0.00f,
+};
+
+static const float32_t chargeDerating[SOP_MAP_SOCS * SOP_MAP_TEMPERATURES] = {
+    0.00f, 0.00f, 0.10f, 0.50f, 1.00f, 1.00f, 1.00f, 0.50f, 0.00f,
+    0.00f, 0.00f, 0.10f, 0.50f, 1.00f, 1.00f, 1.00f, 0.50f, 0.00f,
+    0.00f, 0.00f, 0.10f, 0.50f, 1.00f, 1.00f, 1.00f, 0.50f, 0.00f,
+    0.00f, 0.00f, 0.10f, 0.50f, 1.00f, 1.00f, 1.00f, 0.50f, 0.00f,
+    0.00f, 0.00f, 0.06f, 0.30f, 0.60f, 0.60f, 0.60f, 0.30f, 0.00f,
+    0.00f, 0.00f, 0.01f, 0.05f, 0.10f, 0.10f, 0.10f, 0.05f, 0.00f,
+};
+
+// arm_bilinear_interp_f32 only reads the table; the instance just is not const-qualified
+static const arm_bilinear_interp_instance_f32 dischargeMap = {
+    SOP_MAP_SOCS, SOP_MAP_TEMPERATURES, (float32_t *)dischargeDerating
+};
+static const arm_bilinear_interp_instance_f32 chargeMap = {
+    SOP_MAP_SOCS, SOP_MAP_TEMPERATURES, (float32_t *)chargeDerating
+};
+
+// Added to each cell's DCIR: the RC branch charged for the peak window, and fully charged
+static float peakPolarizationOhm = 0.0f;
+static float continuousPolarizationOhm = 0.0f;
+static SopEstimatorStats estimatorStats;
+
+// Grid coordinate for the interpolator. It returns 0 for anything on or past the last
+// node, so the coordinate is held just inside it.
+static float gridCoordinate(float value, float origin, float step, uint16_t nodes) {
+    float coordinate = (value - origin) / step;
+    float last = (float)(nodes - 1U) - 0.001f;
+
+    return coordinate < 0.0f ? 0.0f : (coordinate > last ? last : coordinate);
+}
+
+// Both temperature extremes are looked up and the lower fraction wins: the coldest cell
+// limits charge, the hottest one limits everything
+static float derating(const arm_bilinear_interp_instance_f32 *map, float coldest, float hottest, float soc) {
+    float y = gridCoordinate(soc, 0.0f, SOP_MAP_SOC_STEP, SOP_MAP_SOCS);
+    float cold = arm_bilinear_interp_f32(map, gridCoordinate(coldest, SOP_MAP_TEMPERATURE_MIN_C,
+                                         SOP_MAP_TEMPERATURE_STEP_C, SOP_MAP_TEMPERATURES), y);
+    float hot = arm_bilinear_interp_f32(map, gridCoordinate(hottest, SOP_MAP_TEMPERATURE_MIN_C,
+                                        SOP_MAP_TEMPERATURE_STEP_C, SOP_MAP_TEMPERATURES), y);
+
+    return cold < hot ? cold : hot;
+}
+
+static float clampCurrent(float current, float limit) {
+    return current < 0.0f ? 0.0f : (current > limit ? limit : current);
+}
+
+// Per cell: back out the open-circuit voltage from the present load, then find the current
+// that puts it at the margin inside MIN/MAX_CELL_VOLTAGE through the window's resistance.
+// The string shares one current, so the first cell to reach its limit sets the pack limit.
+static void computeLimits(const float *voltages, const float *resistances, uint32_t count, float current,
+                          float coldest, float hottest, float soc, SopLimits *limits) {
+    float floorVoltage = MIN_CELL_VOLTAGE + SOP_VOLTAGE_MARGIN;
+    float ceilingVoltage = MAX_CELL_VOLTAGE - SOP_VOLTAGE_MARGIN;
+    float dischargePeak = INFINITY;
+    float dischargeContinuous = INFINITY;
+    float chargePeak = INFINITY;
+    float chargeContinuous = INFINITY;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float ocv = voltages[i] + resistances[i] * current;
+        float peakConductance = 1.0f / (resistances[i] + peakPolarizationOhm);
+        float continuousConductance = 1.0f / (resistances[i] + continuousPolarizationOhm);
+        float dischargeHeadroom = ocv - floorVoltage;
+        float chargeHeadroom = ceilingVoltage - ocv;
+
+        dischargePeak = fminf(dischargePeak, dischargeHeadroom * peakConductance);
+        dischargeContinuous = fminf(dischargeContinuous, dischargeHeadroom * continuousConductance);
+        chargePeak = fminf(chargePeak, chargeHeadroom * peakConductance);
+        chargeContinuous = fminf(chargeContinuous, chargeHeadroom * continuousConductance);
+    }
+
+    float dischargeFraction = derating(&dischargeMap, coldest, hottest, soc);
+    float chargeFraction = derating(&chargeMap, coldest, hottest, soc);
+
+    limits->dischargePeak = clampCurrent(dischargePeak, SOP_DISCHARGE_PEAK_A * dischargeFraction);
+    limits->dischargeContinuous = clampCurrent(dischargeContinuous, SOP_DISCHARGE_CONTINUOUS_A * dischargeFraction);
+    limits->chargePeak = clampCurrent(chargePeak, SOP_CHARGE_PEAK_A * chargeFraction);
+    limits->chargeContinuous = clampCurrent(chargeContinuous, SOP_CHARGE_CONTINUOUS_A * chargeFraction);
+}
+
+void sopEstimatorInit(void) {
+    float tau = SOC_EKF_R1_OHM * SOC_EKF_C1_FARAD;
+
+    peakPolarizationOhm = SOC_EKF_R1_OHM * (1.0f - expf(-SOP_PEAK_DURATION_S / tau));
+    continuousPolarizationOhm = SOC_EKF_R1_OHM;
+    estimatorStats = (SopEstimatorStats){0};
+}
+
+// Safety stage only. A direction a fault has disabled reports zero, and so does everything
+// until SoC is known.
+void sopEstimatorUpdate(const BatteryPack *pack, float soc, uint8_t disabledPaths, SopLimits *limits) {
+    uint32_t start = cycleCounterNow();
+
+    if (soc < 0.0f) {
+        *limits = (SopLimits){0};
+    } else {
+        computeLimits(pack->cellVoltages, pack->cellResistance, NUM_CELLS, pack->current,
+                      pack->temperatureStats.min, pack->temperatureStats.max, soc, limits);
+    }
+    if (disabledPaths & FAULT_PATH_DISCHARGE) {
+        limits->dischargePeak = 0.0f;
+        limits->dischargeContinuous = 0.0f;
+    }
+    if (disabledPaths & FAULT_PATH_CHARGE) {
+        limits->chargePeak = 0.0f;
+        limits->chargeContinuous = 0.0f;
+    }
+
+    uint32_t elapsed = cycleCounterNow() - start;
+    taskENTER_CRITICAL();
+    estimatorStats.updates++;
+    estimatorStats.lastUpdateCycles = elapsed;
+    if (elapsed > estimatorStats.worstUpdateCycles) {
+        estimatorStats.worstUpdateCycles = elapsed;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void sopEstimatorGetStats(SopEstimatorStats *stats) {
+    taskENTER_CRITICAL();
+    *stats = estimatorStats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,282 @@
+#include "temperatureScheduler.h"
+#include "cycleCounter.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define TMP102_TEMPERATURE_REGISTER 0x00U
+#define TMP102_LSB_CELSIUS          0.0625f
+
+#define BUS_RECOVERY_PULSES         9U    // Enough to finish any byte a slave is stuck in
+#define BUS_RECOVERY_HALF_PERIOD_US 5U    // 100 kHz
+
+// Completion bits each bus raises on the sweeping task; failures also set the bit 8 above
+#define BUS_DONE_BIT(bus)   (1UL << (bus))
+#define BUS_FAILED_BIT(bus) (1UL << ((bus) + 8U))
+
+typedef struct {
+    I2C_HandleTypeDef *handle;
+    GPIO_TypeDef *sclPort;
+    uint16_t sclPin;
+    GPIO_TypeDef *sdaPort;
+    uint16_t sdaPin;
+} TemperatureBus;
+
+typedef struct {
+    uint8_t bus;
+    uint8_t address;
+} TemperatureSensor;
+
+static const TemperatureBus buses[PACK_NUM_TEMPERATURE_BUSES] = {
+    [PACK_TEMPERATURE_BUS_I2C1] = {&hi2c1, I2C1_SCL_GPIO_Port, I2C1_SCL_Pin, I2C1_SDA_GPIO_Port, I2C1_SDA_Pin},
+    [PACK_TEMPERATURE_BUS_I2C2] = {&hi2c2, I2C2_SCL_GPIO_Port, I2C2_SCL_Pin, I2C2_SDA_GPIO_Port, I2C2_SDA_Pin},
+};
+
+#define TEMPERATURE_SENSOR_ENTRY(bus, address) {bus, address},
+static const TemperatureSensor sensors[PACK_NUM_I2C_TEMPERATURES] = {
+    PACK_TEMPERATURE_SENSORS(TEMPERATURE_SENSOR_ENTRY)
+};
+#undef TEMPERATURE_SENSOR_ENTRY
+
+static uint8_t rxBuffers[PACK_NUM_TEMPERATURE_BUSES][2];   // DMA targets, one transfer per bus at a time
+static uint8_t nextSensor[PACK_NUM_TEMPERATURE_BUSES];     // Round-robin cursor into sensors[]
+static uint8_t sweepRounds = 0;                            // Most sensors on any one bus
+static float readings[PACK_NUM_I2C_TEMPERATURES];
+static uint8_t reportedLost[PACK_NUM_I2C_TEMPERATURES];    // As of the last sweep
+static TemperatureSensorStats sensorStats[PACK_NUM_I2C_TEMPERATURES];
+static uint32_t busRecoveries[PACK_NUM_TEMPERATURE_BUSES];
+static volatile TaskHandle_t waitingTask = NULL;
+
+void temperatureSchedulerInit(void) {
+    uint8_t perBus[PACK_NUM_TEMPERATURE_BUSES] = {0};
+
+    for (uint8_t sensor = 0; sensor < PACK_NUM_I2C_TEMPERATURES; sensor++) {
+        perBus[sensors[sensor].bus]++;
+        readings[sensor] = 0.0f;
+        reportedLost[sensor] = 1;   // Until its first read
+    }
+    for (uint8_t bus = 0; bus < PACK_NUM_TEMPERATURE_BUSES; bus++) {
+        nextSensor[bus] = 0;
+        if (perBus[bus] > sweepRounds) {
+            sweepRounds = perBus[bus];
+        }
+    }
+}
+
+static void delayMicros(uint32_t micros) {
+    uint32_t start = cycleCounterNow();
+    uint32_t cycles = micros * (SystemCoreClock / 1000000U);
+
+    while (cycleCounterNow() - start < cycles) {
+    }
+}
+
+// A slave reset mid-byte can hold SDA low forever. Take the pins over as open-drain GPIO,
+// clock SCL until SDA is released, issue a STOP, then hand the pins back to a fresh peripheral.
+static void recoverBus(uint8_t bus) {
+    const TemperatureBus *config = &buses[bus];
+    GPIO_InitTypeDef gpio = {0};
+
+    HAL_I2C_DeInit(config->handle);
+
+    gpio.Mode = GPIO_MODE_OUTPUT_OD;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_WritePin(config->sclPort, config->sclPin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(config->sdaPort, config->sdaPin, GPIO_PIN_SET);
+    gpio.Pin = config->sclPin;
+    HAL_GPIO_Init(config->sclPort, &gpio);
+    gpio.Pin = config->sdaPin;
+    HAL_GPIO_Init(config->sdaPort, &gpio);
+
+    for (uint8_t pulse = 0; pulse < BUS_RECOVERY_PULSES; pulse++) {
+        if (HAL_GPIO_ReadPin(config->sdaPort, config->sdaPin) == GPIO_PIN_SET) {
+            break;
+        }
+        HAL_GPIO_WritePin(config->sclPort, config->sclPin, GPIO_PIN_RESET);
+        delayMicros(BUS_RECOVERY_HALF_PERIOD_US);
+        HAL_GPIO_WritePin(config->sclPort, config->sclPin, GPIO_PIN_SET);
+        delayMicros(BUS_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    HAL_GPIO_WritePin(config->sclPort, config->sclPin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(config->sdaPort, config->sdaPin, GPIO_PIN_RESET);
+    delayMicros(BUS_RECOVERY_HALF_PERIOD_US);
+    HAL_GPIO_WritePin(config->sclPort, config->sclPin, GPIO_PIN_SET);
+    delayMicros(BUS_RECOVERY_HALF_PERIOD_US);
+    HAL_GPIO_WritePin(config->sdaPort, config->sdaPin, GPIO_PIN_SET);
+    delayMicros(BUS_RECOVERY_HALF_PERIOD_US);
+
+    // HAL_I2C_Init software-resets the peripheral, which also clears a stuck BUSY flag
+    HAL_I2C_Init(config->handle);
+    busRecoveries[bus]++;
+}
+
+// A NACK only means that sensor is absent or busy; anything else leaves the bus suspect
+static uint8_t busNeedsRecovery(const I2C_HandleTypeDef *handle) {
+    return (handle->ErrorCode & ~HAL_I2C_ERROR_AF) != HAL_I2C_ERROR_NONE;
+}
+
+// Next sensor on this bus from its cursor, or -1 if none is configured there
+static int16_t takeNextSensor(uint8_t bus) {
+    for (uint8_t step = 0; step < PACK_NUM_I2C_TEMPERATURES; step++) {
+        uint8_t sensor = (uint8_t)((nextSensor[bus] + step) % PACK_NUM_I2C_TEMPERATURES);
+
+        if (sensors[sensor].bus == bus) {
+            nextSensor[bus] = (uint8_t)((sensor + 1U) % PACK_NUM_I2C_TEMPERATURES);
+            return sensor;
+        }
+    }
+    return -1;
+}
+
+static void recordResult(uint8_t sensor, uint8_t success, uint8_t timedOut) {
+    TemperatureSensorStats *stats = &sensorStats[sensor];
+
+    taskENTER_CRITICAL();
+    if (success) {
+        stats->reads++;
+        stats->consecutiveFailures = 0;
+        stats->lastReadTick = xTaskGetTickCount();
+        stats->lastTemperature = readings[sensor];
+    } else {
+        if (timedOut) {
+            stats->timeouts++;
+        } else {
+            stats->failures++;
+        }
+        stats->consecutiveFailures++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// One round: start the next sensor on every bus at once, then sleep until each DMA read has
+// completed or timed out. The register address phase runs from the I2C event interrupt.
+static void runRound(void) {
+    int16_t active[PACK_NUM_TEMPERATURE_BUSES];
+    uint32_t pending = 0;
+    uint32_t events = 0;
+
+    waitingTask = xTaskGetCurrentTaskHandle();
+    xTaskNotifyWait(0, 0xFFFFFFFFUL, NULL, 0);   // Drop completions left over from a timed-out round
+
+    for (uint8_t bus = 0; bus < PACK_NUM_TEMPERATURE_BUSES; bus++) {
+        active[bus] = takeNextSensor(bus);
+        if (active[bus] < 0) {
+            continue;
+        }
+
+        I2C_HandleTypeDef *handle = buses[bus].handle;
+        if (HAL_I2C_Mem_Read_DMA(handle, (uint16_t)(sensors[active[bus]].address << 1), TMP102_TEMPERATURE_REGISTER,
+                                 I2C_MEMADD_SIZE_8BIT, rxBuffers[bus], sizeof(rxBuffers[bus])) == HAL_OK) {
+            pending |= BUS_DONE_BIT(bus);
+            continue;
+        }
+        recordResult((uint8_t)active[bus], 0, 0);
+        if (handle->State != HAL_I2C_STATE_READY || busNeedsRecovery(handle)) {
+            recoverBus(bus);
+        }
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(TEMPERATURE_TRANSFER_TIMEOUT_MS) + 1U;
+    while ((events & pending) != pending) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        uint32_t bits;
+
+        if (elapsed >= timeout) {
+            break;
+        }
+        if (xTaskNotifyWait(0, 0xFFFFFFFFUL, &bits, timeout - elapsed) == pdTRUE) {
+            events |= bits;
+        }
+    }
+
+    for (uint8_t bus = 0; bus < PACK_NUM_TEMPERATURE_BUSES; bus++) {
+        if (!(pending & BUS_DONE_BIT(bus))) {
+            continue;
+        }
+        uint8_t sensor = (uint8_t)active[bus];
+
+        if (!(events & BUS_DONE_BIT(bus))) {
+            recordResult(sensor, 0, 1);
+            recoverBus(bus);   // Also aborts the DMA stream still waiting on the bus
+        } else if (events & BUS_FAILED_BIT(bus)) {
+            recordResult(sensor, 0, 0);
+            if (busNeedsRecovery(buses[bus].handle)) {
+                recoverBus(bus);
+            }
+        } else {
+            int16_t raw = (int16_t)((rxBuffers[bus][0] << 8) | rxBuffers[bus][1]);
+            readings[sensor] = (raw >> 4) * TMP102_LSB_CELSIUS;
+            recordResult(sensor, 1, 0);
+        }
+    }
+}
+
+// Reads every configured sensor once, both buses in parallel. Returns 1 if any reading or
+// any sensor's health changed; temperatures always receives the newest value held for every
+// sensor, and lost marks the sensors that are not healthy, whose value is not to be used.
+uint8_t temperatureSchedulerSweep(float temperatures[PACK_NUM_I2C_TEMPERATURES], uint8_t lost[PACK_NUM_I2C_TEMPERATURES]) {
+    uint32_t readsBefore = 0;
+    uint32_t readsAfter = 0;
+    uint8_t healthChanged = 0;
+
+    for (uint8_t sensor = 0; sensor < PACK_NUM_I2C_TEMPERATURES; sensor++) {
+        readsBefore += sensorStats[sensor].reads;
+    }
+    for (uint8_t round = 0; round < sweepRounds; round++) {
+        runRound();
+    }
+    for (uint8_t sensor = 0; sensor < PACK_NUM_I2C_TEMPERATURES; sensor++) {
+        uint8_t isLost = !temperatureSchedulerIsHealthy(sensor);
+
+        readsAfter += sensorStats[sensor].reads;
+        temperatures[sensor] = readings[sensor];
+        healthChanged |= isLost != reportedLost[sensor];
+        reportedLost[sensor] = isLost;
+        lost[sensor] = isLost;
+    }
+    return readsAfter != readsBefore || healthChanged;
+}
+
+uint8_t temperatureSchedulerIsHealthy(uint8_t sensor) {
+    if (sensor >= PACK_NUM_I2C_TEMPERATURES) {
+        return 0;
+    }
+    return sensorStats[sensor].reads > 0 && sensorStats[sensor].consecutiveFailures < TEMPERATURE_SENSOR_FAULT_LIMIT;
+}
+
+void temperatureSchedulerGetStats(uint8_t sensor, TemperatureSensorStats *stats) {
+    if (sensor >= PACK_NUM_I2C_TEMPERATURES) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    *stats = sensorStats[sensor];
+    taskEXIT_CRITICAL();
+}
+
+uint32_t temperatureSchedulerGetBusRecoveries(uint8_t bus) {
+    return bus < PACK_NUM_TEMPERATURE_BUSES ? busRecoveries[bus] : 0;
+}
+
+static void finishTransfer(I2C_HandleTypeDef *hi2c, uint8_t failed) {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    for (uint8_t bus = 0; bus < PACK_NUM_TEMPERATURE_BUSES; bus++) {
+        if (buses[bus].handle != hi2c || waitingTask == NULL) {
+            continue;
+        }
+        uint32_t bits = BUS_DONE_BIT(bus) | (failed ? BUS_FAILED_BIT(bus) : 0U);
+        xTaskNotifyFromISR(waitingTask, bits, eSetBits, &higherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    finishTransfer(hi2c, 0);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    finishTransfer(hi2c, 1);
+}
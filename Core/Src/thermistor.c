@@ -0,0 +1,23 @@
+#include "thermistor.h"
+#include "ntcTable.h"
+
+// A 12-bit ratio code indexes the table in 12.20 fixed point, one entry every 1 << STEP_SHIFT codes
+float thermistorCodeToCelsius(uint16_t code) {
+    q31_t x = (q31_t)code << (20 - NTC_TABLE_STEP_SHIFT);
+    q15_t value = arm_linear_interp_q15(ntcTemperatureTable, x, NTC_TABLE_ENTRIES);
+    return value * (NTC_TABLE_FULL_SCALE_C / 32768.0f);
+}
+
+// Converts count codes and returns how many sat outside the rated range. An open or shorted
+// sensor still gets the clamped table value so the pack maximum stays meaningful.
+uint8_t thermistorConvert(const uint16_t *codes, float *temperatures, uint32_t count) {
+    uint8_t faults = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (codes[i] < NTC_SHORT_CODE || codes[i] > NTC_OPEN_CODE) {
+            faults++;
+        }
+        temperatures[i] = thermistorCodeToCelsius(codes[i]);
+    }
+    return faults;
+}
@@ -0,0 +1,26 @@
+#ifndef FREERTOS_STUB_H
+#define FREERTOS_STUB_H
+
+// Host stand-in for the FreeRTOS kernel: one tick counter the test drives, task notifications
+// kept per handle, and critical sections that are counted so a test can check where they run
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ 1000U
+#define portTICK_PERIOD_MS ((TickType_t)1000U / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define configASSERT(x) do { if ((x) == 0) { hostAssertFailed(__FILE__, __LINE__); } } while (0)
+
+void hostAssertFailed(const char *file, int line);
+
+#endif /* FREERTOS_STUB_H */
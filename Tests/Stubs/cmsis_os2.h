@@ -0,0 +1,35 @@
+#ifndef CMSIS_OS2_STUB_H
+#define CMSIS_OS2_STUB_H
+
+#include "FreeRTOS.h"
+
+typedef void *osThreadId_t;
+typedef void (*osThreadFunc_t)(void *argument);
+typedef enum {
+    osPriorityNone = 0,
+    osPriorityIdle = 1,
+    osPriorityLow = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal = 24,
+    osPriorityAboveNormal = 32,
+    osPriorityHigh = 40,
+    osPriorityRealtime = 48
+} osPriority_t;
+typedef enum { osOK = 0, osError = -1 } osStatus_t;
+
+typedef struct {
+    const char *name;
+    uint32_t attr_bits;
+    void *cb_mem;
+    uint32_t cb_size;
+    void *stack_mem;
+    uint32_t stack_size;
+    osPriority_t priority;
+} osThreadAttr_t;
+
+osThreadId_t osThreadNew(osThreadFunc_t function, void *argument, const osThreadAttr_t *attributes);
+osStatus_t osDelay(uint32_t ticks);
+osStatus_t osKernelInitialize(void);
+osStatus_t osKernelStart(void);
+
+#endif /* CMSIS_OS2_STUB_H */
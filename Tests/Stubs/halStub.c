@@ -0,0 +1,670 @@
+#define _GNU_SOURCE
+#include "stm32f4xx_hal.h"
+#include "hostStub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+
+uint32_t SystemCoreClock = HOST_CORE_CLOCK_HZ;
+
+volatile uint32_t hostPrimask = 0;
+volatile uint32_t hostIpsr = 0;
+__thread volatile uint32_t *hostExclusiveAddress = NULL;
+__thread uint32_t hostExclusiveValue = 0;
+
+GPIO_TypeDef hostGpio[3];
+TIM_TypeDef hostTim[3];
+ADC_TypeDef hostAdc[2];
+CAN_TypeDef hostCan[2];
+SPI_TypeDef hostSpi2;
+I2C_TypeDef hostI2c[2];
+USART_TypeDef hostUsart[2];
+CRC_TypeDef hostCrc;
+RCC_TypeDef hostRcc;
+DMA_Stream_TypeDef hostDmaStreams[8];
+CoreDebug_Type hostCoreDebug;
+
+// The handles main.c and CubeMX would define
+ADC_HandleTypeDef hadc1 = { .Instance = ADC1 };
+ADC_HandleTypeDef hadc2 = { .Instance = ADC2 };
+DMA_HandleTypeDef hdma_adc1 = { .Instance = DMA2_Stream0 };
+TIM_HandleTypeDef htim2 = { .Instance = TIM2 };
+TIM_HandleTypeDef htim3 = { .Instance = TIM3 };
+TIM_HandleTypeDef htim8 = { .Instance = TIM8 };
+SPI_HandleTypeDef hspi2 = { .Instance = SPI2 };
+DMA_HandleTypeDef hdma_spi2_rx = { .Instance = DMA1_Stream3 };
+DMA_HandleTypeDef hdma_spi2_tx = { .Instance = DMA1_Stream4 };
+CAN_HandleTypeDef hcan1 = { .Instance = CAN1 };
+CRC_HandleTypeDef hcrc = { .Instance = CRC };
+I2C_HandleTypeDef hi2c1 = { .Instance = I2C1, .State = HAL_I2C_STATE_READY };
+I2C_HandleTypeDef hi2c2 = { .Instance = I2C2, .State = HAL_I2C_STATE_READY };
+DMA_HandleTypeDef hdma_i2c1_rx = { .Instance = DMA1_Stream0 };
+DMA_HandleTypeDef hdma_i2c2_rx = { .Instance = DMA1_Stream2 };
+UART_HandleTypeDef huart4 = { .Instance = UART4 };
+UART_HandleTypeDef huart2 = { .Instance = USART2 };
+
+uint32_t hostErrorHandlerCalls = 0;
+
+void Error_Handler(void) {
+    hostErrorHandlerCalls++;
+}
+
+// ---- Deferred interrupts ------------------------------------------------------------------
+
+#define HOST_MAX_DEFERRED 16
+
+typedef struct {
+    void (*handler)(void *context);
+    void *context;
+} HostDeferred;
+
+static HostDeferred deferred[HOST_MAX_DEFERRED];
+static uint32_t deferredCount = 0;
+
+void hostDeferInterrupt(void (*handler)(void *context), void *context) {
+    if (deferredCount >= HOST_MAX_DEFERRED) {
+        fprintf(stderr, "host: too many deferred interrupts\n");
+        abort();
+    }
+    deferred[deferredCount].handler = handler;
+    deferred[deferredCount].context = context;
+    deferredCount++;
+}
+
+uint32_t hostRunInterrupts(void) {
+    uint32_t ran = 0;
+
+    while (deferredCount > 0) {
+        HostDeferred next = deferred[0];
+        memmove(&deferred[0], &deferred[1], (deferredCount - 1U) * sizeof(deferred[0]));
+        deferredCount--;
+
+        uint32_t savedIpsr = hostIpsr;
+        hostIpsr = 16U;
+        next.handler(next.context);
+        hostIpsr = savedIpsr;
+        ran++;
+    }
+    return ran;
+}
+
+// ---- Cycle counter ------------------------------------------------------------------------
+
+static DWT_Type dwt;
+static uint8_t dwtManual = 0;
+
+DWT_Type *hostDwt(void) {
+    if (!dwtManual) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+        dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000U) / 1000U);
+    }
+    return &dwt;
+}
+
+void hostCyclesSetManual(uint8_t manual) {
+    dwtManual = manual;
+}
+
+void hostCyclesAdvance(uint32_t cycles) {
+    dwt.CYCCNT += cycles;
+}
+
+uint64_t hostNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// ---- NVIC, RCC ----------------------------------------------------------------------------
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preemptPriority, uint32_t subPriority) {
+    (void)irq; (void)preemptPriority; (void)subPriority;
+}
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return SystemCoreClock / 2U; }
+uint32_t HAL_RCC_GetPCLK2Freq(void) { return SystemCoreClock; }
+uint32_t HAL_RCC_GetHCLKFreq(void) { return SystemCoreClock; }
+
+// ---- GPIO ---------------------------------------------------------------------------------
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) { (void)port; (void)init; }
+void HAL_GPIO_DeInit(GPIO_TypeDef *port, uint32_t pin) { (void)port; (void)pin; }
+
+// BSRR writes land in ODR as soon as they are seen, like the hardware's set/reset port
+static void applyBsrr(GPIO_TypeDef *port) {
+    uint32_t bsrr = port->BSRR;
+
+    port->ODR = (port->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFFU);
+    port->BSRR = 0;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    applyBsrr(port);
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+    applyBsrr(port);
+    return ((port->IDR | port->ODR) & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin) {
+    applyBsrr(port);
+    port->ODR ^= pin;
+}
+
+GPIO_PinState hostGpioOutput(GPIO_TypeDef *port, uint16_t pin) {
+    applyBsrr(port);
+    return (port->ODR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+// ---- Tick ---------------------------------------------------------------------------------
+
+uint32_t HAL_GetTick(void) {
+    return hostTickCount;
+}
+
+void HAL_Delay(uint32_t delay) {
+    hostTickCount += delay + 1U;
+}
+
+// ---- ADC ----------------------------------------------------------------------------------
+
+uint32_t *hostAdcDmaBuffer = NULL;
+uint32_t hostAdcDmaLength = 0;
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc) { (void)hadc; return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *config) {
+    (void)hadc; (void)config;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef *hadc, ADC_AnalogWDGConfTypeDef *config) {
+    hadc->Instance->HTR = config->HighThreshold;
+    hadc->Instance->LTR = config->LowThreshold;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc) { (void)hadc; return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc) { (void)hadc; return HAL_OK; }
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(ADC_HandleTypeDef *hadc, ADC_MultiModeTypeDef *multimode) {
+    (void)hadc; (void)multimode;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStart_DMA(ADC_HandleTypeDef *hadc, uint32_t *data, uint32_t length) {
+    (void)hadc;
+    hostAdcDmaBuffer = data;
+    hostAdcDmaLength = length;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStop_DMA(ADC_HandleTypeDef *hadc) {
+    (void)hadc;
+    hostAdcDmaBuffer = NULL;
+    return HAL_OK;
+}
+
+// The watchdog fires when the test has put an out-of-window value in SR
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc) {
+    if ((hadc->Instance->SR & ADC_FLAG_AWD) && (hadc->Instance->CR1 & ADC_IT_AWD)) {
+        hadc->Instance->SR &= ~(uint32_t)ADC_FLAG_AWD;
+        HAL_ADC_LevelOutOfWindowCallback(hadc);
+    }
+}
+
+__WEAK void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) { (void)hadc; }
+__WEAK void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) { (void)hadc; }
+__WEAK void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc) { (void)hadc; }
+
+// ---- TIM ----------------------------------------------------------------------------------
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim) {
+    htim->Instance->ARR = htim->Init.Period;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim) { htim->Instance->CR1 |= 1U; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim) { htim->Instance->CR1 &= ~1U; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *config) {
+    (void)htim; (void)config;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *config) {
+    (void)htim; (void)config;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_SlaveConfigSynchro(TIM_HandleTypeDef *htim, TIM_SlaveConfigTypeDef *config) {
+    (void)htim; (void)config;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim) {
+    htim->Instance->ARR = htim->Init.Period;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *config, uint32_t channel) {
+    __HAL_TIM_SET_COMPARE(htim, channel, config->Pulse);
+    return HAL_OK;
+}
+// stm32f4xx_hal_msp.c on the target
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel) {
+    (void)htim; (void)channel;
+    return HAL_OK;
+}
+
+// ---- CAN ----------------------------------------------------------------------------------
+
+CAN_FilterTypeDef hostCanFilters[HOST_CAN_FILTER_BANKS];
+uint32_t hostCanFilterCount = 0;
+
+static HostCanTxFrame mailboxes[HOST_CAN_MAILBOXES];
+static uint8_t mailboxBusy[HOST_CAN_MAILBOXES];
+static HostCanRxFrame rxFifos[2][HOST_CAN_RX_FIFO_DEPTH];
+static uint32_t rxFill[2];
+static uint8_t canStarted = 0;
+
+HAL_StatusTypeDef HAL_CAN_Init(CAN_HandleTypeDef *hcan) { (void)hcan; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_CAN_Start(CAN_HandleTypeDef *hcan) {
+    (void)hcan;
+    canStarted = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_ConfigFilter(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *filter) {
+    (void)hcan;
+    if (canStarted || filter->FilterBank >= HOST_CAN_FILTER_BANKS) {
+        return HAL_ERROR;
+    }
+    hostCanFilters[filter->FilterBank] = *filter;
+    if (filter->FilterBank + 1U > hostCanFilterCount) {
+        hostCanFilterCount = filter->FilterBank + 1U;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_ActivateNotification(CAN_HandleTypeDef *hcan, uint32_t interrupts) {
+    (void)hcan; (void)interrupts;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *header,
+                                       uint8_t data[], uint32_t *mailbox) {
+    (void)hcan;
+    if (!canStarted) {
+        return HAL_ERROR;
+    }
+    for (uint8_t i = 0; i < HOST_CAN_MAILBOXES; i++) {
+        if (!mailboxBusy[i]) {
+            mailboxes[i].header = *header;
+            memcpy(mailboxes[i].data, data, header->DLC);
+            mailboxBusy[i] = 1;
+            *mailbox = 1UL << i;
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
+uint32_t HAL_CAN_GetTxMailboxesFreeLevel(CAN_HandleTypeDef *hcan) {
+    uint32_t free = 0;
+
+    (void)hcan;
+    for (uint8_t i = 0; i < HOST_CAN_MAILBOXES; i++) {
+        free += mailboxBusy[i] ? 0U : 1U;
+    }
+    return free;
+}
+
+HAL_StatusTypeDef HAL_CAN_GetRxMessage(CAN_HandleTypeDef *hcan, uint32_t fifo, CAN_RxHeaderTypeDef *header,
+                                       uint8_t data[]) {
+    (void)hcan;
+    if (fifo > 1U || rxFill[fifo] == 0) {
+        return HAL_ERROR;
+    }
+    *header = rxFifos[fifo][0].header;
+    memcpy(data, rxFifos[fifo][0].data, 8);
+    memmove(&rxFifos[fifo][0], &rxFifos[fifo][1], (rxFill[fifo] - 1U) * sizeof(HostCanRxFrame));
+    rxFill[fifo]--;
+    return HAL_OK;
+}
+
+uint32_t HAL_CAN_GetRxFifoFillLevel(CAN_HandleTypeDef *hcan, uint32_t fifo) {
+    (void)hcan;
+    return fifo > 1U ? 0U : rxFill[fifo];
+}
+
+HAL_StatusTypeDef HAL_CAN_ResetError(CAN_HandleTypeDef *hcan) {
+    hcan->ErrorCode = HAL_CAN_ERROR_NONE;
+    return HAL_OK;
+}
+
+void HAL_CAN_IRQHandler(CAN_HandleTypeDef *hcan) { (void)hcan; }
+
+__WEAK void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+__WEAK void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) { (void)hcan; }
+
+uint8_t hostCanMailboxBusy(uint8_t mailbox) {
+    return mailbox < HOST_CAN_MAILBOXES && mailboxBusy[mailbox];
+}
+
+const HostCanTxFrame *hostCanMailboxFrame(uint8_t mailbox) {
+    return &mailboxes[mailbox];
+}
+
+// The frame left the bus: free the mailbox and raise its TX-complete interrupt
+void hostCanCompleteMailbox(CAN_HandleTypeDef *hcan, uint8_t mailbox) {
+    if (!hostCanMailboxBusy(mailbox)) {
+        return;
+    }
+    mailboxBusy[mailbox] = 0;
+    hostIpsr = 16U + CAN1_TX_IRQn;
+    switch (mailbox) {
+    case 0: HAL_CAN_TxMailbox0CompleteCallback(hcan); break;
+    case 1: HAL_CAN_TxMailbox1CompleteCallback(hcan); break;
+    default: HAL_CAN_TxMailbox2CompleteCallback(hcan); break;
+    }
+    hostIpsr = 0;
+}
+
+void hostCanResetTx(void) {
+    memset(mailboxBusy, 0, sizeof(mailboxBusy));
+}
+
+// bxCAN filtering: the lowest-numbered matching bank wins. In 32-bit mask mode every bank is
+// one filter number, counted per FIFO in bank order; that count is the FilterMatchIndex.
+static uint8_t matchFilter(const CAN_RxHeaderTypeDef *header, uint32_t *fifo, uint32_t *matchIndex) {
+    uint32_t word = (header->IDE == CAN_ID_EXT) ? ((header->ExtId << 3) | CAN_ID_EXT) : (header->StdId << 21);
+    uint32_t perFifo[2] = {0, 0};
+
+    word |= header->RTR;
+    for (uint32_t bank = 0; bank < hostCanFilterCount; bank++) {
+        const CAN_FilterTypeDef *filter = &hostCanFilters[bank];
+        uint32_t id = (filter->FilterIdHigh << 16) | filter->FilterIdLow;
+        uint32_t mask = (filter->FilterMaskIdHigh << 16) | filter->FilterMaskIdLow;
+        uint32_t assigned = filter->FilterFIFOAssignment;
+
+        if (!filter->FilterActivation) {
+            continue;
+        }
+        if ((word & mask) == (id & mask)) {
+            *fifo = assigned;
+            *matchIndex = perFifo[assigned];
+            return 1;
+        }
+        perFifo[assigned]++;
+    }
+    return 0;
+}
+
+// A frame arrives: 0 if the filters dropped it, otherwise it is queued in its FIFO and the
+// RX interrupt runs (or the overrun error, if the FIFO was already full)
+uint8_t hostCanReceive(CAN_HandleTypeDef *hcan, uint32_t id, uint8_t extended, const uint8_t *data, uint8_t length) {
+    CAN_RxHeaderTypeDef header = {0};
+    uint32_t fifo;
+    uint32_t matchIndex;
+
+    header.IDE = extended ? CAN_ID_EXT : CAN_ID_STD;
+    header.StdId = extended ? 0 : id;
+    header.ExtId = extended ? id : 0;
+    header.RTR = CAN_RTR_DATA;
+    header.DLC = length;
+    if (!matchFilter(&header, &fifo, &matchIndex)) {
+        return 0;
+    }
+    header.FilterMatchIndex = matchIndex;
+
+    if (rxFill[fifo] >= HOST_CAN_RX_FIFO_DEPTH) {
+        hcan->ErrorCode |= fifo ? HAL_CAN_ERROR_RX_FOV1 : HAL_CAN_ERROR_RX_FOV0;
+        HAL_CAN_ErrorCallback(hcan);
+        return 1;
+    }
+    rxFifos[fifo][rxFill[fifo]].header = header;
+    memset(rxFifos[fifo][rxFill[fifo]].data, 0, 8);
+    memcpy(rxFifos[fifo][rxFill[fifo]].data, data, length);
+    rxFill[fifo]++;
+
+    hostIpsr = 16U + (fifo ? CAN1_RX1_IRQn : CAN1_RX0_IRQn);
+    while (rxFill[fifo] > 0) {
+        uint32_t before = rxFill[fifo];
+        if (fifo) {
+            HAL_CAN_RxFifo1MsgPendingCallback(hcan);
+        } else {
+            HAL_CAN_RxFifo0MsgPendingCallback(hcan);
+        }
+        if (rxFill[fifo] == before) {
+            break;
+        }
+    }
+    hostIpsr = 0;
+    return 1;
+}
+
+// ---- SPI ----------------------------------------------------------------------------------
+
+HostSpiDevice hostSpiDevice = NULL;
+
+typedef struct {
+    SPI_HandleTypeDef *hspi;
+    uint8_t failed;
+} SpiCompletion;
+
+static SpiCompletion spiCompletion;
+
+static void completeSpi(void *context) {
+    SpiCompletion *completion = context;
+
+    if (completion->failed) {
+        HAL_SPI_ErrorCallback(completion->hspi);
+    } else {
+        HAL_SPI_TxRxCpltCallback(completion->hspi);
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi) { (void)hspi; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout) {
+    static uint8_t discard[64];
+
+    (void)hspi; (void)timeout;
+    if (hostSpiDevice != NULL && size <= sizeof(discard)) {
+        hostSpiDevice(data, discard, size);
+    }
+    return HAL_OK;
+}
+
+// The bytes move at once; the completion interrupt runs when the caller next blocks
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *tx, uint8_t *rx, uint16_t size) {
+    uint8_t failed = 0;
+
+    memset(rx, 0xFF, size);
+    if (hostSpiDevice != NULL) {
+        failed = hostSpiDevice(tx, rx, size);
+    }
+    spiCompletion.hspi = hspi;
+    spiCompletion.failed = failed;
+    hostDeferInterrupt(completeSpi, &spiCompletion);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi) { (void)hspi; return HAL_OK; }
+
+__WEAK void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) { (void)hspi; }
+__WEAK void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) { (void)hspi; }
+
+// ---- I2C ----------------------------------------------------------------------------------
+
+HostI2cDevice hostI2cDevice = NULL;
+
+static void completeI2c(void *context) {
+    I2C_HandleTypeDef *hi2c = context;
+
+    if (hi2c->ErrorCode != HAL_I2C_ERROR_NONE) {
+        HAL_I2C_ErrorCallback(hi2c);
+    } else {
+        HAL_I2C_MemRxCpltCallback(hi2c);
+    }
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+    hi2c->State = HAL_I2C_STATE_READY;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+    hi2c->State = HAL_I2C_STATE_RESET;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                       uint16_t memAddSize, uint8_t *data, uint16_t size) {
+    (void)memAddress; (void)memAddSize;
+    if (hi2c->State != HAL_I2C_STATE_READY) {
+        return HAL_BUSY;
+    }
+    hi2c->State = HAL_I2C_STATE_BUSY;
+    hi2c->ErrorCode = (hostI2cDevice != NULL) ? hostI2cDevice(hi2c, address, data, size) : HAL_I2C_ERROR_AF;
+    hostDeferInterrupt(completeI2c, hi2c);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t address) {
+    (void)address;
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+__WEAK void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__WEAK void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+__WEAK void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c) { (void)hi2c; }
+
+// ---- UART ---------------------------------------------------------------------------------
+
+char hostUartOutput[4096];
+uint32_t hostUartLength = 0;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout) {
+    (void)huart; (void)timeout;
+    for (uint16_t i = 0; i < size && hostUartLength + 1U < sizeof(hostUartOutput); i++) {
+        hostUartOutput[hostUartLength++] = (char)data[i];
+    }
+    hostUartOutput[hostUartLength] = '\0';
+    return HAL_OK;
+}
+
+// ---- CRC ----------------------------------------------------------------------------------
+
+static uint32_t crcUnit = 0xFFFFFFFFU;
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *handle) {
+    (void)handle;
+    crcUnit = 0xFFFFFFFFU;
+    return HAL_OK;
+}
+
+void hostCrcUnitReset(void) {
+    crcUnit = 0xFFFFFFFFU;
+}
+
+// CRC-32/MPEG-2 over one word, MSB first, as the STM32 unit computes it
+uint32_t hostCrcUnitWrite(uint32_t word) {
+    crcUnit ^= word;
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        crcUnit = (crcUnit & 0x80000000U) ? (crcUnit << 1) ^ 0x04C11DB7U : crcUnit << 1;
+    }
+    return crcUnit;
+}
+
+// ---- Flash --------------------------------------------------------------------------------
+
+uint32_t hostFlashErases = 0;
+uint32_t hostFlashOperations = 0;
+uint32_t hostFlashCutAt = HOST_FLASH_NO_CUT;
+uint8_t hostFlashPowerLost = 0;
+static uint8_t flashUnlocked = 0;
+
+// Counts one program or erase; 1 if power goes at this one
+static uint8_t flashCut(void) {
+    if (hostFlashOperations++ != hostFlashCutAt) {
+        return 0;
+    }
+    hostFlashPowerLost = 1;
+    return 1;
+}
+
+void hostFlashMap(void) {
+    static uint8_t mapped = 0;
+    void *base = (void *)(uintptr_t)HOST_FLASH_BASE;
+    size_t bytes = HOST_FLASH_SECTORS * HOST_FLASH_SECTOR_BYTES;
+
+    if (!mapped) {
+        if (mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != base) {
+            perror("host: cannot map flash");
+            abort();
+        }
+        mapped = 1;
+    }
+    memset(base, 0xFF, bytes);
+    hostFlashErases = 0;
+    hostFlashOperations = 0;
+    hostFlashCutAt = HOST_FLASH_NO_CUT;
+    hostFlashPowerLost = 0;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) { flashUnlocked = 1; return HAL_OK; }
+HAL_StatusTypeDef HAL_FLASH_Lock(void) { flashUnlocked = 0; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data) {
+    if (!flashUnlocked || type != FLASH_TYPEPROGRAM_WORD || (address & 3U) ||
+        address < HOST_FLASH_BASE || address >= HOST_FLASH_BASE + HOST_FLASH_SECTORS * HOST_FLASH_SECTOR_BYTES) {
+        return HAL_ERROR;
+    }
+    if (hostFlashPowerLost) {
+        return HAL_ERROR;
+    }
+    // A cut program leaves some of the bits it was clearing still set
+    if (flashCut()) {
+        *(volatile uint32_t *)(uintptr_t)address &= (uint32_t)data | 0x5A5A5A5AU;
+        return HAL_ERROR;
+    }
+    *(volatile uint32_t *)(uintptr_t)address &= (uint32_t)data;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *sectorError) {
+    if (!flashUnlocked || erase->Sector + erase->NbSectors > HOST_FLASH_SECTORS) {
+        *sectorError = erase->Sector;
+        return HAL_ERROR;
+    }
+    uint8_t *sector = (uint8_t *)(uintptr_t)(HOST_FLASH_BASE + erase->Sector * HOST_FLASH_SECTOR_BYTES);
+    if (hostFlashPowerLost) {
+        *sectorError = erase->Sector;
+        return HAL_ERROR;
+    }
+    // A cut erase leaves the header and the first half of the sector as they were
+    if (flashCut()) {
+        memset(sector + HOST_FLASH_SECTOR_BYTES / 2U, 0xFF, HOST_FLASH_SECTOR_BYTES / 2U);
+        *sectorError = erase->Sector;
+        return HAL_ERROR;
+    }
+    memset(sector, 0xFF, erase->NbSectors * HOST_FLASH_SECTOR_BYTES);
+    hostFlashErases += erase->NbSectors;
+    *sectorError = 0xFFFFFFFFU;
+    return HAL_OK;
+}
@@ -0,0 +1,30 @@
+#ifndef HOST_STUB_H
+#define HOST_STUB_H
+
+// Test-side controls of the host stubs that have no HAL or FreeRTOS counterpart
+
+#include "stm32f4xx_hal.h"
+#include "task.h"
+
+#define HOST_CORE_CLOCK_HZ 84000000U
+
+// Work an interrupt would do (DMA completions); it runs the next time the calling task blocks
+void hostDeferInterrupt(void (*handler)(void *context), void *context);
+uint32_t hostRunInterrupts(void);
+
+// DWT->CYCCNT follows host time at SystemCoreClock unless a test steps it by hand
+void hostCyclesSetManual(uint8_t manual);
+void hostCyclesAdvance(uint32_t cycles);
+uint64_t hostNanoseconds(void);
+
+// Scheduler state: a fresh boot, then the point where osKernelStart would hand over
+void hostRtosReset(void);
+void hostSchedulerStart(void);
+void hostSetCurrentTask(TaskHandle_t task);
+
+extern uint32_t hostErrorHandlerCalls;
+extern uint32_t hostAssertFailures;
+extern char hostUartOutput[4096];
+extern uint32_t hostUartLength;
+
+#endif /* HOST_STUB_H */
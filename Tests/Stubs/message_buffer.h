@@ -0,0 +1,12 @@
+#ifndef MESSAGE_BUFFER_STUB_H
+#define MESSAGE_BUFFER_STUB_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostMessageBuffer *MessageBufferHandle_t;
+
+MessageBufferHandle_t xMessageBufferCreate(size_t bytes);
+size_t xMessageBufferSend(MessageBufferHandle_t buffer, const void *data, size_t length, TickType_t timeout);
+size_t xMessageBufferReceive(MessageBufferHandle_t buffer, void *data, size_t length, TickType_t timeout);
+
+#endif /* MESSAGE_BUFFER_STUB_H */
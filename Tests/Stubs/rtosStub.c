@@ -0,0 +1,270 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "message_buffer.h"
+#include "cmsis_os2.h"
+#include "hostStub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_MAX_TASKS 16
+
+struct HostTask {
+    osThreadFunc_t function;
+    uint32_t value;
+    uint32_t count;         // ulTaskNotifyTake counts; xTaskNotify values live beside it
+    uint8_t pending;
+};
+
+static struct HostTask tasks[HOST_MAX_TASKS];
+static uint8_t taskCount = 1;   // Index 0 stands for whatever runs main()
+
+volatile uint32_t hostCriticalsBeforeScheduler = 0;
+volatile uint8_t hostSchedulerRunning = 0;
+volatile TickType_t hostTickCount = 0;
+TaskHandle_t hostCurrentTask = &tasks[0];
+uint32_t hostAssertFailures = 0;
+
+static uint32_t criticalNesting = 0;
+
+void hostAssertFailed(const char *file, int line) {
+    fprintf(stderr, "configASSERT failed at %s:%d\n", file, line);
+    hostAssertFailures++;
+}
+
+void hostRtosReset(void) {
+    memset(tasks, 0, sizeof(tasks));
+    taskCount = 1;
+    hostCurrentTask = &tasks[0];
+    hostCriticalsBeforeScheduler = 0;
+    hostSchedulerRunning = 0;
+    hostTickCount = 0;
+    criticalNesting = 0;
+}
+
+void hostSchedulerStart(void) {
+    hostSchedulerRunning = 1;
+}
+
+void hostSetCurrentTask(TaskHandle_t task) {
+    hostCurrentTask = task;
+}
+
+TaskHandle_t hostTaskHandle(uint8_t index) {
+    return index < HOST_MAX_TASKS ? &tasks[index] : NULL;
+}
+
+void hostEnterCritical(void) {
+    if (!hostSchedulerRunning) {
+        hostCriticalsBeforeScheduler++;
+    }
+    criticalNesting++;
+}
+
+void hostExitCritical(void) {
+    if (criticalNesting == 0) {
+        hostAssertFailed(__FILE__, __LINE__);
+        return;
+    }
+    criticalNesting--;
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+    return hostSchedulerRunning ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return hostTickCount;
+}
+
+TickType_t xTaskGetTickCountFromISR(void) {
+    return hostTickCount;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return hostCurrentTask;
+}
+
+// Blocking lets pending interrupts run; time passes only if they did not wake the task
+static void block(TickType_t ticks) {
+    hostRunInterrupts();
+    if (ticks != portMAX_DELAY) {
+        hostTickCount += ticks;
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    block(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment) {
+    *previousWake += increment;
+    hostRunInterrupts();
+    if ((int32_t)(*previousWake - hostTickCount) > 0) {
+        hostTickCount = *previousWake;
+    }
+}
+
+void vTaskSuspendAll(void) {
+}
+
+BaseType_t xTaskResumeAll(void) {
+    return pdFALSE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    switch (action) {
+    case eSetBits:
+        task->value |= value;
+        break;
+    case eIncrement:
+        task->value++;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->pending) {
+            return pdFAIL;
+        }
+        task->value = value;
+        break;
+    case eSetValueWithOverwrite:
+        task->value = value;
+        break;
+    default:
+        break;
+    }
+    task->pending = 1;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken) {
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout) {
+    struct HostTask *task = hostCurrentTask;
+
+    if (!task->pending) {
+        task->value &= ~clearOnEntry;
+        block(task->pending ? 0 : timeout);
+    }
+    if (value != NULL) {
+        *value = task->value;
+    }
+    if (!task->pending) {
+        return pdFALSE;
+    }
+    task->pending = 0;
+    task->value &= ~clearOnExit;
+    return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    if (task == NULL) {
+        return;
+    }
+    task->count++;
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+}
+
+uint32_t hostNotifyTake(BaseType_t clearOnExit, TickType_t timeout) {
+    struct HostTask *task = hostCurrentTask;
+
+    if (task->count == 0) {
+        hostRunInterrupts();
+        if (task->count == 0) {
+            block(timeout);
+        }
+    }
+    uint32_t count = task->count;
+    if (count > 0) {
+        task->count = clearOnExit ? 0 : count - 1U;
+    }
+    return count;
+}
+
+uint32_t hostTaskNotifyValue(TaskHandle_t task) {
+    return task->value;
+}
+
+uint8_t hostTaskNotifyPending(TaskHandle_t task) {
+    return task->pending || task->count > 0;
+}
+
+// ---- Message buffers: length-prefixed records in a flat byte ring --------------------------
+
+struct HostMessageBuffer {
+    size_t capacity;
+    size_t used;
+    uint8_t *bytes;
+};
+
+MessageBufferHandle_t xMessageBufferCreate(size_t bytes) {
+    MessageBufferHandle_t buffer = calloc(1, sizeof(*buffer));
+
+    if (buffer != NULL) {
+        buffer->capacity = bytes;
+        buffer->bytes = malloc(bytes);
+    }
+    return buffer;
+}
+
+size_t xMessageBufferSend(MessageBufferHandle_t buffer, const void *data, size_t length, TickType_t timeout) {
+    (void)timeout;
+    if (buffer->used + sizeof(size_t) + length > buffer->capacity) {
+        return 0;
+    }
+    memcpy(&buffer->bytes[buffer->used], &length, sizeof(size_t));
+    memcpy(&buffer->bytes[buffer->used + sizeof(size_t)], data, length);
+    buffer->used += sizeof(size_t) + length;
+    return length;
+}
+
+size_t xMessageBufferReceive(MessageBufferHandle_t buffer, void *data, size_t length, TickType_t timeout) {
+    size_t stored;
+
+    if (buffer->used == 0) {
+        block(timeout);
+        return 0;
+    }
+    memcpy(&stored, buffer->bytes, sizeof(size_t));
+    if (stored > length) {
+        return 0;
+    }
+    memcpy(data, &buffer->bytes[sizeof(size_t)], stored);
+    buffer->used -= sizeof(size_t) + stored;
+    memmove(buffer->bytes, &buffer->bytes[sizeof(size_t) + stored], buffer->used);
+    return stored;
+}
+
+// ---- CMSIS-RTOS2: threads are recorded, never run --------------------------------------------
+
+osThreadId_t osThreadNew(osThreadFunc_t function, void *argument, const osThreadAttr_t *attributes) {
+    (void)argument; (void)attributes;
+    if (taskCount >= HOST_MAX_TASKS) {
+        return NULL;
+    }
+    tasks[taskCount].function = function;
+    return &tasks[taskCount++];
+}
+
+osStatus_t osDelay(uint32_t ticks) {
+    block(ticks);
+    return osOK;
+}
+
+osStatus_t osKernelInitialize(void) {
+    return osOK;
+}
+
+osStatus_t osKernelStart(void) {
+    hostSchedulerStart();
+    return osOK;
+}
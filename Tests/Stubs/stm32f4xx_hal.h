@@ -0,0 +1,726 @@
+#ifndef STM32F4XX_HAL_STUB_H
+#define STM32F4XX_HAL_STUB_H
+
+// Host stand-in for the STM32F4 HAL and the CMSIS core: the same names, plain memory for the
+// peripherals, and hooks in halStub.c so a test can play the hardware side
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum { RESET = 0U, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+#define SET_BIT(REG, BIT)   ((REG) |= (BIT))
+
+extern uint32_t SystemCoreClock;
+
+// ---- CMSIS core --------------------------------------------------------------------------
+
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE static inline
+#endif
+#ifndef __STATIC_FORCEINLINE
+#define __STATIC_FORCEINLINE static inline __attribute__((always_inline))
+#endif
+#ifndef __ALIGNED
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#endif
+#ifndef __WEAK
+#define __WEAK __attribute__((weak))
+#endif
+#define __IO volatile
+
+// PRIMASK is one flag per process; the stress tests never rely on it excluding another thread
+extern volatile uint32_t hostPrimask;
+extern volatile uint32_t hostIpsr;
+
+static inline uint32_t __get_PRIMASK(void) { return hostPrimask; }
+static inline void __set_PRIMASK(uint32_t primask) { hostPrimask = primask; }
+static inline void __disable_irq(void) { hostPrimask = 1U; }
+static inline void __enable_irq(void) { hostPrimask = 0U; }
+static inline uint32_t __get_IPSR(void) { return hostIpsr; }
+static inline void __DMB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __DSB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __ISB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __NOP(void) { }
+
+// LDREX/STREX as a per-thread reservation on the loaded value; STREX fails if the word changed
+extern __thread volatile uint32_t *hostExclusiveAddress;
+extern __thread uint32_t hostExclusiveValue;
+
+static inline uint32_t __LDREXW(volatile uint32_t *address) {
+    hostExclusiveAddress = address;
+    hostExclusiveValue = __atomic_load_n(address, __ATOMIC_SEQ_CST);
+    return hostExclusiveValue;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *address) {
+    uint32_t expected = hostExclusiveValue;
+
+    if (hostExclusiveAddress != address) {
+        return 1U;
+    }
+    hostExclusiveAddress = NULL;
+    return __atomic_compare_exchange_n(address, &expected, value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0U : 1U;
+}
+
+static inline void __CLREX(void) { hostExclusiveAddress = NULL; }
+
+static inline uint32_t __UNALIGNED_UINT32_READ(const void *address) {
+    uint32_t value;
+    memcpy(&value, address, sizeof(value));
+    return value;
+}
+
+// checksum.c writes __REV(word) to CRC->DR and reads the CRC back from DR. The host CRC unit
+// is fed here, and the value stored to DR is what the hardware would return on the next read.
+uint32_t hostCrcUnitWrite(uint32_t word);
+#define __REV(word) hostCrcUnitWrite(__builtin_bswap32(word))
+
+// DWT->CYCCNT counts host time at SystemCoreClock, so cycle budgets read as real time
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+DWT_Type *hostDwt(void);
+extern CoreDebug_Type hostCoreDebug;
+#define DWT       (hostDwt())
+#define CoreDebug (&hostCoreDebug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+
+typedef int32_t IRQn_Type;
+#define ADC_IRQn            18
+#define CAN1_TX_IRQn        19
+#define CAN1_RX0_IRQn       20
+#define CAN1_RX1_IRQn       21
+#define CAN1_SCE_IRQn       22
+#define TIM8_UP_TIM13_IRQn  44
+#define DMA1_Stream3_IRQn   14
+#define DMA1_Stream4_IRQn   15
+#define DMA1_Stream0_IRQn   11
+#define DMA1_Stream2_IRQn   13
+#define DMA2_Stream0_IRQn   56
+#define I2C1_EV_IRQn        31
+#define I2C1_ER_IRQn        32
+#define I2C2_EV_IRQn        33
+#define I2C2_ER_IRQn        34
+#define SPI2_IRQn           36
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preemptPriority, uint32_t subPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+
+// ---- Peripheral register blocks ------------------------------------------------------------
+
+typedef struct {
+    volatile uint32_t MODER;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t SR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+    volatile uint32_t ARR;
+    volatile uint32_t CNT;
+} TIM_TypeDef;
+
+typedef struct {
+    volatile uint32_t SR;
+    volatile uint32_t CR1;
+    volatile uint32_t HTR;
+    volatile uint32_t LTR;
+} ADC_TypeDef;
+
+typedef struct { volatile uint32_t MCR; volatile uint32_t MSR; } CAN_TypeDef;
+typedef struct { volatile uint32_t CR1; volatile uint32_t SR; } SPI_TypeDef;
+typedef struct { volatile uint32_t CR1; volatile uint32_t SR1; } I2C_TypeDef;
+typedef struct { volatile uint32_t SR; volatile uint32_t DR; } USART_TypeDef;
+typedef struct { volatile uint32_t DR; volatile uint32_t CR; } CRC_TypeDef;
+typedef struct { volatile uint32_t CR; volatile uint32_t NDTR; } DMA_Stream_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t PLLCFGR;
+    volatile uint32_t CFGR;
+    volatile uint32_t CSR;
+} RCC_TypeDef;
+
+extern GPIO_TypeDef hostGpio[3];
+extern TIM_TypeDef hostTim[3];
+extern ADC_TypeDef hostAdc[2];
+extern CAN_TypeDef hostCan[2];
+extern SPI_TypeDef hostSpi2;
+extern I2C_TypeDef hostI2c[2];
+extern USART_TypeDef hostUsart[2];
+extern CRC_TypeDef hostCrc;
+extern RCC_TypeDef hostRcc;
+extern DMA_Stream_TypeDef hostDmaStreams[8];
+
+#define GPIOA (&hostGpio[0])
+#define GPIOB (&hostGpio[1])
+#define GPIOC (&hostGpio[2])
+#define TIM2  (&hostTim[0])
+#define TIM3  (&hostTim[1])
+#define TIM8  (&hostTim[2])
+#define ADC1  (&hostAdc[0])
+#define ADC2  (&hostAdc[1])
+#define CAN1  (&hostCan[0])
+#define CAN2  (&hostCan[1])
+#define SPI2  (&hostSpi2)
+#define I2C1  (&hostI2c[0])
+#define I2C2  (&hostI2c[1])
+#define USART2 (&hostUsart[0])
+#define UART4  (&hostUsart[1])
+#define CRC   (&hostCrc)
+#define RCC   (&hostRcc)
+#define DMA2_Stream0 (&hostDmaStreams[0])
+#define DMA1_Stream3 (&hostDmaStreams[1])
+#define DMA1_Stream4 (&hostDmaStreams[2])
+#define DMA1_Stream0 (&hostDmaStreams[3])
+#define DMA1_Stream2 (&hostDmaStreams[4])
+
+#define RCC_CFGR_PPRE1_2 (1UL << 12)
+#define RCC_CFGR_PPRE2_2 (1UL << 15)
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_CRC_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_CRC_CLK_DISABLE()   do { } while (0)
+#define __HAL_RCC_CLEAR_RESET_FLAGS() (hostRcc.CSR = 0U)
+
+// ---- GPIO ---------------------------------------------------------------------------------
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define GPIO_MODE_OUTPUT_PP   0x01U
+#define GPIO_MODE_OUTPUT_OD   0x11U
+#define GPIO_MODE_AF_OD       0x12U
+#define GPIO_NOPULL           0x00U
+#define GPIO_SPEED_FREQ_LOW   0x00U
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *port, uint32_t pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *port, uint16_t pin);
+
+// Output state as the pins see it, whether written through the HAL or BSRR
+GPIO_PinState hostGpioOutput(GPIO_TypeDef *port, uint16_t pin);
+
+// ---- Tick ---------------------------------------------------------------------------------
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+
+// ---- DMA ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t Channel;
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+    uint32_t FIFOMode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+    DMA_Stream_TypeDef *Instance;
+    DMA_InitTypeDef Init;
+    void *Parent;
+} DMA_HandleTypeDef;
+
+#define __HAL_LINKDMA(handle, field, dma) do { (handle)->field = &(dma); (dma).Parent = (handle); } while (0)
+
+// ---- ADC ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t ClockPrescaler;
+    uint32_t Resolution;
+    uint32_t ScanConvMode;
+    uint32_t ContinuousConvMode;
+    uint32_t DiscontinuousConvMode;
+    uint32_t ExternalTrigConvEdge;
+    uint32_t ExternalTrigConv;
+    uint32_t DataAlign;
+    uint32_t NbrOfConversion;
+    uint32_t DMAContinuousRequests;
+    uint32_t EOCSelection;
+} ADC_InitTypeDef;
+
+typedef struct {
+    ADC_TypeDef *Instance;
+    ADC_InitTypeDef Init;
+    DMA_HandleTypeDef *DMA_Handle;
+    uint32_t State;
+    uint32_t ErrorCode;
+} ADC_HandleTypeDef;
+
+typedef struct {
+    uint32_t Channel;
+    uint32_t Rank;
+    uint32_t SamplingTime;
+    uint32_t Offset;
+} ADC_ChannelConfTypeDef;
+
+typedef struct {
+    uint32_t Mode;
+    uint32_t DMAAccessMode;
+    uint32_t TwoSamplingDelay;
+} ADC_MultiModeTypeDef;
+
+typedef struct {
+    uint32_t WatchdogMode;
+    uint32_t HighThreshold;
+    uint32_t LowThreshold;
+    uint32_t Channel;
+    FunctionalState ITMode;
+    uint32_t WatchdogNumber;
+} ADC_AnalogWDGConfTypeDef;
+
+#define ADC_CHANNEL_0  0U
+#define ADC_CHANNEL_1  1U
+#define ADC_CHANNEL_2  2U
+#define ADC_CHANNEL_3  3U
+#define ADC_CHANNEL_4  4U
+#define ADC_CHANNEL_5  5U
+#define ADC_CHANNEL_6  6U
+#define ADC_CHANNEL_7  7U
+#define ADC_CHANNEL_8  8U
+#define ADC_CHANNEL_9  9U
+#define ADC_CHANNEL_10 10U
+#define ADC_CHANNEL_11 11U
+#define ADC_CHANNEL_12 12U
+#define ADC_CHANNEL_13 13U
+#define ADC_CHANNEL_14 14U
+#define ADC_CHANNEL_15 15U
+#define ADC_SAMPLETIME_3CYCLES      0U
+#define ADC_SAMPLETIME_144CYCLES    6U
+#define ADC_SAMPLETIME_480CYCLES    7U
+#define ADC_DUALMODE_REGSIMULT      6U
+#define ADC_DMAACCESSMODE_2         2U
+#define ADC_TWOSAMPLINGDELAY_5CYCLES 0U
+#define ADC_ANALOGWATCHDOG_SINGLE_REG 1U
+#define ADC_FLAG_AWD                0x01U
+#define ADC_IT_AWD                  0x40U
+#define ADC_CLOCK_SYNC_PCLK_DIV4    1U
+#define ADC_RESOLUTION_12B          0U
+#define ADC_DATAALIGN_RIGHT         0U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE    0U
+#define ADC_EXTERNALTRIGCONVEDGE_RISING  1U
+#define ADC_EXTERNALTRIGCONV_T8_TRGO     14U
+#define ADC_SOFTWARE_START               15U
+#define ADC_EOC_SEQ_CONV            0U
+#define ADC_EOC_SINGLE_CONV         1U
+
+#define __HAL_ADC_ENABLE_IT(handle, it)  ((handle)->Instance->CR1 |= (it))
+#define __HAL_ADC_DISABLE_IT(handle, it) ((handle)->Instance->CR1 &= ~(uint32_t)(it))
+#define __HAL_ADC_CLEAR_FLAG(handle, flag) ((handle)->Instance->SR &= ~(uint32_t)(flag))
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *config);
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef *hadc, ADC_AnalogWDGConfTypeDef *config);
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(ADC_HandleTypeDef *hadc, ADC_MultiModeTypeDef *multimode);
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStart_DMA(ADC_HandleTypeDef *hadc, uint32_t *data, uint32_t length);
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStop_DMA(ADC_HandleTypeDef *hadc);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc);
+
+// The circular buffer MultiModeStart_DMA was given, for a test to fill
+extern uint32_t *hostAdcDmaBuffer;
+extern uint32_t hostAdcDmaLength;
+
+// ---- TIM ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+typedef struct { uint32_t ClockSource; uint32_t ClockPolarity; uint32_t ClockPrescaler; uint32_t ClockFilter; } TIM_ClockConfigTypeDef;
+typedef struct { uint32_t MasterOutputTrigger; uint32_t MasterSlaveMode; } TIM_MasterConfigTypeDef;
+typedef struct { uint32_t SlaveMode; uint32_t InputTrigger; uint32_t TriggerPolarity; uint32_t TriggerPrescaler; uint32_t TriggerFilter; } TIM_SlaveConfigTypeDef;
+typedef struct { uint32_t OCMode; uint32_t Pulse; uint32_t OCPolarity; uint32_t OCNPolarity; uint32_t OCFastMode; uint32_t OCIdleState; uint32_t OCNIdleState; } TIM_OC_InitTypeDef;
+
+#define TIM_CHANNEL_1 0x0U
+#define TIM_CHANNEL_2 0x4U
+#define TIM_CHANNEL_3 0x8U
+#define TIM_CHANNEL_4 0xCU
+#define TIM_COUNTERMODE_UP 0U
+#define TIM_CLOCKDIVISION_DIV1 0U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE 0x80U
+#define TIM_CLOCKSOURCE_INTERNAL 0x1000U
+#define TIM_TRGO_RESET 0U
+#define TIM_TRGO_UPDATE 0x20U
+#define TIM_MASTERSLAVEMODE_DISABLE 0U
+#define TIM_SLAVEMODE_RESET 4U
+#define TIM_TS_ITR1 0x10U
+#define TIM_OCMODE_PWM2 0x70U
+#define TIM_OCPOLARITY_HIGH 0U
+#define TIM_OCFAST_DISABLE 0U
+
+#define __HAL_TIM_SET_COMPARE(handle, channel, compare) \
+    (*(&(handle)->Instance->CCR1 + ((channel) >> 2)) = (compare))
+#define __HAL_TIM_GET_AUTORELOAD(handle) ((handle)->Instance->ARR)
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *config);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *config);
+HAL_StatusTypeDef HAL_TIM_SlaveConfigSynchro(TIM_HandleTypeDef *htim, TIM_SlaveConfigTypeDef *config);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *config, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel);
+
+// ---- CAN ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t Mode;
+    uint32_t SyncJumpWidth;
+    uint32_t TimeSeg1;
+    uint32_t TimeSeg2;
+    FunctionalState TimeTriggeredMode;
+    FunctionalState AutoBusOff;
+    FunctionalState AutoWakeUp;
+    FunctionalState AutoRetransmission;
+    FunctionalState ReceiveFifoLocked;
+    FunctionalState TransmitFifoPriority;
+} CAN_InitTypeDef;
+
+typedef struct {
+    CAN_TypeDef *Instance;
+    CAN_InitTypeDef Init;
+    uint32_t State;
+    volatile uint32_t ErrorCode;
+} CAN_HandleTypeDef;
+
+typedef struct {
+    uint32_t StdId;
+    uint32_t ExtId;
+    uint32_t IDE;
+    uint32_t RTR;
+    uint32_t DLC;
+    FunctionalState TransmitGlobalTime;
+} CAN_TxHeaderTypeDef;
+
+typedef struct {
+    uint32_t StdId;
+    uint32_t ExtId;
+    uint32_t IDE;
+    uint32_t RTR;
+    uint32_t DLC;
+    uint32_t Timestamp;
+    uint32_t FilterMatchIndex;
+} CAN_RxHeaderTypeDef;
+
+typedef struct {
+    uint32_t FilterIdHigh;
+    uint32_t FilterIdLow;
+    uint32_t FilterMaskIdHigh;
+    uint32_t FilterMaskIdLow;
+    uint32_t FilterFIFOAssignment;
+    uint32_t FilterBank;
+    uint32_t FilterMode;
+    uint32_t FilterScale;
+    uint32_t FilterActivation;
+    uint32_t SlaveStartFilterBank;
+} CAN_FilterTypeDef;
+
+#define CAN_ID_STD 0x00000000U
+#define CAN_ID_EXT 0x00000004U
+#define CAN_RTR_DATA 0x00000000U
+#define CAN_RTR_REMOTE 0x00000002U
+#define CAN_RX_FIFO0 0x00000000U
+#define CAN_RX_FIFO1 0x00000001U
+#define CAN_FILTER_FIFO0 0x00000000U
+#define CAN_FILTER_FIFO1 0x00000001U
+#define CAN_FILTERMODE_IDMASK 0x00000000U
+#define CAN_FILTERSCALE_32BIT 0x00000001U
+#define CAN_TX_MAILBOX0 0x00000001U
+#define CAN_TX_MAILBOX1 0x00000002U
+#define CAN_TX_MAILBOX2 0x00000004U
+#define CAN_IT_TX_MAILBOX_EMPTY     (1UL << 0)
+#define CAN_IT_RX_FIFO0_MSG_PENDING (1UL << 1)
+#define CAN_IT_RX_FIFO0_OVERRUN     (1UL << 3)
+#define CAN_IT_RX_FIFO1_MSG_PENDING (1UL << 4)
+#define CAN_IT_RX_FIFO1_OVERRUN     (1UL << 6)
+#define CAN_IT_ERROR                (1UL << 15)
+#define HAL_CAN_ERROR_NONE    0x00000000U
+#define HAL_CAN_ERROR_RX_FOV0 0x00000200U
+#define HAL_CAN_ERROR_RX_FOV1 0x00000400U
+#define CAN_MCR_TXFP (1UL << 2)
+#define CAN_MODE_NORMAL 0U
+#define CAN_MODE_LOOPBACK 1U
+#define CAN_SJW_1TQ 0U
+#define CAN_BS1_13TQ 12U
+#define CAN_BS2_2TQ 1U
+
+HAL_StatusTypeDef HAL_CAN_Init(CAN_HandleTypeDef *hcan);
+HAL_StatusTypeDef HAL_CAN_Start(CAN_HandleTypeDef *hcan);
+HAL_StatusTypeDef HAL_CAN_ConfigFilter(CAN_HandleTypeDef *hcan, CAN_FilterTypeDef *filter);
+HAL_StatusTypeDef HAL_CAN_ActivateNotification(CAN_HandleTypeDef *hcan, uint32_t interrupts);
+HAL_StatusTypeDef HAL_CAN_AddTxMessage(CAN_HandleTypeDef *hcan, CAN_TxHeaderTypeDef *header,
+                                       uint8_t data[], uint32_t *mailbox);
+uint32_t HAL_CAN_GetTxMailboxesFreeLevel(CAN_HandleTypeDef *hcan);
+HAL_StatusTypeDef HAL_CAN_GetRxMessage(CAN_HandleTypeDef *hcan, uint32_t fifo, CAN_RxHeaderTypeDef *header,
+                                       uint8_t data[]);
+uint32_t HAL_CAN_GetRxFifoFillLevel(CAN_HandleTypeDef *hcan, uint32_t fifo);
+HAL_StatusTypeDef HAL_CAN_ResetError(CAN_HandleTypeDef *hcan);
+void HAL_CAN_IRQHandler(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_RxFifo1MsgPendingCallback(CAN_HandleTypeDef *hcan);
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan);
+
+// Stubbed bxCAN: three TX mailboxes that stay occupied until the test completes them, and two
+// three-deep RX FIFOs fed through the configured filter banks
+#define HOST_CAN_MAILBOXES 3
+#define HOST_CAN_RX_FIFO_DEPTH 3
+#define HOST_CAN_FILTER_BANKS 28
+
+typedef struct {
+    CAN_TxHeaderTypeDef header;
+    uint8_t data[8];
+} HostCanTxFrame;
+
+typedef struct {
+    CAN_RxHeaderTypeDef header;
+    uint8_t data[8];
+} HostCanRxFrame;
+
+extern CAN_FilterTypeDef hostCanFilters[HOST_CAN_FILTER_BANKS];
+extern uint32_t hostCanFilterCount;
+
+uint8_t hostCanMailboxBusy(uint8_t mailbox);
+const HostCanTxFrame *hostCanMailboxFrame(uint8_t mailbox);
+void hostCanCompleteMailbox(CAN_HandleTypeDef *hcan, uint8_t mailbox);
+void hostCanResetTx(void);
+uint8_t hostCanReceive(CAN_HandleTypeDef *hcan, uint32_t id, uint8_t extended, const uint8_t *data, uint8_t length);
+
+// ---- SPI ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+    uint32_t TIMode;
+    uint32_t CRCCalculation;
+    uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct __SPI_HandleTypeDef {
+    SPI_TypeDef *Instance;
+    SPI_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    uint32_t ErrorCode;
+} SPI_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *tx, uint8_t *rx, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+// A test plays the devices on the bus: called for every transfer with chip select low.
+// Returning non-zero ends the DMA transfer with an error.
+typedef uint8_t (*HostSpiDevice)(const uint8_t *tx, uint8_t *rx, uint16_t size);
+extern HostSpiDevice hostSpiDevice;
+
+// ---- I2C ----------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef enum {
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY = 0x24U
+} HAL_I2C_StateTypeDef;
+
+typedef struct __I2C_HandleTypeDef {
+    I2C_TypeDef *Instance;
+    I2C_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_I2C_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+#define HAL_I2C_ERROR_NONE 0x00000000U
+#define HAL_I2C_ERROR_AF   0x00000004U
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                       uint16_t memAddSize, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t address);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c);
+
+// A test plays the sensors: fills data and returns HAL_OK, or an error code to NACK
+typedef uint32_t (*HostI2cDevice)(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data, uint16_t size);
+extern HostI2cDevice hostI2cDevice;
+
+// ---- UART ---------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout);
+
+// ---- CRC ----------------------------------------------------------------------------------
+
+typedef struct {
+    CRC_TypeDef *Instance;
+} CRC_HandleTypeDef;
+
+#define __HAL_CRC_DR_RESET(handle) hostCrcUnitReset()
+void hostCrcUnitReset(void);
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *hcrc);
+
+// ---- Flash --------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Sector;
+    uint32_t NbSectors;
+    uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEPROGRAM_WORD 0x02U
+#define FLASH_TYPEERASE_SECTORS 0x00U
+#define FLASH_VOLTAGE_RANGE_3 0x02U
+#define FLASH_SECTOR_0 0U
+#define FLASH_SECTOR_1 1U
+#define FLASH_SECTOR_2 2U
+#define FLASH_SECTOR_3 3U
+#define FLASH_FLAG_EOP   0x01U
+#define FLASH_FLAG_OPERR 0x02U
+#define FLASH_FLAG_WRPERR 0x10U
+#define FLASH_FLAG_PGAERR 0x20U
+#define FLASH_FLAG_PGPERR 0x40U
+#define FLASH_FLAG_PGSERR 0x80U
+#define __HAL_FLASH_CLEAR_FLAG(flags) do { } while (0)
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address, uint64_t data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *sectorError);
+
+// Sectors 0-3 (16 KB each) mapped at their real addresses, so code that reads flash through
+// a pointer works unchanged. Programming only clears bits, as on the part.
+#define HOST_FLASH_BASE 0x08000000U
+#define HOST_FLASH_SECTOR_BYTES 0x4000U
+#define HOST_FLASH_SECTORS 4U
+void hostFlashMap(void);
+extern uint32_t hostFlashErases;
+
+// Power loss: the program or erase numbered hostFlashCutAt (counting from 0 since the map) is
+// cut part-way, and every one after it fails until the test restores power
+#define HOST_FLASH_NO_CUT UINT32_MAX
+extern uint32_t hostFlashOperations;
+extern uint32_t hostFlashCutAt;
+extern uint8_t hostFlashPowerLost;
+
+#endif /* STM32F4XX_HAL_STUB_H */
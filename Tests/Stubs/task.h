@@ -0,0 +1,57 @@
+#ifndef TASK_STUB_H
+#define TASK_STUB_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostTask *TaskHandle_t;
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+#define taskSCHEDULER_SUSPENDED   ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING     ((BaseType_t)2)
+
+// Entering a kernel critical section before the scheduler runs leaves BASEPRI raised on the
+// part; the stub counts those so the boot path can be checked for them
+void hostEnterCritical(void);
+void hostExitCritical(void);
+#define taskENTER_CRITICAL() hostEnterCritical()
+#define taskEXIT_CRITICAL()  hostExitCritical()
+#define taskENTER_CRITICAL_FROM_ISR() ((UBaseType_t)0)
+#define taskEXIT_CRITICAL_FROM_ISR(saved) ((void)(saved))
+#define taskDISABLE_INTERRUPTS() do { } while (0)
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+extern volatile uint32_t hostCriticalsBeforeScheduler;
+extern volatile uint8_t hostSchedulerRunning;
+extern volatile TickType_t hostTickCount;
+extern TaskHandle_t hostCurrentTask;
+
+BaseType_t xTaskGetSchedulerState(void);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t hostNotifyTake(BaseType_t clearOnExit, TickType_t timeout);
+#define ulTaskNotifyTake(clearOnExit, timeout) hostNotifyTake((clearOnExit), (timeout))
+
+// Notification state of a task, for a test that plays the task itself
+uint32_t hostTaskNotifyValue(TaskHandle_t task);
+uint8_t hostTaskNotifyPending(TaskHandle_t task);
+TaskHandle_t hostTaskHandle(uint8_t index);
+
+#endif /* TASK_STUB_H */
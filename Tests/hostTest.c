@@ -0,0 +1,12 @@
+#include "hostTest.h"
+
+unsigned hostTestFailures = 0;
+
+int hostTestReport(const char *name) {
+    if (hostTestFailures == 0) {
+        printf("%s: passed\n", name);
+        return 0;
+    }
+    printf("%s: %u check(s) failed\n", name, hostTestFailures);
+    return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Minimal checks for the host tests: every failure is printed, the exit status counts them
+
+#include <stdio.h>
+#include <math.h>
+
+extern unsigned hostTestFailures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            hostTestFailures++; \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double actualValue = (double)(actual); \
+        double expectedValue = (double)(expected); \
+        if (!(fabs(actualValue - expectedValue) <= (double)(tolerance))) { \
+            hostTestFailures++; \
+            printf("%s:%d: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__, #actual, \
+                   actualValue, expectedValue, (double)(tolerance)); \
+        } \
+    } while (0)
+
+// Each test program ends main() with this
+int hostTestReport(const char *name);
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,92 @@
+// adcAcquisition: DMA half-buffer hand-off, block location and overrun detection
+#include "hostTest.h"
+#include "hostStub.h"
+#include "adcAcquisition.h"
+
+#define SWEEPS 4U
+
+static uint32_t callbackBlocks = 0;
+static uint32_t lastCallbackSequence = 0;
+
+static void onBlock(const AdcBlock *block) {
+    callbackBlocks++;
+    lastCallbackSequence = block->sequence;
+}
+
+// The DMA writes one word per rank: ADC1 in the low half, ADC2 (current) in the high half
+static void fillHalf(uint32_t half, uint16_t base) {
+    uint32_t words = ADC_ACQ_NUM_RANKS * SWEEPS;
+
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t rank = i % ADC_ACQ_NUM_RANKS;
+        uint32_t sweep = i / ADC_ACQ_NUM_RANKS;
+        uint16_t voltage = (uint16_t)(base + rank * 10U + sweep);
+        uint16_t current = (uint16_t)(base + 1000U + sweep);
+        hostAdcDmaBuffer[half * words + i] = ((uint32_t)current << 16) | voltage;
+    }
+}
+
+int main(void) {
+    AdcBlock block;
+    AdcBlock held;
+    uint16_t average[ADC_ACQ_NUM_CHANNELS];
+
+    hostCyclesSetManual(1);
+    CHECK(adcAcquisitionInit() == HAL_OK);
+    CHECK(adcAcquisitionSetSweepsPerBlock(0) == HAL_ERROR);
+    CHECK(adcAcquisitionSetSweepsPerBlock(ADC_ACQ_MAX_SWEEPS_PER_BLOCK + 1) == HAL_ERROR);
+    CHECK(adcAcquisitionSetSweepsPerBlock(SWEEPS) == HAL_OK);
+    adcAcquisitionRegisterCallback(onBlock);
+    CHECK(adcAcquisitionStart() == HAL_OK);
+
+    // Circular DMA over two blocks, counted in words
+    CHECK(hostAdcDmaBuffer != NULL);
+    CHECK(hostAdcDmaLength == 2U * ADC_ACQ_NUM_RANKS * SWEEPS);
+    CHECK(adcAcquisitionGetLatestBlock(&block) == 0);
+
+    // First half done: block 1, at the start of the buffer
+    fillHalf(0, 100);
+    hostCyclesAdvance(1000);
+    HAL_ADC_ConvHalfCpltCallback(&hadc1);
+    CHECK(callbackBlocks == 1 && lastCallbackSequence == 1);
+    CHECK(adcAcquisitionGetLatestBlock(&block) == 1);
+    CHECK(block.sequence == 1);
+    CHECK(block.sweeps == SWEEPS);
+    CHECK(block.samples == (const uint16_t *)hostAdcDmaBuffer);
+    CHECK(block.timestamp == DWT->CYCCNT);
+    adcAcquisitionAverageBlock(&block, average);
+    for (uint32_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        // Sweeps add 0..3, so the integer mean drops the .5
+        CHECK(average[ADC_ACQ_RANK_CHANNEL(rank)] == 100U + rank * 10U + 1U);
+        CHECK(average[ADC_ACQ_CURRENT_CHANNEL(rank)] == 1101U);
+    }
+    CHECK(adcAcquisitionReleaseBlock(&block) == 1);
+    held = block;
+
+    // Conversions from ADC2 are not blocks
+    HAL_ADC_ConvHalfCpltCallback(&hadc2);
+    CHECK(callbackBlocks == 1);
+
+    // Second half done: block 2 in the other half; block 1 is now being overwritten
+    fillHalf(1, 500);
+    hostCyclesAdvance(1000);
+    HAL_ADC_ConvCpltCallback(&hadc1);
+    CHECK(adcAcquisitionGetLatestBlock(&block) == 1);
+    CHECK(block.sequence == 2);
+    CHECK(block.samples == (const uint16_t *)hostAdcDmaBuffer + ADC_ACQ_NUM_CHANNELS * SWEEPS);
+    CHECK(block.samples[ADC_ACQ_RANK_CHANNEL(2)] == 520U);
+    CHECK(block.samples[ADC_ACQ_CURRENT_CHANNEL(2)] == 1500U);
+    CHECK(adcAcquisitionReleaseBlock(&held) == 0);
+    CHECK(adcAcquisitionGetOverruns() == 1);
+    CHECK(adcAcquisitionReleaseBlock(&block) == 1);
+
+    // Block 3 reuses the first half
+    HAL_ADC_ConvHalfCpltCallback(&hadc1);
+    CHECK(adcAcquisitionGetLatestBlock(&block) == 1);
+    CHECK(block.sequence == 3);
+    CHECK(block.samples == (const uint16_t *)hostAdcDmaBuffer);
+    CHECK(callbackBlocks == 3 && lastCallbackSequence == 3);
+
+    adcAcquisitionStop();
+    return hostTestReport("testAdcAcquisition");
+}
@@ -0,0 +1,440 @@
+// afeChain against an emulated LTC681x daisy chain: decoding, PEC rejection, last-good
+// readings and the stale-voltage fault, the scan against its own period, the 0x100 and 0x102
+// rotations over every cell and temperature sensor, and the modelled bus time and PEC cost of
+// one 144-cell scan
+#include "hostTest.h"
+#include "hostStub.h"
+#include "afeChain.h"
+#include "batteryManagement.h"
+#include "faultManager.h"
+#include "canCommunication.h"
+#include "canTelemetry.h"
+#include "samplingScheduler.h"
+#include "checksum.h"
+#include "cycleCounter.h"
+#include <string.h>
+
+#define COMMAND_BYTES      4
+#define DEVICE_FRAME_BYTES (AFE_REGISTER_BYTES + AFE_PEC_BYTES)
+#define SPI2_BIT_RATE      (42000000.0 / 64.0)   // PCLK1 / SPI_BAUDRATEPRESCALER_64
+
+typedef struct {
+    uint16_t cells[AFE_CELLS_PER_DEVICE];
+    uint16_t aux[AFE_AUX_REGISTERS];
+    uint8_t config[AFE_REGISTER_BYTES];
+    uint8_t dead;      // Never drives SDO: every byte reads back 0xFF
+    uint8_t corrupt;   // Flips a data bit after computing the PEC
+} EmulatedDevice;
+
+static EmulatedDevice devices[AFE_NUM_DEVICES];   // Index 0 is nearest the MCU
+static uint32_t commandPecErrors = 0;
+static uint32_t configPecErrors = 0;
+static uint32_t conversions = 0;
+static uint32_t busBytes = 0;
+
+// LTC681x datasheet PEC: x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1, seed 16, bit by bit
+static uint16_t referencePec15(const uint8_t *data, uint32_t length) {
+    uint16_t remainder = 16;
+
+    for (uint32_t i = 0; i < length; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint16_t in0 = (uint16_t)(((data[i] >> bit) & 1U) ^ ((remainder >> 14) & 1U));
+            remainder = (uint16_t)((remainder << 1) & 0x7FFFU);
+            if (in0) {
+                remainder ^= 0x4599U;
+            }
+        }
+    }
+    return (uint16_t)(remainder << 1);
+}
+
+static uint8_t pecMatches(const uint8_t *data, uint32_t length) {
+    uint16_t pec = referencePec15(data, length);
+    return data[length] == (uint8_t)(pec >> 8) && data[length + 1] == (uint8_t)pec;
+}
+
+static void answer(uint8_t device, uint8_t *frame, const uint16_t *registers) {
+    const EmulatedDevice *emulated = &devices[device];
+
+    if (emulated->dead) {
+        return;
+    }
+    for (uint8_t i = 0; i < AFE_REGISTER_BYTES / 2; i++) {
+        frame[2 * i] = (uint8_t)registers[i];
+        frame[2 * i + 1] = (uint8_t)(registers[i] >> 8);
+    }
+    uint16_t pec = referencePec15(frame, AFE_REGISTER_BYTES);
+    frame[AFE_REGISTER_BYTES] = (uint8_t)(pec >> 8);
+    frame[AFE_REGISTER_BYTES + 1] = (uint8_t)pec;
+    if (emulated->corrupt) {
+        frame[0] ^= 0x01U;
+    }
+}
+
+static uint8_t chain(const uint8_t *tx, uint8_t *rx, uint16_t size) {
+    busBytes += size;
+    if (size < COMMAND_BYTES) {
+        return 0;   // Wake-up pulse
+    }
+    if (!pecMatches(tx, 2)) {
+        commandPecErrors++;
+        return 0;
+    }
+
+    uint16_t command = (uint16_t)((tx[0] << 8) | tx[1]);
+    uint8_t *frames = &rx[COMMAND_BYTES];
+
+    switch (command) {
+    case AFE_CMD_WRCFGA:
+        // Shifts through the chain, so the first frame on the wire ends up in the farthest device
+        for (uint8_t i = 0; i < AFE_NUM_DEVICES; i++) {
+            const uint8_t *frame = &tx[COMMAND_BYTES + i * DEVICE_FRAME_BYTES];
+            if (!pecMatches(frame, AFE_REGISTER_BYTES)) {
+                configPecErrors++;
+                continue;
+            }
+            memcpy(devices[AFE_NUM_DEVICES - 1U - i].config, frame, AFE_REGISTER_BYTES);
+        }
+        break;
+    case AFE_CMD_ADCV:
+    case AFE_CMD_ADAX:
+        conversions++;
+        break;
+    case AFE_CMD_RDCVA:
+    case AFE_CMD_RDCVB:
+    case AFE_CMD_RDCVC:
+    case AFE_CMD_RDCVD: {
+        uint8_t group = (uint8_t)((command - AFE_CMD_RDCVA) / 2U);
+        for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+            answer(device, &frames[device * DEVICE_FRAME_BYTES], &devices[device].cells[group * AFE_CELLS_PER_GROUP]);
+        }
+        break;
+    }
+    case AFE_CMD_RDAUXA:
+    case AFE_CMD_RDAUXB: {
+        uint8_t group = (uint8_t)((command - AFE_CMD_RDAUXA) / 2U);
+        for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+            answer(device, &frames[device * DEVICE_FRAME_BYTES], &devices[device].aux[group * AFE_AUX_PER_GROUP]);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return 0;
+}
+
+static uint16_t cellCode(uint8_t device, uint8_t cell, uint16_t scan) {
+    return (uint16_t)(30000U + device * 100U + cell * 5U + scan);
+}
+
+static void setCells(uint16_t scan) {
+    for (uint8_t device = 0; device < AFE_NUM_DEVICES; device++) {
+        for (uint8_t cell = 0; cell < AFE_CELLS_PER_DEVICE; cell++) {
+            devices[device].cells[cell] = cellCode(device, cell, scan);
+        }
+    }
+}
+
+static uint32_t mismatchedCells(const float voltages[PACK_NUM_CELLS], uint16_t scan, uint8_t heldDevice, uint16_t heldScan) {
+    uint32_t mismatches = 0;
+
+    for (uint16_t i = 0; i < PACK_NUM_CELLS; i++) {
+        uint8_t device = (uint8_t)(i / AFE_CELLS_PER_DEVICE);
+        uint16_t expected = cellCode(device, i % AFE_CELLS_PER_DEVICE, device == heldDevice ? heldScan : scan);
+        if (fabsf(voltages[i] - expected * AFE_CELL_LSB_VOLTS) > 0.5f * AFE_CELL_LSB_VOLTS) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static void testScans(void) {
+    float voltages[PACK_NUM_CELLS];
+    AfeChainStats stats;
+    uint8_t dead = AFE_NUM_DEVICES / 2U;
+
+    // Every cell decoded, no device stale
+    setCells(0);
+    CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+    CHECK(commandPecErrors == 0 && configPecErrors == 0);
+    CHECK(conversions == 2);   // ADCV, and ADAX on the first scan
+    CHECK(mismatchedCells(voltages, 0, 0xFF, 0) == 0);
+    CHECK(afeChainGetStaleScans() == 0);
+
+    // One device stops answering: the rest refresh, it keeps its last good readings
+    devices[dead].dead = 1;
+    for (uint16_t scan = 1; scan <= 3; scan++) {
+        setCells(scan);
+        CHECK(afeChainMeasureCells(voltages) == HAL_ERROR);
+        CHECK(mismatchedCells(voltages, scan, dead, 0) == 0);
+        CHECK(afeChainGetStaleScans() == scan);
+    }
+    afeChainGetStats(&stats);
+    CHECK(stats.devicePecErrors[dead] == 3U * AFE_NUM_CELL_GROUPS);
+    CHECK(stats.deviceStaleScans[dead] == 3 && stats.deviceStaleScans[0] == 0);
+
+    // A corrupted frame is rejected the same way
+    devices[dead].dead = 0;
+    devices[dead].corrupt = 1;
+    setCells(4);
+    CHECK(afeChainMeasureCells(voltages) == HAL_ERROR);
+    CHECK(mismatchedCells(voltages, 4, dead, 0) == 0);
+    CHECK(afeChainGetStaleScans() == 4);
+
+    // Recovery clears the age
+    devices[dead].corrupt = 0;
+    setCells(5);
+    CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+    CHECK(mismatchedCells(voltages, 5, 0xFF, 0) == 0);
+    CHECK(afeChainGetStaleScans() == 0);
+
+    // Discharge bits reach the right device in the next WRCFGA: cell 13 is DCC2 of device 1
+    afeChainSetDischarge(13, 1);
+    afeChainSetDischarge(PACK_NUM_CELLS - 1U, 1);
+    CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+    CHECK(devices[1].config[4] == 0x02U && devices[0].config[4] == 0);
+    CHECK(devices[AFE_NUM_DEVICES - 1U].config[5] == 0x08U);
+    afeChainSetDischarge(13, 0);
+    afeChainSetDischarge(PACK_NUM_CELLS - 1U, 0);
+}
+
+// Held readings still reach the safety stage, which trips on their age and opens both paths
+static void testStaleFault(void) {
+    AdcBlock block = {0};
+    float voltages[PACK_NUM_CELLS];
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t lost[PACK_NUM_TEMPERATURES] = {0};
+    FaultStatus status;
+
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        temperatures[i] = 25.0f;
+    }
+    batteryPackInit();
+    updateBatteryPackTemperatures(temperatures, lost);
+
+    setCells(0);
+    for (uint8_t i = 0; i < 20; i++) {
+        afeChainMeasureCells(voltages);
+        CHECK(readCellVoltages(&block, voltages) == STATUS_OK);
+        updateBatteryPackVoltages(voltages, readCellVoltageStaleScans());
+        faultManagerEvaluate(&batteryPack);
+    }
+    faultManagerGetStatus(&status);
+    CHECK(status.active == 0);
+
+    devices[0].dead = 1;
+    for (uint8_t i = 0; i < 10; i++) {
+        CHECK(!faultManagerIsActive(FAULT_ID_VoltageStale));
+        afeChainMeasureCells(voltages);
+        CHECK(readCellVoltages(&block, voltages) == STATUS_OK);
+        updateBatteryPackVoltages(voltages, readCellVoltageStaleScans());
+        faultManagerEvaluate(&batteryPack);
+    }
+    faultManagerGetStatus(&status);
+    CHECK(faultManagerIsActive(FAULT_ID_VoltageStale));
+    CHECK(status.disabledPaths == FAULT_PATH_BOTH);
+    CHECK(status.state == BMS_STATE_SHUTDOWN);
+    CHECK(batteryPack.voltageStaleScans == 10);
+    devices[0].dead = 0;
+}
+
+// A scan, thermistors included, fits its own period on the target. The voltage stage only
+// copies out the last completed scan: no bus traffic, and nothing from a scan in progress.
+static void testScanPeriod(void) {
+    AdcBlock block = {0};
+    float voltages[PACK_NUM_CELLS];
+    double worstMs = 0.0;
+    double cellMs = 0.0;
+
+    setCells(6);
+    for (uint32_t scan = 0; scan < AFE_AUX_SCAN_INTERVAL; scan++) {
+        busBytes = 0;
+        conversions = 0;
+        CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+        double ms = busBytes * 8.0 * 1000.0 / SPI2_BIT_RATE + conversions * (AFE_CONVERSION_TIME_MS + 1.0);
+
+        cellMs = conversions == 1U ? ms : cellMs;
+        worstMs = ms > worstMs ? ms : worstMs;
+    }
+    printf("%u cells: scan %.2f ms, %.2f ms with the thermistors, every %u ms against a %u ms block\n",
+           (unsigned)PACK_NUM_CELLS, cellMs, worstMs, (unsigned)AFE_SCAN_PERIOD_MS,
+           (unsigned)(1000U / SAMPLING_TARGET_BLOCK_RATE_HZ));
+    CHECK(worstMs < AFE_SCAN_PERIOD_MS);
+    CHECK(cellMs > 0.0 && worstMs > cellMs);
+
+    setCells(7);
+    busBytes = 0;
+    conversions = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(readCellVoltages(&block, voltages) == STATUS_OK);
+        CHECK(mismatchedCells(voltages, 6, 0xFF, 0) == 0);
+    }
+    CHECK(busBytes == 0 && conversions == 0);
+    CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+    CHECK(readCellVoltages(&block, voltages) == STATUS_OK);
+    CHECK(mismatchedCells(voltages, 7, 0xFF, 0) == 0);
+}
+
+// 0x100 carries three cells per frame, four frames per period, until every cell has been sent
+static void testCellTelemetry(void) {
+    static PackSnapshot snap;
+    uint8_t seen[PACK_NUM_CELLS] = {0};
+    uint32_t frames = 0;
+    uint32_t periods = 0;
+    uint32_t wrong = 0;
+
+    for (uint16_t i = 0; i < PACK_NUM_CELLS; i++) {
+        snap.pack.cellVoltages[i] = 3.0f + i * 0.001f;
+    }
+    CHECK(canInit() == CAN_STATUS_OK);
+    canTelemetryInit();
+    for (uint8_t message = 0; message < TELEMETRY_NUM_MESSAGES; message++) {
+        canTelemetrySetPeriod((TelemetryMessage)message, message == TELEMETRY_MSG_CellVoltages ? 10 : 0);
+    }
+
+    for (TickType_t now = 0; periods < 2U * TELEMETRY_CELL_FRAMES / TELEMETRY_MAX_FRAMES_PER_PERIOD; now += 10) {
+        uint32_t sent = 0;
+
+        canTelemetryService(&snap, now);
+        periods++;
+        for (uint8_t mailbox = 0; mailbox < HOST_CAN_MAILBOXES; mailbox++) {
+            while (hostCanMailboxBusy(mailbox)) {
+                const HostCanTxFrame *frame = hostCanMailboxFrame(mailbox);
+                uint8_t group = frame->data[0];
+
+                CHECK(frame->header.StdId == 0x100 && frame->header.DLC == 7);
+                for (uint8_t k = 0; k < TELEMETRY_CELLS_PER_FRAME && group < TELEMETRY_CELL_FRAMES; k++) {
+                    uint16_t cell = (uint16_t)(group * TELEMETRY_CELLS_PER_FRAME + k);
+                    uint16_t raw = (uint16_t)(frame->data[1 + 2 * k] | (frame->data[2 + 2 * k] << 8));
+                    wrong += raw != 3000U + cell;
+                    seen[cell] = 1;
+                }
+                sent++;
+                hostCanCompleteMailbox(&hcan1, mailbox);
+                mailbox = 0;
+            }
+        }
+        frames += sent;
+        CHECK(sent == TELEMETRY_MAX_FRAMES_PER_PERIOD);
+    }
+
+    uint32_t missing = 0;
+    for (uint16_t i = 0; i < PACK_NUM_CELLS; i++) {
+        missing += !seen[i];
+    }
+    CHECK(missing == 0);
+    CHECK(wrong == 0);
+    CHECK(frames == 2U * TELEMETRY_CELL_FRAMES);
+    printf("0x100: %u frames per rotation, %u ms for all %u cells\n", (unsigned)TELEMETRY_CELL_FRAMES,
+           (unsigned)(10U * TELEMETRY_CELL_FRAMES / TELEMETRY_MAX_FRAMES_PER_PERIOD), (unsigned)PACK_NUM_CELLS);
+}
+
+// 0x102 likewise over every sensor; a lost sensor and the unused slots of the last frame read
+// raw 0x8000
+static void testTemperatureTelemetry(void) {
+    static PackSnapshot snap;
+    uint8_t seen[PACK_NUM_TEMPERATURES] = {0};
+    uint32_t frames = 0;
+    uint32_t wrong = 0;
+    uint32_t lostSlot = PACK_FIRST_THERMISTOR + 7U;
+    uint32_t periods = (TELEMETRY_TEMPERATURE_FRAMES + TELEMETRY_MAX_FRAMES_PER_PERIOD - 1U) /
+                       TELEMETRY_MAX_FRAMES_PER_PERIOD;
+
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        snap.pack.temperatures[i] = -20.0f + i * 0.5f;
+    }
+    snap.pack.temperatureLost[lostSlot] = 1;
+    canTelemetryInit();
+    for (uint8_t message = 0; message < TELEMETRY_NUM_MESSAGES; message++) {
+        canTelemetrySetPeriod((TelemetryMessage)message, message == TELEMETRY_MSG_Temperatures ? 100 : 0);
+    }
+
+    for (TickType_t now = 0; now < 100U * periods; now += 100) {
+        canTelemetryService(&snap, now);
+        for (uint8_t mailbox = 0; mailbox < HOST_CAN_MAILBOXES; mailbox++) {
+            while (hostCanMailboxBusy(mailbox)) {
+                const HostCanTxFrame *frame = hostCanMailboxFrame(mailbox);
+                uint8_t group = frame->data[0];
+
+                CHECK(frame->header.StdId == 0x102 && frame->header.DLC == 7);
+                for (uint8_t k = 0; k < TELEMETRY_TEMPERATURES_PER_FRAME && group < TELEMETRY_TEMPERATURE_FRAMES; k++) {
+                    uint16_t sensor = (uint16_t)(group * TELEMETRY_TEMPERATURES_PER_FRAME + k);
+                    int16_t raw = (int16_t)(frame->data[1 + 2 * k] | (frame->data[2 + 2 * k] << 8));
+
+                    if (sensor >= PACK_NUM_TEMPERATURES || sensor == lostSlot) {
+                        wrong += raw != INT16_MIN;
+                    } else {
+                        wrong += raw != -200 + 5 * sensor;
+                        seen[sensor] = 1;
+                    }
+                }
+                frames++;
+                hostCanCompleteMailbox(&hcan1, mailbox);
+                mailbox = 0;
+            }
+        }
+    }
+
+    uint32_t missing = 0;
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        missing += !seen[i] && i != lostSlot;
+    }
+    CHECK(missing == 0);
+    CHECK(wrong == 0);
+    CHECK(frames == periods * TELEMETRY_MAX_FRAMES_PER_PERIOD);
+    printf("0x102: %u frames per rotation, %u ms for all %u sensors\n", (unsigned)TELEMETRY_TEMPERATURE_FRAMES,
+           (unsigned)(100U * periods), (unsigned)PACK_NUM_TEMPERATURES);
+}
+
+// What one scan costs on the target: bytes clocked at the SPI2 rate, and the PEC checks
+static void reportScanCost(void) {
+    static uint8_t data[1U << 16];
+    float voltages[PACK_NUM_CELLS];
+    uint32_t iterations = 200;
+    volatile uint16_t sink = 0;
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 131U + 7U);
+    }
+    for (uint32_t length = 0; length <= 64; length++) {
+        CHECK(checksumPec15(data, length) == referencePec15(data, length));
+    }
+
+    busBytes = 0;
+    CHECK(afeChainMeasureCells(voltages) == HAL_OK);
+    uint32_t scanBytes = busBytes;
+    double busMs = scanBytes * 8.0 * 1000.0 / SPI2_BIT_RATE;
+
+    uint64_t start = hostNanoseconds();
+    for (uint32_t i = 0; i < iterations; i++) {
+        data[0] = (uint8_t)i;
+        sink = checksumPec15(data, sizeof(data));
+    }
+    double nsPerByte = (double)(hostNanoseconds() - start) / ((double)iterations * sizeof(data));
+    uint32_t pecBytes = AFE_NUM_CELL_GROUPS * AFE_NUM_DEVICES * AFE_REGISTER_BYTES;
+
+    printf("scan of %u cells: %u bytes on the bus, %.2f ms at %.0f kbit/s plus %u ms conversion\n",
+           (unsigned)PACK_NUM_CELLS, (unsigned)scanBytes, busMs, SPI2_BIT_RATE / 1000.0,
+           (unsigned)AFE_CONVERSION_TIME_MS + 1U);
+    printf("PEC15: %.2f ns/byte on the host (%.1f MB/s), %u bytes checked per scan\n",
+           nsPerByte, 1000.0 / nsPerByte, (unsigned)pecBytes);
+    CHECK(scanBytes > 0);
+}
+
+int main(void) {
+    hostRtosReset();
+    cycleCounterInit();
+    checksumInit();
+    hostSpiDevice = chain;
+    CHECK(afeChainInit() == HAL_OK);
+    hostSchedulerStart();
+
+    testScans();
+    testStaleFault();
+    testScanPeriod();
+    testCellTelemetry();
+    testTemperatureTelemetry();
+    reportScanCost();
+    return hostTestReport("testAfeChain");
+}
@@ -0,0 +1,248 @@
+// balancingPlanner: bleed durations from the excess charge, the start/stop hysteresis, the
+// group power budget and thermal pause, and the pack simulation against the threshold
+// balancer it replaced
+#include "hostTest.h"
+#include "hostStub.h"
+#include "balancingPlanner.h"
+#include "coulombCounter.h"
+#include "arm_math.h"
+#include <string.h>
+
+#define CELL_V      3.7f
+#define CAPACITY    3000.0f
+
+// Threshold balancer (every cell above the minimum bleeds while the spread is over 50 mV)
+// against the planner on a simulated pack at rest
+enum {
+    BALANCE_SIM_THRESHOLD,
+    BALANCE_SIM_PLANNER,
+    BALANCE_SIM_ALGORITHMS
+};
+
+#define BALANCE_SIM_STEP_S          10U
+#define BALANCE_SIM_LIMIT_S         (24U * 3600U)
+#define BALANCE_LEGACY_THRESHOLD_V  0.05f   // What balanceCells() used before the planner
+#define BALANCE_SIM_AMBIENT_C       25.0f
+#define BALANCE_SIM_KELVIN_PER_W    12.0f   // Resistor group to hottest sensor, steady state
+
+typedef struct {
+    uint32_t convergeSeconds[BALANCE_SIM_ALGORITHMS];   // Until the charge spread is within BALANCE_START_MAH; UINT32_MAX if never
+    float finalSpreadMah[BALANCE_SIM_ALGORITHMS];
+    float dissipatedJoules[BALANCE_SIM_ALGORITHMS];
+    float peakTemperature[BALANCE_SIM_ALGORITHMS];
+    uint32_t pinWrites[BALANCE_SIM_ALGORITHMS];         // GPIO/DCC writes at the live 1 s balancing period
+} BalancingSimulation;
+
+static BalancingPlanner planner;
+static float soc[PACK_NUM_CELLS];
+static float capacity[PACK_NUM_CELLS];
+static float voltages[PACK_NUM_CELLS];
+
+static uint32_t bleedMs(float excessMah) {
+    return (uint32_t)(excessMah / (CELL_V / BALANCE_BLEED_RESISTOR_OHM * 1000.0f) * 3600000.0f);
+}
+
+static void setExcess(const float *excessMah) {
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        capacity[i] = CAPACITY;
+        voltages[i] = CELL_V;
+        soc[i] = 50.0f + excessMah[i] / CAPACITY * 100.0f;
+    }
+}
+
+static uint32_t activeCount(void) {
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        count += planner.active[i];
+    }
+    return count;
+}
+
+// Each cell owes the time its resistor takes to bleed it down to the emptiest one
+static void testReplan(void) {
+    const float excess[PACK_NUM_CELLS] = { 0.0f, 40.0f, 9.0f, 25.0f, 80.0f, 11.0f };
+
+    balancingPlannerInit(&planner);
+    CHECK(balancingPlannerReplanDue(&planner));
+    setExcess(excess);
+    balancingPlannerReplan(&planner, soc, capacity, voltages);
+    CHECK(!balancingPlannerReplanDue(&planner));
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        uint32_t expected = excess[i] > BALANCE_START_MAH ? bleedMs(excess[i]) : 0;
+        CHECK_NEAR(planner.remainingMs[i], expected, expected * 0.001 + 1.0);
+    }
+
+    // Planned cells stay in down to BALANCE_STOP_MAH; one that was out needs BALANCE_START_MAH
+    const float later[PACK_NUM_CELLS] = { 0.0f, 5.0f, 9.0f, 1.0f, 30.0f, 11.0f };
+    setExcess(later);
+    balancingPlannerReplan(&planner, soc, capacity, voltages);
+    CHECK(planner.remainingMs[1] > 0 && planner.remainingMs[2] == 0 && planner.remainingMs[3] == 0);
+    CHECK(planner.remainingMs[4] > 0 && planner.remainingMs[5] > 0);
+}
+
+// Within the group's budget the longest bleeds start first, running cells keep their slot,
+// and pins only change when the set does
+static void testStep(void) {
+    const float excess[PACK_NUM_CELLS] = { 0.0f, 40.0f, 30.0f, 25.0f, 80.0f, 60.0f };
+    uint32_t slots = (uint32_t)(BALANCE_GROUP_POWER_W / (CELL_V * CELL_V / BALANCE_BLEED_RESISTOR_OHM));
+
+    balancingPlannerInit(&planner);
+    setExcess(excess);
+    balancingPlannerReplan(&planner, soc, capacity, voltages);
+    CHECK(balancingPlannerStep(&planner, voltages, NULL, 25.0f, 0) == slots);
+    CHECK(slots == 3 && planner.active[4] && planner.active[5] && planner.active[1]);
+    CHECK(balancingPlannerStep(&planner, voltages, NULL, 25.0f, 1000) == 0);
+
+    // Cell 1 finishes; its slot goes to the longest one waiting
+    uint32_t remaining = planner.remainingMs[1];
+    CHECK(balancingPlannerStep(&planner, voltages, NULL, 25.0f, remaining) == 2);
+    CHECK(!planner.active[1] && planner.active[2] && activeCount() == slots);
+    CHECK(planner.remainingMs[1] == 0);
+
+    // Energy is counted for the time each resistor was on
+    double expected = CELL_V * CELL_V / BALANCE_BLEED_RESISTOR_OHM * (1.0 + remaining / 1000.0) * slots;
+    CHECK_NEAR(planner.dissipatedJoules, expected, expected * 0.001);
+
+    // At half duty a resistor takes half the power and bleeds half as fast
+    balancingPlannerInit(&planner);
+    balancingPlannerReplan(&planner, soc, capacity, voltages);
+    float duty[PACK_NUM_CELLS] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+    balancingPlannerStep(&planner, voltages, duty, 25.0f, 0);
+    CHECK(activeCount() == 5);
+    remaining = planner.remainingMs[4];
+    balancingPlannerStep(&planner, voltages, duty, 25.0f, 10000);
+    CHECK(planner.remainingMs[4] == remaining - 5000U);
+}
+
+// Everything stops above BALANCE_MAX_TEMPERATURE_C and waits for BALANCE_RESUME_TEMPERATURE_C
+static void testThermalPause(void) {
+    const float excess[PACK_NUM_CELLS] = { 0.0f, 40.0f, 30.0f, 25.0f, 80.0f, 60.0f };
+
+    balancingPlannerInit(&planner);
+    setExcess(excess);
+    balancingPlannerReplan(&planner, soc, capacity, voltages);
+    balancingPlannerStep(&planner, voltages, NULL, 25.0f, 0);
+    CHECK(activeCount() == 3);
+
+    CHECK(balancingPlannerStep(&planner, voltages, NULL, BALANCE_MAX_TEMPERATURE_C + 1.0f, 1000) == 3);
+    CHECK(activeCount() == 0 && planner.thermalPause);
+    CHECK(balancingPlannerStep(&planner, voltages, NULL, BALANCE_RESUME_TEMPERATURE_C + 1.0f, 1000) == 0);
+    CHECK(activeCount() == 0);
+    balancingPlannerStep(&planner, voltages, NULL, BALANCE_RESUME_TEMPERATURE_C - 1.0f, 1000);
+    CHECK(activeCount() == 3 && !planner.thermalPause);
+}
+
+static float chargeSpread(const float soc[PACK_NUM_CELLS], const float capacityMah[PACK_NUM_CELLS]) {
+    float lowest = soc[0] * 0.01f * capacityMah[0];
+    float highest = lowest;
+
+    for (uint32_t i = 1; i < PACK_NUM_CELLS; i++) {
+        float charge = soc[i] * 0.01f * capacityMah[i];
+        if (charge < lowest) lowest = charge;
+        if (charge > highest) highest = charge;
+    }
+    return highest - lowest;
+}
+
+// A resting pack with a few percent of SoC and capacity spread, run through both balancers
+// with the estimator assumed exact. Each resistor group heats the hottest sensor in
+// proportion to what it dissipates.
+static void simulate(BalancingSimulation *result) {
+    static uint8_t active[PACK_NUM_CELLS];
+
+    for (uint8_t algorithm = 0; algorithm < BALANCE_SIM_ALGORITHMS; algorithm++) {
+        float hottest = BALANCE_SIM_AMBIENT_C;
+        float energy = 0.0f;
+
+        for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+            capacity[i] = COULOMB_CAPACITY_MAH * (1.0f - 0.005f * (float)((i * 13U) % 7U));
+            soc[i] = 60.0f + 8.0f * (float)((i * 37U) % 53U) / 52.0f;
+            active[i] = 0;
+        }
+        balancingPlannerInit(&planner);
+        result->convergeSeconds[algorithm] = UINT32_MAX;
+        result->peakTemperature[algorithm] = hottest;
+        result->pinWrites[algorithm] = 0;
+
+        for (uint32_t t = 0; t < BALANCE_SIM_LIMIT_S; t += BALANCE_SIM_STEP_S) {
+            for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+                voltages[i] = socToOcv(soc[i], NULL);
+            }
+            if (result->convergeSeconds[algorithm] == UINT32_MAX && chargeSpread(soc, capacity) <= BALANCE_START_MAH) {
+                result->convergeSeconds[algorithm] = t;
+            }
+
+            if (algorithm == BALANCE_SIM_THRESHOLD) {
+                float maxVoltage, minVoltage;
+                uint32_t index;
+                arm_max_f32(voltages, PACK_NUM_CELLS, &maxVoltage, &index);
+                arm_min_f32(voltages, PACK_NUM_CELLS, &minVoltage, &index);
+                for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+                    active[i] = (maxVoltage - minVoltage > BALANCE_LEGACY_THRESHOLD_V) && voltages[i] > minVoltage;
+                }
+                result->pinWrites[algorithm] += PACK_NUM_CELLS * BALANCE_SIM_STEP_S;   // Every pin, every second
+            } else {
+                if (balancingPlannerReplanDue(&planner)) {
+                    balancingPlannerReplan(&planner, soc, capacity, voltages);
+                }
+                result->pinWrites[algorithm] += balancingPlannerStep(&planner, voltages, NULL, hottest, BALANCE_SIM_STEP_S * 1000U);
+                memcpy(active, planner.active, sizeof(active));
+            }
+
+            hottest = BALANCE_SIM_AMBIENT_C;
+            for (uint32_t first = 0; first < PACK_NUM_CELLS; first += BALANCE_GROUP_CELLS) {
+                float power = 0.0f;
+                for (uint32_t i = first; i < first + BALANCE_GROUP_CELLS && i < PACK_NUM_CELLS; i++) {
+                    if (active[i]) {
+                        power += voltages[i] * voltages[i] / BALANCE_BLEED_RESISTOR_OHM;
+                        soc[i] -= voltages[i] / BALANCE_BLEED_RESISTOR_OHM * BALANCE_SIM_STEP_S / (capacity[i] * 3.6f) * 100.0f;
+                        energy += voltages[i] * voltages[i] / BALANCE_BLEED_RESISTOR_OHM * BALANCE_SIM_STEP_S;
+                    }
+                }
+                if (BALANCE_SIM_AMBIENT_C + power * BALANCE_SIM_KELVIN_PER_W > hottest) {
+                    hottest = BALANCE_SIM_AMBIENT_C + power * BALANCE_SIM_KELVIN_PER_W;
+                }
+            }
+            if (hottest > result->peakTemperature[algorithm]) {
+                result->peakTemperature[algorithm] = hottest;
+            }
+        }
+
+        result->finalSpreadMah[algorithm] = chargeSpread(soc, capacity);
+        result->dissipatedJoules[algorithm] = energy;
+    }
+}
+
+static void testSimulation(void) {
+    static const char *const names[BALANCE_SIM_ALGORITHMS] = { "threshold", "planner" };
+    BalancingSimulation sim;
+
+    simulate(&sim);
+    for (uint8_t i = 0; i < BALANCE_SIM_ALGORITHMS; i++) {
+        printf("%-9s: converged %6.0f s, final spread %5.1f mAh, %6.0f J, peak %4.1f degC, %6u pin writes\n",
+               names[i], sim.convergeSeconds[i] == UINT32_MAX ? -1.0 : (double)sim.convergeSeconds[i],
+               (double)sim.finalSpreadMah[i], (double)sim.dissipatedJoules[i], (double)sim.peakTemperature[i],
+               (unsigned)sim.pinWrites[i]);
+    }
+
+    // The planner balances by charge, within the thermal limit, with a handful of pin changes
+    CHECK(sim.convergeSeconds[BALANCE_SIM_PLANNER] != UINT32_MAX);
+    CHECK(sim.finalSpreadMah[BALANCE_SIM_PLANNER] <= BALANCE_START_MAH);
+    CHECK(sim.peakTemperature[BALANCE_SIM_PLANNER] <= BALANCE_MAX_TEMPERATURE_C);
+    CHECK(sim.pinWrites[BALANCE_SIM_PLANNER] * 100U < sim.pinWrites[BALANCE_SIM_THRESHOLD]);
+    CHECK(sim.finalSpreadMah[BALANCE_SIM_PLANNER] < sim.finalSpreadMah[BALANCE_SIM_THRESHOLD]);
+
+    // Bleeding every cell above the minimum at once runs the board past the thermal limit
+    CHECK(sim.peakTemperature[BALANCE_SIM_THRESHOLD] > BALANCE_MAX_TEMPERATURE_C);
+}
+
+int main(void) {
+    hostRtosReset();
+    testReplan();
+    testStep();
+    testThermalPause();
+    testSimulation();
+    return hostTestReport("testBalancingPlanner");
+}
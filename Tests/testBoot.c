@@ -0,0 +1,62 @@
+// The init sequence of main() and MX_FREERTOS_Init(). A kernel critical section before the
+// scheduler starts leaves BASEPRI raised on the part, which masks SysTick and hangs the first
+// HAL_Delay; none may be taken. Both paths must still be off when the scheduler starts.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "packConfig.h"
+#include "checksum.h"
+#include "eventLog.h"
+#include "batteryManagement.h"
+#include "canCommunication.h"
+#include "adcAcquisition.h"
+#include "samplingScheduler.h"
+#include "overcurrentProtection.h"
+#include "afeChain.h"
+#include "bmsPipeline.h"
+#include "cycleCounter.h"
+
+#define CHECK_STEP(step) \
+    do { \
+        step; \
+        CHECK(hostCriticalsBeforeScheduler == 0); \
+        if (hostCriticalsBeforeScheduler != 0) { \
+            printf("  after %s\n", #step); \
+            hostCriticalsBeforeScheduler = 0; \
+        } \
+    } while (0)
+
+int main(void) {
+    hostRtosReset();
+    hostFlashMap();
+    cycleCounterInit();
+
+    CHECK_STEP(checksumInit());
+    CHECK_STEP(eventLogInit());
+    HAL_GPIO_WritePin(Charge_Control_Port, Charge_Control_Pin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(Discharge_Control_Port, Discharge_Control_Pin, GPIO_PIN_SET);
+    CHECK_STEP(chargeControlInit());
+    // Nothing has been measured yet: both paths must be off
+    CHECK(hostGpioOutput(Charge_Control_Port, Charge_Control_Pin) == GPIO_PIN_RESET);
+    CHECK(hostGpioOutput(Discharge_Control_Port, Discharge_Control_Pin) == GPIO_PIN_RESET);
+    CHECK_STEP(CHECK(canInit() == CAN_STATUS_OK));
+    CHECK_STEP(CHECK(adcAcquisitionInit() == HAL_OK));
+    CHECK_STEP(CHECK(samplingSchedulerInit(SAMPLING_DEFAULT_RATE_HZ) == HAL_OK));
+    CHECK_STEP(CHECK(overcurrentProtectionInit() == HAL_OK));
+#if PACK_CELL_SOURCE == PACK_CELL_SOURCE_AFE
+    uint32_t start = cycleCounterNow();
+    uint32_t tickBefore = HAL_GetTick();
+    CHECK_STEP(CHECK(afeChainInit() == HAL_OK));
+    // The wake-up must not wait on SysTick, and still has to last tWAKE per device
+    CHECK(HAL_GetTick() == tickBefore);
+    CHECK(cycleCounterToMicros(cycleCounterNow() - start) >= AFE_NUM_DEVICES * AFE_WAKE_TIME_US);
+#endif
+    CHECK_STEP(bmsPipelineInit());
+    CHECK_STEP(CHECK(samplingSchedulerStart() == HAL_OK));
+    CHECK(hostErrorHandlerCalls == 0);
+
+    CHECK(hostGpioOutput(Charge_Control_Port, Charge_Control_Pin) == GPIO_PIN_RESET);
+    CHECK(hostGpioOutput(Discharge_Control_Port, Discharge_Control_Pin) == GPIO_PIN_RESET);
+
+    hostSchedulerStart();
+    return hostTestReport("testBoot");
+}
@@ -0,0 +1,189 @@
+// CAN in loopback: frames queued at every priority go out through the three mailboxes, the
+// emulated bus picks the next mailbox the way bxCAN does (request order with MCR.TXFP set,
+// else lowest identifier, then lowest mailbox), and each frame comes back through the receive
+// filters the way loopback mode returns a node's own frames. Checks the order the TX queues
+// refill the mailboxes in, that frames leave in that order, the queue statistics, and the
+// frames the receive table routes reaching their handler.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "canCommunication.h"
+#include "canReceive.h"
+#include "chargeController.h"
+
+#define MAILBOXES     3U
+#define HIGH_ID       0x0F0U
+#define NORMAL_ID     0x101U
+#define LOW_ID        0x7F0U
+#define HIGH_FRAMES   4U
+#define NORMAL_FRAMES CAN_TX_QUEUE_DEPTH
+#define LOW_FRAMES    (MAILBOXES + CAN_TX_QUEUE_DEPTH + 1U)   // Fills the mailboxes, then the queue, then one too many
+#define MAX_FRAMES    64U
+
+typedef struct {
+    uint32_t id;
+    uint8_t sequence;
+} BusFrame;
+
+static BusFrame loaded[MAX_FRAMES];     // In the order frames reached a mailbox
+static uint32_t loadedCount = 0;
+static BusFrame sent[MAX_FRAMES];       // In the order they won arbitration
+static uint32_t sentCount = 0;
+static uint32_t echoed = 0;             // Passed the receive filters
+static uint8_t seen[MAILBOXES];
+static uint32_t requested[MAILBOXES];   // Load stamp of each mailbox's frame
+
+static uint32_t frameId(const HostCanTxFrame *frame) {
+    return frame->header.IDE == CAN_ID_EXT ? frame->header.ExtId : frame->header.StdId;
+}
+
+// Which pending mailbox the controller transmits first. By identifier, a standard ID compares
+// against the top 11 bits of an extended one and the lower wins.
+static uint32_t transmitKey(uint8_t mailbox) {
+    const HostCanTxFrame *frame = hostCanMailboxFrame(mailbox);
+
+    if (CAN1->MCR & CAN_MCR_TXFP) {
+        return requested[mailbox];
+    }
+    return frame->header.IDE == CAN_ID_EXT ? frame->header.ExtId : (frame->header.StdId << 18);
+}
+
+static void noteLoaded(void) {
+    for (uint8_t mailbox = 0; mailbox < MAILBOXES; mailbox++) {
+        if (hostCanMailboxBusy(mailbox) && !seen[mailbox] && loadedCount < MAX_FRAMES) {
+            const HostCanTxFrame *frame = hostCanMailboxFrame(mailbox);
+
+            requested[mailbox] = loadedCount;
+            loaded[loadedCount].id = frameId(frame);
+            loaded[loadedCount++].sequence = frame->data[0];
+            seen[mailbox] = 1;
+        }
+    }
+}
+
+// One frame on the bus: the highest-priority pending mailbox transmits, is received back,
+// and its completion interrupt refills it. Returns 0 once every mailbox is empty.
+static uint8_t busStep(void) {
+    int8_t winner = -1;
+
+    noteLoaded();
+    for (uint8_t mailbox = 0; mailbox < MAILBOXES; mailbox++) {
+        if (hostCanMailboxBusy(mailbox) && (winner < 0 || transmitKey(mailbox) < transmitKey((uint8_t)winner))) {
+            winner = (int8_t)mailbox;
+        }
+    }
+    if (winner < 0) {
+        return 0;
+    }
+
+    const HostCanTxFrame *frame = hostCanMailboxFrame((uint8_t)winner);
+    if (sentCount < MAX_FRAMES) {
+        sent[sentCount].id = frameId(frame);
+        sent[sentCount++].sequence = frame->data[0];
+    }
+    echoed += hostCanReceive(&hcan1, frameId(frame), frame->header.IDE == CAN_ID_EXT, frame->data,
+                             (uint8_t)frame->header.DLC);
+    seen[winner] = 0;
+    hostCanCompleteMailbox(&hcan1, (uint8_t)winner);
+    return 1;
+}
+
+static void queue(uint32_t id, uint8_t sequence, CanTxPriority priority, can_status_t expected) {
+    uint8_t data[8] = { sequence };
+
+    CHECK(canTransmitMessage(id, data, sizeof(data), priority) == expected);
+}
+
+static void checkStats(CanTxPriority priority, uint32_t queued, uint32_t dropped, uint16_t peakDepth) {
+    CanTxQueueStats stats;
+
+    canGetTxQueueStats(priority, &stats);
+    CHECK(stats.queued == queued && stats.sent == queued && stats.dropped == dropped);
+    CHECK(stats.depth == 0 && stats.peakDepth == peakDepth);
+}
+
+// Low frames take the idle mailboxes; once those are busy the rings hold everything else and
+// every mailbox that frees up goes to the highest priority still waiting
+static void testPriorityRefill(void) {
+    uint32_t next = 0;
+
+    for (uint8_t i = 0; i < LOW_FRAMES; i++) {
+        queue(LOW_ID, i, CAN_TX_PRIORITY_LOW, i + 1U < LOW_FRAMES ? CAN_STATUS_OK : CAN_STATUS_QUEUE_FULL);
+    }
+    for (uint8_t i = 0; i < NORMAL_FRAMES; i++) {
+        queue(NORMAL_ID, i, CAN_TX_PRIORITY_NORMAL, CAN_STATUS_OK);
+    }
+    for (uint8_t i = 0; i < HIGH_FRAMES; i++) {
+        queue(HIGH_ID, i, CAN_TX_PRIORITY_HIGH, CAN_STATUS_OK);
+    }
+    while (busStep()) {
+    }
+
+    CHECK(loadedCount == LOW_FRAMES - 1U + NORMAL_FRAMES + HIGH_FRAMES);
+    CHECK(sentCount == loadedCount);
+    for (uint8_t i = 0; i < MAILBOXES; i++, next++) {
+        CHECK(loaded[next].id == LOW_ID && loaded[next].sequence == i);
+    }
+    for (uint8_t i = 0; i < HIGH_FRAMES; i++, next++) {
+        CHECK(loaded[next].id == HIGH_ID && loaded[next].sequence == i);
+    }
+    for (uint8_t i = 0; i < NORMAL_FRAMES; i++, next++) {
+        CHECK(loaded[next].id == NORMAL_ID && loaded[next].sequence == i);
+    }
+    for (uint8_t i = MAILBOXES; i + 1U < LOW_FRAMES; i++, next++) {
+        CHECK(loaded[next].id == LOW_ID && loaded[next].sequence == i);
+    }
+
+    // Frames leave in the order they were loaded, so frames sharing an ID never swap
+    uint32_t reordered = 0;
+    for (uint32_t i = 0; i < sentCount; i++) {
+        reordered += sent[i].id != loaded[i].id || sent[i].sequence != loaded[i].sequence;
+    }
+    CHECK(reordered == 0);
+
+    checkStats(CAN_TX_PRIORITY_HIGH, HIGH_FRAMES, 0, HIGH_FRAMES);
+    checkStats(CAN_TX_PRIORITY_NORMAL, NORMAL_FRAMES, 0, NORMAL_FRAMES);
+    checkStats(CAN_TX_PRIORITY_LOW, LOW_FRAMES - 1U, 1, CAN_TX_QUEUE_DEPTH);
+
+    // None of these identifiers is in the receive table, so the filters kept them all out
+    CHECK(echoed == 0);
+}
+
+// A frame the receive table routes comes back through its filter bank, FIFO and pool slot to
+// the handler; the extended charger request the BMS itself sends is filtered out
+static void testReceiveRoute(void) {
+    uint8_t status[8] = { 0x03, 0x20, 0x00, 0x1E, CHARGER_FLAG_COMMS, 0, 0, 0 };   // 80.0 V, 3.0 A
+    uint8_t request[8] = { 0 };
+    ChargerStatus charger;
+    CanRxStats stats;
+
+    chargeControllerInit();
+    CHECK(canTransmitExtendedMessage(0x18FF50E5U, status, sizeof(status), CAN_TX_PRIORITY_NORMAL) == CAN_STATUS_OK);
+    CHECK(canTransmitExtendedMessage(CHARGER_REQUEST_ID, request, sizeof(request), CAN_TX_PRIORITY_HIGH) == CAN_STATUS_OK);
+    while (busStep()) {
+    }
+    CHECK(echoed == 1);
+
+    canReceiveDispatch(0);
+    chargeControllerGetChargerStatus(&charger);
+    CHECK(charger.valid && charger.flags == CHARGER_FLAG_COMMS);
+    CHECK(charger.outputVoltage > 79.9f && charger.outputVoltage < 80.1f);
+    CHECK(charger.outputCurrent > 2.9f && charger.outputCurrent < 3.1f);
+
+    canReceiveGetStats(CAN_RX_PRIORITY_LOW, &stats);
+    CHECK(stats.received == 1 && stats.dropped == 0 && stats.unmatched == 0);
+    canReceiveGetStats(CAN_RX_PRIORITY_HIGH, &stats);
+    CHECK(stats.received == 0);
+}
+
+int main(void) {
+    hostRtosReset();
+    hcan1.Init.Mode = CAN_MODE_LOOPBACK;
+    CHECK(canInit() == CAN_STATUS_OK);
+    CHECK(CAN1->MCR & CAN_MCR_TXFP);
+    canReceiveSubscribe(xTaskGetCurrentTaskHandle());
+
+    testPriorityRefill();
+    testReceiveRoute();
+    printf("%u frames on the bus, %u received back\n", (unsigned)sentCount, (unsigned)echoed);
+    return hostTestReport("testCanLoopback");
+}
@@ -0,0 +1,210 @@
+// cellFilter: the anti-alias biquads and FIR decimator at the default 1 kHz sweep rate. A DC
+// level and a tone well inside the band pass at unity gain; tones that would alias onto the
+// 100 Hz output are held under 1 %, where the 10-sample average the bank replaced lets them
+// through. Built for the float and the fixed-point path; reports each tone and the benchmark.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "cellFilter.h"
+#include "cycleCounter.h"
+
+#define SAMPLE_RATE_HZ   1000U
+#define DECIMATION       (SAMPLE_RATE_HZ / CELL_FILTER_OUTPUT_RATE_HZ)
+#define MID_CODE         2048.0
+#define AMPLITUDE_CODES  500.0
+#define SETTLE_OUTPUTS   50U
+#define MEASURE_OUTPUTS  200U     // 2 s: a whole number of periods of every tone below
+#define MAX_ALIAS_GAIN   0.01
+#define REFERENCE_TAPS   10       // Length of the running average the filter bank replaced
+
+static uint16_t samples[ADC_ACQ_NUM_CHANNELS * DECIMATION];
+static uint16_t benchmarkSamples[ADC_ACQ_NUM_CHANNELS * ADC_ACQ_MAX_SWEEPS_PER_BLOCK];
+static double outputs[MEASURE_OUTPUTS];
+
+static double milliPerCode(void) {
+    return SIGNAL_CELL_FULL_SCALE_MILLI / 4096.0;
+}
+
+static uint16_t toneCode(double frequencyHz, uint32_t sweep) {
+    return (uint16_t)lround(MID_CODE + AMPLITUDE_CODES * sin(2.0 * M_PI * frequencyHz * sweep / SAMPLE_RATE_HZ));
+}
+
+// Amplitude at frequencyHz of samples taken at rateHz, by projection onto sine and cosine
+static double toneAmplitude(const double *values, uint32_t count, double frequencyHz, double rateHz) {
+    double mean = 0.0;
+    double inPhase = 0.0;
+    double quadrature = 0.0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        mean += values[i] / count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        inPhase += (values[i] - mean) * sin(2.0 * M_PI * frequencyHz * i / rateHz);
+        quadrature += (values[i] - mean) * cos(2.0 * M_PI * frequencyHz * i / rateHz);
+    }
+    return 2.0 / count * sqrt(inPhase * inPhase + quadrature * quadrature);
+}
+
+// One output per block: each block is exactly one decimation long. Returns the gain at the
+// frequency the tone lands on after decimation.
+static double filterGain(double frequencyHz) {
+    AdcBlock block = { samples, 0, 0, DECIMATION };
+    signal_t out[ADC_ACQ_NUM_CELL_CHANNELS];
+    double aliasHz = fabs(frequencyHz - CELL_FILTER_OUTPUT_RATE_HZ * round(frequencyHz / CELL_FILTER_OUTPUT_RATE_HZ));
+    uint32_t sweep = 0;
+
+    CHECK(cellFilterInit(SAMPLE_RATE_HZ) == HAL_OK);
+    for (uint32_t output = 0; output < SETTLE_OUTPUTS + MEASURE_OUTPUTS; output++) {
+        for (uint32_t i = 0; i < DECIMATION; i++, sweep++) {
+            for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+                samples[i * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_RANK_CHANNEL(cell)] = toneCode(frequencyHz, sweep);
+            }
+        }
+        CHECK(cellFilterProcessBlock(&block, out) == 1);
+        if (output >= SETTLE_OUTPUTS) {
+            outputs[output - SETTLE_OUTPUTS] = SIGNAL_TO_FLOAT(out[ADC_ACQ_NUM_CELL_CHANNELS - 1]) * 1000.0;
+        }
+    }
+    return toneAmplitude(outputs, MEASURE_OUTPUTS, aliasHz, CELL_FILTER_OUTPUT_RATE_HZ) /
+           (AMPLITUDE_CODES * milliPerCode());
+}
+
+// The scalar running average over the same tone, sampled at the output rate
+static double referenceGain(double frequencyHz) {
+    double aliasHz = fabs(frequencyHz - CELL_FILTER_OUTPUT_RATE_HZ * round(frequencyHz / CELL_FILTER_OUTPUT_RATE_HZ));
+
+    for (uint32_t output = 0; output < MEASURE_OUTPUTS; output++) {
+        uint32_t last = (SETTLE_OUTPUTS + output + 1U) * DECIMATION - 1U;
+
+        outputs[output] = 0.0;
+        for (uint32_t tap = 0; tap < REFERENCE_TAPS; tap++) {
+            outputs[output] += toneCode(frequencyHz, last - tap) / (double)REFERENCE_TAPS;
+        }
+    }
+    return toneAmplitude(outputs, MEASURE_OUTPUTS, aliasHz, CELL_FILTER_OUTPUT_RATE_HZ) / AMPLITUDE_CODES;
+}
+
+static void testConfigure(void) {
+    CHECK(cellFilterConfigure(0, 10, 40.0f) == HAL_ERROR);
+    CHECK(cellFilterConfigure(SAMPLE_RATE_HZ, 0, 40.0f) == HAL_ERROR);
+    CHECK(cellFilterConfigure(SAMPLE_RATE_HZ, ADC_ACQ_MAX_SWEEPS_PER_BLOCK + 1U, 40.0f) == HAL_ERROR);
+    CHECK(cellFilterConfigure(SAMPLE_RATE_HZ, 10, 0.0f) == HAL_ERROR);
+    CHECK(cellFilterConfigure(SAMPLE_RATE_HZ, 10, 0.45f * SAMPLE_RATE_HZ) == HAL_ERROR);
+
+    CHECK(cellFilterInit(SAMPLE_RATE_HZ) == HAL_OK);
+    CHECK(cellFilterGetDecimation() == DECIMATION);
+    CHECK(cellFilterInit(50U) == HAL_OK && cellFilterGetDecimation() == 1U);
+    CHECK(cellFilterInit(20000U) == HAL_OK && cellFilterGetDecimation() == ADC_ACQ_MAX_SWEEPS_PER_BLOCK);
+}
+
+// A steady cell settles to its calibrated voltage; a block that does not divide is refused
+static void testDcAndRejection(void) {
+    AdcBlock block = { samples, 0, 0, DECIMATION };
+    signal_t out[ADC_ACQ_NUM_CELL_CHANNELS];
+    CellFilterStats before;
+    CellFilterStats after;
+
+    CHECK(cellFilterInit(SAMPLE_RATE_HZ) == HAL_OK);
+    for (uint32_t i = 0; i < DECIMATION; i++) {
+        for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+            samples[i * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_RANK_CHANNEL(cell)] = (uint16_t)(2000U + 100U * cell);
+        }
+    }
+    cellFilterGetStats(&before);
+    for (uint32_t output = 0; output < SETTLE_OUTPUTS; output++) {
+        CHECK(cellFilterProcessBlock(&block, out) == 1);
+    }
+    for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+        // Within a code, plus the 1 mV the fixed path truncates
+        CHECK_NEAR(SIGNAL_TO_FLOAT(out[cell]) * 1000.0, (2000.0 + 100.0 * cell) * milliPerCode(),
+                   1.0 + milliPerCode());
+    }
+
+    block.sweeps = DECIMATION + 5U;
+    CHECK(cellFilterProcessBlock(&block, out) == 0);
+    block.sweeps = 0;
+    CHECK(cellFilterProcessBlock(&block, out) == 0);
+    cellFilterGetStats(&after);
+    CHECK(after.blocks == before.blocks + SETTLE_OUTPUTS);
+    CHECK(after.rejectedBlocks == before.rejectedBlocks + 2U);
+    CHECK(after.samplesFiltered == before.samplesFiltered + SETTLE_OUTPUTS * DECIMATION * ADC_ACQ_NUM_CELL_CHANNELS);
+}
+
+static void testResponse(void) {
+    static const double passband[] = { 2.0, 5.0 };
+    static const double aliased[] = { 90.0, 110.0, 195.0, 405.0 };
+
+    for (uint32_t i = 0; i < sizeof(passband) / sizeof(passband[0]); i++) {
+        double gain = filterGain(passband[i]);
+
+        printf("%5.0f Hz: gain %.4f\n", passband[i], gain);
+        CHECK_NEAR(gain, 1.0, 0.02);
+    }
+    for (uint32_t i = 0; i < sizeof(aliased) / sizeof(aliased[0]); i++) {
+        double gain = filterGain(aliased[i]);
+        double reference = referenceGain(aliased[i]);
+
+        printf("%5.0f Hz: gain %.4f, %u-sample average %.4f\n", aliased[i], gain,
+               (unsigned)REFERENCE_TAPS, reference);
+        CHECK(gain < MAX_ALIAS_GAIN);
+    }
+
+    // The average has no stopband: a tone just under the output rate comes through at 11 %
+    CHECK(referenceGain(aliased[0]) > 10.0 * MAX_ALIAS_GAIN);
+}
+
+// Per-sample running average, as the old shared CircularBuffer did it
+static float referenceAverage(float *window, uint8_t *head, float *sum, float sample) {
+    *sum += sample - window[*head];
+    window[*head] = sample;
+    *head = (uint8_t)((*head + 1) % REFERENCE_TAPS);
+    return *sum / REFERENCE_TAPS;
+}
+
+// One full-size block through the bank, timed by its own stats, and the running average over
+// the same codes. A ramp with alternating dither, roughly a charging cell through the ADC.
+static void reportBenchmark(void) {
+    uint32_t sweeps = ADC_ACQ_MAX_SWEEPS_PER_BLOCK - ADC_ACQ_MAX_SWEEPS_PER_BLOCK % DECIMATION;
+    AdcBlock block = { benchmarkSamples, 0, 0, sweeps };
+    signal_t out[ADC_ACQ_NUM_CELL_CHANNELS];
+    float window[ADC_ACQ_NUM_CELL_CHANNELS][REFERENCE_TAPS] = {{0}};
+    float sum[ADC_ACQ_NUM_CELL_CHANNELS] = {0};
+    uint8_t head[ADC_ACQ_NUM_CELL_CHANNELS] = {0};
+    volatile float sink = 0.0f;
+    CellFilterStats stats;
+
+    for (uint32_t i = 0; i < sweeps; i++) {
+        for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+            benchmarkSamples[i * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_RANK_CHANNEL(cell)] =
+                (uint16_t)(2048U + i + ((i & 1U) ? 3 : -3));
+        }
+    }
+    CHECK(cellFilterInit(SAMPLE_RATE_HZ) == HAL_OK);
+    CHECK(cellFilterProcessBlock(&block, out) == 1);
+    cellFilterGetStats(&stats);
+
+    uint32_t start = cycleCounterNow();
+    for (uint8_t cell = 0; cell < ADC_ACQ_NUM_CELL_CHANNELS; cell++) {
+        for (uint32_t i = 0; i < sweeps; i++) {
+            uint16_t code = benchmarkSamples[i * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_RANK_CHANNEL(cell)];
+
+            sink = referenceAverage(window[cell], &head[cell], &sum[cell], code * 3.3f / 4096.0f);
+        }
+    }
+    uint32_t referenceCycles = cycleCounterNow() - start;
+    (void)sink;
+
+    printf("%s path: %.1f cycles per sample, %.1f for the %u-sample average (host clock)\n",
+           BMS_FIXED_POINT ? "fixed-point" : "float",
+           (double)stats.lastBlockCycles / (sweeps * ADC_ACQ_NUM_CELL_CHANNELS),
+           (double)referenceCycles / (sweeps * ADC_ACQ_NUM_CELL_CHANNELS), (unsigned)REFERENCE_TAPS);
+}
+
+int main(void) {
+    hostRtosReset();
+    signalPathInit();
+    testConfigure();
+    testDcAndRejection();
+    testResponse();
+    reportBenchmark();
+    return hostTestReport("testCellFilter");
+}
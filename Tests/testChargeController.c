@@ -0,0 +1,229 @@
+// chargeController: which Elcon status flags end a session and which only pause it, then
+// a simulated charge comparing pack-voltage CC/CV with the cell-level loop
+#include "hostTest.h"
+#include "hostStub.h"
+#include "chargeControllerLoop.h"
+#include "batteryManagement.h"
+#include "coulombCounter.h"
+#include "socEstimator.h"
+#include <math.h>
+
+// Charger-side pack CC/CV with the BMS only switching the path, against the cell-level loop
+enum {
+    CHARGE_SIM_BASELINE,
+    CHARGE_SIM_CONTROLLER,
+    CHARGE_SIM_ALGORITHMS
+};
+
+#define CHARGE_SIM_LIMIT_S         (4U * 3600U)
+#define CHARGE_SIM_STEP_S          0.5f
+#define CHARGE_SIM_R0_OHM          0.02f   // Cell DCIR, spread +-10 % across the pack
+#define CHARGE_SIM_CHARGER_TAU_S   2.0f    // Charger output slew, first order
+#define CHARGE_SIM_CURRENT_LSB_A   0.1f    // Request resolution
+
+typedef struct {
+    uint32_t completeSeconds[CHARGE_SIM_ALGORITHMS];   // UINT32_MAX if it never terminated
+    float finalMinSoc[CHARGE_SIM_ALGORITHMS];
+    float finalMeanSoc[CHARGE_SIM_ALGORITHMS];
+    float peakCellVoltage[CHARGE_SIM_ALGORITHMS];
+    uint8_t overvoltageTrip[CHARGE_SIM_ALGORITHMS];    // A cell went above MAX_CELL_VOLTAGE
+} ChargeSimulation;
+
+static PackSnapshot snap;
+
+static void chargerStatus(uint8_t flags) {
+    CanRxFrame frame = {0};
+
+    frame.header.DLC = 8;
+    frame.data[4] = flags;
+    chargeControllerHandleStatus(&frame);
+}
+
+// One control period with a status broadcast in it
+static void period(uint8_t flags) {
+    hostTickCount += pdMS_TO_TICKS(CHARGE_CONTROL_PERIOD_MS);
+    chargerStatus(flags);
+    chargeControllerService(&snap, hostTickCount);
+}
+
+static void unplug(void) {
+    hostTickCount += pdMS_TO_TICKS(CHARGER_TIMEOUT_MS);
+    chargeControllerService(&snap, hostTickCount);
+    CHECK(chargeControllerGetState() == CHARGE_STATE_IDLE);
+}
+
+static uint8_t isCharging(void) {
+    return chargeControllerGetState() == CHARGE_STATE_CHARGING && chargeControllerGetCommand() > 0.0f;
+}
+
+// A transient flag holds the request at zero and the session resumes once it clears
+static void testPause(uint8_t flag) {
+    period(0);
+    CHECK(isCharging());
+    for (uint8_t i = 0; i < 4; i++) {
+        period(flag);
+        CHECK(chargeControllerGetState() == CHARGE_STATE_CHARGING);
+        CHECK(chargeControllerGetCommand() == 0.0f);
+    }
+    period(0);
+    CHECK(isCharging());
+}
+
+// A fault flag ends the session, even once it clears, until the charger is unplugged
+static void testFault(uint8_t flag) {
+    period(0);
+    CHECK(isCharging());
+    period(flag);
+    CHECK(chargeControllerGetState() == CHARGE_STATE_FAULT);
+    CHECK(chargeControllerGetCommand() == 0.0f);
+    period(0);
+    CHECK(chargeControllerGetState() == CHARGE_STATE_FAULT);
+    unplug();
+}
+
+// Charges a simulated pack from 20 % with cell-to-cell spread in SoC, capacity and DCIR,
+// plus the EKF's RC polarization. The baseline is a charger doing CC/CV on pack voltage at
+// PACK_NUM_CELLS x CHARGE_CV_CELL_VOLTAGE, with the BMS only able to open the path.
+static void simulate(ChargeSimulation *result) {
+    static float soc[PACK_NUM_CELLS];
+    static float capacityAs[PACK_NUM_CELLS];
+    static float resistance[PACK_NUM_CELLS];
+    static float polarization[PACK_NUM_CELLS];
+    arm_pid_instance_f32 simPid;
+    float rcDecay = expf(-CHARGE_SIM_STEP_S / (SOC_EKF_R1_OHM * SOC_EKF_C1_FARAD));
+    float chargerDecay = expf(-CHARGE_SIM_STEP_S / CHARGE_SIM_CHARGER_TAU_S);
+    uint32_t stepsPerControl = (uint32_t)(CHARGE_CONTROL_PERIOD_MS / 1000.0f / CHARGE_SIM_STEP_S);
+    float totalResistance = 0.0f;
+
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        resistance[i] = CHARGE_SIM_R0_OHM * (1.0f + 0.1f * (float)((i * 5U) % 3U) - 0.1f);
+        totalResistance += resistance[i];
+    }
+
+    for (uint8_t algorithm = 0; algorithm < CHARGE_SIM_ALGORITHMS; algorithm++) {
+        float current = 0.0f;
+        float request = 0.0f;
+        float lowSeconds = 0.0f;
+        float socSum = 0.0f;
+        float minSoc = 100.0f;
+        uint32_t step = 0;
+
+        for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+            capacityAs[i] = COULOMB_CAPACITY_MAH * 3.6f * (1.0f - 0.005f * (float)((i * 13U) % 7U));
+            soc[i] = 20.0f + 8.0f * (float)((i * 37U) % 53U) / 52.0f;
+            polarization[i] = 0.0f;
+        }
+        simPid.Kp = CHARGE_PID_KP;
+        simPid.Ki = CHARGE_PID_KI * (CHARGE_CONTROL_PERIOD_MS / 1000.0f);
+        simPid.Kd = CHARGE_PID_KD / (CHARGE_CONTROL_PERIOD_MS / 1000.0f);
+        arm_pid_init_f32(&simPid, 1);
+        result->completeSeconds[algorithm] = UINT32_MAX;
+        result->peakCellVoltage[algorithm] = 0.0f;
+        result->overvoltageTrip[algorithm] = 0;
+
+        for (float t = 0.0f; t < CHARGE_SIM_LIMIT_S; t += CHARGE_SIM_STEP_S, step++) {
+            float maxVoltage = 0.0f;
+            float packVoltage = 0.0f;
+
+            for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+                float voltage = socToOcv(soc[i], NULL) + resistance[i] * current + polarization[i];
+                packVoltage += voltage;
+                if (voltage > maxVoltage) {
+                    maxVoltage = voltage;
+                }
+            }
+            if (maxVoltage > result->peakCellVoltage[algorithm]) {
+                result->peakCellVoltage[algorithm] = maxVoltage;
+            }
+            if (maxVoltage > MAX_CELL_VOLTAGE) {
+                result->overvoltageTrip[algorithm] = 1;   // The safety stage would open the path here
+                break;
+            }
+
+            if (step % stepsPerControl == 0) {
+                if (algorithm == CHARGE_SIM_BASELINE) {
+                    // Pack-voltage CV: the charger only sees the sum, never the highest cell
+                    float excess = packVoltage - PACK_NUM_CELLS * CHARGE_CV_CELL_VOLTAGE;
+                    request = (excess < 0.0f) ? CHARGE_MAX_CURRENT_A : fmaxf(0.0f, current - excess / totalResistance);
+                } else {
+                    request = chargeControllerControlStep(&simPid, maxVoltage, CHARGE_MAX_CURRENT_A);
+                }
+                request = roundf(request / CHARGE_SIM_CURRENT_LSB_A) * CHARGE_SIM_CURRENT_LSB_A;
+                lowSeconds = (request < CHARGE_TERMINATION_A) ? lowSeconds + CHARGE_CONTROL_PERIOD_MS / 1000.0f : 0.0f;
+                if (lowSeconds * 1000.0f >= CHARGE_TERMINATION_MS) {
+                    result->completeSeconds[algorithm] = (uint32_t)t;
+                    break;
+                }
+            }
+
+            current = request + (current - request) * chargerDecay;
+            for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+                soc[i] += current * CHARGE_SIM_STEP_S / capacityAs[i] * 100.0f;
+                polarization[i] = rcDecay * polarization[i] + SOC_EKF_R1_OHM * (1.0f - rcDecay) * current;
+            }
+        }
+
+        for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+            socSum += soc[i];
+            if (soc[i] < minSoc) {
+                minSoc = soc[i];
+            }
+        }
+        result->finalMinSoc[algorithm] = minSoc;
+        result->finalMeanSoc[algorithm] = socSum / PACK_NUM_CELLS;
+    }
+}
+
+static void testSimulation(void) {
+    static const char *const names[CHARGE_SIM_ALGORITHMS] = { "pack CC/CV", "cell loop" };
+    ChargeSimulation sim;
+
+    simulate(&sim);
+    for (uint8_t i = 0; i < CHARGE_SIM_ALGORITHMS; i++) {
+        printf("%-10s: complete %6.0f s, min SoC %5.1f %%, mean SoC %5.1f %%, peak %.3f V%s\n", names[i],
+               sim.completeSeconds[i] == UINT32_MAX ? -1.0 : (double)sim.completeSeconds[i],
+               (double)sim.finalMinSoc[i], (double)sim.finalMeanSoc[i], (double)sim.peakCellVoltage[i],
+               sim.overvoltageTrip[i] ? ", overvoltage trip" : "");
+    }
+
+    // The cell loop finishes without tripping and never lets the highest cell past its target
+    CHECK(sim.completeSeconds[CHARGE_SIM_CONTROLLER] != UINT32_MAX);
+    CHECK(!sim.overvoltageTrip[CHARGE_SIM_CONTROLLER]);
+    CHECK(sim.peakCellVoltage[CHARGE_SIM_CONTROLLER] < CHARGE_CV_CELL_VOLTAGE + 0.01f);
+    CHECK(sim.peakCellVoltage[CHARGE_SIM_CONTROLLER] < sim.peakCellVoltage[CHARGE_SIM_BASELINE]);
+    CHECK(sim.finalMinSoc[CHARGE_SIM_CONTROLLER] > 85.0f);
+
+    // Pack voltage alone lets the highest cell run into the trip
+    CHECK(sim.overvoltageTrip[CHARGE_SIM_BASELINE]);
+}
+
+int main(void) {
+    hostRtosReset();
+    chargeControllerInit();
+    snap.faults.state = BMS_STATE_NORMAL;
+    snap.faults.disabledPaths = FAULT_PATH_NONE;
+    snap.powerLimits.chargeContinuous = 2.0f * CHARGE_MAX_CURRENT_A;
+    snap.pack.voltageStats.max = 3.9f;
+
+    testPause(CHARGER_FLAG_COMMS);
+    testPause(CHARGER_FLAG_INPUT);
+    testPause(CHARGER_FLAG_COMMS | CHARGER_FLAG_INPUT);
+    testFault(CHARGER_FLAG_HARDWARE);
+    testFault(CHARGER_FLAG_TEMPERATURE);
+    testFault(CHARGER_FLAG_BATTERY);
+    testFault(CHARGER_FLAG_BATTERY | CHARGER_FLAG_COMMS);
+
+    // A pause while the fault manager monitors is not a fault either
+    period(0);
+    snap.faults.state = BMS_STATE_MONITORING;
+    snap.faults.disabledPaths = FAULT_PATH_BOTH;
+    period(CHARGER_FLAG_COMMS);
+    CHECK(chargeControllerGetState() == CHARGE_STATE_CHARGING && chargeControllerGetCommand() == 0.0f);
+    snap.faults.state = BMS_STATE_CHARGING;
+    snap.faults.disabledPaths = FAULT_PATH_NONE;
+    period(0);
+    CHECK(isCharging());
+
+    testSimulation();
+    return hostTestReport("testChargeController");
+}
@@ -0,0 +1,154 @@
+// checksum: the slice-by-4 PEC15, table CRC-8 and CRC-unit CRC-32 against the published
+// check values and against bit-at-a-time references written from the specifications, at
+// every length and alignment up to 300 bytes. Reports each against its reference over 256 bytes.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "checksum.h"
+#include "cycleCounter.h"
+#include <string.h>
+
+#define MAX_LENGTH      300U
+#define BENCHMARK_BYTES 256U
+
+static uint8_t pattern[MAX_LENGTH + 3U];
+
+// The LTC681x datasheet form: a 15-bit register seeded with 16, the result shifted up one bit
+static uint16_t referencePec15(const uint8_t *data, uint32_t length) {
+    uint16_t remainder = 16;
+
+    for (uint32_t i = 0; i < length; i++) {
+        remainder ^= (uint16_t)(data[i] << 7);
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            remainder = (remainder & 0x4000U) ? (uint16_t)((remainder << 1) ^ 0x4599U) : (uint16_t)(remainder << 1);
+            remainder &= 0x7FFFU;
+        }
+    }
+    return (uint16_t)(remainder << 1);
+}
+
+static uint8_t referenceCrc8(const uint8_t *data, uint32_t length) {
+    uint8_t crc = 0xFF;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80U) ? (uint8_t)((crc << 1) ^ 0x1DU) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc ^ 0xFF;
+}
+
+static uint32_t referenceCrc32(const uint8_t *data, uint32_t length) {
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000U) ? (crc << 1) ^ 0x04C11DB7U : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t reference(ChecksumType type, const uint8_t *data, uint32_t length) {
+    switch (type) {
+    case CHECKSUM_PEC15:
+        return referencePec15(data, length);
+    case CHECKSUM_CRC8:
+        return referenceCrc8(data, length);
+    default:
+        return referenceCrc32(data, length);
+    }
+}
+
+static void testCheckValues(void) {
+    const uint8_t *check = (const uint8_t *)"123456789";
+    const uint8_t wrcfga[2] = { 0x00, 0x01 };
+    const uint8_t rdcva[2] = { 0x00, 0x04 };
+
+    // Command PECs from the LTC681x datasheet
+    CHECK(checksumPec15(wrcfga, 2) == 0x3D6EU);
+    CHECK(checksumPec15(rdcva, 2) == 0x07C2U);
+    CHECK(checksumPec15(check, 0) == 0x0020U);
+
+    // The catalogue check values for CRC-8/SAE-J1850 and CRC-32/MPEG-2
+    CHECK(checksumCrc8(check, 9) == 0x4BU);
+    CHECK(checksumCrc32(check, 9) == 0x0376E6E7U);
+    CHECK(checksumCrc32(check, 8) == referenceCrc32(check, 8));
+
+    CHECK(checksumCompute(CHECKSUM_PEC15, wrcfga, 2) == 0x3D6EU);
+    CHECK(checksumCompute(CHECKSUM_CRC8, check, 9) == 0x4BU);
+    CHECK(checksumCompute(CHECKSUM_CRC32, check, 9) == 0x0376E6E7U);
+    CHECK(checksumCompute(CHECKSUM_NUM_TYPES, check, 9) == 0U);
+}
+
+// Each length from every start alignment, so the slices, the PEC tail and the CRC-32 bytes the
+// word-wide unit cannot take all meet every remainder
+static void testAgainstReferences(void) {
+    uint32_t mismatches[CHECKSUM_NUM_TYPES] = { 0 };
+
+    for (uint32_t offset = 0; offset < 4U; offset++) {
+        for (uint32_t length = 0; length <= MAX_LENGTH; length++) {
+            const uint8_t *data = &pattern[offset];
+
+            mismatches[CHECKSUM_PEC15] += checksumPec15(data, length) != referencePec15(data, length);
+            mismatches[CHECKSUM_CRC8] += checksumCrc8(data, length) != referenceCrc8(data, length);
+            mismatches[CHECKSUM_CRC32] += checksumCrc32(data, length) != referenceCrc32(data, length);
+        }
+    }
+    for (uint8_t type = 0; type < CHECKSUM_NUM_TYPES; type++) {
+        CHECK(mismatches[type] == 0);
+    }
+}
+
+// A single flipped bit anywhere in an AFE register group changes its PEC
+static void testBitFlips(void) {
+    uint8_t group[6];
+    uint32_t missed = 0;
+
+    memcpy(group, pattern, sizeof(group));
+    uint16_t pec = checksumPec15(group, sizeof(group));
+    for (uint32_t bit = 0; bit < sizeof(group) * 8U; bit++) {
+        group[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+        missed += checksumPec15(group, sizeof(group)) == pec;
+        group[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+    }
+    CHECK(missed == 0);
+}
+
+// Table-driven or hardware variant against the bit-at-a-time reference over the same bytes
+static void reportBenchmark(void) {
+    static const char *const names[CHECKSUM_NUM_TYPES] = { "PEC15", "CRC-8", "CRC-32" };
+    volatile uint32_t sink;
+
+    for (uint8_t type = 0; type < CHECKSUM_NUM_TYPES; type++) {
+        uint32_t start = cycleCounterNow();
+        sink = checksumCompute((ChecksumType)type, pattern, BENCHMARK_BYTES);
+        uint32_t cycles = cycleCounterNow() - start;
+
+        start = cycleCounterNow();
+        sink = reference((ChecksumType)type, pattern, BENCHMARK_BYTES);
+        uint32_t referenceCycles = cycleCounterNow() - start;
+
+        printf("%-6s over %u bytes: %u cycles, reference %u (host clock)\n", names[type],
+               (unsigned)BENCHMARK_BYTES, (unsigned)cycles, (unsigned)referenceCycles);
+    }
+    (void)sink;
+}
+
+int main(void) {
+    uint32_t seed = 0xC0FFEEU;
+
+    hostRtosReset();
+    checksumInit();
+    for (uint32_t i = 0; i < sizeof(pattern); i++) {
+        seed = seed * 1664525U + 1013904223U;
+        pattern[i] = (uint8_t)(seed >> 24);
+    }
+
+    testCheckValues();
+    testAgainstReferences();
+    testBitFlips();
+    reportBenchmark();
+    return hostTestReport("testChecksum");
+}
@@ -0,0 +1,78 @@
+// controlCharging: each path follows its own faults and the SoC band, so a charge-side fault
+// or a full pack never leaves discharge cut
+#include "hostTest.h"
+#include "hostStub.h"
+#include "batteryManagement.h"
+#include "faultManager.h"
+
+static uint8_t charging(void) {
+    return hostGpioOutput(Charge_Control_Port, Charge_Control_Pin) == GPIO_PIN_SET;
+}
+
+static uint8_t discharging(void) {
+    return hostGpioOutput(Discharge_Control_Port, Discharge_Control_Pin) == GPIO_PIN_SET;
+}
+
+static void evaluate(uint32_t updates) {
+    for (uint32_t i = 0; i < updates; i++) {
+        faultManagerEvaluate(&batteryPack);
+    }
+}
+
+int main(void) {
+    float voltages[NUM_CELLS];
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t lost[PACK_NUM_TEMPERATURES] = {0};
+
+    for (uint16_t i = 0; i < NUM_CELLS; i++) {
+        voltages[i] = 3.7f;
+    }
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        temperatures[i] = 25.0f;
+    }
+    hostRtosReset();
+    batteryPackInit();
+    chargeControlInit();
+    updateBatteryPackVoltages(voltages, 0);
+    updateBatteryPackTemperatures(temperatures, lost);
+    evaluate(200);
+    CHECK(faultManagerGetDisabledPaths() == FAULT_PATH_NONE);
+
+    // SoC unknown: the paths stay as init left them, disabled
+    CHECK(!charging() && !discharging());
+    controlCharging(-1.0f);
+    CHECK(!charging() && !discharging());
+
+    // Empty: charge only; mid band: discharge comes back, charge is held; full: discharge only
+    controlCharging(10.0f);
+    CHECK(charging() && !discharging());
+    controlCharging(50.0f);
+    CHECK(charging() && discharging());
+    controlCharging(90.0f);
+    CHECK(!charging() && discharging());
+    controlCharging(50.0f);
+    CHECK(!charging() && discharging());
+    controlCharging(10.0f);
+    controlCharging(20.0f);
+    CHECK(charging() && discharging());
+
+    // A charge-side fault cuts charge only; discharge still follows the SoC
+    batteryPack.current = -2.0f * MAX_CHARGE_CURRENT;
+    evaluate(10);
+    CHECK(faultManagerGetDisabledPaths() == FAULT_PATH_CHARGE);
+    controlCharging(10.0f);
+    CHECK(!charging() && !discharging());
+    controlCharging(50.0f);
+    CHECK(!charging() && discharging());
+
+    // Once it clears, charge comes back with the band
+    batteryPack.current = 0.0f;
+    evaluate(200);
+    CHECK(faultManagerGetDisabledPaths() == FAULT_PATH_NONE);
+    controlCharging(10.0f);
+    CHECK(charging() && !discharging());
+    controlCharging(50.0f);
+    CHECK(charging() && discharging());
+
+    return hostTestReport("testControlCharging");
+}
@@ -0,0 +1,146 @@
+// coulombCounter replaying a current trace through the ADC codes a bidirectional shunt
+// amplifier would produce, against the exact charge of the trace. The trace is a CSV of
+// piecewise-constant segments (duration_s,current_a); traces/driveCycle.csv unless one is given.
+// Also checks the rest period that gates the OCV re-anchor. Reports the SoC error and the cycles
+// each block costs.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "coulombCounter.h"
+#include "signalPath.h"
+#include "samplingScheduler.h"
+#include <math.h>
+
+#define SWEEP_RATE_HZ      SAMPLING_DEFAULT_RATE_HZ
+#define SWEEPS_PER_BLOCK   (SAMPLING_DEFAULT_RATE_HZ / SAMPLING_TARGET_BLOCK_RATE_HZ)
+#define START_SOC          80.0f
+#define FULL_SCALE_MILLI   200000    // -100 A .. +100 A over the ADC range
+#define NOISE_CODES        3.0f      // Peak-to-peak sensor noise, which also dithers the quantization
+#define MAX_SOC_ERROR      0.05f     // Percent
+
+static uint16_t samples[ADC_ACQ_NUM_CHANNELS * SWEEPS_PER_BLOCK];
+static uint32_t noiseState = 12345U;
+
+// Uniform, in codes
+static float noise(void) {
+    noiseState = noiseState * 1664525U + 1013904223U;
+    return ((float)(noiseState >> 8) / 16777216.0f - 0.5f) * NOISE_CODES;
+}
+
+// What the shunt channels read at this current
+static void fillBlock(float current) {
+    float code = (current * 1000.0f + FULL_SCALE_MILLI / 2) * 4096.0f / FULL_SCALE_MILLI;
+
+    for (uint32_t sweep = 0; sweep < SWEEPS_PER_BLOCK; sweep++) {
+        for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+            int32_t sample = (int32_t)lroundf(code + noise());
+
+            samples[sweep * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_CURRENT_CHANNEL(rank)] =
+                (uint16_t)(sample < 0 ? 0 : (sample > 4095 ? 4095 : sample));
+        }
+    }
+}
+
+static uint32_t ocvCorrections(void) {
+    CoulombCounterStats stats;
+
+    coulombCounterGetStats(&stats);
+    return stats.ocvCorrections;
+}
+
+// The OCV re-anchor waits for a full rest period counted in samples: a single 10 A sample near
+// the end of a block restarts it from the samples after that one
+static void testRestPeriod(void) {
+    AdcBlock block = { samples, 0, 0, SWEEPS_PER_BLOCK };
+    uint32_t restBlocks = COULOMB_REST_TIME_S * SAMPLING_TARGET_BLOCK_RATE_HZ;
+    uint32_t corrections;
+
+    coulombCounterInit(SWEEP_RATE_HZ);
+    coulombCounterApplyOcv(socToOcv(START_SOC, NULL));
+    corrections = ocvCorrections();
+
+    fillBlock(0.0f);
+    for (uint32_t i = 0; i < restBlocks - 1U; i++) {
+        coulombCounterIntegrateBlock(&block);
+    }
+    samples[(SWEEPS_PER_BLOCK - 2U) * ADC_ACQ_NUM_CHANNELS + ADC_ACQ_CURRENT_CHANNEL(0)] =
+        (uint16_t)((10000 + FULL_SCALE_MILLI / 2) * 4096 / FULL_SCALE_MILLI);
+    coulombCounterIntegrateBlock(&block);
+    coulombCounterApplyOcv(socToOcv(START_SOC, NULL));
+    CHECK(ocvCorrections() == corrections);
+
+    // Two sweeps less one sample were already at rest; one more block completes the period
+    fillBlock(0.0f);
+    for (uint32_t i = 0; i < restBlocks - 1U; i++) {
+        coulombCounterIntegrateBlock(&block);
+    }
+    coulombCounterApplyOcv(socToOcv(START_SOC, NULL));
+    CHECK(ocvCorrections() == corrections);
+    coulombCounterIntegrateBlock(&block);
+    coulombCounterApplyOcv(socToOcv(START_SOC, NULL));
+    CHECK(ocvCorrections() == corrections + 1U);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "traces/driveCycle.csv";
+    FILE *trace = fopen(path, "r");
+    AdcBlock block = { samples, 0, 0, SWEEPS_PER_BLOCK };
+    CoulombCounterStats stats;
+    char line[128];
+    double trueAmpSeconds = 0.0;
+    float worstError = 0.0f;
+    float soc = 0.0f;
+    float trueSoc = START_SOC;
+    uint32_t blocks = 0;
+    uint32_t segments = 0;
+
+    hostRtosReset();
+    signalPathInit();
+    for (uint8_t rank = 0; rank < ADC_ACQ_NUM_RANKS; rank++) {
+        signalPathSetCalibration(ADC_ACQ_CURRENT_CHANNEL(rank), FULL_SCALE_MILLI, -FULL_SCALE_MILLI / 2);
+    }
+    coulombCounterInit(SWEEP_RATE_HZ);
+    coulombCounterApplyOcv(socToOcv(START_SOC, NULL));
+    CHECK(fabsf(coulombCounterGetSoc() - START_SOC) < 0.01f);
+
+    CHECK(trace != NULL);
+    if (trace == NULL) {
+        printf("  cannot open %s\n", path);
+        return hostTestReport("testCoulombCounter");
+    }
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        float seconds;
+        float current;
+
+        if (line[0] == '#' || sscanf(line, "%f,%f", &seconds, &current) != 2) {
+            continue;
+        }
+        uint32_t segmentBlocks = (uint32_t)lroundf(seconds * SAMPLING_TARGET_BLOCK_RATE_HZ);
+
+        for (uint32_t i = 0; i < segmentBlocks; i++, blocks++) {
+            fillBlock(current);
+            coulombCounterIntegrateBlock(&block);
+            trueAmpSeconds += (double)current / SAMPLING_TARGET_BLOCK_RATE_HZ;
+
+            trueSoc = START_SOC - (float)(trueAmpSeconds / (COULOMB_CAPACITY_MAH * 3.6) * 100.0);
+            soc = coulombCounterGetSoc();
+            if (fabsf(soc - trueSoc) > worstError) {
+                worstError = fabsf(soc - trueSoc);
+            }
+        }
+        segments++;
+    }
+    fclose(trace);
+    coulombCounterGetStats(&stats);
+
+    CHECK(segments > 0);
+    CHECK(stats.samplesIntegrated == blocks * SWEEPS_PER_BLOCK * ADC_ACQ_NUM_RANKS);
+    CHECK(worstError < MAX_SOC_ERROR);
+    printf("%s: %u segments, %.0f s, SoC %.2f %% (true %.2f %%), worst error %.3f %%\n", path,
+           (unsigned)segments, (double)blocks / SAMPLING_TARGET_BLOCK_RATE_HZ, (double)soc, (double)trueSoc,
+           (double)worstError);
+    printf("%u samples per block: %u cycles for the last one (host clock)\n",
+           (unsigned)(SWEEPS_PER_BLOCK * ADC_ACQ_NUM_RANKS), (unsigned)stats.lastUpdateCycles);
+
+    testRestPeriod();
+    return hostTestReport("testCoulombCounter");
+}
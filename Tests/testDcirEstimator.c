@@ -0,0 +1,143 @@
+// dcirEstimator: the per-cell RLS fit on cells with known OCV and resistance under a pulsed
+// load with measurement noise. Each cell must converge to its own resistance, a steady current
+// must not move the fit, the power limits must follow from the fitted cells, and pairing a
+// voltage with a current from another sampling window must show up as a biased fit.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "dcirEstimator.h"
+
+#define STEPS          1000U     // 10 s of 10 ms blocks
+#define NOISE_V        0.001f    // Peak-to-peak
+#define MAX_R_ERROR    0.05f     // Fraction of the true resistance
+
+static float trueOcv[NUM_CELLS];
+static float trueResistance[NUM_CELLS];
+static float voltages[NUM_CELLS];
+static float currents[NUM_CELLS];
+static uint32_t noiseState = 7U;
+
+static float uniform(void) {
+    noiseState = noiseState * 1664525U + 1013904223U;
+    return (float)(noiseState >> 8) / 16777216.0f;
+}
+
+// Every cell sees the same string current; each voltage is taken with the current of its own window
+static void measure(float current, float pairedCurrent) {
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        voltages[i] = trueOcv[i] - trueResistance[i] * current + (uniform() - 0.5f) * NOISE_V;
+        currents[i] = pairedCurrent;
+    }
+}
+
+// A drive-like pulse train between -10 A (regen) and 30 A
+static float pulse(uint32_t step) {
+    return step % 4U == 0 ? 0.0f : -10.0f + 40.0f * uniform();
+}
+
+static float worstError(void) {
+    float resistances[NUM_CELLS];
+    float worst = 0.0f;
+
+    dcirEstimatorGetResistances(resistances);
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        float error = fabsf(resistances[i] - trueResistance[i]) / trueResistance[i];
+        worst = error > worst ? error : worst;
+    }
+    return worst;
+}
+
+static void testConvergence(void) {
+    DcirEstimatorStats stats;
+    float resistances[NUM_CELLS];
+
+    dcirEstimatorInit();
+    dcirEstimatorGetResistances(resistances);
+    CHECK(resistances[0] == DCIR_INITIAL_OHM);
+
+    for (uint32_t step = 0; step < STEPS; step++) {
+        float current = pulse(step);
+        measure(current, current);
+        dcirEstimatorUpdate(voltages, currents);
+    }
+    printf("aligned pairs: worst resistance error %.2f %%\n", (double)(worstError() * 100.0f));
+    CHECK(worstError() < MAX_R_ERROR);
+
+    // Holding the current adds nothing about R: once it settles every cell is skipped and
+    // nothing moves
+    measure(12.0f, 12.0f);
+    dcirEstimatorUpdate(voltages, currents);
+    dcirEstimatorGetStats(&stats);
+    uint32_t skipped = stats.skipped;
+    dcirEstimatorGetResistances(resistances);
+    for (uint32_t step = 0; step < 50U; step++) {
+        measure(12.5f, 12.5f);
+        dcirEstimatorUpdate(voltages, currents);
+        measure(12.0f, 12.0f);
+        dcirEstimatorUpdate(voltages, currents);
+    }
+    dcirEstimatorGetStats(&stats);
+    CHECK(stats.skipped == skipped + 100U * NUM_CELLS);
+    CHECK(stats.updates + stats.skipped == (STEPS + 101U) * NUM_CELLS);
+
+    float held[NUM_CELLS];
+    dcirEstimatorGetResistances(held);
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        CHECK(held[i] == resistances[i]);
+    }
+}
+
+// The limits from the fitted cells match the ones the true cells give
+static void testPowerLimits(void) {
+    DcirPowerLimits limits;
+    float discharge = INFINITY;
+    float charge = INFINITY;
+    float dischargePower = 0.0f;
+
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        discharge = fminf(discharge, (trueOcv[i] - MIN_CELL_VOLTAGE) / trueResistance[i]);
+        charge = fminf(charge, (MAX_CELL_VOLTAGE - trueOcv[i]) / trueResistance[i]);
+    }
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        dischargePower += (trueOcv[i] - trueResistance[i] * discharge) * discharge;
+    }
+
+    dcirEstimatorGetPowerLimits(&limits);
+    CHECK_NEAR(limits.dischargeCurrent, discharge, discharge * MAX_R_ERROR);
+    CHECK_NEAR(limits.chargeCurrent, charge, charge * MAX_R_ERROR);
+    CHECK_NEAR(limits.dischargePower, dischargePower, dischargePower * MAX_R_ERROR);
+    CHECK(limits.chargePower > 0.0f);
+}
+
+// The current one window late: the voltage step and the current step no longer line up
+static void testMisaligned(void) {
+    float previous = 0.0f;
+
+    dcirEstimatorInit();
+    for (uint32_t step = 0; step < STEPS; step++) {
+        float current = pulse(step);
+        measure(current, previous);
+        dcirEstimatorUpdate(voltages, currents);
+        previous = current;
+    }
+    printf("current one window late: worst resistance error %.2f %%\n", (double)(worstError() * 100.0f));
+    CHECK(worstError() > 2.0f * MAX_R_ERROR);
+}
+
+int main(void) {
+    DcirEstimatorStats stats;
+
+    hostRtosReset();
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        trueOcv[i] = 3.6f + 0.02f * (float)(i % 5U);
+        trueResistance[i] = DCIR_INITIAL_OHM * (0.7f + 0.15f * (float)((i * 3U) % 5U));
+    }
+
+    testConvergence();
+    testPowerLimits();
+    testMisaligned();
+
+    dcirEstimatorGetStats(&stats);
+    printf("%u cells: %u cycles for the slowest update (host clock)\n", (unsigned)NUM_CELLS,
+           (unsigned)stats.worstUpdateCycles);
+    return hostTestReport("testDcirEstimator");
+}
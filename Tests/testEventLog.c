@@ -0,0 +1,435 @@
+// eventLog on the stubbed internal flash: power cut at program and erase steps of a run that
+// rotates through every sector, and erases held back until the caller allows them. The log is
+// read back here with its own parser of the on-flash format. The store is also run on a RAM
+// emulator with small sectors, cut at every step. Then a CAN readout held back by a slow bus.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "eventLogStore.h"
+#include "checksum.h"
+#include "canCommunication.h"
+#include "canTelemetryTable.h"
+#include <string.h>
+
+#define MAGIC              0xE7E1064BU
+#define HEADER_WORDS       4U
+#define RECORD_WORDS       5U
+#define RECORDS_PER_SECTOR ((EVENT_LOG_SECTOR_BYTES - 4U * HEADER_WORDS) / (4U * RECORD_WORDS))
+#define TEST_CODE          0x200U
+#define LAST_CODE          0x2FFU
+#define APPENDS            (2U * RECORDS_PER_SECTOR + 64U)   // Into the third sector, with an erase
+#define PER_SERVICE        8U
+#define CUT_STRIDE         61U   // Between the steps that write headers or erase
+#define READOUT_ID         0x110U
+#define READOUT_RECORDS    40U
+#define FILLER_ID          0x7F0U
+#define TX_RESERVE         (2U * TELEMETRY_MAX_FRAMES_PER_PERIOD)
+
+typedef struct {
+    uint32_t count;
+    uint32_t newestSequence;
+    uint32_t newestValue;      // Of the newest TEST_CODE record
+    uint32_t newestCode;
+    uint8_t ordered;           // Sequences strictly increase from the oldest sector on
+    uint8_t consistent;        // TEST_CODE values (append indexes) strictly increase too
+    uint8_t foundTest;
+} LogContents;
+
+static const uint32_t *flashWords(uint8_t sector) {
+    return (const uint32_t *)(uintptr_t)(EVENT_LOG_BASE_ADDRESS + sector * EVENT_LOG_SECTOR_BYTES);
+}
+
+static void readLog(LogContents *log) {
+    uint8_t order[EVENT_LOG_SECTORS];
+    uint32_t sequences[EVENT_LOG_SECTORS];
+    uint8_t valid = 0;
+
+    memset(log, 0, sizeof(*log));
+    log->ordered = 1;
+    log->consistent = 1;
+
+    for (uint8_t sector = 0; sector < EVENT_LOG_SECTORS; sector++) {
+        const uint32_t *header = flashWords(sector);
+        if (header[0] != MAGIC || checksumCrc32((const uint8_t *)header, 12) != header[3]) {
+            continue;
+        }
+        uint8_t position = valid++;
+        while (position > 0 && sequences[position - 1U] > header[1]) {
+            order[position] = order[position - 1U];
+            sequences[position] = sequences[position - 1U];
+            position--;
+        }
+        order[position] = sector;
+        sequences[position] = header[1];
+    }
+
+    for (uint8_t i = 0; i < valid; i++) {
+        const uint32_t *words = flashWords(order[i]) + HEADER_WORDS;
+
+        for (uint32_t slot = 0; slot < RECORDS_PER_SECTOR; slot++, words += RECORD_WORDS) {
+            if (checksumCrc32((const uint8_t *)words, 16) != words[4]) {
+                continue;   // Erased or torn
+            }
+            if (log->count > 0 && words[0] <= log->newestSequence) {
+                log->ordered = 0;
+            }
+            if (words[2] == TEST_CODE) {
+                if (log->foundTest && words[3] <= log->newestValue) {
+                    log->consistent = 0;
+                }
+                log->newestValue = words[3];
+                log->foundTest = 1;
+            }
+            log->count++;
+            log->newestSequence = words[0];
+            log->newestCode = words[2];
+        }
+    }
+}
+
+static void reboot(void) {
+    hostFlashCutAt = HOST_FLASH_NO_CUT;
+    hostFlashPowerLost = 0;
+    eventLogInit();
+}
+
+// Boot from blank flash and append APPENDS events. Returns how many were committed before the
+// cut, and marks the operation ranges that did more than program records.
+static uint32_t runScript(uint32_t cut, uint8_t *interesting, uint32_t maxOperations) {
+    uint32_t committed = 0;
+
+    hostFlashMap();
+    hostFlashCutAt = cut;
+    eventLogInit();
+    for (uint32_t i = 0; i < hostFlashOperations && interesting != NULL && i < maxOperations; i++) {
+        interesting[i] = 1;
+    }
+
+    for (uint32_t i = 0; i < APPENDS && !hostFlashPowerLost; i++) {
+        eventLogAppend(TEST_CODE, i);
+        if ((i + 1U) % PER_SERVICE != 0 && i + 1U != APPENDS) {
+            continue;
+        }
+        EventLogStats before;
+        EventLogStats after;
+        uint32_t start = hostFlashOperations;
+
+        eventLogGetStats(&before);
+        eventLogService(1);
+        eventLogGetStats(&after);
+        if (!hostFlashPowerLost) {
+            committed = i + 1U;
+        }
+        if (interesting != NULL &&
+            hostFlashOperations - start != RECORD_WORDS * (after.committed - before.committed)) {
+            for (uint32_t op = start; op < hostFlashOperations && op < maxOperations; op++) {
+                interesting[op] = 1;
+            }
+        }
+    }
+    return committed;
+}
+
+static void testPowerLoss(void) {
+    static uint8_t interesting[RECORD_WORDS * APPENDS + 256U];
+    LogContents log;
+    uint32_t cuts = 0;
+    uint32_t failures = 0;
+
+    runScript(HOST_FLASH_NO_CUT, interesting, sizeof(interesting));
+    uint32_t operations = hostFlashOperations;
+    readLog(&log);
+    CHECK(log.ordered && log.consistent);
+    CHECK(log.foundTest && log.newestValue == APPENDS - 1U);
+    CHECK(hostFlashErases > 0);
+    CHECK(operations <= sizeof(interesting));
+
+    for (uint32_t cut = 0; cut < operations; cut++) {
+        if (!interesting[cut] && cut % CUT_STRIDE != 0) {
+            continue;
+        }
+        uint32_t committed = runScript(cut, NULL, 0);
+        uint8_t ok;
+
+        reboot();
+        readLog(&log);
+        // Intact and in order; nothing committed lost from the newest end (the cut record may land)
+        ok = log.ordered && log.consistent;
+        if (committed > 0) {
+            ok &= log.foundTest && log.newestValue + 1U >= committed && log.newestValue <= committed + PER_SERVICE;
+        }
+
+        // And the log keeps going right after what survived: the reboot's record, then ours
+        uint32_t expected = log.count > 0 ? log.newestSequence + 2U : 1U;
+        eventLogAppend(LAST_CODE, 0);
+        eventLogService(1);
+        readLog(&log);
+        ok &= log.ordered && log.newestCode == LAST_CODE && log.newestSequence == expected;
+
+        if (!ok) {
+            failures++;
+            printf("  cut at operation %u of %u failed (%u committed)\n", (unsigned)cut, (unsigned)operations,
+                   (unsigned)committed);
+        }
+        cuts++;
+    }
+    CHECK(failures == 0);
+    printf("%u of %u flash operations cut, %u failed\n", (unsigned)cuts, (unsigned)operations, (unsigned)failures);
+}
+
+// With erases refused the log fills every sector, then holds commits until an erase is allowed
+static void testEraseGating(void) {
+    EventLogStats stats;
+    LogContents log;
+    uint32_t appended = 0;
+
+    hostFlashMap();
+    eventLogInit();
+    CHECK(hostFlashErases == 0);
+    while (appended < EVENT_LOG_SECTORS * RECORDS_PER_SECTOR) {
+        for (uint32_t i = 0; i < PER_SERVICE; i++) {
+            eventLogAppend(TEST_CODE, appended++);
+        }
+        eventLogService(0);
+    }
+    eventLogGetStats(&stats);
+    CHECK(hostFlashErases == 0);
+    CHECK(stats.deferred > 0);
+    CHECK(stats.dropped == 0);
+
+    eventLogService(1);
+    eventLogGetStats(&stats);
+    CHECK(hostFlashErases == 2);   // The sector rotated into, then the new spare
+    readLog(&log);
+    CHECK(log.ordered && log.consistent && log.newestValue == appended - 1U);
+}
+
+// Readout over CAN against a bus that clears only the three mailboxes between service calls.
+// The LOW queue starts one frame short of the readout's share, so the first record is split
+// across two calls. Every record must arrive whole and once, telemetry's share must stay free,
+// and the queue must never refuse a frame.
+static void testReadoutBackPressure(void) {
+    static uint8_t valueSeen[READOUT_RECORDS];
+    uint8_t filler[8] = {0};
+    uint8_t request[1] = {EVENT_LOG_READOUT_CAN};
+    CanRxFrame frame = {0};
+    CanTxQueueStats stats;
+    uint32_t firstParts = 0;
+    uint32_t secondParts = 0;
+    uint32_t endCount = UINT32_MAX;
+    uint32_t sequences = 0;     // Sum, against 0 + 1 + ... + READOUT_RECORDS
+    uint32_t peakDepth = 0;
+    uint32_t calls = 0;
+
+    hostFlashMap();
+    eventLogInit();
+    for (uint32_t i = 0; i < READOUT_RECORDS; i++) {
+        eventLogAppend(TEST_CODE, i);
+        if ((i + 1U) % PER_SERVICE == 0) {
+            eventLogService(1);
+        }
+    }
+
+    hostCanResetTx();
+    CHECK(canInit() == CAN_STATUS_OK);
+    for (uint32_t i = 0; i < 3U + CAN_TX_QUEUE_DEPTH - TX_RESERVE - 1U; i++) {
+        CHECK(canTransmitMessage(FILLER_ID, filler, 8, CAN_TX_PRIORITY_LOW) == CAN_STATUS_OK);
+    }
+
+    frame.header.DLC = 1;
+    memcpy(frame.data, request, sizeof(request));
+    eventLogHandleReadout(&frame);
+    while (endCount == UINT32_MAX && calls++ < 1000U) {
+        eventLogService(1);
+        canGetTxQueueStats(CAN_TX_PRIORITY_LOW, &stats);
+        peakDepth = stats.depth > peakDepth ? stats.depth : peakDepth;
+
+        for (uint8_t mailbox = 0; mailbox < 3U; mailbox++) {
+            const HostCanTxFrame *sent = hostCanMailboxFrame(mailbox);
+
+            if (!hostCanMailboxBusy(mailbox)) {
+                continue;
+            }
+            if (sent->header.StdId == READOUT_ID && sent->data[0] == 0) {
+                sequences += sent->data[1] | (sent->data[2] << 8) | ((uint32_t)sent->data[3] << 16);
+                firstParts++;
+            } else if (sent->header.StdId == READOUT_ID && sent->data[0] == 1) {
+                uint32_t code = sent->data[1] | (sent->data[2] << 8);
+                uint32_t value;
+
+                memcpy(&value, &sent->data[3], 4);
+                if (code == TEST_CODE && value < READOUT_RECORDS) {
+                    valueSeen[value]++;
+                }
+                secondParts++;
+            } else if (sent->header.StdId == READOUT_ID) {
+                memcpy(&endCount, &sent->data[1], 4);
+            }
+            hostCanCompleteMailbox(&hcan1, mailbox);
+        }
+    }
+
+    // The boot record, then ours
+    CHECK(endCount == READOUT_RECORDS + 1U);
+    CHECK(firstParts == endCount && secondParts == endCount);
+    CHECK(sequences == READOUT_RECORDS * (READOUT_RECORDS + 1U) / 2U);
+    for (uint32_t i = 0; i < READOUT_RECORDS; i++) {
+        CHECK(valueSeen[i] == 1U);
+    }
+    canGetTxQueueStats(CAN_TX_PRIORITY_LOW, &stats);
+    CHECK(stats.dropped == 0);
+    CHECK(peakDepth <= CAN_TX_QUEUE_DEPTH - TX_RESERVE);
+    printf("readout: %u records in %u service calls, LOW queue peak %u of %u\n", (unsigned)endCount,
+           (unsigned)calls, (unsigned)peakDepth, (unsigned)CAN_TX_QUEUE_DEPTH);
+}
+
+// RAM flash emulator: the same store code on three small sectors, cut at every program and
+// erase step of a script that rotates through all of them
+#define RAM_SECTOR_BYTES   256U
+#define RAM_APPENDS        40U
+#define RAM_NO_CUT         UINT32_MAX
+
+static uint32_t ramFlash[EVENT_LOG_SECTORS * RAM_SECTOR_BYTES / 4U];
+static uint32_t ramOpsLeft;
+static uint8_t ramPowerLost;
+
+static uint32_t ramRead(uint32_t address) {
+    return ramFlash[address / 4U];
+}
+
+// Programming only clears bits; the cut step leaves some of them still set
+static HAL_StatusTypeDef ramProgram(uint32_t address, uint32_t word) {
+    if (ramPowerLost) {
+        return HAL_ERROR;
+    }
+    if (ramOpsLeft == 0) {
+        ramFlash[address / 4U] &= word | 0x5A5A5A5AU;
+        ramPowerLost = 1;
+        return HAL_ERROR;
+    }
+    ramOpsLeft--;
+    ramFlash[address / 4U] &= word;
+    return HAL_OK;
+}
+
+// A cut erase leaves the header and the first half of the sector as they were
+static HAL_StatusTypeDef ramErase(uint8_t sector) {
+    uint32_t *words = &ramFlash[sector * RAM_SECTOR_BYTES / 4U];
+
+    if (ramPowerLost) {
+        return HAL_ERROR;
+    }
+    if (ramOpsLeft == 0) {
+        memset(&words[RAM_SECTOR_BYTES / 8U], 0xFF, RAM_SECTOR_BYTES / 2U);
+        ramPowerLost = 1;
+        return HAL_ERROR;
+    }
+    ramOpsLeft--;
+    memset(words, 0xFF, RAM_SECTOR_BYTES);
+    return HAL_OK;
+}
+
+static const EventLogMedium ramMedium = {
+    ramRead, ramProgram, ramErase, 0, RAM_SECTOR_BYTES
+};
+
+// Boot, then append with a spare kept ready; returns the operations used and the last
+// sequence whose append completed
+static uint32_t ramScript(EventLogStore *log, uint32_t cut, uint8_t *acknowledged, uint32_t *lastSequence) {
+    uint32_t start = cut;
+
+    ramOpsLeft = cut;
+    ramPowerLost = 0;
+    *acknowledged = 0;
+    memset(log, 0, sizeof(*log));
+    log->medium = &ramMedium;
+    eventLogStoreMount(log);
+    eventLogStorePrepareSpare(log);
+
+    for (uint32_t i = 0; i < RAM_APPENDS && !ramPowerLost; i++) {
+        uint32_t sequence = log->nextSequence;
+
+        if (eventLogStoreAppend(log, i, i, ~i, 0) == HAL_OK) {
+            *acknowledged = 1;
+            *lastSequence = sequence;
+        }
+        eventLogStorePrepareSpare(log);
+    }
+    return start - ramOpsLeft;
+}
+
+// After the reboot: every record intact and in order, nothing acknowledged lost from the
+// newest end, and the log still takes a new record right after the newest one
+static uint8_t ramVerify(uint8_t acknowledged, uint32_t lastSequence) {
+    EventLogStore log;
+    EventLogCursor cursor;
+    EventRecord record;
+    uint8_t found = 0;
+    uint32_t newest = 0;
+
+    ramOpsLeft = RAM_NO_CUT;
+    ramPowerLost = 0;
+    memset(&log, 0, sizeof(log));
+    log.medium = &ramMedium;
+    eventLogStoreMount(&log);
+
+    eventLogStoreOpenCursor(&log, &cursor);
+    while (eventLogStoreReadNext(&log, &cursor, &record)) {
+        if (found && record.sequence <= newest) {
+            return 0;
+        }
+        if (record.code != record.timestamp || record.value != ~record.code) {
+            return 0;
+        }
+        newest = record.sequence;
+        found = 1;
+    }
+
+    // The cut record itself may have landed whole
+    if (acknowledged && (!found || newest < lastSequence || newest > lastSequence + 1U)) {
+        return 0;
+    }
+
+    uint32_t expected = found ? newest + 1U : 0U;
+    if (eventLogStoreAppend(&log, 7U, 7U, ~7U, 1) != HAL_OK) {
+        return 0;
+    }
+    eventLogStoreOpenCursor(&log, &cursor);
+    found = 0;
+    while (eventLogStoreReadNext(&log, &cursor, &record)) {
+        newest = record.sequence;
+        found = 1;
+    }
+    return found && newest == expected;
+}
+
+// Every cut point must keep the records intact and in order and leave the log usable
+static void testRamPowerLoss(void) {
+    EventLogStore log;
+    uint8_t acknowledged;
+    uint32_t lastSequence = 0;
+    uint32_t failures = 0;
+
+    memset(ramFlash, 0xFF, sizeof(ramFlash));
+    uint32_t steps = ramScript(&log, RAM_NO_CUT, &acknowledged, &lastSequence);
+
+    for (uint32_t cut = 0; cut < steps; cut++) {
+        memset(ramFlash, 0xFF, sizeof(ramFlash));
+        ramScript(&log, cut, &acknowledged, &lastSequence);
+        if (!ramVerify(acknowledged, lastSequence)) {
+            failures++;
+        }
+    }
+    CHECK(steps > 0 && failures == 0);
+    printf("RAM emulator: %u program and erase steps cut, %u failed\n", (unsigned)steps, (unsigned)failures);
+}
+
+int main(void) {
+    hostRtosReset();
+    checksumInit();
+
+    testRamPowerLoss();
+    testEraseGating();
+    testPowerLoss();
+    testReadoutBackPressure();
+    return hostTestReport("testEventLog");
+}
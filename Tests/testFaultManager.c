@@ -0,0 +1,283 @@
+// faultManager state machine (ReadMe 6.2): the transition function against every input class,
+// then faultManagerEvaluate from every state, every worst severity held against every current
+// direction until it settles. After each update the transition must be an edge of 6.2 and the
+// disabled paths must match the state. Then the temperature sensor-loss fault.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "batteryManagement.h"
+#include "faultManagerState.h"
+
+#define SETTLE_UPDATES 300U
+#define CLEAR_UPDATES  20U   // Past the longest clear window of a latching fault
+
+typedef enum {
+    INPUT_HEALTHY,
+    INPUT_WARNING,    // Cell imbalance
+    INPUT_MAJOR,      // Cell undervoltage, disables discharge
+    INPUT_CRITICAL,   // Overtemperature, latched
+    NUM_INPUTS
+} Input;
+
+static const char *const stateNames[BMS_NUM_STATES] = {
+    "IDLE", "MONITORING", "NORMAL", "CHARGING", "DISCHARGING", "FAULT_MODE", "SHUTDOWN"
+};
+static const char *const inputNames[NUM_INPUTS] = { "healthy", "warning", "major", "critical" };
+static const float currents[] = { -2.0f, 0.0f, 2.0f };
+static const BmsState currentStates[] = { BMS_STATE_CHARGING, BMS_STATE_NORMAL, BMS_STATE_DISCHARGING };
+
+static uint8_t isOperating(BmsState state) {
+    return state == BMS_STATE_NORMAL || state == BMS_STATE_CHARGING || state == BMS_STATE_DISCHARGING;
+}
+
+// The edges of 6.2, with a critical fault reaching SHUTDOWN and a major one FAULT_MODE from anywhere
+static uint8_t isAllowed(BmsState from, BmsState to) {
+    if (to == BMS_STATE_SHUTDOWN || to == from) {
+        return 1;
+    }
+    switch (from) {
+    case BMS_STATE_IDLE:
+        return to == BMS_STATE_MONITORING;
+    case BMS_STATE_MONITORING:
+        return isOperating(to) || to == BMS_STATE_FAULT_MODE;
+    case BMS_STATE_FAULT_MODE:
+    case BMS_STATE_SHUTDOWN:
+        return to == BMS_STATE_MONITORING || to == BMS_STATE_FAULT_MODE;
+    default:
+        return isOperating(to) || to == BMS_STATE_FAULT_MODE;
+    }
+}
+
+static void applyInput(Input input, float current) {
+    float voltages[NUM_CELLS];
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t lost[PACK_NUM_TEMPERATURES] = {0};
+
+    for (uint16_t i = 0; i < NUM_CELLS; i++) {
+        voltages[i] = 3.7f;
+    }
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        temperatures[i] = 25.0f;
+    }
+    if (input == INPUT_WARNING) {
+        voltages[0] = 3.7f - 2.0f * MAX_CELL_VOLTAGE_SPREAD;
+    } else if (input == INPUT_MAJOR) {
+        voltages[0] = MIN_CELL_VOLTAGE - 0.1f;
+    } else if (input == INPUT_CRITICAL) {
+        temperatures[0] = MAX_SAFE_TEMPERATURE + 5.0f;
+    }
+    updateBatteryPackVoltages(voltages, 0);
+    updateBatteryPackTemperatures(temperatures, lost);
+    batteryPack.current = current;
+}
+
+// One update, checked against 6.2; returns the new state
+static BmsState step(BmsState from) {
+    FaultStatus status;
+
+    faultManagerEvaluate(&batteryPack);
+    faultManagerGetStatus(&status);
+
+    CHECK(isAllowed(from, status.state));
+    if (!isAllowed(from, status.state)) {
+        printf("  %s -> %s\n", stateNames[from], stateNames[status.state]);
+    }
+    switch (status.state) {
+    case BMS_STATE_IDLE:
+    case BMS_STATE_MONITORING:
+    case BMS_STATE_SHUTDOWN:
+        CHECK(status.disabledPaths == FAULT_PATH_BOTH);
+        break;
+    case BMS_STATE_FAULT_MODE:
+        CHECK(status.disabledPaths != FAULT_PATH_NONE);
+        break;
+    default:
+        CHECK(status.disabledPaths == FAULT_PATH_NONE);
+        break;
+    }
+    return status.state;
+}
+
+static BmsState run(BmsState state, Input input, float current, uint32_t updates) {
+    applyInput(input, current);
+    for (uint32_t i = 0; i < updates; i++) {
+        state = step(state);
+    }
+    return state;
+}
+
+// From a fresh boot to the given state, checking every update on the way
+static BmsState reach(BmsState target) {
+    BmsState state = BMS_STATE_IDLE;
+    FaultStatus status;
+
+    batteryPackInit();
+    faultManagerGetStatus(&status);
+    CHECK(status.state == BMS_STATE_IDLE && status.disabledPaths == FAULT_PATH_BOTH);
+
+    switch (target) {
+    case BMS_STATE_IDLE:
+        break;
+    case BMS_STATE_MONITORING:
+        state = run(state, INPUT_HEALTHY, 0.0f, 1);
+        break;
+    case BMS_STATE_NORMAL:
+    case BMS_STATE_CHARGING:
+    case BMS_STATE_DISCHARGING:
+        for (uint8_t c = 0; c < 3; c++) {
+            if (currentStates[c] == target) {
+                state = run(state, INPUT_HEALTHY, currents[c], SETTLE_UPDATES);
+            }
+        }
+        break;
+    case BMS_STATE_FAULT_MODE:
+        state = run(state, INPUT_HEALTHY, 0.0f, SETTLE_UPDATES);
+        state = run(state, INPUT_MAJOR, 0.0f, 10);
+        break;
+    case BMS_STATE_SHUTDOWN:
+        state = run(state, INPUT_HEALTHY, 0.0f, SETTLE_UPDATES);
+        state = run(state, INPUT_CRITICAL, 0.0f, 10);
+        break;
+    default:
+        break;
+    }
+    CHECK(state == target);
+    return state;
+}
+
+// A lost sensor is left out of the statistics, whatever it last read, and trips the debounced
+// sensor-loss fault, which holds charge off until the sensor has answered for its clear window
+static void testTemperatureLost(void) {
+    float temperatures[PACK_NUM_TEMPERATURES];
+    uint8_t lost[PACK_NUM_TEMPERATURES] = {0};
+
+    reach(BMS_STATE_NORMAL);
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        temperatures[i] = 30.0f;
+    }
+    temperatures[0] = MAX_SAFE_TEMPERATURE + 20.0f;   // Garbage from a sensor that stopped answering
+    lost[0] = 1;
+    updateBatteryPackTemperatures(temperatures, lost);
+    CHECK(batteryPack.temperatureSensorsLost == 1);
+    CHECK(batteryPack.temperatureStats.max == 30.0f && batteryPack.temperatureStats.maxIndex != 0);
+
+    for (uint8_t i = 0; i < 49; i++) {
+        faultManagerEvaluate(&batteryPack);
+    }
+    CHECK(!faultManagerIsActive(FAULT_ID_TemperatureLost));
+    faultManagerEvaluate(&batteryPack);
+    CHECK(faultManagerIsActive(FAULT_ID_TemperatureLost));
+    CHECK(!faultManagerIsActive(FAULT_ID_Overtemperature));
+    CHECK(faultManagerGetDisabledPaths() == FAULT_PATH_CHARGE);
+
+    temperatures[0] = 30.0f;
+    lost[0] = 0;
+    updateBatteryPackTemperatures(temperatures, lost);
+    CHECK(batteryPack.temperatureSensorsLost == 0);
+    for (uint8_t i = 0; i < 100; i++) {
+        faultManagerEvaluate(&batteryPack);
+    }
+    CHECK(!faultManagerIsActive(FAULT_ID_TemperatureLost));
+}
+
+// The transition function alone, every state against every input class: worst severity,
+// whether the monitoring window has elapsed, and the current direction. Every transition
+// must follow 6.2, and every state must be reachable from IDLE.
+static void testTransitionTable(void) {
+    uint32_t violations = 0;
+    uint32_t reachable = 1UL << BMS_STATE_IDLE;
+
+    for (uint8_t state = 0; state < BMS_NUM_STATES; state++) {
+        for (uint8_t severity = FAULT_SEVERITY_NONE; severity <= FAULT_SEVERITY_CRITICAL; severity++) {
+            for (uint8_t monitored = 0; monitored < 2; monitored++) {
+                for (uint8_t c = 0; c < 3; c++) {
+                    BmsState next = faultManagerNextState((BmsState)state, (FaultSeverity)severity, monitored,
+                                                          currents[c]);
+                    uint8_t faultFree = severity < FAULT_SEVERITY_MAJOR;
+
+                    if (severity == FAULT_SEVERITY_CRITICAL && next != BMS_STATE_SHUTDOWN) {
+                        violations++;
+                    }
+                    if (severity == FAULT_SEVERITY_MAJOR && state != BMS_STATE_IDLE && next != BMS_STATE_FAULT_MODE) {
+                        violations++;
+                    }
+                    if (next == BMS_STATE_IDLE) {
+                        violations++;
+                    }
+                    if (state == BMS_STATE_IDLE && next != BMS_STATE_MONITORING && next != BMS_STATE_SHUTDOWN) {
+                        violations++;
+                    }
+                    // Paths only come back from an operating state or a completed monitoring window
+                    if (isOperating(next) &&
+                        (!faultFree || !(isOperating((BmsState)state) || (state == BMS_STATE_MONITORING && monitored)))) {
+                        violations++;
+                    }
+                    if (isOperating(next) && next != currentStates[c]) {
+                        violations++;
+                    }
+                    if (faultFree && (next == BMS_STATE_FAULT_MODE || next == BMS_STATE_SHUTDOWN)) {
+                        violations++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Closure over every input from IDLE
+    for (uint8_t pass = 0; pass < BMS_NUM_STATES; pass++) {
+        for (uint8_t state = 0; state < BMS_NUM_STATES; state++) {
+            if (!(reachable & (1UL << state))) {
+                continue;
+            }
+            for (uint8_t severity = FAULT_SEVERITY_NONE; severity <= FAULT_SEVERITY_CRITICAL; severity++) {
+                for (uint8_t monitored = 0; monitored < 2; monitored++) {
+                    for (uint8_t c = 0; c < 3; c++) {
+                        reachable |= 1UL << faultManagerNextState((BmsState)state, (FaultSeverity)severity,
+                                                                  monitored, currents[c]);
+                    }
+                }
+            }
+        }
+    }
+    CHECK(violations == 0);
+    CHECK(reachable == (1UL << BMS_NUM_STATES) - 1UL);
+}
+
+int main(void) {
+    uint32_t cases = 0;
+
+    hostRtosReset();
+    testTransitionTable();
+
+    for (uint8_t start = 0; start < BMS_NUM_STATES; start++) {
+        for (uint8_t input = 0; input < NUM_INPUTS; input++) {
+            for (uint8_t c = 0; c < 3; c++) {
+                BmsState state = reach((BmsState)start);
+                BmsState expected;
+
+                // A latched fault needs the clear command once its condition has been gone for its
+                // clear window; the command is taken on the next update
+                state = run(state, (Input)input, currents[c], CLEAR_UPDATES);
+                faultManagerClearLatched();
+                state = run(state, (Input)input, currents[c], SETTLE_UPDATES);
+
+                if (input == INPUT_CRITICAL) {
+                    expected = BMS_STATE_SHUTDOWN;
+                } else if (input == INPUT_MAJOR) {
+                    expected = BMS_STATE_FAULT_MODE;
+                } else {
+                    expected = currentStates[c];
+                }
+                CHECK(state == expected);
+                if (state != expected) {
+                    printf("  from %s, %s at %.1f A: %s\n", stateNames[start], inputNames[input],
+                           (double)currents[c], stateNames[state]);
+                }
+                cases++;
+            }
+        }
+    }
+    printf("%u cases of %u updates\n", (unsigned)cases, (unsigned)SETTLE_UPDATES);
+
+    testTemperatureLost();
+    return hostTestReport("testFaultManager");
+}
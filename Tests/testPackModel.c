@@ -0,0 +1,162 @@
+// packModel: the structure-of-arrays pack sized by packConfig.h, its voltage statistics and
+// pack totals against a plain pass over the cells, and the temperature statistics with lost
+// sensors left out and their indices mapped back. Built for the 6S ADC pack and the 144S AFE
+// pack; reports the balancing min/max search before and after the SoA layout.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "packModel.h"
+#include "cycleCounter.h"
+#include "arm_math.h"
+
+#define BENCHMARK_MAX_CELLS 144U
+
+// The search balanceCells() ran before the pack model: a scalar loop over padded cell structs
+typedef struct {
+    float voltage;
+    uint8_t channel;
+} LegacyCell;
+
+static BatteryPack pack;
+static uint32_t seed = 1313U;
+
+static float uniform(void) {
+    seed = seed * 1664525U + 1013904223U;
+    return (float)(seed >> 8) / 16777216.0f;
+}
+
+static void testLayout(void) {
+    pack.cellVoltages[PACK_NUM_CELLS - 1U] = 1.0f;
+    pack.current = 1.0f;
+    packModelInit(&pack);
+    CHECK(pack.cellVoltages[PACK_NUM_CELLS - 1U] == 0.0f && pack.current == 0.0f);
+
+    // Every per-cell array holds exactly the configured pack, back to back
+    CHECK(sizeof(pack.cellVoltages) == PACK_NUM_CELLS * sizeof(float));
+    CHECK(sizeof(pack.cellResistance) == PACK_NUM_CELLS * sizeof(float));
+    CHECK(sizeof(pack.balancing) == PACK_NUM_CELLS && sizeof(pack.cellFaults) == PACK_NUM_CELLS);
+    CHECK(sizeof(pack.temperatures) == PACK_NUM_TEMPERATURES * sizeof(float));
+    CHECK(PACK_CELL_SOURCE != PACK_CELL_SOURCE_AFE || PACK_NUM_CELLS == AFE_NUM_DEVICES * AFE_CELLS_PER_DEVICE);
+}
+
+static void testVoltageStatistics(void) {
+    double sum = 0.0;
+    uint32_t minIndex = 0;
+    uint32_t maxIndex = 0;
+
+    packModelInit(&pack);
+    for (uint32_t i = 0; i < PACK_NUM_CELLS; i++) {
+        pack.cellVoltages[i] = 3.5f + 0.6f * uniform();
+        sum += pack.cellVoltages[i];
+        minIndex = pack.cellVoltages[i] < pack.cellVoltages[minIndex] ? i : minIndex;
+        maxIndex = pack.cellVoltages[i] > pack.cellVoltages[maxIndex] ? i : maxIndex;
+    }
+    packModelUpdateVoltageStatistics(&pack);
+
+    CHECK(pack.voltageStats.minIndex == minIndex && pack.voltageStats.maxIndex == maxIndex);
+    CHECK(pack.voltageStats.min == pack.cellVoltages[minIndex]);
+    CHECK(pack.voltageStats.max == pack.cellVoltages[maxIndex]);
+    CHECK_NEAR(pack.totalVoltage, sum, sum * 1e-6);
+    CHECK_NEAR(pack.averageVoltage, sum / PACK_NUM_CELLS, 1e-5);
+}
+
+// A lost sensor keeps whatever it last read; here that is hotter and colder than any live one
+static void testTemperatureStatistics(void) {
+    uint32_t lost = 0;
+    float hottest = -INFINITY;
+    uint32_t hottestIndex = 0;
+
+    packModelInit(&pack);
+    for (uint32_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        pack.temperatureLost[i] = i % 3U == 1U;
+        pack.temperatures[i] = pack.temperatureLost[i] ? (i % 2U ? 150.0f : -60.0f) : 20.0f + 20.0f * uniform();
+        lost += pack.temperatureLost[i];
+        if (!pack.temperatureLost[i] && pack.temperatures[i] > hottest) {
+            hottest = pack.temperatures[i];
+            hottestIndex = i;
+        }
+    }
+    packModelUpdateTemperatureStatistics(&pack);
+
+    CHECK(pack.temperatureSensorsLost == lost);
+    CHECK(pack.temperatureStats.max == hottest && pack.temperature == hottest);
+    CHECK(pack.temperatureStats.maxIndex == hottestIndex);
+    CHECK(!pack.temperatureLost[pack.temperatureStats.minIndex]);
+    CHECK(pack.temperatureStats.min >= 20.0f);
+    CHECK(pack.temperatures[pack.temperatureStats.minIndex] == pack.temperatureStats.min);
+
+    // With every sensor lost the last statistics stand
+    PackStatistics previous = pack.temperatureStats;
+    for (uint32_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        pack.temperatureLost[i] = 1;
+        pack.temperatures[i] = 150.0f;
+    }
+    packModelUpdateTemperatureStatistics(&pack);
+    CHECK(pack.temperatureSensorsLost == PACK_NUM_TEMPERATURES);
+    CHECK(pack.temperatureStats.max == previous.max && pack.temperature == hottest);
+}
+
+static void legacyMinMax(const LegacyCell *cells, uint32_t count, float *minVoltage, float *maxVoltage) {
+    float maxValue = cells[0].voltage;
+    float minValue = cells[0].voltage;
+
+    for (uint32_t i = 1; i < count; i++) {
+        if (cells[i].voltage > maxValue) {
+            maxValue = cells[i].voltage;
+        }
+        if (cells[i].voltage < minValue) {
+            minValue = cells[i].voltage;
+        }
+    }
+    *minVoltage = minValue;
+    *maxVoltage = maxValue;
+}
+
+// The old and the CMSIS-DSP min/max search at each pack size, whatever PACK_NUM_CELLS is. A
+// spread of a few tens of millivolts, extremes away from either end of the array.
+static void reportMinMaxSearch(void) {
+    static const uint16_t cellCounts[] = {6, 96, BENCHMARK_MAX_CELLS};
+    static LegacyCell legacyCells[BENCHMARK_MAX_CELLS];
+    static float32_t voltages[BENCHMARK_MAX_CELLS];
+    volatile float sink;
+
+    for (uint32_t i = 0; i < BENCHMARK_MAX_CELLS; i++) {
+        voltages[i] = 3.7f + 0.001f * (float)((i * 37U) % 53U);
+        legacyCells[i].voltage = voltages[i];
+        legacyCells[i].channel = (uint8_t)i;
+    }
+
+    for (uint8_t size = 0; size < sizeof(cellCounts) / sizeof(cellCounts[0]); size++) {
+        uint32_t count = cellCounts[size];
+        float legacyMin;
+        float legacyMax;
+        float minVoltage;
+        float maxVoltage;
+        uint32_t index;
+
+        uint32_t start = cycleCounterNow();
+        legacyMinMax(legacyCells, count, &legacyMin, &legacyMax);
+        uint32_t scalarCycles = cycleCounterNow() - start;
+
+        start = cycleCounterNow();
+        arm_max_f32(voltages, count, &maxVoltage, &index);
+        arm_min_f32(voltages, count, &minVoltage, &index);
+        uint32_t vectorCycles = cycleCounterNow() - start;
+        sink = maxVoltage - minVoltage;
+
+        CHECK(minVoltage == legacyMin && maxVoltage == legacyMax);
+        printf("%3u cells: min/max search %u cycles over structs, %u over the SoA array (host clock)\n",
+               (unsigned)count, (unsigned)scalarCycles, (unsigned)vectorCycles);
+    }
+    (void)sink;
+}
+
+int main(void) {
+    hostRtosReset();
+    testLayout();
+    testVoltageStatistics();
+    testTemperatureStatistics();
+
+    reportMinMaxSearch();
+    printf("%u cells, %u temperature sensors\n", (unsigned)PACK_NUM_CELLS, (unsigned)PACK_NUM_TEMPERATURES);
+    return hostTestReport("testPackModel");
+}
@@ -0,0 +1,176 @@
+// packSnapshot under contention: one writer thread publishing as fast as it can, several
+// readers checking that every frame they get is whole and that a failed read leaves their
+// copy untouched; then a writer in a timer signal that preempts the reader mid-copy, the way
+// the safety task preempts the lower-priority readers on the target
+#include "hostTest.h"
+#include "packSnapshot.h"
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PUBLISHES 50000U
+#define READERS   8
+#define PREEMPTED_READS 500000U
+
+typedef struct {
+    uint32_t reads;
+    uint32_t failures;
+    uint32_t torn;          // Frames whose fields came from different publishes
+    uint32_t clobbered;     // Failed reads that still wrote the caller's copy
+    uint32_t regressions;   // Versions that went backwards
+} ReaderResult;
+
+static volatile uint32_t writerDone = 0;
+static ReaderResult results[READERS];
+static volatile uint32_t interruptPublishes = 0;
+static PackSnapshot sentinel;   // What a reader's copy holds before each read
+
+// Every field carries the publish number, so a mix of two frames shows up as a mismatch
+static void fill(PackSnapshot *snap, uint32_t n) {
+    float value = (float)(n & 0xFFFFU);
+
+    for (uint16_t i = 0; i < PACK_NUM_CELLS; i++) {
+        snap->pack.cellVoltages[i] = value;
+        snap->pack.cellResistance[i] = value;
+    }
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        snap->pack.temperatures[i] = value;
+    }
+    snap->timestamp = n;
+    snap->soc = value;
+}
+
+static uint8_t isWhole(const PackSnapshot *snap) {
+    float value = (float)(snap->timestamp & 0xFFFFU);
+
+    if (snap->soc != value || snap->version != snap->timestamp) {
+        return 0;
+    }
+    for (uint16_t i = 0; i < PACK_NUM_CELLS; i++) {
+        if (snap->pack.cellVoltages[i] != value || snap->pack.cellResistance[i] != value) {
+            return 0;
+        }
+    }
+    for (uint16_t i = 0; i < PACK_NUM_TEMPERATURES; i++) {
+        if (snap->pack.temperatures[i] != value) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void *writer(void *argument) {
+    static PackSnapshot snap;
+
+    (void)argument;
+    for (uint32_t n = 1; n <= PUBLISHES; n++) {
+        fill(&snap, n);
+        packSnapshotPublish(&snap);
+    }
+    __atomic_store_n(&writerDone, 1U, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void readOnce(ReaderResult *result, uint32_t *lastVersion) {
+    PackSnapshot snap = sentinel;
+
+    result->reads++;
+    if (!packSnapshotRead(&snap)) {
+        result->failures++;
+        result->clobbered += memcmp(&snap, &sentinel, sizeof(snap)) != 0;
+        return;
+    }
+    result->torn += !isWhole(&snap);
+    result->regressions += snap.version < *lastVersion;
+    *lastVersion = snap.version;
+}
+
+static void *reader(void *argument) {
+    uint32_t lastVersion = 0;
+
+    while (packSnapshotGetVersion() == 0) {
+    }
+    while (!__atomic_load_n(&writerDone, __ATOMIC_ACQUIRE)) {
+        readOnce(argument, &lastVersion);
+    }
+    return NULL;
+}
+
+// Two publishes per tick, so a read the tick lands in always sees its slot change
+static void publishFromInterrupt(int signal) {
+    static PackSnapshot snap;
+
+    (void)signal;
+    for (uint8_t i = 0; i < 2; i++) {
+        uint32_t n = packSnapshotGetVersion() + 1U;
+        fill(&snap, n);
+        packSnapshotPublish(&snap);
+        interruptPublishes++;
+    }
+}
+
+int main(void) {
+    static PackSnapshot snap;
+    PackSnapshotStats stats;
+    pthread_t writerThread;
+    pthread_t readerThreads[READERS];
+    uint32_t reads = 0;
+    uint32_t failures = 0;
+
+    // Nothing published yet: the read fails and leaves the copy alone
+    memset(&sentinel, 0xA5, sizeof(sentinel));
+    snap = sentinel;
+    CHECK(packSnapshotRead(&snap) == 0);
+    CHECK(memcmp(&snap, &sentinel, sizeof(snap)) == 0);
+
+    for (uint8_t i = 0; i < READERS; i++) {
+        CHECK(pthread_create(&readerThreads[i], NULL, reader, &results[i]) == 0);
+    }
+    CHECK(pthread_create(&writerThread, NULL, writer, NULL) == 0);
+    pthread_join(writerThread, NULL);
+    for (uint8_t i = 0; i < READERS; i++) {
+        pthread_join(readerThreads[i], NULL);
+        CHECK(results[i].torn == 0);
+        CHECK(results[i].clobbered == 0);
+        CHECK(results[i].regressions == 0);
+        reads += results[i].reads;
+        failures += results[i].failures;
+    }
+
+    // The newest frame once the writer has stopped
+    CHECK(packSnapshotRead(&snap) == 1);
+    CHECK(snap.version == PUBLISHES && isWhole(&snap));
+    CHECK(packSnapshotGetVersion() == PUBLISHES);
+
+    packSnapshotGetStats(&stats);
+    CHECK(stats.publishes == PUBLISHES);
+    CHECK(stats.readFailures == failures);
+    printf("%u publishes, %u reads by %u readers: %u retries, %u failed reads\n", (unsigned)PUBLISHES,
+           (unsigned)reads, (unsigned)READERS, (unsigned)stats.readRetries, (unsigned)failures);
+
+    // Writer preempting the reader
+    ReaderResult preempted = {0};
+    uint32_t lastVersion = 0;
+    uint32_t retriesBefore = stats.readRetries;
+    struct itimerval tick = { { 0, 20 }, { 0, 20 } };
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+
+    signal(SIGALRM, publishFromInterrupt);
+    setitimer(ITIMER_REAL, &tick, NULL);
+    for (uint32_t i = 0; i < PREEMPTED_READS; i++) {
+        readOnce(&preempted, &lastVersion);
+    }
+    setitimer(ITIMER_REAL, &off, NULL);
+    signal(SIGALRM, SIG_DFL);
+
+    packSnapshotGetStats(&stats);
+    CHECK(preempted.torn == 0);
+    CHECK(preempted.clobbered == 0);
+    CHECK(preempted.regressions == 0);
+    CHECK(interruptPublishes > 0);
+    printf("%u publishes from the timer over %u reads: %u retries, %u failed reads\n",
+           (unsigned)interruptPublishes, (unsigned)PREEMPTED_READS,
+           (unsigned)(stats.readRetries - retriesBefore), (unsigned)preempted.failures);
+    return hostTestReport("testPackSnapshot");
+}
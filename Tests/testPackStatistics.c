@@ -0,0 +1,130 @@
+// packStatistics: every field of packStatisticsCompute against a double-precision pass over
+// the same cells, at every pack size up to 144 and with ties at the extremes, then the
+// benchmark against the separate scalar loops
+#include "hostTest.h"
+#include "hostStub.h"
+#include "packStatistics.h"
+#include "cycleCounter.h"
+
+#define MAX_CELLS 144U
+
+static float voltages[MAX_CELLS];
+static uint32_t seed = 2024U;
+
+static float randomVoltage(void) {
+    seed = seed * 1664525U + 1013904223U;
+    return 3.0f + 1.2f * (float)(seed >> 8) / 16777216.0f;
+}
+
+// The first cell at an extreme is the one reported, as a scalar scan would find it
+static void checkAgainstReference(const float *values, uint32_t count) {
+    PackStatistics stats;
+    uint32_t minIndex = 0;
+    uint32_t maxIndex = 0;
+    double sum = 0.0;
+    double squares = 0.0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        minIndex = values[i] < values[minIndex] ? i : minIndex;
+        maxIndex = values[i] > values[maxIndex] ? i : maxIndex;
+        sum += values[i];
+    }
+    double mean = sum / count;
+    for (uint32_t i = 0; i < count; i++) {
+        squares += (values[i] - mean) * (values[i] - mean);
+    }
+    double stdDev = count > 1U ? sqrt(squares / (count - 1U)) : 0.0;
+
+    packStatisticsCompute(values, count, &stats);
+    CHECK(stats.minIndex == minIndex && stats.maxIndex == maxIndex);
+    CHECK(stats.min == values[minIndex] && stats.max == values[maxIndex]);
+    CHECK_NEAR(stats.spread, values[maxIndex] - values[minIndex], 1e-6);
+    CHECK_NEAR(stats.mean, mean, 1e-5);
+    CHECK_NEAR(stats.stdDev, stdDev, 1e-4);
+}
+
+// What the pack did per acquisition before this stage: balancing searched for the maximum
+// and the minimum, safety walked every cell against its limits, and the mean was its own pass
+static uint32_t legacyPasses(const float *values, uint32_t count, float *spread) {
+    float maxValue = values[0];
+    float minValue = values[0];
+    float sum = 0.0f;
+    uint32_t outOfLimits = 0;
+
+    for (uint32_t i = 1; i < count; i++) {
+        if (values[i] > maxValue) {
+            maxValue = values[i];
+        }
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        if (values[i] < minValue) {
+            minValue = values[i];
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (values[i] > 4.2f || values[i] < 3.0f) {   // MAX_/MIN_CELL_VOLTAGE
+            outOfLimits++;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    *spread = (maxValue - minValue) + sum / count;
+    return outOfLimits;
+}
+
+// Both at each pack size; the kernels also deliver the indices and the deviation
+static void reportBenchmark(void) {
+    static const uint16_t cellCounts[] = {6, 96, MAX_CELLS};
+    volatile float sink;
+    PackStatistics stats;
+
+    for (uint32_t i = 0; i < MAX_CELLS; i++) {
+        voltages[i] = 3.7f + 0.001f * (float)((i * 37U) % 53U);
+    }
+
+    for (uint8_t size = 0; size < sizeof(cellCounts) / sizeof(cellCounts[0]); size++) {
+        uint32_t count = cellCounts[size];
+        float spread;
+
+        uint32_t start = cycleCounterNow();
+        sink = (float)legacyPasses(voltages, count, &spread);
+        uint32_t loopCycles = cycleCounterNow() - start;
+        sink = spread;
+
+        start = cycleCounterNow();
+        packStatisticsCompute(voltages, count, &stats);
+        uint32_t kernelCycles = cycleCounterNow() - start;
+        sink = stats.spread + stats.stdDev;
+
+        printf("%3u cells: separate loops %5u cycles, kernels %5u cycles (host clock)\n",
+               (unsigned)count, (unsigned)loopCycles, (unsigned)kernelCycles);
+    }
+    (void)sink;
+}
+
+int main(void) {
+    hostRtosReset();
+    for (uint32_t count = 1; count <= MAX_CELLS; count++) {
+        for (uint32_t i = 0; i < count; i++) {
+            voltages[i] = randomVoltage();
+        }
+        checkAgainstReference(voltages, count);
+    }
+
+    // Several cells sharing the extremes, including the first and the last
+    for (uint32_t i = 0; i < MAX_CELLS; i++) {
+        voltages[i] = (i % 3U == 0) ? 3.5f : ((i % 3U == 1) ? 3.9f : 3.7f);
+    }
+    voltages[MAX_CELLS - 1U] = 3.5f;
+    checkAgainstReference(voltages, MAX_CELLS);
+
+    // A balanced pack: no spread, no deviation
+    for (uint32_t i = 0; i < MAX_CELLS; i++) {
+        voltages[i] = 3.7f;
+    }
+    checkAgainstReference(voltages, MAX_CELLS);
+
+    reportBenchmark();
+    return hostTestReport("testPackStatistics");
+}
@@ -0,0 +1,128 @@
+// samplingScheduler: TIM8 programming across the 1 Hz-10 kHz range, then the block timing
+// under load. TIM8 paces the blocks exactly; the DMA interrupt that timestamps them is held
+// off by a random amount, as critical sections and higher-priority interrupts would. The
+// jitter histogram must show only that latency, the period must not drift, and the
+// subscriber must be woken with every block, or with the newest one when it falls behind.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "samplingScheduler.h"
+
+#define BLOCKS            2000U
+#define MAX_LATENCY_US    20U
+#define CYCLES_PER_US     (HOST_CORE_CLOCK_HZ / 1000000U)
+
+static uint32_t latencyState = 99U;
+
+static uint32_t latencyCycles(void) {
+    latencyState = latencyState * 1664525U + 1013904223U;
+    return (latencyState >> 8) % (MAX_LATENCY_US * CYCLES_PER_US + 1U);
+}
+
+// The timer and sweep grouping give the requested rate, and the nominal period the
+// histogram measures against matches them
+static void testRates(void) {
+    static const uint32_t rates[] = { SAMPLING_MIN_RATE_HZ, 10, 100, 333, SAMPLING_DEFAULT_RATE_HZ, 2500,
+                                      SAMPLING_MAX_RATE_HZ };
+
+    CHECK(samplingSchedulerInit(SAMPLING_MIN_RATE_HZ - 1U) == HAL_ERROR);
+    CHECK(samplingSchedulerInit(SAMPLING_MAX_RATE_HZ + 1U) == HAL_ERROR);
+
+    for (uint32_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        CHECK(samplingSchedulerInit(rates[i]) == HAL_OK);
+        CHECK(samplingSchedulerStart() == HAL_OK);
+
+        double timerHz = (double)HOST_CORE_CLOCK_HZ / ((htim8.Init.Prescaler + 1.0) * (htim8.Init.Period + 1.0));
+        uint32_t sweeps = hostAdcDmaLength / (2U * ADC_ACQ_NUM_RANKS);
+        uint32_t expectedSweeps = rates[i] / SAMPLING_TARGET_BLOCK_RATE_HZ;
+
+        expectedSweeps = expectedSweeps == 0 ? 1 : expectedSweeps;
+        CHECK(htim8.Init.Period <= 0xFFFFU && htim8.Init.Prescaler <= 0xFFFFU);
+        CHECK(fabs(timerHz - rates[i]) < rates[i] * 1e-4);
+        CHECK(samplingSchedulerGetRate() == rates[i]);
+        CHECK(sweeps == expectedSweeps);
+        CHECK_NEAR(samplingSchedulerGetBlockPeriodCycles(), HOST_CORE_CLOCK_HZ / timerHz * sweeps, 1.0);
+        CHECK(TIM8->CR1 & 1U);
+
+        samplingSchedulerStop();
+        CHECK(!(TIM8->CR1 & 1U));
+    }
+}
+
+// Every block becomes due one nominal period after the last; its interrupt runs late by up to
+// MAX_LATENCY_US. Moves the cycle counter there and completes the DMA half.
+static void completeBlock(uint32_t index, uint32_t start, uint32_t period) {
+    uint32_t due = start + index * period + latencyCycles();
+
+    hostCyclesAdvance(due - DWT->CYCCNT);
+    if (index % 2U == 0) {
+        HAL_ADC_ConvHalfCpltCallback(&hadc1);
+    } else {
+        HAL_ADC_ConvCpltCallback(&hadc1);
+    }
+}
+
+static void testTimingUnderLoad(void) {
+    JitterHistogram histogram;
+    AdcBlock block;
+    uint32_t period;
+    uint32_t start;
+    uint32_t firstTimestamp = 0;
+    uint32_t lastTimestamp = 0;
+    uint32_t missed = 0;
+    uint32_t binned = 0;
+
+    CHECK(samplingSchedulerInit(SAMPLING_DEFAULT_RATE_HZ) == HAL_OK);
+    samplingSchedulerSubscribe(xTaskGetCurrentTaskHandle());
+    CHECK(samplingSchedulerStart() == HAL_OK);
+    period = samplingSchedulerGetBlockPeriodCycles();
+    start = DWT->CYCCNT;
+
+    // A consumer that keeps up sees every block in order
+    for (uint32_t i = 0; i < BLOCKS; i++) {
+        completeBlock(i, start, period);
+        if (!samplingSchedulerWaitBlock(&block, 0) || block.sequence != i + 1U) {
+            missed++;
+        }
+        firstTimestamp = i == 0 ? block.timestamp : firstTimestamp;
+        lastTimestamp = block.timestamp;
+        adcAcquisitionReleaseBlock(&block);
+    }
+    CHECK(missed == 0);
+
+    // Hardware pacing: the last block is on time however late the interrupts ran
+    int64_t drift = (int64_t)(uint32_t)(lastTimestamp - firstTimestamp) - (int64_t)(BLOCKS - 1U) * period;
+    CHECK(drift >= -(int64_t)(MAX_LATENCY_US * CYCLES_PER_US) && drift <= (int64_t)(MAX_LATENCY_US * CYCLES_PER_US));
+
+    samplingSchedulerGetJitterHistogram(&histogram);
+    for (uint32_t bin = 0; bin < SAMPLING_JITTER_BINS; bin++) {
+        binned += histogram.bins[bin];
+    }
+    CHECK(histogram.samples == BLOCKS - 1U && binned == histogram.samples);
+    CHECK(histogram.minJitterUs >= -(int32_t)MAX_LATENCY_US && histogram.maxJitterUs <= (int32_t)MAX_LATENCY_US);
+    CHECK(histogram.bins[0] == 0 && histogram.bins[SAMPLING_JITTER_BINS - 1] == 0);
+    printf("%u blocks at %u Hz: jitter %d..%d us, drift %.1f us\n", (unsigned)BLOCKS,
+           (unsigned)SAMPLING_DEFAULT_RATE_HZ, (int)histogram.minJitterUs, (int)histogram.maxJitterUs,
+           (double)drift / CYCLES_PER_US);
+
+    // A consumer held up for three blocks wakes once, with the newest
+    for (uint32_t i = BLOCKS; i < BLOCKS + 3U; i++) {
+        completeBlock(i, start, period);
+    }
+    CHECK(samplingSchedulerWaitBlock(&block, 0) && block.sequence == BLOCKS + 3U);
+    CHECK(!samplingSchedulerWaitBlock(&block, 0));
+
+    samplingSchedulerResetJitterHistogram();
+    samplingSchedulerGetJitterHistogram(&histogram);
+    CHECK(histogram.samples == 0 && histogram.bins[SAMPLING_JITTER_BINS / 2] == 0);
+    samplingSchedulerStop();
+}
+
+int main(void) {
+    hostRtosReset();
+    hostCyclesSetManual(1);
+    CHECK(adcAcquisitionInit() == HAL_OK);
+
+    testRates();
+    testTimingUnderLoad();
+    return hostTestReport("testSamplingScheduler");
+}
@@ -0,0 +1,116 @@
+// signalPath: raw ADC blocks to calibrated millivolts/milliamps against the exact conversion,
+// at every code on every channel, with the block mean keeping its fraction and a signed offset
+// carried through. Built once for the float path and once for the fixed-point path, each
+// reporting its worst error and the cycles one full block costs.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "signalPath.h"
+
+#define SWEEPS            ADC_ACQ_MAX_SWEEPS_PER_BLOCK
+#define MAX_ERROR_MILLI   1.0     // Fixed path truncates to whole milli units
+#define SHUNT_SCALE_MILLI 200000  // -100 A .. +100 A over the ADC range
+
+static uint16_t samples[ADC_ACQ_NUM_CHANNELS * SWEEPS];
+
+// The thermistor ranks stay in codes; signalPathInit only calibrates cells and currents
+static uint32_t fullScale(uint8_t channel) {
+    if (channel % 2U == 1U) {
+        return SIGNAL_CURRENT_FULL_SCALE_MILLI;
+    }
+    return channel < ADC_ACQ_RANK_CHANNEL(ADC_ACQ_NUM_CELL_CHANNELS) ? SIGNAL_CELL_FULL_SCALE_MILLI : 0;
+}
+
+// Each channel gets its own code, offset so neighbouring channels never read the same
+static void fillBlock(uint32_t code, uint32_t nextCode) {
+    for (uint32_t sweep = 0; sweep < SWEEPS; sweep++) {
+        for (uint8_t channel = 0; channel < ADC_ACQ_NUM_CHANNELS; channel++) {
+            uint32_t value = ((sweep % 2U == 0 ? code : nextCode) + 293U * channel) % 4096U;
+            samples[sweep * ADC_ACQ_NUM_CHANNELS + channel] = (uint16_t)value;
+        }
+    }
+}
+
+// Every code through the default calibration; alternate sweeps one code apart so the exact
+// mean sits halfway between two codes
+static double testDefaultCalibration(void) {
+    AdcBlock block = { samples, 0, 0, SWEEPS };
+    signal_t out[ADC_ACQ_NUM_CHANNELS];
+    double worst = 0.0;
+
+    signalPathInit();
+    for (uint32_t code = 0; code < 4096U; code++) {
+        for (uint32_t step = 0; step < 2U; step++) {
+            fillBlock(code, code + step);
+            signalConvertBlock(&block, out);
+            for (uint8_t channel = 0; channel < ADC_ACQ_NUM_CHANNELS; channel++) {
+                uint32_t first = (code + 293U * channel) % 4096U;
+                uint32_t second = (code + step + 293U * channel) % 4096U;
+                double expected = (first + second) * 0.5 * fullScale(channel) / 4096.0;
+                double error = fabs(SIGNAL_TO_FLOAT(out[channel]) * 1000.0 - expected);
+
+                worst = error > worst ? error : worst;
+            }
+        }
+    }
+    CHECK(worst < MAX_ERROR_MILLI);
+    return worst;
+}
+
+// A bidirectional shunt: mid scale is zero and the bottom codes are negative
+static void testOffset(void) {
+    uint8_t channel = ADC_ACQ_CURRENT_CHANNEL(0);
+
+    signalPathSetCalibration(channel, SHUNT_SCALE_MILLI, -SHUNT_SCALE_MILLI / 2);
+    for (uint32_t code = 0; code < 4096U; code += 15U) {
+#if BMS_FIXED_POINT
+        signal_t value = signalCalibrate(channel, (q31_t)code << SIGNAL_CODE_FRACTION_BITS);
+#else
+        signal_t value = signalCalibrate(channel, (float32_t)code);
+#endif
+        double expected = code * (double)SHUNT_SCALE_MILLI / 4096.0 - SHUNT_SCALE_MILLI / 2;
+
+        CHECK_NEAR(SIGNAL_TO_FLOAT(value) * 1000.0, expected, MAX_ERROR_MILLI);
+    }
+    CHECK(SIGNAL_TO_FLOAT(signalCalibrate(channel, 0)) < -99.99f);
+
+    // A whole vector in one call matches value by value
+    signal_t codes[SWEEPS];
+    signal_t values[SWEEPS];
+    for (uint32_t i = 0; i < SWEEPS; i++) {
+#if BMS_FIXED_POINT
+        codes[i] = (q31_t)(i * 41U % 4096U) << SIGNAL_CODE_FRACTION_BITS;
+#else
+        codes[i] = (float32_t)(i * 41U % 4096U);
+#endif
+    }
+    signalCalibrateBlock(channel, codes, values, SWEEPS);
+    for (uint32_t i = 0; i < SWEEPS; i++) {
+        CHECK(values[i] == signalCalibrate(channel, codes[i]));
+    }
+
+    // Out-of-range channels are ignored
+    signalPathSetCalibration(ADC_ACQ_NUM_CHANNELS, 1, 0);
+    signalPathInit();
+}
+
+int main(void) {
+    AdcBlock block = { samples, 0, 0, SWEEPS };
+    signal_t out[ADC_ACQ_NUM_CHANNELS];
+    SignalPathStats stats;
+
+    hostRtosReset();
+    double worst = testDefaultCalibration();
+    testOffset();
+
+    signalPathGetStats(&stats);
+    CHECK(stats.conversions == 2U * 4096U);
+    CHECK(stats.worstConvertCycles >= stats.lastConvertCycles);
+
+    fillBlock(1000U, 1001U);
+    signalConvertBlock(&block, out);
+    signalPathGetStats(&stats);
+    printf("%s path: worst error %.3f milli units, %u cycles for %u channels x %u sweeps (host clock)\n",
+           BMS_FIXED_POINT ? "fixed-point" : "float", worst, (unsigned)stats.lastConvertCycles,
+           (unsigned)ADC_ACQ_NUM_CHANNELS, (unsigned)SWEEPS);
+    return hostTestReport("testSignalPath");
+}
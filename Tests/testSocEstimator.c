@@ -0,0 +1,128 @@
+// socEstimator: the per-cell EKF replaying a current trace against simulated cells of known
+// SoC and capacity, at the 100 Hz block rate. The cells start off a load with their RC pair
+// still charged, so the filter is seeded low and has to pull in. Reports the SoC error, how
+// SoH follows the cells' capacities, and the cycles one update of every cell costs. Built for
+// the 6S scalar path and the 144S CMSIS-DSP matrix path.
+//
+// The cells are synthetic: the same 1-RC model and OCV curve the EKF assumes, differing only
+// in capacity, SoC and measurement noise, so this checks convergence and tracking, not model
+// error against a real cell. The trace, played nine times, is a CSV of piecewise-constant
+// segments (duration_s,current_a); traces/driveCycle.csv unless one is given.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "socEstimator.h"
+#include "coulombCounter.h"
+
+#define STEP_S            0.01f
+#define START_SOC         80.0f
+#define START_CURRENT_A   10.0f     // Load the pack came off just before power-up
+#define NOISE_V           0.002f    // Peak-to-peak
+#define SETTLE_S          300.0f    // Error is judged after this
+#define MAX_SOC_ERROR     1.5f      // Percent
+#define TRACE_PASSES      9U
+#define MAX_STEPS         (NUM_CELLS > 6 ? 120000U : UINT32_MAX)   // The 144S matrix path stops after 20 min
+
+static float trueSoc[NUM_CELLS];
+static float truePolarization[NUM_CELLS];
+static float trueCapacityAs[NUM_CELLS];
+static float voltages[NUM_CELLS];
+static uint32_t noiseState = 4242U;
+
+static float noise(void) {
+    noiseState = noiseState * 1664525U + 1013904223U;
+    return ((float)(noiseState >> 8) / 16777216.0f - 0.5f) * NOISE_V;
+}
+
+// Advances the true cells by one step and samples their terminal voltages
+static void stepCells(float current, float rcDecay) {
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        trueSoc[i] -= current * STEP_S / trueCapacityAs[i] * 100.0f;
+        truePolarization[i] = rcDecay * truePolarization[i] + SOC_EKF_R1_OHM * (1.0f - rcDecay) * current;
+        voltages[i] = socToOcv(trueSoc[i], NULL) - truePolarization[i] - SOC_EKF_R0_OHM * current + noise();
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "traces/driveCycle.csv";
+    float rcDecay = expf(-STEP_S / (SOC_EKF_R1_OHM * SOC_EKF_C1_FARAD));
+    SocEstimatorStats stats;
+    CellEstimate estimate;
+    float seededError = 0.0f;
+    float worstError = 0.0f;
+    uint32_t steps = 0;
+    uint32_t segments = 0;
+    char line[128];
+
+    hostRtosReset();
+    socEstimatorInit();
+    CHECK(socEstimatorGetPackSoc() < 0.0f);
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        trueSoc[i] = START_SOC - 0.5f * (float)(i % 7U);
+        truePolarization[i] = SOC_EKF_R1_OHM * START_CURRENT_A;
+        trueCapacityAs[i] = COULOMB_CAPACITY_MAH * 3.6f * (1.0f - 0.01f * (float)(i % 5U));
+    }
+
+    for (uint32_t pass = 0; pass < TRACE_PASSES && steps < MAX_STEPS; pass++) {
+        FILE *trace = fopen(path, "r");
+
+        CHECK(trace != NULL);
+        if (trace == NULL) {
+            printf("  cannot open %s\n", path);
+            return hostTestReport("testSocEstimator");
+        }
+        while (steps < MAX_STEPS && fgets(line, sizeof(line), trace) != NULL) {
+            float duration;
+            float current;
+
+            if (line[0] == '#' || sscanf(line, "%f,%f", &duration, &current) != 2) {
+                continue;
+            }
+            for (uint32_t step = (uint32_t)lroundf(duration / STEP_S); step > 0 && steps < MAX_STEPS; step--, steps++) {
+                stepCells(current, rcDecay);
+                socEstimatorUpdate(voltages, current, STEP_S);
+
+                for (uint8_t i = 0; i < NUM_CELLS; i++) {
+                    socEstimatorGetCell(i, &estimate);
+                    float error = fabsf(estimate.soc - trueSoc[i]);
+
+                    if (steps == 0 && error > seededError) {
+                        seededError = error;
+                    } else if (steps * STEP_S >= SETTLE_S && error > worstError) {
+                        worstError = error;
+                    }
+                }
+            }
+            segments++;
+        }
+        fclose(trace);
+    }
+
+    float lowest = trueSoc[0];
+    for (uint32_t i = 1; i < NUM_CELLS; i++) {
+        lowest = fminf(lowest, trueSoc[i]);
+    }
+    socEstimatorGetStats(&stats);
+
+    CHECK(segments > 0);
+    CHECK(seededError > 3.0f * MAX_SOC_ERROR);
+    CHECK(worstError < MAX_SOC_ERROR);
+    CHECK(fabsf(socEstimatorGetPackSoc() - lowest) < MAX_SOC_ERROR);
+    CHECK(stats.updates == steps);
+    printf("%u cells, %s path, %s: %.0f s, seeded %.1f %% off, worst error after %.0f s %.2f %%\n",
+           (unsigned)NUM_CELLS, SOC_EKF_SCALAR_PATH ? "scalar" : "matrix", path, (double)(steps * STEP_S),
+           (double)seededError, (double)SETTLE_S, (double)worstError);
+
+    // Each full SoC window nudges SoH toward the cell's capacity, so the smallest cell ends
+    // lowest; the 20 min matrix run is too short to close one
+    CellEstimate full;
+
+    socEstimatorGetCell(0, &full);
+    socEstimatorGetCell(4, &estimate);
+    CHECK(estimate.soh > 95.0f && full.soh < 101.0f);
+    CHECK(MAX_STEPS != UINT32_MAX || estimate.soh < full.soh);
+    printf("SoH: %.1f %% for the full-capacity cell, %.1f %% for the 96 %% one\n", (double)full.soh,
+           (double)estimate.soh);
+    printf("one update of every cell: %u cycles, worst %u (host clock)\n", (unsigned)stats.lastUpdateCycles,
+           (unsigned)stats.worstUpdateCycles);
+    return hostTestReport("testSocEstimator");
+}
@@ -0,0 +1,168 @@
+// sopEstimator: the pack current limits against the cell model worked by hand. The weakest
+// cell sets each limit, the present load is backed out first, the derating map clamps the
+// result from both temperature extremes, and a disabled path or an unknown SoC reports zero.
+// Built for the 6S ADC pack and the 144S AFE pack; reports the cost of one update at each.
+#include "hostTest.h"
+#include "hostStub.h"
+#include "sopEstimator.h"
+#include "batteryManagement.h"
+#include "socEstimator.h"
+#include "faultManager.h"
+
+#define RESISTANCE 0.015f
+
+static BatteryPack pack;
+
+static void setPack(float voltage, float current, float coldest, float hottest) {
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        pack.cellResistance[i] = RESISTANCE;
+        pack.cellVoltages[i] = voltage - RESISTANCE * current;
+    }
+    pack.current = current;
+    pack.temperatureStats.min = coldest;
+    pack.temperatureStats.max = hottest;
+}
+
+// Current that takes a cell from ocv to limit through its DCIR plus the RC branch charged over
+// the window
+static double limitThrough(double ocv, double limit, double resistance, double seconds) {
+    double polarization = SOC_EKF_R1_OHM * (1.0 - exp(-seconds / (SOC_EKF_R1_OHM * SOC_EKF_C1_FARAD)));
+    double current = fabs(ocv - limit) / (resistance + polarization);
+
+    return ocv < limit ? 0.0 : current;
+}
+
+// Near empty at room temperature none of the ratings bind, so the cell model sets every limit
+static void testCellModel(void) {
+    double floorVoltage = MIN_CELL_VOLTAGE + SOP_VOLTAGE_MARGIN;
+    double ceilingVoltage = MAX_CELL_VOLTAGE - SOP_VOLTAGE_MARGIN;
+    SopLimits limits;
+
+    setPack(3.3f, 0.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.dischargeContinuous, limitThrough(3.3, floorVoltage, RESISTANCE, INFINITY), 0.01);
+    CHECK_NEAR(limits.dischargePeak, limitThrough(3.3, floorVoltage, RESISTANCE, SOP_PEAK_DURATION_S), 0.01);
+    CHECK(limits.dischargePeak > limits.dischargeContinuous);
+    CHECK_NEAR(limits.chargeContinuous, SOP_CHARGE_CONTINUOUS_A, 0.001);
+    CHECK_NEAR(limits.chargePeak, SOP_CHARGE_PEAK_A, 0.001);
+
+    // The same cells under a 10 A load: their terminal voltage sags, the OCV does not
+    SopLimits loaded;
+    setPack(3.3f, 10.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &loaded);
+    CHECK_NEAR(loaded.dischargeContinuous, limits.dischargeContinuous, 0.01);
+    CHECK_NEAR(loaded.dischargePeak, limits.dischargePeak, 0.01);
+
+    // Near full, charge is the cell-limited direction
+    setPack(4.1f, 0.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.chargeContinuous, limitThrough(ceilingVoltage, 4.1, RESISTANCE, INFINITY), 0.01);
+    CHECK_NEAR(limits.chargePeak, limitThrough(ceilingVoltage, 4.1, RESISTANCE, SOP_PEAK_DURATION_S), 0.01);
+
+    // One cell already past the ceiling: no charge at all
+    pack.cellVoltages[NUM_CELLS - 1U] = (float)ceilingVoltage + 0.01f;
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK(limits.chargeContinuous == 0.0f && limits.chargePeak == 0.0f);
+    CHECK(limits.dischargeContinuous > 0.0f);
+}
+
+// The series string shares one current, so the lowest cell or the one with the highest
+// resistance limits discharge for the whole pack
+static void testWeakestCell(void) {
+    double floorVoltage = MIN_CELL_VOLTAGE + SOP_VOLTAGE_MARGIN;
+    SopLimits limits;
+
+    setPack(3.3f, 0.0f, 25.0f, 25.0f);
+    pack.cellVoltages[1] = 3.2f;
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.dischargeContinuous, limitThrough(3.2, floorVoltage, RESISTANCE, INFINITY), 0.01);
+
+    setPack(3.3f, 0.0f, 25.0f, 25.0f);
+    pack.cellResistance[NUM_CELLS - 1U] = 2.0f * RESISTANCE;
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.dischargeContinuous, limitThrough(3.3, floorVoltage, 2.0 * RESISTANCE, INFINITY), 0.01);
+}
+
+// At mid charge the ratings bind, scaled by the map. Between nodes the map interpolates.
+static void testDerating(void) {
+    SopLimits limits;
+
+    setPack(3.8f, 0.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.dischargeContinuous, SOP_DISCHARGE_CONTINUOUS_A, 0.001);
+    CHECK_NEAR(limits.dischargePeak, SOP_DISCHARGE_PEAK_A, 0.001);
+
+    // 5 degC and 50 % SoC sit midway between the 0/10 degC and 40/60 % nodes
+    setPack(3.8f, 0.0f, 5.0f, 5.0f);
+    sopEstimatorUpdate(&pack, 50.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.dischargeContinuous, 0.80 * SOP_DISCHARGE_CONTINUOUS_A, 0.001);
+    CHECK_NEAR(limits.chargeContinuous, 0.30 * SOP_CHARGE_CONTINUOUS_A, 0.001);
+
+    // The coldest cell blocks charge even while another one is at room temperature
+    setPack(3.8f, 0.0f, -15.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK(limits.chargeContinuous == 0.0f && limits.chargePeak == 0.0f);
+    CHECK_NEAR(limits.dischargeContinuous, 0.40 * SOP_DISCHARGE_CONTINUOUS_A, 0.001);
+
+    // The hottest one stops everything at the top of the map, and past it
+    setPack(3.8f, 0.0f, 25.0f, 70.0f);
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_NONE, &limits);
+    CHECK(limits.dischargeContinuous < 0.01f && limits.chargeContinuous < 0.01f);
+
+    // Charge tapers near full; the last row is read from just inside it
+    setPack(3.8f, 0.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, 100.0f, FAULT_PATH_NONE, &limits);
+    CHECK_NEAR(limits.chargeContinuous, 0.10 * SOP_CHARGE_CONTINUOUS_A, 0.005);
+}
+
+static void testDisabled(void) {
+    SopLimits limits;
+
+    setPack(3.8f, 0.0f, 25.0f, 25.0f);
+    sopEstimatorUpdate(&pack, -1.0f, FAULT_PATH_NONE, &limits);
+    CHECK(limits.dischargeContinuous == 0.0f && limits.dischargePeak == 0.0f);
+    CHECK(limits.chargeContinuous == 0.0f && limits.chargePeak == 0.0f);
+
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_DISCHARGE, &limits);
+    CHECK(limits.dischargeContinuous == 0.0f && limits.dischargePeak == 0.0f);
+    CHECK(limits.chargeContinuous > 0.0f);
+
+    sopEstimatorUpdate(&pack, 60.0f, FAULT_PATH_CHARGE, &limits);
+    CHECK(limits.chargeContinuous == 0.0f && limits.chargePeak == 0.0f);
+    CHECK(limits.dischargeContinuous > 0.0f);
+}
+
+// One full update, cell walk plus four map lookups, over a pack with some spread in it
+static void reportUpdateCost(void) {
+    SopEstimatorStats stats;
+    SopLimits limits;
+
+    setPack(3.7f, 20.0f, 15.0f, 35.0f);
+    for (uint32_t i = 0; i < NUM_CELLS; i++) {
+        pack.cellVoltages[i] += 0.001f * (float)((i * 37U) % 53U);
+        pack.cellResistance[i] *= 1.0f + 0.01f * (float)((i * 13U) % 7U);
+    }
+    sopEstimatorUpdate(&pack, 55.0f, FAULT_PATH_NONE, &limits);
+    sopEstimatorGetStats(&stats);
+    CHECK(limits.dischargePeak > 0.0f);
+    printf("%3u cells: %u cycles per update (host clock)\n", (unsigned)NUM_CELLS, (unsigned)stats.lastUpdateCycles);
+}
+
+int main(void) {
+    SopEstimatorStats stats;
+
+    hostRtosReset();
+    sopEstimatorInit();
+    packModelInit(&pack);
+
+    testCellModel();
+    testWeakestCell();
+    testDerating();
+    testDisabled();
+
+    sopEstimatorGetStats(&stats);
+    CHECK(stats.updates == 14 && stats.worstUpdateCycles >= stats.lastUpdateCycles);
+
+    reportUpdateCost();
+    return hostTestReport("testSopEstimator");
+}
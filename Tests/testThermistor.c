@@ -0,0 +1,104 @@
+// thermistor: the generated table through arm_linear_interp_q15 against the exact beta
+// equation in double precision at every in-range code, the open/short handling, and the
+// cycles a 60-sensor conversion costs against logf
+#include "hostTest.h"
+#include "hostStub.h"
+#include "thermistor.h"
+#include "ntcTable.h"
+#include "cycleCounter.h"
+
+#define MAX_ERROR_C   0.05
+#define RATED_MIN_C   -40.0
+#define RATED_MAX_C   125.0
+#define BENCHMARK_SENSORS 60U   // A 144S pack with five NTCs per module
+
+static double betaCelsius(uint16_t code) {
+    double resistance = NTC_PULLUP_OHMS * code / (4096.0 - code);
+    double inverse = 1.0 / (NTC_NOMINAL_C + 273.15) + log(resistance / NTC_NOMINAL_OHMS) / NTC_BETA;
+    return 1.0 / inverse - 273.15;
+}
+
+// The table covers the rated range to MAX_ERROR_C and never rises with the code
+static void testAgainstBeta(void) {
+    double worstError = 0.0;
+    uint16_t worstCode = 0;
+    uint32_t rises = 0;
+    float previous = thermistorCodeToCelsius(NTC_SHORT_CODE);
+
+    // The limits are the rated range rounded to the nearest code
+    CHECK(betaCelsius(NTC_SHORT_CODE - 1) > RATED_MAX_C && betaCelsius(NTC_SHORT_CODE + 1) < RATED_MAX_C);
+    CHECK(betaCelsius(NTC_OPEN_CODE + 1) < RATED_MIN_C && betaCelsius(NTC_OPEN_CODE - 1) > RATED_MIN_C);
+
+    for (uint16_t code = NTC_SHORT_CODE; code <= NTC_OPEN_CODE; code++) {
+        float celsius = thermistorCodeToCelsius(code);
+        double error = fabs(celsius - betaCelsius(code));
+
+        if (error > worstError) {
+            worstError = error;
+            worstCode = code;
+        }
+        rises += celsius > previous;
+        previous = celsius;
+    }
+    CHECK(worstError < MAX_ERROR_C);
+    CHECK(rises == 0);
+    printf("codes %u-%u: worst error %.3f degC at code %u\n", (unsigned)NTC_SHORT_CODE, (unsigned)NTC_OPEN_CODE,
+           worstError, (unsigned)worstCode);
+}
+
+// A shorted sensor still reads hot and an open one cold, and both are counted
+static void testOutOfRange(void) {
+    const uint16_t codes[5] = { 0, NTC_SHORT_CODE - 1, 2048, NTC_OPEN_CODE + 1, 4095 };
+    float temperatures[5];
+
+    CHECK(thermistorConvert(codes, temperatures, 5) == 4);
+    CHECK(temperatures[0] > RATED_MAX_C && temperatures[1] > RATED_MAX_C);
+    CHECK_NEAR(temperatures[2], NTC_NOMINAL_C, MAX_ERROR_C);
+    CHECK(temperatures[3] < RATED_MIN_C && temperatures[4] < RATED_MIN_C);
+}
+
+// The per-sample path the table replaced: divider resistance, then 1/T = 1/T0 + ln(R/R0)/B
+static float equationToCelsius(uint16_t code) {
+    float resistance = NTC_PULLUP_OHMS * code / (4096.0f - code);
+    float inverse = 1.0f / (NTC_NOMINAL_C + 273.15f) + logf(resistance / NTC_NOMINAL_OHMS) / NTC_BETA;
+    return 1.0f / inverse - 273.15f;
+}
+
+// A spread of in-range codes through the table and through logf, each pass timed
+static void reportBenchmark(void) {
+    uint16_t codes[BENCHMARK_SENSORS];
+    float table[BENCHMARK_SENSORS];
+    float equation[BENCHMARK_SENSORS];
+    float maxError = 0.0f;
+
+    for (uint32_t i = 0; i < BENCHMARK_SENSORS; i++) {
+        codes[i] = (uint16_t)(NTC_SHORT_CODE + i * (NTC_OPEN_CODE - NTC_SHORT_CODE) / (BENCHMARK_SENSORS - 1U));
+    }
+
+    uint32_t start = cycleCounterNow();
+    thermistorConvert(codes, table, BENCHMARK_SENSORS);
+    uint32_t tableCycles = cycleCounterNow() - start;
+
+    start = cycleCounterNow();
+    for (uint32_t i = 0; i < BENCHMARK_SENSORS; i++) {
+        equation[i] = equationToCelsius(codes[i]);
+    }
+    uint32_t equationCycles = cycleCounterNow() - start;
+
+    for (uint32_t i = 0; i < BENCHMARK_SENSORS; i++) {
+        if (fabsf(table[i] - equation[i]) > maxError) {
+            maxError = fabsf(table[i] - equation[i]);
+        }
+    }
+    CHECK(maxError < MAX_ERROR_C);
+    printf("%u sensors: table %u cycles, logf %u cycles (host clock)\n", (unsigned)BENCHMARK_SENSORS,
+           (unsigned)tableCycles, (unsigned)equationCycles);
+}
+
+int main(void) {
+    hostRtosReset();
+    testAgainstBeta();
+    testOutOfRange();
+    reportBenchmark();
+    return hostTestReport("testThermistor");
+}
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""Generate the BMS telemetry DBC from Core/Inc/canTelemetryTable.h.
+
+usage: python3 Tools/generateDbc.py [--cells N] [output.dbc]   (default: 6 cells, Tools/bms.dbc)
+"""
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+TABLE = os.path.join(ROOT, "Core", "Inc", "canTelemetryTable.h")
+PACK_CONFIG = os.path.join(ROOT, "Core", "Inc", "packConfig.h")
+ADC_CONFIG = os.path.join(ROOT, "Core", "Inc", "adcAcquisition.h")
+MUX_SELECTOR = "TELEMETRY_MUX_SELECTOR"
+MUX_NONE = "TELEMETRY_MUX_NONE"
+MUX_EACH = "TELEMETRY_MUX_EACH"
+
+
+def macro_body(text, name):
+    """Return the joined body of a multi-line #define NAME(X)."""
+    match = re.search(r"#define\s+" + name + r"\(X\)((?:.*\\\n)*.*)", text)
+    if not match:
+        sys.exit("table macro %s not found in %s" % (name, TABLE))
+    return match.group(1).replace("\\\n", " ")
+
+
+def entries(body):
+    """Split 'X(a, b(c, d), e) X(...)' into argument lists, honouring nested parentheses."""
+    result = []
+    i = 0
+    while True:
+        i = body.find("X(", i)
+        if i < 0:
+            return result
+        i += 2
+        depth, args, current = 0, [], ""
+        while True:
+            ch = body[i]
+            i += 1
+            if ch == "(":
+                depth += 1
+            elif ch == ")":
+                if depth == 0:
+                    args.append(current.strip())
+                    break
+                depth -= 1
+            elif ch == "," and depth == 0:
+                args.append(current.strip())
+                current = ""
+                continue
+            current += ch
+        result.append(args)
+
+
+def frame_count(token, text, cells, temperatures):
+    """Resolve a frames column, expanding the table's own #defines with the pack's counts."""
+    defines = {name: re.sub(r"\s*//.*", "", value)
+               for name, value in re.findall(r"#define\s+(\w+)[ \t]+([^\n]+)", text.replace("\\\n", " "))}
+    defines["PACK_NUM_CELLS"] = str(cells)
+    defines["PACK_NUM_TEMPERATURES"] = str(temperatures)
+    for _ in range(len(defines)):
+        token = re.sub(r"[A-Za-z_]\w*", lambda m: "(%s)" % defines.get(m.group(0), m.group(0)), token)
+    if re.search(r"[A-Za-z_]", token):
+        sys.exit("cannot resolve frame count %s" % token)
+    return int(eval(token.replace("/", "//")))
+
+
+def pack_temperatures(cells):
+    """PACK_NUM_TEMPERATURES of the build with this many cells: the I2C sensors, then the NTCs on
+    the ADC scan (ADC build) or on every AFE (AFE build)."""
+    with open(PACK_CONFIG) as f:
+        config = f.read()
+    with open(ADC_CONFIG) as f:
+        adc = f.read()
+
+    def value(text, name):
+        return int(re.search(r"#define\s+%s\s+(\d+)" % name, text).group(1))
+
+    i2c = len(entries(macro_body(config, "PACK_TEMPERATURE_SENSORS")))
+    if cells == value(adc, "ADC_ACQ_NUM_CELL_CHANNELS"):
+        return i2c + value(adc, "ADC_ACQ_NUM_NTC_CHANNELS")
+    per_device = value(config, "AFE_CELLS_PER_DEVICE")
+    if cells % per_device != 0:
+        sys.exit("%d cells is neither the ADC build nor a whole number of AFEs" % cells)
+    return i2c + cells // per_device * value(config, "AFE_THERMISTORS_PER_DEVICE")
+
+
+def renumber(name, frame, per_frame):
+    """Name of a TELEMETRY_MUX_EACH signal in a later frame: Cell1_Voltage -> Cell4_Voltage."""
+    return re.sub(r"\d+", lambda m: str(int(m.group(0)) + per_frame * frame), name, count=1)
+
+
+def number(token):
+    return float(token.rstrip("fFuU"))
+
+
+def signal_range(length, signed, factor, offset):
+    if signed:
+        low, high = -(1 << (length - 1)), (1 << (length - 1)) - 1
+    else:
+        low, high = 0, (1 << length) - 1
+    return low * factor + offset, high * factor + offset
+
+
+def fmt(value):
+    return ("%.6f" % value).rstrip("0").rstrip(".")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the BMS telemetry DBC from %s." % os.path.relpath(TABLE, ROOT))
+    parser.add_argument("output", nargs="?", default=os.path.join(ROOT, "Tools", "bms.dbc"),
+                        help="DBC file to write (default: Tools/bms.dbc)")
+    parser.add_argument("--cells", type=int, default=6,
+                        help="PACK_NUM_CELLS of the build the DBC describes (default: 6, the ADC build)")
+    args = parser.parse_args()
+    output = args.output
+    with open(TABLE) as f:
+        text = f.read()
+
+    temperatures = pack_temperatures(args.cells)
+    messages = entries(macro_body(text, "TELEMETRY_MESSAGES"))
+    signals = entries(macro_body(text, "TELEMETRY_SIGNALS"))
+
+    lines = [
+        'VERSION ""',
+        "",
+        "NS_ :",
+        "",
+        "BS_:",
+        "",
+        "BU_: BMS",
+        "",
+    ]
+    cycle_times = []
+    for name, msg_id, dlc, frames, period, _priority in messages:
+        can_id = int(msg_id, 0)
+        frames = frame_count(frames, text, args.cells, temperatures)
+        lines.append("BO_ %d %s: %s BMS" % (can_id, name, dlc))
+        own = [sig for sig in signals if sig[0] == name]
+        each = [sig for sig in own if sig[2] == MUX_EACH]
+        # One copy of every TELEMETRY_MUX_EACH signal per frame, in frame order
+        expanded = [(sig, sig[1], sig[2]) for sig in own if sig[2] != MUX_EACH]
+        for frame in range(frames if each else 0):
+            expanded += [(sig, renumber(sig[1], frame, len(each)), str(frame)) for sig in each]
+        for sig, sig_name, mux in expanded:
+            _message, _name, _mux, start, length, signed, factor, offset, unit, _source = sig
+            length, signed = int(length), int(signed) != 0
+            factor, offset = number(factor), number(offset)
+            if mux == MUX_SELECTOR:
+                mux_text = " M"
+            elif mux == MUX_NONE:
+                mux_text = ""
+            else:
+                mux_text = " m%d" % int(mux)
+            low, high = signal_range(length, signed, factor, offset)
+            lines.append(' SG_ %s%s : %d|%d@1%s (%s,%s) [%s|%s] %s Vector__XXX' % (
+                sig_name, mux_text, int(start), length, "-" if signed else "+",
+                fmt(factor), fmt(offset), fmt(low), fmt(high), unit))
+        lines.append("")
+        cycle_times.append((can_id, int(period)))
+
+    lines.append('BA_DEF_ BO_ "GenMsgCycleTime" INT 0 65535;')
+    lines.append('BA_DEF_DEF_ "GenMsgCycleTime" 0;')
+    for can_id, period in cycle_times:
+        lines.append('BA_ "GenMsgCycleTime" BO_ %d %d;' % (can_id, period))
+    lines.append("")
+
+    with open(output, "w") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Generate Core/Inc/ntcTable.h, the thermistor code-to-temperature lookup table.
+
+usage: python3 Tools/generateNtcTable.py [output.h]   (default: Core/Inc/ntcTable.h)
+
+The divider is a pull-up to the ADC reference with the NTC to ground, so a 12-bit ratio
+code c gives R = R_PULLUP * c / (4096 - c). The table holds the beta-equation temperature
+at every STEP codes in Q15 (full scale +/-FULL_SCALE_C). After writing it, the table is
+run through the same integer arithmetic as arm_linear_interp_q15 for every code in the
+rated range and compared with the exact equation; the script fails if the error is too big.
+"""
+import argparse
+import math
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OUTPUT = os.path.join(ROOT, "Core", "Inc", "ntcTable.h")
+
+R0 = 10000.0            # Ohms at T0
+T0_C = 25.0
+BETA = 3435.0           # B25/85
+R_PULLUP = 10000.0
+CODES = 4096
+STEP = 16               # Codes per table interval; a power of two so the index is a shift
+FULL_SCALE_C = 256.0    # Q15 full scale
+RATED_MIN_C = -40.0     # Sensor rating; outside it a reading is treated as an open or short
+RATED_MAX_C = 125.0
+MAX_ERROR_C = 0.05      # Interpolation error budget inside the rated range
+KELVIN = 273.15
+
+
+def resistance(code):
+    if code <= 0:
+        return 0.0
+    if code >= CODES:
+        return math.inf
+    return R_PULLUP * code / (CODES - code)
+
+
+def celsius(code):
+    r = resistance(code)
+    if r == 0.0:
+        return math.inf
+    if r == math.inf:
+        return -math.inf
+    return 1.0 / (1.0 / (T0_C + KELVIN) + math.log(r / R0) / BETA) - KELVIN
+
+
+def code_for(temperature_c):
+    """Inverse of celsius(): the ratio code a given temperature produces."""
+    r = R0 * math.exp(BETA * (1.0 / (temperature_c + KELVIN) - 1.0 / (T0_C + KELVIN)))
+    return CODES * r / (r + R_PULLUP)
+
+
+def to_q15(temperature_c):
+    value = int(round(temperature_c / FULL_SCALE_C * 32768.0))
+    return max(-32768, min(32767, value))
+
+
+def interpolate_q15(table, code):
+    """Bit-exact model of arm_linear_interp_q15 with x = code in 12.20 scaled by STEP."""
+    x = code << (20 - STEP.bit_length() + 1)
+    index = x >> 20
+    if index >= len(table) - 1:
+        return table[-1]
+    fract = x & 0xFFFFF
+    y = table[index] * (0xFFFFF - fract) + table[index + 1] * fract
+    return y >> 20
+
+
+def define(name, value, comment=None):
+    text = "#define %-24s %s" % (name, value)
+    return "%-40s// %s" % (text, comment) if comment else text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the NTC lookup table header.")
+    parser.add_argument("output", nargs="?", default=OUTPUT, help="header to write (default: Core/Inc/ntcTable.h)")
+    output = parser.parse_args().output
+    entries = CODES // STEP + 1
+    table = [to_q15(max(-FULL_SCALE_C, min(FULL_SCALE_C, celsius(i * STEP)))) for i in range(entries)]
+
+    # Higher code is colder: the short threshold sits at the hot end, the open one at the cold end
+    short_code = int(math.floor(code_for(RATED_MAX_C)))
+    open_code = int(math.ceil(code_for(RATED_MIN_C)))
+
+    worst, worst_code = 0.0, 0
+    for code in range(short_code, open_code + 1):
+        error = abs(interpolate_q15(table, code) * FULL_SCALE_C / 32768.0 - celsius(code))
+        if error > worst:
+            worst, worst_code = error, code
+
+    lines = [
+        "#ifndef NTC_TABLE_H",
+        "#define NTC_TABLE_H",
+        "",
+        "// Generated by Tools/generateNtcTable.py; edit the parameters there and regenerate.",
+        "// %.0f ohm / B%.0f NTC to ground, %.0f ohm pull-up to the ADC reference." % (R0, BETA, R_PULLUP),
+        "// Worst interpolation error %.3f degC (code %d) between %.0f and %.0f degC." % (
+            worst, worst_code, RATED_MIN_C, RATED_MAX_C),
+        "",
+        '#include "arm_math.h"',
+        "",
+        define("NTC_TABLE_ENTRIES", "%d" % entries),
+        define("NTC_TABLE_STEP_SHIFT", "%d" % (STEP.bit_length() - 1), "Codes per interval = 1 << shift"),
+        define("NTC_TABLE_FULL_SCALE_C", "%.1ff" % FULL_SCALE_C, "Q15 1.0 in degC"),
+        define("NTC_SHORT_CODE", "%d" % short_code, "Below this the sensor reads hotter than %.0f degC" % RATED_MAX_C),
+        define("NTC_OPEN_CODE", "%d" % open_code, "Above this it reads colder than %.0f degC" % RATED_MIN_C),
+        "",
+        "// Divider and beta-equation parameters, for the on-target cross-check against logf",
+        define("NTC_NOMINAL_OHMS", "%.1ff" % R0),
+        define("NTC_NOMINAL_C", "%.1ff" % T0_C),
+        define("NTC_BETA", "%.1ff" % BETA),
+        define("NTC_PULLUP_OHMS", "%.1ff" % R_PULLUP),
+        "",
+        "static const q15_t ntcTemperatureTable[NTC_TABLE_ENTRIES] = {",
+    ]
+    for row in range(0, entries, 8):
+        lines.append("    " + " ".join("%6d," % value for value in table[row:row + 8]))
+    lines += ["};", "", "#endif /* NTC_TABLE_H */", ""]
+
+    with open(output, "w") as f:
+        f.write("\n".join(lines))
+
+    print("worst error %.4f degC at code %d" % (worst, worst_code))
+    if worst > MAX_ERROR_C:
+        sys.exit("interpolation error %.3f degC exceeds %.3f degC; lower STEP" % (worst, MAX_ERROR_C))
+
+
+if __name__ == "__main__":
+    main()